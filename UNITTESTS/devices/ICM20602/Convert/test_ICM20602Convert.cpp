@@ -0,0 +1,128 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "icm20602_convert.h"
+
+#include <stdint.h>
+
+class TestICM20602Convert : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    icm20602_sample_t raw_sample(int16_t ax, int16_t ay, int16_t az, int16_t t,
+            int16_t gx, int16_t gy, int16_t gz)
+    {
+        icm20602_sample_t s = { { ax, ay, az }, t, { gx, gy, gz } };
+        return s;
+    }
+};
+
+TEST_F(TestICM20602Convert, default_ranges)
+{
+    ICM20602Converter converter;
+    icm20602_si_sample_t si;
+
+    // +-2 g and +-1000 dps
+    converter.convert(raw_sample(16384, -16384, 0, 0, 32767, -32768, 0), si);
+
+    EXPECT_NEAR(ICM20602_STANDARD_GRAVITY, si.accel[0], 1e-4);
+    EXPECT_NEAR(-ICM20602_STANDARD_GRAVITY, si.accel[1], 1e-4);
+    EXPECT_FLOAT_EQ(0.0f, si.accel[2]);
+    EXPECT_NEAR(1000.0f * ICM20602_DEG_TO_RAD, si.gyro[0], 1e-3);
+    EXPECT_NEAR(-1000.0f * ICM20602_DEG_TO_RAD, si.gyro[1], 1e-3);
+    EXPECT_FLOAT_EQ(0.0f, si.gyro[2]);
+    EXPECT_FLOAT_EQ(ICM20602_TEMP_OFFSET, si.temp);
+}
+
+TEST_F(TestICM20602Convert, resolution_is_per_instance)
+{
+    ICM20602Converter a(2.0f / 32768.0f, 250.0f / 32768.0f);
+    ICM20602Converter b(16.0f / 32768.0f, 2000.0f / 32768.0f);
+    icm20602_si_sample_t si_a, si_b;
+    icm20602_sample_t raw = raw_sample(2048, 0, 0, 0, 4096, 0, 0);
+
+    a.convert(raw, si_a);
+    b.convert(raw, si_b);
+
+    EXPECT_NEAR(8.0f * si_a.accel[0], si_b.accel[0], 1e-4);
+    EXPECT_NEAR(8.0f * si_a.gyro[0], si_b.gyro[0], 1e-4);
+}
+
+TEST_F(TestICM20602Convert, applies_bias_then_scale)
+{
+    ICM20602Converter converter;
+    const float accel_bias[3] = { 0.5f, -0.25f, 0.0f };
+    const float accel_scale[3] = { 1.0f, 2.0f, 0.5f };
+    const float gyro_bias[3] = { 0.01f, 0.0f, -0.02f };
+    const float gyro_scale[3] = { 1.0f, 1.0f, 1.1f };
+    converter.set_accel_calibration(accel_bias, accel_scale);
+    converter.set_gyro_calibration(gyro_bias, gyro_scale);
+
+    icm20602_si_sample_t si;
+    converter.convert(raw_sample(16384, 16384, 16384, 327, 0, 0, 3277), si);
+
+    const float g = ICM20602_STANDARD_GRAVITY;
+    EXPECT_NEAR((g - 0.5f) * 1.0f, si.accel[0], 1e-4);
+    EXPECT_NEAR((g + 0.25f) * 2.0f, si.accel[1], 1e-4);
+    EXPECT_NEAR(g * 0.5f, si.accel[2], 1e-4);
+    EXPECT_NEAR(-0.01f, si.gyro[0], 1e-6);
+    EXPECT_FLOAT_EQ(0.0f, si.gyro[1]);
+    EXPECT_NEAR((3277 * (1000.0f / 32768.0f) * ICM20602_DEG_TO_RAD + 0.02f) * 1.1f, si.gyro[2], 1e-4);
+    EXPECT_NEAR(26.0f, si.temp, 1e-2);
+}
+
+TEST_F(TestICM20602Convert, batch_matches_single)
+{
+    ICM20602Converter converter(4.0f / 32768.0f, 500.0f / 32768.0f);
+    const float bias[3] = { 0.1f, 0.2f, 0.3f };
+    const float scale[3] = { 1.01f, 0.99f, 1.0f };
+    converter.set_accel_calibration(bias, scale);
+
+    icm20602_sample_t raw[16];
+    for (int i = 0; i < 16; i++) {
+        raw[i] = raw_sample(i * 1000, -i * 500, i, i * 3, -i * 7, i * 11, 32767 - i);
+    }
+
+    icm20602_si_sample_t batch[16];
+    converter.convert(raw, batch, 16);
+
+    for (int i = 0; i < 16; i++) {
+        icm20602_si_sample_t single;
+        converter.convert(raw[i], single);
+        for (int axis = 0; axis < 3; axis++) {
+            EXPECT_FLOAT_EQ(single.accel[axis], batch[i].accel[axis]);
+            EXPECT_FLOAT_EQ(single.gyro[axis], batch[i].gyro[axis]);
+        }
+        EXPECT_FLOAT_EQ(single.temp, batch[i].temp);
+    }
+}
@@ -0,0 +1,222 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "icm20602_fifo.h"
+
+#include <stdint.h>
+#include <deque>
+
+/**
+ * Register model of the ICM20602 FIFO
+ *
+ * Frames are pushed as the sensor would write them. FIFO_MODE stop-when-full
+ * behaviour and the clear-on-read INT_STATUS overflow flag are modelled.
+ */
+class Icm20602FifoModel {
+public:
+
+    uint8_t readByte(uint8_t reg)
+    {
+        uint8_t value = 0;
+        readBytes(reg, &value, 1);
+        return value;
+    }
+
+    int readBytes(uint8_t reg, uint8_t* data, int length)
+    {
+        transactions++;
+        if (fail) {
+            return -1;
+        }
+        for (int i = 0; i < length; i++) {
+            data[i] = read_register(reg);
+            // Register address auto-increments, except for FIFO_R_W
+            if (reg != ICM20602_FIFO_R_W) {
+                reg++;
+            }
+        }
+        return 0;
+    }
+
+    void push_frame(int16_t seed)
+    {
+        for (int i = 0; i < ICM20602_SAMPLE_BYTES / 2; i++) {
+            uint16_t word = (uint16_t)(seed + i);
+            push_byte(word >> 8);
+            push_byte(word & 0xFF);
+        }
+    }
+
+    std::deque<uint8_t> fifo;
+    uint8_t int_status = 0;
+    int transactions = 0;
+    bool fail = false;
+
+private:
+
+    void push_byte(uint8_t byte)
+    {
+        if (fifo.size() >= ICM20602_FIFO_SIZE) {
+            int_status |= ICM20602_INT_FIFO_OFLOW;
+            return;
+        }
+        fifo.push_back(byte);
+    }
+
+    uint8_t read_register(uint8_t reg)
+    {
+        switch (reg) {
+            case ICM20602_INT_STATUS: {
+                uint8_t status = int_status;
+                int_status = 0;
+                return status;
+            }
+            case ICM20602_FIFO_COUNTH:
+                return (uint8_t)(fifo.size() >> 8);
+            case ICM20602_FIFO_COUNTL:
+                return (uint8_t)(fifo.size() & 0xFF);
+            case ICM20602_FIFO_R_W: {
+                if (fifo.empty()) {
+                    return 0xFF;
+                }
+                uint8_t byte = fifo.front();
+                fifo.pop_front();
+                return byte;
+            }
+            default:
+                return 0;
+        }
+    }
+};
+
+class TestICM20602Fifo : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void expect_frame(const icm20602_sample_t& sample, int16_t seed)
+    {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(seed + i, sample.accel[i]);
+            EXPECT_EQ(seed + 4 + i, sample.gyro[i]);
+        }
+        EXPECT_EQ(seed + 3, sample.temp);
+    }
+
+    Icm20602FifoModel model;
+    icm20602_sample_t samples[ICM20602_FIFO_MAX_FRAMES];
+};
+
+TEST_F(TestICM20602Fifo, empty_fifo_reads_nothing)
+{
+    bool overflow = true;
+    EXPECT_EQ(0, icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES, &overflow));
+    EXPECT_FALSE(overflow);
+}
+
+TEST_F(TestICM20602Fifo, drains_all_frames_in_one_burst)
+{
+    for (int i = 0; i < 10; i++) {
+        model.push_frame(i * 100);
+    }
+
+    EXPECT_EQ(10, icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES));
+
+    // INT_STATUS, FIFO_COUNT and one FIFO_R_W burst
+    EXPECT_EQ(3, model.transactions);
+    EXPECT_TRUE(model.fifo.empty());
+    for (int i = 0; i < 10; i++) {
+        expect_frame(samples[i], i * 100);
+    }
+}
+
+TEST_F(TestICM20602Fifo, decodes_negative_values)
+{
+    model.push_frame(-7);
+
+    ASSERT_EQ(1, icm20602_fifo_drain(model, samples, 1));
+    expect_frame(samples[0], -7);
+}
+
+TEST_F(TestICM20602Fifo, leaves_partial_frame_in_fifo)
+{
+    model.push_frame(1);
+    model.push_frame(2);
+    model.fifo.pop_back();  // second frame still being written
+
+    EXPECT_EQ(1, icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES));
+    expect_frame(samples[0], 1);
+    EXPECT_EQ((size_t) ICM20602_SAMPLE_BYTES - 1, model.fifo.size());
+}
+
+TEST_F(TestICM20602Fifo, respects_caller_capacity)
+{
+    for (int i = 0; i < 5; i++) {
+        model.push_frame(i);
+    }
+
+    EXPECT_EQ(3, icm20602_fifo_drain(model, samples, 3));
+    EXPECT_EQ((size_t) 2 * ICM20602_SAMPLE_BYTES, model.fifo.size());
+
+    EXPECT_EQ(2, icm20602_fifo_drain(model, samples, 3));
+    expect_frame(samples[0], 3);
+    expect_frame(samples[1], 4);
+}
+
+TEST_F(TestICM20602Fifo, overflow_keeps_frames_aligned)
+{
+    for (int i = 0; i < ICM20602_FIFO_MAX_FRAMES + 3; i++) {
+        model.push_frame(i);
+    }
+
+    bool overflow = false;
+    EXPECT_EQ(ICM20602_FIFO_MAX_FRAMES,
+            icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES, &overflow));
+    EXPECT_TRUE(overflow);
+
+    // Stop-when-full mode drops the newest frames, the stored ones stay intact
+    expect_frame(samples[0], 0);
+    expect_frame(samples[ICM20602_FIFO_MAX_FRAMES - 1], ICM20602_FIFO_MAX_FRAMES - 1);
+
+    // The flag clears once read
+    model.push_frame(0);
+    EXPECT_EQ(1, icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES, &overflow));
+    EXPECT_FALSE(overflow);
+}
+
+TEST_F(TestICM20602Fifo, reports_bus_error)
+{
+    model.push_frame(0);
+    model.fail = true;
+
+    EXPECT_EQ(-1, icm20602_fifo_drain(model, samples, ICM20602_FIFO_MAX_FRAMES));
+}
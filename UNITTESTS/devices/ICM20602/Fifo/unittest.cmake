@@ -0,0 +1,17 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../devices/ICM20602/
+)
+
+set(unittest-sources
+)
+
+set(unittest-test-sources
+  devices/ICM20602/Fifo/test_ICM20602Fifo.cpp
+)
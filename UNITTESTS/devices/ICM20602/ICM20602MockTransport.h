@@ -0,0 +1,167 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_ICM20602_MOCK_TRANSPORT_H_
+#define EP_OC_MCU_UNITTESTS_ICM20602_MOCK_TRANSPORT_H_
+
+#include "icm20602_regs.h"
+#include "icm20602_fifo.h"
+#include "icm20602_transport.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+
+/**
+ * Host-side register model of an ICM20602 behind an ICM20602Transport
+ *
+ * Models auto-incrementing register access, the FIFO (count, FIFO_R_W pops,
+ * FIFO_RST) and the clear-on-read INT_STATUS register, and counts bus
+ * transactions so tests can check that bursts are not split.
+ */
+class ICM20602MockTransport : public ICM20602Transport {
+public:
+
+    ICM20602MockTransport(bool spi = false) : reads(0), writes(0),
+            last_read_reg(0), last_read_length(0), fail(false), _spi(spi)
+    {
+        memset(regs, 0, sizeof(regs));
+        regs[ICM20602_WHO_AM_I] = 0x12;
+    }
+
+    virtual int read(uint8_t reg, uint8_t* data, int length)
+    {
+        reads++;
+        last_read_reg = reg;
+        last_read_length = length;
+        if (fail) {
+            return -1;
+        }
+        for (int i = 0; i < length; i++) {
+            data[i] = read_register(reg);
+            if (reg != ICM20602_FIFO_R_W) {
+                reg++;
+            }
+        }
+        return 0;
+    }
+
+    virtual int write(uint8_t reg, const uint8_t* data, int length)
+    {
+        writes++;
+        if (fail) {
+            return -1;
+        }
+        for (int i = 0; i < length; i++) {
+            write_register(reg++, data[i]);
+        }
+        return 0;
+    }
+
+    virtual bool disable_i2c() const
+    {
+        return _spi;
+    }
+
+    /** Loads the data registers as the sensor would after a conversion */
+    void set_sample(const icm20602_sample_t& sample)
+    {
+        encode(sample, &regs[ICM20602_ACCEL_XOUT_H]);
+    }
+
+    /** Appends a frame to the FIFO as the sensor would */
+    void push_fifo_frame(const icm20602_sample_t& sample)
+    {
+        uint8_t raw[ICM20602_SAMPLE_BYTES];
+        encode(sample, raw);
+        for (int i = 0; i < ICM20602_SAMPLE_BYTES; i++) {
+            if (fifo.size() >= ICM20602_FIFO_SIZE) {
+                regs[ICM20602_INT_STATUS] |= ICM20602_INT_FIFO_OFLOW;
+                return;
+            }
+            fifo.push_back(raw[i]);
+        }
+    }
+
+    uint8_t regs[128];
+    std::deque<uint8_t> fifo;
+
+    int reads;
+    int writes;
+    uint8_t last_read_reg;
+    int last_read_length;
+    bool fail;
+
+private:
+
+    static void encode(const icm20602_sample_t& sample, uint8_t* raw)
+    {
+        const int16_t words[7] = {
+            sample.accel[0], sample.accel[1], sample.accel[2], sample.temp,
+            sample.gyro[0], sample.gyro[1], sample.gyro[2]
+        };
+        for (int i = 0; i < 7; i++) {
+            raw[2 * i] = (uint8_t)((uint16_t) words[i] >> 8);
+            raw[2 * i + 1] = (uint8_t)(words[i] & 0xFF);
+        }
+    }
+
+    uint8_t read_register(uint8_t reg)
+    {
+        switch (reg) {
+            case ICM20602_INT_STATUS: {
+                uint8_t status = regs[reg];
+                regs[reg] = 0;
+                return status;
+            }
+            case ICM20602_FIFO_COUNTH:
+                return (uint8_t)(fifo.size() >> 8);
+            case ICM20602_FIFO_COUNTL:
+                return (uint8_t)(fifo.size() & 0xFF);
+            case ICM20602_FIFO_R_W: {
+                if (fifo.empty()) {
+                    return 0xFF;
+                }
+                uint8_t byte = fifo.front();
+                fifo.pop_front();
+                return byte;
+            }
+            default:
+                return regs[reg & 0x7F];
+        }
+    }
+
+    void write_register(uint8_t reg, uint8_t value)
+    {
+        if (reg == ICM20602_USER_CTRL && (value & ICM20602_USER_CTRL_FIFO_RST)) {
+            // Self-clearing reset
+            fifo.clear();
+            value &= ~ICM20602_USER_CTRL_FIFO_RST;
+        }
+        regs[reg & 0x7F] = value;
+    }
+
+    bool _spi;
+};
+
+#endif /* EP_OC_MCU_UNITTESTS_ICM20602_MOCK_TRANSPORT_H_ */
@@ -0,0 +1,81 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_DIGITALOUT_H_
+#define EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_DIGITALOUT_H_
+
+#include "PinNames.h"
+
+namespace mbed {
+
+/**
+ * Host-side DigitalOut mock for the chip select
+ *
+ * The level of the last pin written is kept in cs_level(), so the SPI
+ * mock can tell whether the sensor is selected
+ */
+class DigitalOut {
+public:
+
+    DigitalOut(PinName pin, int value = 0)
+    {
+        write(value);
+    }
+
+    void write(int value)
+    {
+        _value = value;
+        cs_level() = value;
+    }
+
+    int read()
+    {
+        return _value;
+    }
+
+    DigitalOut &operator=(int value)
+    {
+        write(value);
+        return *this;
+    }
+
+    operator int()
+    {
+        return read();
+    }
+
+    /** Level of the last pin written, high (deselected) if there is none */
+    static int &cs_level()
+    {
+        static int level = 1;
+        return level;
+    }
+
+private:
+
+    int _value;
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_DIGITALOUT_H_ */
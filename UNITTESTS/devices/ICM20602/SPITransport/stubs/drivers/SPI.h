@@ -0,0 +1,111 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_SPI_H_
+#define EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_SPI_H_
+
+#include "PinNames.h"
+#include "drivers/DigitalOut.h"
+#include "ICM20602MockTransport.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace mbed {
+
+/**
+ * Host-side SPI mock with an ICM20602 on the bus
+ *
+ * Like a hardware chip select, every write() call is a separate frame: its
+ * first byte addresses the sensor's register model and the rest is data.
+ * The length of each frame and the chip select level during it are recorded.
+ */
+class SPI {
+public:
+
+    struct frame_t {
+        int length;
+        int cs_level;
+    };
+
+    SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel = NC) : device(nullptr), locks(0)
+    {
+    }
+
+    void format(int bits, int mode = 0)
+    {
+    }
+
+    void frequency(int hz)
+    {
+    }
+
+    void lock()
+    {
+        locks++;
+    }
+
+    void unlock()
+    {
+        locks--;
+    }
+
+    int write(int value)
+    {
+        char tx = (char) value;
+        char rx = 0;
+        write(&tx, 1, &rx, 1);
+        return rx;
+    }
+
+    int write(const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length)
+    {
+        int length = (tx_length > rx_length) ? tx_length : rx_length;
+        frame_t frame = { length, DigitalOut::cs_level() };
+        frames.push_back(frame);
+
+        uint8_t addr = (uint8_t) tx_buffer[0];
+        uint8_t data[1024] = { 0 };
+        if (addr & 0x80) {
+            device->read(addr & 0x7F, data, length - 1);
+        } else {
+            for (int i = 1; i < length; i++) {
+                data[i - 1] = (i < tx_length) ? (uint8_t) tx_buffer[i] : 0xFF;
+            }
+            device->write(addr, data, length - 1);
+        }
+
+        for (int i = 0; i < rx_length; i++) {
+            rx_buffer[i] = (i == 0) ? 0 : (char) data[i - 1];
+        }
+        return length;
+    }
+
+    ICM20602MockTransport *device;
+    std::vector<frame_t> frames;
+    int locks;
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_ICM20602_SPITRANSPORT_STUBS_SPI_H_ */
@@ -0,0 +1,164 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "icm20602_i2c.h"
+#include "icm20602_spi_transport.h"
+#include "ICM20602MockTransport.h"
+
+#include <stdint.h>
+
+class TestICM20602SPITransport : public testing::Test {
+
+    virtual void SetUp()
+    {
+        spi.device = &device;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestICM20602SPITransport() : spi(NC, NC, NC)
+    {
+    }
+
+    icm20602_sample_t make_sample(int16_t seed)
+    {
+        icm20602_sample_t s = {
+            { seed, (int16_t)(seed + 1), (int16_t)(seed + 2) },
+            (int16_t)(seed + 3),
+            { (int16_t)(seed + 4), (int16_t)(seed + 5), (int16_t)(seed + 6) }
+        };
+        return s;
+    }
+
+    ICM20602MockTransport device;
+    mbed::SPI spi;
+};
+
+TEST_F(TestICM20602SPITransport, hardware_cs_read_is_one_frame)
+{
+    ICM20602SPITransport transport(spi);
+    device.set_sample(make_sample(0x0102));
+
+    uint8_t data[ICM20602_SAMPLE_BYTES];
+    EXPECT_EQ(0, transport.read(ICM20602_ACCEL_XOUT_H, data, ICM20602_SAMPLE_BYTES));
+
+    ASSERT_EQ(1u, spi.frames.size());
+    EXPECT_EQ(ICM20602_SAMPLE_BYTES + 1, spi.frames[0].length);
+    EXPECT_EQ(ICM20602_ACCEL_XOUT_H, device.last_read_reg);
+    EXPECT_EQ(0x01, data[0]);
+    EXPECT_EQ(0x02, data[1]);
+    EXPECT_EQ(0x01, data[12]);
+    EXPECT_EQ(0x08, data[13]);
+    EXPECT_EQ(0, spi.locks);
+}
+
+TEST_F(TestICM20602SPITransport, hardware_cs_write_is_one_frame)
+{
+    ICM20602SPITransport transport(spi);
+
+    const uint8_t config[3] = { 0x07, 0x01, 0x10 };
+    EXPECT_EQ(0, transport.write(ICM20602_SMPLRT_DIV, config, 3));
+
+    ASSERT_EQ(1u, spi.frames.size());
+    EXPECT_EQ(4, spi.frames[0].length);
+    EXPECT_EQ(0x07, device.regs[ICM20602_SMPLRT_DIV]);
+    EXPECT_EQ(0x01, device.regs[ICM20602_CONFIG]);
+    EXPECT_EQ(0x10, device.regs[ICM20602_GYRO_CONFIG]);
+    EXPECT_EQ(0, spi.locks);
+}
+
+TEST_F(TestICM20602SPITransport, long_fifo_read_is_split)
+{
+    ICM20602SPITransport transport(spi);
+    for (int i = 0; i < 20; i++) {
+        device.push_fifo_frame(make_sample(i));
+    }
+
+    uint8_t data[20 * ICM20602_SAMPLE_BYTES];
+    EXPECT_EQ(0, transport.read(ICM20602_FIFO_R_W, data, sizeof(data)));
+
+    // 280 bytes in bursts of ICM20602_SPI_BURST_MAX, all from FIFO_R_W
+    EXPECT_EQ((sizeof(data) + ICM20602_SPI_BURST_MAX - 1) / ICM20602_SPI_BURST_MAX, spi.frames.size());
+    EXPECT_EQ(ICM20602_FIFO_R_W, device.last_read_reg);
+    EXPECT_TRUE(device.fifo.empty());
+    for (int i = 0; i < 20; i++) {
+        icm20602_sample_t s;
+        icm20602_decode_sample(&data[i * ICM20602_SAMPLE_BYTES], s);
+        EXPECT_EQ(i, s.accel[0]);
+        EXPECT_EQ(i + 6, s.gyro[2]);
+    }
+}
+
+TEST_F(TestICM20602SPITransport, long_register_read_resumes_address)
+{
+    ICM20602SPITransport transport(spi);
+    for (int i = 0; i < 100; i++) {
+        device.regs[i] = (uint8_t)(i + 1);
+    }
+
+    uint8_t data[100];
+    EXPECT_EQ(0, transport.read(0x00, data, sizeof(data)));
+    EXPECT_EQ(2u, spi.frames.size());
+    EXPECT_EQ(ICM20602_SPI_BURST_MAX, device.last_read_reg);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(i + 1, data[i]);
+    }
+}
+
+TEST_F(TestICM20602SPITransport, gpio_cs_frames_each_burst)
+{
+    ICM20602SPITransport transport(spi, (PinName) 1);  // any pin but NC
+    EXPECT_EQ(1, mbed::DigitalOut::cs_level());
+
+    uint8_t data[ICM20602_SAMPLE_BYTES];
+    EXPECT_EQ(0, transport.read(ICM20602_ACCEL_XOUT_H, data, ICM20602_SAMPLE_BYTES));
+    const uint8_t value = 0x01;
+    EXPECT_EQ(0, transport.write(ICM20602_PWR_MGMT_1, &value, 1));
+
+    ASSERT_EQ(2u, spi.frames.size());
+    EXPECT_EQ(0, spi.frames[0].cs_level);
+    EXPECT_EQ(0, spi.frames[1].cs_level);
+    EXPECT_EQ(1, mbed::DigitalOut::cs_level());
+    EXPECT_EQ(0x01, device.regs[ICM20602_PWR_MGMT_1]);
+}
+
+TEST_F(TestICM20602SPITransport, sensor_over_spi)
+{
+    ICM20602SPITransport transport(spi);
+    ICM20602 imu(transport);
+    EXPECT_EQ(ICM20602_I2C_IF_DIS, device.regs[ICM20602_I2C_IF]);
+    EXPECT_TRUE(imu.isOnline());
+
+    device.set_sample(make_sample(-500));
+    icm20602_sample_t sample;
+    ASSERT_TRUE(imu.read_all(sample));
+    EXPECT_EQ(-500, sample.accel[0]);
+    EXPECT_EQ(-497, sample.temp);
+    EXPECT_EQ(-494, sample.gyro[2]);
+}
@@ -0,0 +1,24 @@
+####################
+# UNIT TESTS
+####################
+
+# The SPI and DigitalOut mocks must shadow mbed-os' drivers
+set(unittest-includes
+  devices/ICM20602/SPITransport/stubs
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ICM20602/
+  devices/ICM20602/
+)
+
+set(unittest-sources
+  ../devices/ICM20602/icm20602_i2c.cpp
+  ../devices/ICM20602/icm20602_spi_transport.cpp
+)
+
+set(unittest-test-sources
+  devices/ICM20602/SPITransport/test_ICM20602SPITransport.cpp
+)
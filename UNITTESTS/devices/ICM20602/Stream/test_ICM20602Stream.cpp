@@ -0,0 +1,356 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "icm20602_stream.h"
+#include "ICM20602MockTransport.h"
+
+#include <chrono>
+#include <stdint.h>
+
+using namespace std::chrono;
+
+/** Simulated time of the interrupt timestamps */
+static us_timestamp_t fake_now_us = 0;
+
+extern "C" {
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return NULL;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return fake_now_us;
+}
+
+}
+
+/** Exposes the mocked INT pin of a stream */
+class TestableICM20602Stream : public ICM20602Stream {
+
+public:
+
+    TestableICM20602Stream(ICM20602& imu, events::EventQueue& queue, ICM20602SampleRing& ring) :
+        ICM20602Stream(imu, NC, queue, ring)
+    {
+    }
+
+    /** One INT pulse */
+    void pulse()
+    {
+        _irq.set(1);
+        _irq.set(0);
+    }
+};
+
+class TestICM20602Stream : public testing::Test {
+
+    virtual void SetUp()
+    {
+        fake_now_us = 0;
+        rtos::Kernel::Clock::set(0);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestICM20602Stream() : imu(bus), ring(storage), stream(imu, queue, ring),
+        data_calls(0), motion_calls(0), last_motion(false)
+    {
+        stream.attach(mbed::callback(this, &TestICM20602Stream::on_data));
+        stream.attach_motion(mbed::callback(this, &TestICM20602Stream::on_motion));
+    }
+
+    void on_data()
+    {
+        data_calls++;
+    }
+
+    void on_motion(bool moving)
+    {
+        motion_calls++;
+        last_motion = moving;
+    }
+
+    /** Runs the queue and the interrupt timestamp clock together, 1 ms at a time */
+    void run(int ms)
+    {
+        for (int i = 0; i < ms; i++) {
+            fake_now_us += 1000;
+            queue.dispatch_for(milliseconds(1));
+        }
+    }
+
+    /** One data-ready interrupt with a sample of the given X acceleration */
+    void sample(int16_t accel_x)
+    {
+        icm20602_sample_t s = make_sample(0);
+        s.accel[0] = accel_x;
+        bus.set_sample(s);
+        stream.pulse();
+        run(1);
+    }
+
+    icm20602_sample_t make_sample(int16_t seed)
+    {
+        icm20602_sample_t s = {
+            { seed, (int16_t)(seed + 1), (int16_t)(seed + 2) },
+            (int16_t)(seed + 3),
+            { (int16_t)(seed + 4), (int16_t)(seed + 5), (int16_t)(seed + 6) }
+        };
+        return s;
+    }
+
+    ICM20602MockTransport bus;
+    ICM20602 imu;
+    events::EventQueue queue;
+    icm20602_timed_sample_t storage[128];
+    ICM20602SampleRing ring;
+    TestableICM20602Stream stream;
+    int data_calls;
+    int motion_calls;
+    bool last_motion;
+};
+
+TEST_F(TestICM20602Stream, data_ready_reads_each_sample)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::DATA_READY, 4));
+    EXPECT_EQ(ICM20602_INT_DATA_RDY, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(4, bus.regs[ICM20602_SMPLRT_DIV]);
+    EXPECT_EQ(5000u, stream.get_period_us());
+
+    bus.set_sample(make_sample(100));
+    fake_now_us = 12345;
+    stream.pulse();
+    EXPECT_EQ(1u, queue.pending());
+    EXPECT_TRUE(ring.empty());
+
+    queue.dispatch_for(milliseconds(1));
+    icm20602_timed_sample_t s;
+    ASSERT_TRUE(ring.pop(s));
+    EXPECT_EQ(12345u, s.timestamp_us);
+    EXPECT_EQ(100, s.sample.accel[0]);
+    EXPECT_EQ(106, s.sample.gyro[2]);
+    EXPECT_EQ(1, data_calls);
+    EXPECT_EQ(0u, stream.get_missed());
+}
+
+TEST_F(TestICM20602Stream, data_ready_counts_missed)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::DATA_READY));
+    fake_now_us = 1000;
+    stream.pulse();
+    fake_now_us = 2000;
+    stream.pulse();
+    EXPECT_EQ(1u, queue.pending());
+    EXPECT_EQ(1u, stream.get_missed());
+
+    queue.dispatch_for(milliseconds(1));
+    icm20602_timed_sample_t s;
+    ASSERT_TRUE(ring.pop(s));
+    EXPECT_EQ(1000u, s.timestamp_us);
+    EXPECT_TRUE(ring.empty());
+
+    // Re-armed once the read ran
+    stream.pulse();
+    EXPECT_EQ(1u, queue.pending());
+    EXPECT_EQ(1u, stream.get_missed());
+}
+
+TEST_F(TestICM20602Stream, full_queue_counts_missed)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::DATA_READY));
+
+    queue.set_capacity(0);
+    stream.pulse();
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_EQ(1u, stream.get_missed());
+
+    // The stream isn't stuck waiting for a read that was never posted
+    queue.set_capacity(SIZE_MAX);
+    stream.pulse();
+    EXPECT_EQ(1u, queue.pending());
+    queue.dispatch_for(milliseconds(1));
+    EXPECT_EQ(1u, ring.size());
+    EXPECT_EQ(1u, stream.get_missed());
+}
+
+TEST_F(TestICM20602Stream, watermark_drains_fifo)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::FIFO_WATERMARK, 0, 20));
+    EXPECT_EQ(ICM20602_INT_FIFO_OFLOW, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(0x01, bus.regs[ICM20602_FIFO_WM_TH1]);   // 280 bytes
+    EXPECT_EQ(0x18, bus.regs[ICM20602_FIFO_WM_TH2]);
+
+    // More than a burst, the frames after the watermark are dated forward
+    for (int i = 0; i < 25; i++) {
+        bus.push_fifo_frame(make_sample(i * 10));
+    }
+    fake_now_us = 100000;
+    stream.pulse();
+    queue.dispatch_for(milliseconds(1));
+
+    ASSERT_EQ(25u, ring.size());
+    for (int i = 0; i < 25; i++) {
+        icm20602_timed_sample_t s;
+        ASSERT_TRUE(ring.pop(s));
+        EXPECT_EQ(i * 10, s.sample.accel[0]);
+        EXPECT_EQ(100000 + (i - 19) * 1000, (int64_t) s.timestamp_us);
+    }
+    EXPECT_TRUE(bus.fifo.empty());
+    EXPECT_EQ(1, data_calls);
+    EXPECT_EQ(0u, stream.get_missed());
+
+    // FIFO data is still buffered by the sensor, a second interrupt isn't a loss
+    stream.pulse();
+    stream.pulse();
+    EXPECT_EQ(0u, stream.get_missed());
+}
+
+TEST_F(TestICM20602Stream, watermark_counts_fifo_overflow)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::FIFO_WATERMARK, 0, 20));
+    for (int i = 0; i < ICM20602_FIFO_MAX_FRAMES; i++) {
+        bus.push_fifo_frame(make_sample(i));
+    }
+    bus.regs[ICM20602_INT_STATUS] = ICM20602_INT_FIFO_OFLOW;
+    stream.pulse();
+    queue.dispatch_for(milliseconds(1));
+
+    EXPECT_EQ((size_t) ICM20602_FIFO_MAX_FRAMES, ring.size());
+    EXPECT_EQ(1u, stream.get_missed());
+}
+
+TEST_F(TestICM20602Stream, watermark_range)
+{
+    EXPECT_FALSE(stream.start(ICM20602Stream::FIFO_WATERMARK, 0, 0));
+    EXPECT_FALSE(stream.start(ICM20602Stream::FIFO_WATERMARK, 0, ICM20602_FIFO_MAX_FRAMES + 1));
+    EXPECT_FALSE(stream.is_running());
+    EXPECT_EQ(0x00, bus.regs[ICM20602_FIFO_WM_TH1]);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_FIFO_WM_TH2]);
+
+    EXPECT_FALSE(imu.setFifoWatermark(74));     // 1036 bytes would wrap to 12
+    EXPECT_EQ(0x00, bus.regs[ICM20602_FIFO_WM_TH2]);
+
+    EXPECT_TRUE(stream.start(ICM20602Stream::FIFO_WATERMARK, 0, ICM20602_FIFO_MAX_FRAMES));
+    EXPECT_EQ(0x03, bus.regs[ICM20602_FIFO_WM_TH1]);   // 1008 bytes
+    EXPECT_EQ(0xF0, bus.regs[ICM20602_FIFO_WM_TH2]);
+}
+
+TEST_F(TestICM20602Stream, stop_cancels_pending_read)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::DATA_READY));
+    stream.pulse();
+    EXPECT_EQ(1u, queue.pending());
+
+    stream.stop();
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_EQ(0, bus.regs[ICM20602_INT_ENABLE]);
+
+    stream.pulse();
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestICM20602Stream, bus_errors_are_counted)
+{
+    ASSERT_TRUE(stream.start(ICM20602Stream::DATA_READY));
+    stream.pulse();
+    bus.fail = true;
+    queue.dispatch_for(milliseconds(1));
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(1u, stream.get_bus_errors());
+    EXPECT_EQ(0, data_calls);
+}
+
+TEST_F(TestICM20602Stream, start_auto_follows_motion)
+{
+    stream.set_wake_on_motion(100, 49);
+    ASSERT_TRUE(stream.start_auto(ICM20602Stream::DATA_READY, milliseconds(50), 4));
+    EXPECT_EQ(ICM20602Stream::WAKE_ON_MOTION, stream.get_mode());
+    EXPECT_EQ(ICM20602_PWR_CYCLE, bus.regs[ICM20602_PWR_MGMT_1]);
+    EXPECT_EQ(ICM20602_INT_WOM, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(25, bus.regs[ICM20602_ACCEL_WOM_X_THR]);
+    EXPECT_EQ(49, bus.regs[ICM20602_SMPLRT_DIV]);
+
+    // Motion: stream at the requested rate
+    stream.pulse();
+    run(1);
+    EXPECT_EQ(1, motion_calls);
+    EXPECT_TRUE(last_motion);
+    EXPECT_EQ(ICM20602Stream::DATA_READY, stream.get_mode());
+    EXPECT_EQ(0x00, bus.regs[ICM20602_PWR_MGMT_1]);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_ACCEL_INTEL_CTRL]);
+    EXPECT_EQ(ICM20602_INT_DATA_RDY, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(4, bus.regs[ICM20602_SMPLRT_DIV]);
+
+    // Keeps moving for 40 ms (100 mg is ~1638 counts at 2 g), then stays still
+    for (int i = 0; i < 40; i++) {
+        sample((i & 1) ? 4000 : 0);
+    }
+    for (int i = 0; i < 40; i++) {
+        sample(0);
+    }
+    EXPECT_EQ(ICM20602Stream::DATA_READY, stream.get_mode());
+    EXPECT_EQ(1, motion_calls);
+    EXPECT_EQ(80u, ring.size());
+
+    // Quiet for 50 ms since the last motion: back to wake-on-motion
+    run(20);
+    EXPECT_EQ(ICM20602Stream::WAKE_ON_MOTION, stream.get_mode());
+    EXPECT_EQ(2, motion_calls);
+    EXPECT_FALSE(last_motion);
+    EXPECT_EQ(ICM20602_PWR_CYCLE, bus.regs[ICM20602_PWR_MGMT_1]);
+    EXPECT_EQ(ICM20602_INT_WOM, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(ICM20602_ACCEL_INTEL_EN | ICM20602_ACCEL_INTEL_MODE, bus.regs[ICM20602_ACCEL_INTEL_CTRL]);
+    EXPECT_EQ(49, bus.regs[ICM20602_SMPLRT_DIV]);
+    EXPECT_EQ(0u, queue.pending());
+
+    // And streams again on the next motion
+    stream.pulse();
+    run(1);
+    EXPECT_EQ(3, motion_calls);
+    EXPECT_TRUE(last_motion);
+    EXPECT_EQ(ICM20602Stream::DATA_READY, stream.get_mode());
+    EXPECT_EQ(ICM20602_INT_DATA_RDY, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(1u, queue.pending());
+
+    stream.stop();
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestICM20602Stream, start_auto_rejects_invalid_modes)
+{
+    EXPECT_FALSE(stream.start_auto(ICM20602Stream::WAKE_ON_MOTION, milliseconds(50)));
+    EXPECT_FALSE(stream.start_auto(ICM20602Stream::FIFO_WATERMARK, milliseconds(50), 0, 0));
+    EXPECT_FALSE(stream.start_auto(ICM20602Stream::FIFO_WATERMARK, milliseconds(50), 0,
+                                   ICM20602_FIFO_MAX_FRAMES + 1));
+    EXPECT_FALSE(stream.is_running());
+    EXPECT_EQ(0, motion_calls);
+}
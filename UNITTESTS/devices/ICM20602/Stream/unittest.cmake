@@ -0,0 +1,26 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' InterruptIn, EventQueue and Kernel clock
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ICM20602/
+  devices/ICM20602/
+)
+
+set(unittest-sources
+  ../devices/ICM20602/icm20602_i2c.cpp
+  ../devices/ICM20602/icm20602_stream.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+)
+
+set(unittest-test-sources
+  devices/ICM20602/Stream/test_ICM20602Stream.cpp
+)
@@ -0,0 +1,215 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "icm20602_i2c.h"
+#include "ICM20602MockTransport.h"
+
+#include <stdint.h>
+
+class TestICM20602Transport : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    icm20602_sample_t make_sample(int16_t seed)
+    {
+        icm20602_sample_t s = {
+            { seed, (int16_t)(seed + 1), (int16_t)(seed + 2) },
+            (int16_t)(seed + 3),
+            { (int16_t)(seed + 4), (int16_t)(seed + 5), (int16_t)(seed + 6) }
+        };
+        return s;
+    }
+
+    void expect_sample(const icm20602_sample_t& sample, int16_t seed)
+    {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(seed + i, sample.accel[i]);
+            EXPECT_EQ(seed + 4 + i, sample.gyro[i]);
+        }
+        EXPECT_EQ(seed + 3, sample.temp);
+    }
+};
+
+TEST_F(TestICM20602Transport, init_disables_i2c_only_over_spi)
+{
+    ICM20602MockTransport i2c_bus(false);
+    ICM20602 i2c_imu(i2c_bus);
+    EXPECT_EQ(0x00, i2c_bus.regs[ICM20602_I2C_IF]);
+    EXPECT_TRUE(i2c_imu.isOnline());
+
+    ICM20602MockTransport spi_bus(true);
+    ICM20602 spi_imu(spi_bus);
+    EXPECT_EQ(ICM20602_I2C_IF_DIS, spi_bus.regs[ICM20602_I2C_IF]);
+    EXPECT_TRUE(spi_imu.isOnline());
+}
+
+TEST_F(TestICM20602Transport, read_all_is_one_burst)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+    bus.set_sample(make_sample(-1000));
+    bus.reads = 0;
+
+    icm20602_sample_t sample;
+    ASSERT_TRUE(imu.read_all(sample));
+    EXPECT_EQ(1, bus.reads);
+    EXPECT_EQ(ICM20602_ACCEL_XOUT_H, bus.last_read_reg);
+    EXPECT_EQ(ICM20602_SAMPLE_BYTES, bus.last_read_length);
+    expect_sample(sample, -1000);
+
+    bus.fail = true;
+    EXPECT_FALSE(imu.read_all(sample));
+}
+
+TEST_F(TestICM20602Transport, single_axis_reads_do_not_tear)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+    bus.set_sample(make_sample(0x1234));
+    bus.reads = 0;
+
+    EXPECT_EQ(0x1234, imu.getAccXvalue());
+    EXPECT_EQ(0x1237, imu.getIMUTemp());
+    EXPECT_EQ(0x123A, imu.getGyrZvalue());
+    EXPECT_EQ(3, bus.reads);
+}
+
+TEST_F(TestICM20602Transport, fifo_streams_over_transport)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+
+    imu.enableFifo();
+    EXPECT_EQ(ICM20602_FIFO_EN_GYRO | ICM20602_FIFO_EN_ACCEL, bus.regs[ICM20602_FIFO_EN]);
+    EXPECT_EQ(ICM20602_USER_CTRL_FIFO_EN, bus.regs[ICM20602_USER_CTRL]);
+    EXPECT_TRUE(bus.regs[ICM20602_CONFIG] & ICM20602_CONFIG_FIFO_MODE);
+
+    for (int i = 0; i < 20; i++) {
+        bus.push_fifo_frame(make_sample(i * 10));
+    }
+
+    icm20602_sample_t samples[32];
+    bool overflow = true;
+    bus.reads = 0;
+    EXPECT_EQ(20, imu.readFifo(samples, 32, &overflow));
+    EXPECT_FALSE(overflow);
+    EXPECT_EQ(3, bus.reads);
+    for (int i = 0; i < 20; i++) {
+        expect_sample(samples[i], i * 10);
+    }
+
+    bus.push_fifo_frame(make_sample(0));
+    imu.resetFifo();
+    EXPECT_TRUE(bus.fifo.empty());
+}
+
+TEST_F(TestICM20602Transport, fifo_overflow_is_counted)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+    imu.enableFifo();
+
+    for (int i = 0; i < ICM20602_FIFO_MAX_FRAMES + 1; i++) {
+        bus.push_fifo_frame(make_sample(i));
+    }
+
+    icm20602_sample_t samples[ICM20602_FIFO_MAX_FRAMES];
+    bool overflow = false;
+    EXPECT_EQ(ICM20602_FIFO_MAX_FRAMES, imu.readFifo(samples, ICM20602_FIFO_MAX_FRAMES, &overflow));
+    EXPECT_TRUE(overflow);
+    EXPECT_EQ(1u, imu.getFifoOverflows());
+}
+
+TEST_F(TestICM20602Transport, watermark_and_interrupts)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+
+    imu.setFifoWatermark(20);   // 280 bytes
+    EXPECT_EQ(0x01, bus.regs[ICM20602_FIFO_WM_TH1]);
+    EXPECT_EQ(0x18, bus.regs[ICM20602_FIFO_WM_TH2]);
+
+    imu.enableInterrupts(ICM20602_INT_DATA_RDY);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_INT_PIN_CFG]);
+    EXPECT_EQ(ICM20602_INT_DATA_RDY, bus.regs[ICM20602_INT_ENABLE]);
+}
+
+TEST_F(TestICM20602Transport, scaling_is_per_instance)
+{
+    ICM20602MockTransport bus_a, bus_b;
+    ICM20602 imu_a(bus_a);
+    ICM20602 imu_b(bus_b);
+
+    imu_b.setAccRange(AFS_16G);
+    imu_b.setGyroRange(GFS_250DPS);
+
+    EXPECT_FLOAT_EQ(2.0f / 32768.0f, imu_a.getAccResolution());
+    EXPECT_FLOAT_EQ(1000.0f / 32768.0f, imu_a.getGyroResolution());
+    EXPECT_FLOAT_EQ(16.0f / 32768.0f, imu_b.getAccResolution());
+    EXPECT_FLOAT_EQ(250.0f / 32768.0f, imu_b.getGyroResolution());
+    EXPECT_EQ(AFS_16G << 3, bus_b.regs[ICM20602_ACCEL_CONFIG]);
+    EXPECT_EQ(GFS_1000DPS << 3, bus_a.regs[ICM20602_GYRO_CONFIG]);
+
+    bus_a.set_sample(make_sample(2048));
+    bus_b.set_sample(make_sample(2048));
+    icm20602_si_sample_t si_a, si_b;
+    ASSERT_TRUE(imu_a.read_si(si_a));
+    ASSERT_TRUE(imu_b.read_si(si_b));
+    EXPECT_NEAR(8.0f * si_a.accel[0], si_b.accel[0], 1e-4);
+}
+
+TEST_F(TestICM20602Transport, wake_on_motion_configuration)
+{
+    ICM20602MockTransport bus;
+    ICM20602 imu(bus);
+
+    imu.enableWakeOnMotion(100, 49);
+    EXPECT_EQ(ICM20602_PWR_CYCLE, bus.regs[ICM20602_PWR_MGMT_1]);
+    EXPECT_EQ(ICM20602_PWR_STBY_GYRO, bus.regs[ICM20602_PWR_MGMT_2]);
+    EXPECT_EQ(25, bus.regs[ICM20602_ACCEL_WOM_X_THR]);
+    EXPECT_EQ(25, bus.regs[ICM20602_ACCEL_WOM_Y_THR]);
+    EXPECT_EQ(25, bus.regs[ICM20602_ACCEL_WOM_Z_THR]);
+    EXPECT_EQ(ICM20602_ACCEL_INTEL_EN | ICM20602_ACCEL_INTEL_MODE, bus.regs[ICM20602_ACCEL_INTEL_CTRL]);
+    EXPECT_EQ(ICM20602_INT_WOM, bus.regs[ICM20602_INT_ENABLE]);
+    EXPECT_EQ(49, bus.regs[ICM20602_SMPLRT_DIV]);
+
+    // Threshold saturates at the register range
+    imu.enableWakeOnMotion(5000);
+    EXPECT_EQ(255, bus.regs[ICM20602_ACCEL_WOM_X_THR]);
+
+    imu.disableWakeOnMotion();
+    EXPECT_EQ(0x00, bus.regs[ICM20602_PWR_MGMT_1]);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_PWR_MGMT_2]);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_ACCEL_INTEL_CTRL]);
+    EXPECT_EQ(0x00, bus.regs[ICM20602_INT_ENABLE]);
+}
@@ -0,0 +1,21 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ICM20602/
+  devices/ICM20602/
+)
+
+set(unittest-sources
+  ../devices/ICM20602/icm20602_i2c.cpp
+)
+
+set(unittest-test-sources
+  devices/ICM20602/Transport/test_ICM20602Transport.cpp
+)
@@ -0,0 +1,160 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "MCP23008KeyMatrixIO.h"
+
+#include <stdint.h>
+
+extern "C" {
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return NULL;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return 0;
+}
+
+}
+
+/** Rows on GP0/GP1, columns on GP4-GP6, GP2/GP3/GP7 are not part of the matrix */
+static const uint8_t rows[] = { 0, 1 };
+static const uint8_t cols[] = { 4, 5, 6 };
+
+/**
+ * Scans a simulated 2 x 3 matrix wired to the mocked MCP23008
+ *
+ * An input column reads low when a closed key connects it to a row that is
+ * an output latched low, otherwise its pull-up makes it read high.
+ */
+class TestMCP23008KeyMatrixIO : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestMCP23008KeyMatrixIO() : mcp(P0_0, P0_1, 0), bus(*mbed::I2C::instance())
+    {
+        for(int r = 0; r < 2; r++) {
+            for(int c = 0; c < 3; c++) {
+                closed[r][c] = false;
+            }
+        }
+        bus.on_read = mbed::callback(this, &TestMCP23008KeyMatrixIO::on_read);
+    }
+
+    uint8_t on_read(uint8_t reg)
+    {
+        if(reg != mbed::I2C::GPIO) {
+            return bus.regs[reg];
+        }
+
+        uint8_t iodir = bus.regs[mbed::I2C::IODIR];
+        uint8_t levels = (bus.regs[mbed::I2C::OLAT] & ~iodir) | (bus.regs[mbed::I2C::GPPU] & iodir);
+        for(int r = 0; r < 2; r++) {
+            bool driven_low = !(iodir & (1 << rows[r])) && !(bus.regs[mbed::I2C::OLAT] & (1 << rows[r]));
+            for(int c = 0; c < 3; c++) {
+                if(driven_low && closed[r][c] && (iodir & (1 << cols[c]))) {
+                    levels &= ~(1 << cols[c]);
+                }
+            }
+        }
+        return levels;
+    }
+
+    uint8_t iodir(void)
+    {
+        return bus.regs[mbed::I2C::IODIR];
+    }
+
+    MCP23008 mcp;
+    mbed::I2C& bus;
+    bool closed[2][3];
+};
+
+TEST_F(TestMCP23008KeyMatrixIO, idle_configuration)
+{
+    mcp.set_output_pins(MCP23008::Pin_GP7 | MCP23008::Pin_GP0);
+    mcp.write_outputs(0x01);
+
+    ep::MCP23008KeyMatrixIO io(mcp, rows, 2, cols, 3);
+
+    // Rows and columns are inputs, GP7 is still an output
+    EXPECT_EQ(0x7Fu, iodir());
+    EXPECT_EQ(0x70u, bus.regs[mbed::I2C::GPPU]);
+    EXPECT_EQ(0x00u, bus.regs[mbed::I2C::OLAT] & 0x03);
+}
+
+TEST_F(TestMCP23008KeyMatrixIO, select_row)
+{
+    ep::MCP23008KeyMatrixIO io(mcp, rows, 2, cols, 3);
+
+    io.select_row(1);
+    EXPECT_EQ(0xFDu, iodir());
+    io.select_row(0);
+    EXPECT_EQ(0xFEu, iodir());
+    io.release_rows();
+    EXPECT_EQ(0xFFu, iodir());
+}
+
+TEST_F(TestMCP23008KeyMatrixIO, read_columns)
+{
+    ep::MCP23008KeyMatrixIO io(mcp, rows, 2, cols, 3);
+    closed[1][2] = true;
+
+    io.select_row(0);
+    EXPECT_EQ(0x0u, io.read_columns());
+    io.select_row(1);
+    EXPECT_EQ(0x4u, io.read_columns());
+    io.release_rows();
+    EXPECT_EQ(0x0u, io.read_columns());
+}
+
+TEST_F(TestMCP23008KeyMatrixIO, other_pins_reconfigured_while_scanning)
+{
+    ep::MCP23008KeyMatrixIO io(mcp, rows, 2, cols, 3);
+
+    // The application changes pins outside the matrix between scans
+    io.select_row(0);
+    mcp.set_output_pins(MCP23008::Pin_GP2);
+    io.select_row(1);
+    io.release_rows();
+    EXPECT_EQ(0xFBu, iodir());
+
+    mcp.set_input_pins(MCP23008::Pin_GP2);
+    mcp.set_output_pins(MCP23008::Pin_GP3);
+    io.select_row(0);
+    EXPECT_EQ(0xF6u, iodir());
+    io.release_rows();
+    EXPECT_EQ(0xF7u, iodir());
+}
@@ -0,0 +1,26 @@
+####################
+# UNIT TESTS
+####################
+
+# The I2C mock must shadow mbed.h, the mocks mbed-os' EventQueue, Kernel clock and Timeout
+set(unittest-includes
+  devices/MCP23008/stubs
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+  ../devices/MCP23008/
+)
+
+set(unittest-sources
+  ../devices/MCP23008/MCP23008.cpp
+  ../drivers/src/VerticalCounterDebouncer.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+)
+
+set(unittest-test-sources
+  devices/MCP23008/KeyMatrixIO/test_MCP23008KeyMatrixIO.cpp
+)
@@ -0,0 +1,105 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MCP23008_STUBS_MBED_H_
+#define EP_OC_MCU_UNITTESTS_MCP23008_STUBS_MBED_H_
+
+#include "PinNames.h"
+#include "platform/Callback.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace mbed {
+
+/**
+ * Host-side I2C mock for the MCP23008 tests
+ *
+ * Models the register file of a single MCP23008: a one byte write sets the
+ * register pointer, longer writes store data from it. Like on the chip,
+ * writing GPIO sets the output latch (OLAT). Reads go through on_read when
+ * it is set, so tests can model the pin levels. The last constructed bus is
+ * available from instance().
+ */
+class I2C {
+public:
+
+    I2C(PinName sda, PinName scl) : pointer(0), writes(0)
+    {
+        memset(regs, 0, sizeof(regs));
+        instance() = this;
+    }
+
+    static I2C *&instance()
+    {
+        static I2C *bus = NULL;
+        return bus;
+    }
+
+    void frequency(int hz)
+    {
+    }
+
+    int write(int address, const char *data, int length, bool repeated = false)
+    {
+        pointer = (uint8_t) data[0];
+        for (int i = 1; i < length; i++) {
+            uint8_t reg = pointer++ % sizeof(regs);
+            regs[(reg == GPIO) ? OLAT : reg] = (uint8_t) data[i];
+            writes++;
+        }
+        return 0;
+    }
+
+    int read(int address, char *data, int length, bool repeated = false)
+    {
+        for (int i = 0; i < length; i++) {
+            uint8_t reg = pointer++ % sizeof(regs);
+            data[i] = (char)(on_read ? on_read(reg) : regs[reg]);
+        }
+        return 0;
+    }
+
+    enum {
+        IODIR = 0x00,
+        GPPU = 0x06,
+        GPIO = 0x09,
+        OLAT = 0x0A
+    };
+
+    uint8_t regs[0x0B];
+    uint8_t pointer;
+    int writes;
+    Callback<uint8_t(uint8_t)> on_read;
+};
+
+} // namespace mbed
+
+using namespace mbed;
+
+/** The mocked bus always acknowledges */
+inline void error(const char *format, ...)
+{
+}
+
+#endif /* EP_OC_MCU_UNITTESTS_MCP23008_STUBS_MBED_H_ */
@@ -0,0 +1,254 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "ResistorDivider.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define FULL_SCALE 65535
+
+/**
+ * Tests for ResistorDivider's ratiometric mode and reference channel calibration
+ *
+ * The measured, reference and zero channels are mocked AnalogIns, so the
+ * ADC's gain and offset errors can be modelled exactly
+ */
+class TestResistorDividerCalibration : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestResistorDividerCalibration() : adc(3.3f), ref(3.3f), zero(3.3f)
+    {
+    }
+
+    /** ADC with the given gain and offset errors, clamped to its range */
+    static uint16_t adc_model(uint16_t code, double gain, double offset)
+    {
+        double out = round(code * gain + offset);
+        return (out < 0.0) ? 0 : ((out > FULL_SCALE) ? FULL_SCALE : (uint16_t) out);
+    }
+
+    /** Set up the ADC's errors on all three channels, the reference divider is 50% */
+    void model_adc(double gain, double offset)
+    {
+        ref.code = adc_model(32768, gain, offset);
+        zero.code = adc_model(0, gain, offset);
+        adc_gain = gain;
+        adc_offset = offset;
+    }
+
+    /** Sample the measured channel for the given ideal code */
+    uint16_t measure(ep::ResistorDivider& div, uint16_t code)
+    {
+        adc.code = adc_model(code, adc_gain, adc_offset);
+        return div.measure();
+    }
+
+    mbed::AnalogIn adc;
+    mbed::AnalogIn ref;
+    mbed::AnalogIn zero;
+
+    events::EventQueue queue;
+
+    double adc_gain;
+    double adc_offset;
+};
+
+/** Ratiometric mode only depends on the code ratio, not on Vin or the reference voltage */
+TEST_F(TestResistorDividerCalibration, ratiometric_ignores_voltages)
+{
+    adc.set_reference_voltage(2.5f);
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    adc.code = 21845;
+    EXPECT_NE(20000u, div.get_R_pu_ohms_u32());
+
+    div.set_ratiometric(true);
+    EXPECT_EQ(20000u, div.get_R_pu_ohms_u32());
+    EXPECT_NEAR(20000.0f, div.get_R_pu_ohms(), 0.5f);
+}
+
+/** Ratiometric pull-down, including the end codes */
+TEST_F(TestResistorDividerCalibration, ratiometric_pull_down)
+{
+    ep::ResistorDivider div(adc, ep::ResistorDivider::UnknownVal, 10000.0f, 3.3f);
+    div.set_ratiometric(true);
+
+    adc.code = 43690;
+    EXPECT_EQ(20000u, div.get_R_pd_ohms_u32());
+    EXPECT_NEAR(20000.0f, div.get_R_pd_ohms(), 0.5f);
+
+    for(uint32_t code = 1; code < FULL_SCALE; code += 101) {
+        adc.code = code;
+        EXPECT_EQ((uint32_t) llround(10000.0 * code / (FULL_SCALE - code)),
+                div.get_R_pd_ohms_u32()) << "code " << code;
+    }
+
+    adc.code = 0;
+    EXPECT_EQ(0u, div.get_R_pd_ohms_u32());
+    adc.code = FULL_SCALE;
+    EXPECT_EQ(UINT32_MAX, div.get_R_pd_ohms_u32());
+}
+
+/** Without a reference channel, measurements are passed through */
+TEST_F(TestResistorDividerCalibration, uncalibrated)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    div.recalibrate();
+    for(uint32_t code = 0; code <= FULL_SCALE; code += 4369) {
+        adc.code = code;
+        EXPECT_EQ(code, div.measure());
+        EXPECT_EQ(code, div.read_u16());
+    }
+}
+
+/** Gain and offset errors are cancelled using the reference and zero channels */
+TEST_F(TestResistorDividerCalibration, gain_and_offset)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    model_adc(1.02, 200.0);
+    div.recalibrate();
+
+    for(uint32_t code = 0; code < 60000; code += 1234) {
+        EXPECT_NEAR(code, measure(div, code), 1.0) << "code " << code;
+        EXPECT_NEAR(code, div.read_u16(), 1.0) << "code " << code;
+    }
+
+    // The corrected code feeds the resistance calculation
+    div.set_ratiometric(true);
+    measure(div, 21845);
+    EXPECT_NEAR(20000.0, div.get_R_pu_ohms_u32(false), 2.0);
+}
+
+/** Without a zero channel only the gain is corrected */
+TEST_F(TestResistorDividerCalibration, gain_only)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f);
+
+    model_adc(0.98, 0.0);
+    div.recalibrate();
+
+    for(uint32_t code = 0; code <= FULL_SCALE; code += 1234) {
+        EXPECT_NEAR(code, measure(div, code), 1.0) << "code " << code;
+    }
+}
+
+/** Corrected codes are clamped to the ADC's range */
+TEST_F(TestResistorDividerCalibration, clamped)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    model_adc(0.9, 1000.0);
+    div.recalibrate();
+
+    adc.code = 500;
+    EXPECT_EQ(0, div.measure());
+    adc.code = FULL_SCALE;
+    EXPECT_EQ(FULL_SCALE, div.measure());
+}
+
+/** A reference reading at or below the zero reading keeps the last good correction */
+TEST_F(TestResistorDividerCalibration, bad_reference_ignored)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    model_adc(1.02, 200.0);
+    div.recalibrate();
+    uint16_t good = measure(div, 30000);
+
+    ref.code = 100;
+    zero.code = 200;
+    div.recalibrate();
+    EXPECT_EQ(good, measure(div, 30000));
+
+    ref.code = 200;
+    div.recalibrate();
+    EXPECT_EQ(good, measure(div, 30000));
+}
+
+/** reset_calibration() goes back to uncorrected measurements */
+TEST_F(TestResistorDividerCalibration, reset)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    model_adc(1.02, 200.0);
+    div.recalibrate();
+    div.reset_calibration();
+
+    adc.code = 30000;
+    EXPECT_EQ(30000, div.measure());
+}
+
+/** Recalibrating picks up drift of the ADC */
+TEST_F(TestResistorDividerCalibration, recalibrate_tracks_drift)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    model_adc(1.02, 200.0);
+    div.start_calibration(queue, std::chrono::milliseconds(1000));
+    EXPECT_NEAR(25000, measure(div, 25000), 1.0);
+
+    // Drift without recalibrating shows up as an error
+    model_adc(1.05, 300.0);
+    EXPECT_GT(abs(measure(div, 25000) - 25000), 500);
+
+    div.recalibrate();
+    EXPECT_NEAR(25000, measure(div, 25000), 1.0);
+
+    div.stop_calibration();
+}
+
+/** A zero offset too large to represent saturates instead of wrapping */
+TEST_F(TestResistorDividerCalibration, large_zero_offset)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    div.set_reference_channel(ref, 10000.0f, 10000.0f, &zero);
+
+    // gain = 32768 / 20000, offset = -40000 * gain does not fit in Q16.16
+    zero.code = 40000;
+    ref.code = 60000;
+    div.recalibrate();
+
+    // Below the zero reading, the offset must still pull the code down
+    adc.code = 20000;
+    EXPECT_EQ(0, div.measure());
+}
@@ -0,0 +1,31 @@
+####################
+# UNIT TESTS
+####################
+
+# The AnalogIn mock must shadow mbed-os' drivers/AnalogIn.h
+set(unittest-includes
+  devices/ResistorDivider/stubs
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ResistorDivider/
+)
+
+set(unittest-sources
+  ../devices/ResistorDivider/ResistorDivider.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+  ../../mbed-os/UNITTESTS/stubs/EventQueue_stub.cpp
+  ../../mbed-os/UNITTESTS/stubs/equeue_stub.c
+)
+
+set(unittest-test-sources
+  devices/ResistorDivider/Calibration/test_ResistorDividerCalibration.cpp
+)
+
+set(DEVICE_FLAGS "-DDEVICE_ANALOGIN")
+set(CONF_FLAGS "-DMBED_CONF_TARGET_DEFAULT_ADC_VREF=3.3f")
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${DEVICE_FLAGS} ${CONF_FLAGS}")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${DEVICE_FLAGS} ${CONF_FLAGS}")
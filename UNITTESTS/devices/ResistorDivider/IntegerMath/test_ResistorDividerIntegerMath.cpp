@@ -0,0 +1,221 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "ResistorDivider.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define FULL_SCALE 65535
+
+/**
+ * Tests for the integer-only ResistorDivider getters and oversampling
+ *
+ * Vout is sampled through a mocked AnalogIn with a 3.3V reference. The
+ * integer results are checked against the exact ratio, rounded to nearest,
+ * and against the float getters.
+ */
+class TestResistorDividerIntegerMath : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestResistorDividerIntegerMath() : adc(3.3f)
+    {
+    }
+
+    /** Exact Rpu for the given code with Vin = Vref */
+    static double exact_r_pu(double r_pd, uint16_t code)
+    {
+        return r_pd * (FULL_SCALE - code) / code;
+    }
+
+    mbed::AnalogIn adc;
+};
+
+/** Known parameters are returned rounded, without sampling */
+TEST_F(TestResistorDividerIntegerMath, known_values)
+{
+    ep::ResistorDivider div(adc, 4700.4f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    EXPECT_EQ(4700u, div.get_R_pd_ohms_u32());
+    EXPECT_EQ(3300u, div.get_Vin_mv());
+    EXPECT_EQ(0, adc.reads);
+}
+
+/** Resistances are rounded to the nearest ohm, not truncated */
+TEST_F(TestResistorDividerIntegerMath, rounding)
+{
+    ep::ResistorDivider div(adc, 1.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    adc.code = 2;       // 32766.5
+    EXPECT_EQ(32767u, div.get_R_pu_ohms_u32());
+    adc.code = 3;       // 21844
+    EXPECT_EQ(21844u, div.get_R_pu_ohms_u32());
+    adc.code = 4;       // 16382.75
+    EXPECT_EQ(16383u, div.get_R_pu_ohms_u32());
+    adc.code = 40000;   // 0.638
+    EXPECT_EQ(1u, div.get_R_pu_ohms_u32());
+    adc.code = 50000;   // 0.311
+    EXPECT_EQ(0u, div.get_R_pu_ohms_u32());
+}
+
+/** The integer getters agree with the exact result and the float getters across the range */
+TEST_F(TestResistorDividerIntegerMath, matches_float_path)
+{
+    ep::ResistorDivider pu_div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    ep::ResistorDivider pd_div(adc, ep::ResistorDivider::UnknownVal, 10000.0f, 3.3f);
+
+    for(uint32_t code = 1; code < FULL_SCALE; code += 97) {
+        adc.code = code;
+
+        double exact = exact_r_pu(10000.0, code);
+        uint32_t r_pu = pu_div.get_R_pu_ohms_u32();
+        EXPECT_EQ((uint32_t) llround(exact), r_pu) << "code " << code;
+        EXPECT_NEAR(pu_div.get_R_pu_ohms(false), r_pu, fmax(1.0, r_pu * 1e-4)) << "code " << code;
+
+        exact = 10000.0 * code / (FULL_SCALE - code);
+        uint32_t r_pd = pd_div.get_R_pd_ohms_u32();
+        EXPECT_EQ((uint32_t) llround(exact), r_pd) << "code " << code;
+        EXPECT_NEAR(pd_div.get_R_pd_ohms(false), r_pd, fmax(1.0, r_pd * 1e-4)) << "code " << code;
+    }
+}
+
+/** Vout at ground or at Vin saturates instead of dividing by zero */
+TEST_F(TestResistorDividerIntegerMath, end_codes)
+{
+    ep::ResistorDivider pu_div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+    ep::ResistorDivider pd_div(adc, ep::ResistorDivider::UnknownVal, 10000.0f, 3.3f);
+
+    adc.code = 0;
+    EXPECT_EQ(UINT32_MAX, pu_div.get_R_pu_ohms_u32());
+    EXPECT_EQ(0u, pd_div.get_R_pd_ohms_u32());
+
+    adc.code = FULL_SCALE;
+    EXPECT_EQ(0u, pu_div.get_R_pu_ohms_u32());
+    EXPECT_EQ(UINT32_MAX, pd_div.get_R_pd_ohms_u32());
+
+    // Vout above a Vin lower than the reference clamps as well
+    ep::ResistorDivider low_vin(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 1.8f);
+    adc.code = 40000;
+    EXPECT_EQ(0u, low_vin.get_R_pu_ohms_u32());
+}
+
+/** Vin is rounded to the nearest millivolt */
+TEST_F(TestResistorDividerIntegerMath, vin)
+{
+    ep::ResistorDivider div(adc, 10000.0f, 10000.0f, ep::ResistorDivider::UnknownVal);
+
+    adc.code = 0;
+    EXPECT_EQ(0u, div.get_Vin_mv());
+    adc.code = 32768;   // 3300.05mV
+    EXPECT_EQ(3300u, div.get_Vin_mv());
+    adc.code = FULL_SCALE;
+    EXPECT_EQ(6600u, div.get_Vin_mv());
+
+    for(uint32_t code = 0; code <= FULL_SCALE; code += 89) {
+        adc.code = code;
+        uint32_t vin = div.get_Vin_mv();
+        EXPECT_EQ((uint32_t) llround(2.0 * 3300.0 * code / FULL_SCALE), vin) << "code " << code;
+        EXPECT_NEAR(div.get_Vin_volts(false) * 1000.0f, vin, 1.0) << "code " << code;
+    }
+}
+
+/** A pull-down that rounds to 0 ohms does not divide by zero */
+TEST_F(TestResistorDividerIntegerMath, vin_zero_r_pd)
+{
+    ep::ResistorDivider div(adc, 0.4f, 1000.0f, ep::ResistorDivider::UnknownVal);
+
+    adc.code = 1000;
+    EXPECT_EQ(UINT32_MAX, div.get_Vin_mv());
+}
+
+/** Oversampled measurements are the rounded average of the samples */
+TEST_F(TestResistorDividerIntegerMath, oversampling)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    const uint16_t codes[] = { 100, 101, 101, 103 };
+    adc.set_sequence(codes, 4);
+
+    div.set_oversampling(4);
+    EXPECT_EQ(101, div.measure());     // 101.25
+    EXPECT_EQ(4, adc.reads);
+
+    div.set_oversampling(2);
+    EXPECT_EQ(101, div.measure());     // 100.5, rounded up
+    EXPECT_EQ(102, div.measure());     // 102
+    EXPECT_EQ(8, adc.reads);
+
+    // 0 disables oversampling
+    div.set_oversampling(0);
+    EXPECT_EQ(100, div.measure());
+    EXPECT_EQ(9, adc.reads);
+
+    // Full scale samples do not overflow the sum
+    adc.set_sequence(NULL, 0);
+    adc.code = FULL_SCALE;
+    div.set_oversampling(255);
+    EXPECT_EQ(FULL_SCALE, div.measure());
+}
+
+/** new_measurement = false reuses the cached measurement */
+TEST_F(TestResistorDividerIntegerMath, cached_measurement)
+{
+    ep::ResistorDivider div(adc, 10000.0f, ep::ResistorDivider::UnknownVal, 3.3f);
+
+    adc.code = 20000;
+    EXPECT_EQ(20000, div.measure());
+    int reads = adc.reads;
+
+    adc.code = 40000;
+    EXPECT_EQ((uint32_t) llround(exact_r_pu(10000.0, 20000)), div.get_R_pu_ohms_u32(false));
+    EXPECT_EQ(20000, div.get_last_measurement());
+    EXPECT_EQ(reads, adc.reads);
+
+    EXPECT_EQ((uint32_t) llround(exact_r_pu(10000.0, 40000)), div.get_R_pu_ohms_u32());
+    EXPECT_EQ(40000, div.get_last_measurement());
+    EXPECT_EQ(reads + 1, adc.reads);
+}
+
+/** A reference voltage changed after construction is picked up by the integer getters */
+TEST_F(TestResistorDividerIntegerMath, reference_change)
+{
+    ep::ResistorDivider div(adc, 10000.0f, 10000.0f, ep::ResistorDivider::UnknownVal);
+
+    adc.code = 32768;
+    EXPECT_EQ(3300u, div.get_Vin_mv());
+
+    adc.set_reference_voltage(2.5f);
+    EXPECT_EQ(2500u, div.get_Vin_mv());
+    EXPECT_NEAR(div.get_Vin_volts(false) * 1000.0f, (float) div.get_Vin_mv(false), 1.0f);
+}
@@ -0,0 +1,110 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_RESISTORDIVIDER_STUBS_ANALOGIN_H_
+#define EP_OC_MCU_UNITTESTS_RESISTORDIVIDER_STUBS_ANALOGIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <functional>
+
+namespace mbed {
+
+/**
+ * Host-side AnalogIn mock for the ResistorDivider and ThermistorNTC tests
+ *
+ * Returns a fixed code, or cycles through a sequence of codes given with
+ * set_sequence(), and counts the samples taken. An optional hook runs
+ * before each sample so a test can look at the caller mid-measurement.
+ */
+class AnalogIn {
+public:
+
+    static const size_t MAX_SEQUENCE = 16;
+
+    AnalogIn(float vref = 3.3f) : code(0), reads(0), _vref(vref),
+            _sequence_length(0), _sequence_index(0)
+    {
+    }
+
+    unsigned short read_u16()
+    {
+        if (on_read) {
+            on_read();
+        }
+        reads++;
+        if (_sequence_length == 0) {
+            return code;
+        }
+        uint16_t next = _sequence[_sequence_index];
+        _sequence_index = (_sequence_index + 1) % _sequence_length;
+        return next;
+    }
+
+    float read()
+    {
+        return read_u16() / 65535.0f;
+    }
+
+    float read_voltage()
+    {
+        return read() * _vref;
+    }
+
+    void set_reference_voltage(float vref)
+    {
+        _vref = vref;
+    }
+
+    float get_reference_voltage() const
+    {
+        return _vref;
+    }
+
+    /** Return the given codes in turn, an empty sequence returns to the fixed code */
+    void set_sequence(const uint16_t* codes, size_t length)
+    {
+        _sequence_length = (length > MAX_SEQUENCE) ? MAX_SEQUENCE : length;
+        for (size_t i = 0; i < _sequence_length; i++) {
+            _sequence[i] = codes[i];
+        }
+        _sequence_index = 0;
+    }
+
+    uint16_t code;
+    int reads;
+
+    std::function<void()> on_read;
+
+private:
+
+    float _vref;
+    uint16_t _sequence[MAX_SEQUENCE];
+    size_t _sequence_length;
+    size_t _sequence_index;
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_RESISTORDIVIDER_STUBS_ANALOGIN_H_ */
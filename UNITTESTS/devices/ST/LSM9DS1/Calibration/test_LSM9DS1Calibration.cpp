@@ -0,0 +1,380 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+#include "LSM9DS1_Calibration.h"
+
+#include "rtos/Kernel.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono;
+
+class TestLSM9DS1Calibration : public testing::Test {
+
+    virtual void SetUp()
+    {
+        i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+        i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+        rtos::Kernel::Clock::set(0);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestLSM9DS1Calibration() : imu(i2c), cal(imu, queue)
+    {
+    }
+
+    /** Push a frame, gx carries n so the frames counted can be told apart */
+    void push(int16_t n, const int16_t rest[5])
+    {
+        int16_t values[6] = { n, rest[0], rest[1], rest[2], rest[3], rest[4] };
+        uint8_t frame[LSM9DS1_FIFO_FRAME_BYTES];
+        for (int axis = 0; axis < 6; axis++) {
+            frame[2 * axis] = (uint8_t)(values[axis] & 0xFF);
+            frame[2 * axis + 1] = (uint8_t)((uint16_t) values[axis] >> 8);
+        }
+        i2c.push_frame(frame);
+    }
+
+    void set_mag(int16_t x, int16_t y, int16_t z)
+    {
+        const int16_t values[3] = { x, y, z };
+        for (int axis = 0; axis < 3; axis++) {
+            i2c.m_regs[OUT_X_L_M + 2 * axis] = (uint8_t)(values[axis] & 0xFF);
+            i2c.m_regs[OUT_X_L_M + 2 * axis + 1] = (uint8_t)((uint16_t) values[axis] >> 8);
+        }
+        i2c.m_regs[STATUS_REG_M] = 0x08;
+    }
+
+    /** Run the next poll, its delay from the previous one is in waited */
+    bool poll()
+    {
+        int64_t before = now_ms();
+        bool ran = queue.dispatch_one(INT64_MAX);
+        waited = milliseconds(now_ms() - before);
+        return ran;
+    }
+
+    static int64_t now_ms()
+    {
+        return rtos::Kernel::Clock::now().time_since_epoch().count();
+    }
+
+    void on_done(int status)
+    {
+        done.push_back(status);
+    }
+
+    void on_progress(uint16_t count, uint16_t total)
+    {
+        progress.push_back(std::make_pair(count, total));
+    }
+
+    void attach()
+    {
+        cal.attach(mbed::callback(this, &TestLSM9DS1Calibration::on_done));
+        cal.attach_progress(mbed::callback(this, &TestLSM9DS1Calibration::on_progress));
+    }
+
+    mbed::I2C i2c;
+    events::EventQueue queue;
+    LSM9DS1 imu;
+    LSM9DS1Calibration cal;
+
+    milliseconds waited;
+    std::vector<int> done;
+    std::vector<std::pair<uint16_t, uint16_t> > progress;
+};
+
+TEST_F(TestLSM9DS1Calibration, accel_gyro_counts_samples_across_bursts)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    // The sensor faces up: 1 g plus some bias on Z
+    int32_t one_g = (int32_t)(1.0f / imu.calcAccel(1));
+    const int16_t rest[5] = { -4, 7, 20, -30, (int16_t)(one_g + 50) };
+
+    ASSERT_EQ(0, cal.start_accel_gyro(20));
+    EXPECT_EQ(LSM9DS1Calibration::ACCEL_GYRO, cal.get_state());
+    EXPECT_FALSE(imu.getAutoCalc());
+
+    ASSERT_EQ(1u, queue.pending());
+
+    // One full burst and a partial one
+    for (int n = 1; n <= 13; n++) {
+        push(n, rest);
+    }
+    ASSERT_TRUE(poll());
+
+    // 16 frames of 952 Hz between polls
+    EXPECT_EQ(16ms, waited);
+    ASSERT_EQ(1u, progress.size());
+    EXPECT_EQ(13, progress[0].first);
+    EXPECT_EQ(20, progress[0].second);
+    EXPECT_TRUE(done.empty());
+    EXPECT_EQ(0, i2c.fifo_count);
+
+    // Only 7 more are needed, the rest of the FIFO is discarded
+    for (int n = 14; n <= 25; n++) {
+        push(n, rest);
+    }
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(2u, progress.size());
+    EXPECT_EQ(20, progress[1].first);
+    ASSERT_EQ(1u, done.size());
+    EXPECT_EQ(0, done[0]);
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+
+    // Mean of frames 1 to 20 only
+    EXPECT_EQ(210 / 20, imu.gBiasRaw[X_AXIS]);
+    EXPECT_EQ(-4, imu.gBiasRaw[Y_AXIS]);
+    EXPECT_EQ(7, imu.gBiasRaw[Z_AXIS]);
+    EXPECT_EQ(20, imu.aBiasRaw[X_AXIS]);
+    EXPECT_EQ(-30, imu.aBiasRaw[Y_AXIS]);
+    EXPECT_EQ(50, imu.aBiasRaw[Z_AXIS]);
+    EXPECT_FLOAT_EQ(imu.calcGyro(-4), imu.gBias[Y_AXIS]);
+    EXPECT_FLOAT_EQ(imu.calcAccel(50), imu.aBias[Z_AXIS]);
+    EXPECT_TRUE(imu.getAutoCalc());
+}
+
+TEST_F(TestLSM9DS1Calibration, accel_gyro_restores_application_fifo)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    // The application streams with its own watermark and INT1 setup
+    ASSERT_EQ(0, imu.startFIFOStream(5, INT_ACTIVE_LOW, INT_OPEN_DRAIN));
+    const uint8_t fifo_ctrl = i2c.xg_regs[FIFO_CTRL];
+    const uint8_t int1_ctrl = i2c.xg_regs[INT1_CTRL];
+    const uint8_t ctrl_reg8 = i2c.xg_regs[CTRL_REG8];
+    const uint8_t ctrl_reg9 = i2c.xg_regs[CTRL_REG9];
+
+    const int16_t rest[5] = { 0, 0, 0, 0, 0 };
+    ASSERT_EQ(0, cal.start_accel_gyro(4, false));
+    EXPECT_EQ((FIFO_CONT << 5) | LSM9DS1_CALIBRATION_POLL_FRAMES, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG8] & 0x20);
+
+    for (int n = 1; n <= 4; n++) {
+        push(n, rest);
+    }
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(1u, done.size());
+    EXPECT_EQ(0, done[0]);
+
+    EXPECT_EQ(fifo_ctrl, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_EQ(int1_ctrl, i2c.xg_regs[INT1_CTRL]);
+    EXPECT_EQ(ctrl_reg8, i2c.xg_regs[CTRL_REG8]);
+    EXPECT_EQ(ctrl_reg9, i2c.xg_regs[CTRL_REG9]);
+    EXPECT_FALSE(imu.getAutoCalc());
+}
+
+TEST_F(TestLSM9DS1Calibration, accel_gyro_leaves_unused_fifo_off)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    const int16_t rest[5] = { 0, 0, 0, 0, 0 };
+    ASSERT_EQ(0, cal.start_accel_gyro(1));
+    push(1, rest);
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(1u, done.size());
+
+    EXPECT_EQ(0, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_EQ(0, i2c.xg_regs[INT1_CTRL]);
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG9] & 0x02);
+}
+
+TEST_F(TestLSM9DS1Calibration, cancel_restores_configuration)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    imu.setAutoCalc(true);
+    imu.gBiasRaw[X_AXIS] = 123;
+    ASSERT_EQ(0, imu.startFIFOStream(3));
+    const uint8_t fifo_ctrl = i2c.xg_regs[FIFO_CTRL];
+    const uint8_t int1_ctrl = i2c.xg_regs[INT1_CTRL];
+
+    const int16_t rest[5] = { 0, 0, 0, 0, 0 };
+    ASSERT_EQ(0, cal.start_accel_gyro(32));
+    for (int n = 1; n <= 10; n++) {
+        push(n, rest);
+    }
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(1u, queue.pending());
+
+    // Busy until cancelled
+    EXPECT_NE(0, cal.start_accel_gyro(32));
+    EXPECT_NE(0, cal.start_mag(16));
+
+    cal.cancel();
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_TRUE(done.empty());
+
+    // Nothing applied, the previous setup is back
+    EXPECT_EQ(123, imu.gBiasRaw[X_AXIS]);
+    EXPECT_TRUE(imu.getAutoCalc());
+    EXPECT_EQ(fifo_ctrl, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_EQ(int1_ctrl, i2c.xg_regs[INT1_CTRL]);
+    EXPECT_TRUE(i2c.xg_regs[CTRL_REG9] & 0x02);
+
+    // And another calibration can start
+    EXPECT_EQ(0, cal.start_accel_gyro(32));
+}
+
+TEST_F(TestLSM9DS1Calibration, accel_gyro_needs_gyro)
+{
+    ASSERT_NE(0, imu.begin());
+    imu.settings.gyro.enabled = false;
+
+    EXPECT_NE(0, cal.start_accel_gyro(32));
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG9] & 0x02);
+}
+
+TEST_F(TestLSM9DS1Calibration, mag_centers_extremes)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    ASSERT_EQ(0, cal.start_mag(3));
+    EXPECT_EQ(LSM9DS1Calibration::MAG, cal.get_state());
+
+    // No new data, nothing counted
+    i2c.m_regs[STATUS_REG_M] = 0;
+    ASSERT_TRUE(poll());
+    EXPECT_EQ(0, progress[0].first);
+
+    // Axes that never change sign
+    set_mag(1000, -3000, 200);
+    ASSERT_TRUE(poll());
+    set_mag(1400, -2000, 300);
+    ASSERT_TRUE(poll());
+    set_mag(1200, -2500, 600);
+    ASSERT_TRUE(poll());
+
+    ASSERT_EQ(1u, done.size());
+    EXPECT_EQ(0, done[0]);
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_EQ(1200, imu.mBiasRaw[X_AXIS]);
+    EXPECT_EQ(-2500, imu.mBiasRaw[Y_AXIS]);
+    EXPECT_EQ(400, imu.mBiasRaw[Z_AXIS]);
+
+    // Loaded into the offset registers
+    EXPECT_EQ(1200 & 0xFF, i2c.m_regs[OFFSET_X_REG_L_M]);
+    EXPECT_EQ(1200 >> 8, i2c.m_regs[OFFSET_X_REG_L_M + 1]);
+}
+
+TEST_F(TestLSM9DS1Calibration, mag_disabled_fails_fast)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+    imu.settings.mag.enabled = false;
+
+    EXPECT_NE(0, cal.start_mag(16));
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_EQ(0u, queue.pending());
+    EXPECT_TRUE(done.empty());
+}
+
+TEST_F(TestLSM9DS1Calibration, start_fails_when_queue_full)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+    imu.setAutoCalc(true);
+    queue.set_capacity(0);
+
+    // Nothing would ever poll, undo the setup
+    EXPECT_NE(0, cal.start_accel_gyro(32));
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_TRUE(imu.getAutoCalc());
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG9] & 0x02);
+    EXPECT_EQ(0, i2c.xg_regs[INT1_CTRL]);
+
+    EXPECT_NE(0, cal.start_mag(16));
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_TRUE(done.empty());
+
+    // Room again
+    queue.set_capacity(SIZE_MAX);
+    EXPECT_EQ(0, cal.start_accel_gyro(32));
+}
+
+TEST_F(TestLSM9DS1Calibration, reschedule_failure_finishes)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+    imu.gBiasRaw[X_AXIS] = 123;
+
+    const int16_t rest[5] = { 0, 0, 0, 0, 0 };
+    ASSERT_EQ(0, cal.start_accel_gyro(32));
+    for (int n = 1; n <= 10; n++) {
+        push(n, rest);
+    }
+
+    // The poll can't queue the next one, report it instead of stalling
+    queue.set_capacity(0);
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(1u, done.size());
+    EXPECT_EQ(-1, done[0]);
+    EXPECT_EQ(LSM9DS1Calibration::IDLE, cal.get_state());
+    EXPECT_EQ(0u, queue.pending());
+
+    // Nothing applied, the FIFO is off again
+    EXPECT_EQ(123, imu.gBiasRaw[X_AXIS]);
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG9] & 0x02);
+}
+
+TEST_F(TestLSM9DS1Calibration, mag_clears_soft_iron)
+{
+    ASSERT_NE(0, imu.begin());
+    attach();
+
+    const float doubled[3][3] = { { 2, 0, 0 }, { 0, 2, 0 }, { 0, 0, 2 } };
+    imu.setMagSoftIron(doubled);
+
+    // The extremes come from the uncorrected readings
+    ASSERT_EQ(0, cal.start_mag(1, false));
+    set_mag(1000, -3000, 200);
+    ASSERT_TRUE(poll());
+    ASSERT_EQ(1u, done.size());
+    EXPECT_EQ(1000, imu.mBiasRaw[X_AXIS]);
+    EXPECT_EQ(-3000, imu.mBiasRaw[Y_AXIS]);
+    EXPECT_EQ(200, imu.mBiasRaw[Z_AXIS]);
+
+    ASSERT_EQ(0, imu.readMag());
+    EXPECT_EQ(1000, imu.mx);
+}
@@ -0,0 +1,28 @@
+
+####################
+# UNIT TESTS
+####################
+
+# The bus mocks must shadow mbed-os' drivers/I2C.h, drivers/SPI.h and
+# drivers/DigitalOut.h, the shared mocks its EventQueue and Kernel clock
+set(unittest-includes
+  devices/ST/LSM9DS1/stubs
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ST/LSM9DS1/
+)
+
+set(unittest-sources
+  ../devices/ST/LSM9DS1/LSM9DS1.cpp
+  ../devices/ST/LSM9DS1/LSM9DS1_Calibration.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+)
+
+set(unittest-test-sources
+  devices/ST/LSM9DS1/Calibration/test_LSM9DS1Calibration.cpp
+)
@@ -0,0 +1,175 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+
+#include <stdint.h>
+
+class TestLSM9DS1Fifo : public testing::Test {
+
+    virtual void SetUp()
+    {
+        i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+        i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    /** Push frame n, every axis carries n and its index so misplaced bytes show */
+    void push(int16_t n)
+    {
+        uint8_t frame[LSM9DS1_FIFO_FRAME_BYTES];
+        for (int axis = 0; axis < 6; axis++) {
+            int16_t value = n * 8 + axis;
+            frame[2 * axis] = (uint8_t)(value & 0xFF);
+            frame[2 * axis + 1] = (uint8_t)((uint16_t) value >> 8);
+        }
+        i2c.push_frame(frame);
+    }
+
+    void expect_frame(const lsm9ds1_fifo_sample_t& sample, int16_t n)
+    {
+        EXPECT_EQ(n * 8 + 0, sample.gx);
+        EXPECT_EQ(n * 8 + 1, sample.gy);
+        EXPECT_EQ(n * 8 + 2, sample.gz);
+        EXPECT_EQ(n * 8 + 3, sample.ax);
+        EXPECT_EQ(n * 8 + 4, sample.ay);
+        EXPECT_EQ(n * 8 + 5, sample.az);
+    }
+
+    mbed::I2C i2c;
+};
+
+TEST_F(TestLSM9DS1Fifo, start_configures_continuous_mode_and_int1)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+
+    EXPECT_EQ(0, imu.startFIFOStream(16));
+    EXPECT_EQ((FIFO_CONT << 5) | 16, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_TRUE(i2c.xg_regs[CTRL_REG9] & 0x02);
+    EXPECT_EQ(INT_FTH, i2c.xg_regs[INT1_CTRL]);
+
+    EXPECT_EQ(0, imu.stopFIFOStream());
+    EXPECT_EQ(0, i2c.xg_regs[FIFO_CTRL]);
+    EXPECT_FALSE(i2c.xg_regs[CTRL_REG9] & 0x02);
+    EXPECT_EQ(0, i2c.xg_regs[INT1_CTRL]);
+}
+
+TEST_F(TestLSM9DS1Fifo, drain_is_one_burst_with_timestamps)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    ASSERT_EQ(0, imu.startFIFOStream(8));
+    for (int n = 1; n <= 10; n++) {
+        push(n);
+    }
+    i2c.transactions = 0;
+
+    lsm9ds1_fifo_sample_t samples[LSM9DS1_FIFO_DEPTH];
+    ASSERT_EQ(10, imu.readFIFOStream(samples, LSM9DS1_FIFO_DEPTH, 100000));
+
+    // FIFO_SRC read plus the burst, each a sub-address write and a read
+    EXPECT_EQ(4, i2c.transactions);
+    EXPECT_EQ(0, i2c.fifo_count);
+
+    // 952 Hz gyro ODR by default
+    uint32_t period = imu.getFIFOPeriod();
+    EXPECT_EQ(1050u, period);
+    for (int i = 0; i < 10; i++) {
+        expect_frame(samples[i], i + 1);
+        EXPECT_EQ(100000u - (9 - i) * period, samples[i].timestamp_us);
+    }
+    EXPECT_EQ(0u, imu.getFIFOOverflows());
+}
+
+TEST_F(TestLSM9DS1Fifo, partial_drain_keeps_newest_frame_timing)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    ASSERT_EQ(0, imu.startFIFOStream(4));
+    for (int n = 1; n <= 6; n++) {
+        push(n);
+    }
+
+    lsm9ds1_fifo_sample_t samples[4];
+    ASSERT_EQ(4, imu.readFIFOStream(samples, 4, 50000));
+    uint32_t period = imu.getFIFOPeriod();
+    for (int i = 0; i < 4; i++) {
+        expect_frame(samples[i], i + 1);
+        // Two newer frames are still stored
+        EXPECT_EQ(50000u - (5 - i) * period, samples[i].timestamp_us);
+    }
+
+    ASSERT_EQ(2, imu.readFIFOStream(samples, 4, 50000));
+    expect_frame(samples[0], 5);
+    expect_frame(samples[1], 6);
+}
+
+TEST_F(TestLSM9DS1Fifo, overflow_is_counted)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    ASSERT_EQ(0, imu.startFIFOStream(16));
+    for (int n = 1; n <= LSM9DS1_FIFO_DEPTH + 3; n++) {
+        push(n);
+    }
+
+    lsm9ds1_fifo_sample_t samples[LSM9DS1_FIFO_DEPTH];
+    ASSERT_EQ(LSM9DS1_FIFO_DEPTH, imu.readFIFOStream(samples, LSM9DS1_FIFO_DEPTH, 0));
+    expect_frame(samples[0], 4);
+    expect_frame(samples[LSM9DS1_FIFO_DEPTH - 1], LSM9DS1_FIFO_DEPTH + 3);
+    EXPECT_EQ(1u, imu.getFIFOOverflows());
+
+    push(1);
+    ASSERT_EQ(1, imu.readFIFOStream(samples, LSM9DS1_FIFO_DEPTH, 0));
+    EXPECT_EQ(1u, imu.getFIFOOverflows());
+}
+
+TEST_F(TestLSM9DS1Fifo, bias_is_removed_like_single_reads)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    ASSERT_EQ(0, imu.startFIFOStream(1));
+
+    // Calibrate against a FIFO of identical frames
+    for (int n = 0; n < 31; n++) {
+        push(2);
+    }
+    imu.calibrate(true);
+    ASSERT_EQ(0, imu.startFIFOStream(1));
+
+    push(2);
+    lsm9ds1_fifo_sample_t sample;
+    ASSERT_EQ(1, imu.readFIFOStream(&sample, 1, 0));
+    EXPECT_EQ(0, sample.gx);
+    EXPECT_EQ(0, sample.gy);
+    EXPECT_EQ(0, sample.gz);
+    EXPECT_EQ(0, sample.ax);
+}
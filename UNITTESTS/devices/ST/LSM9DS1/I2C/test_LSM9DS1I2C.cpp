@@ -0,0 +1,153 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+
+#include <stdint.h>
+
+class TestLSM9DS1I2C : public testing::Test {
+
+    virtual void SetUp()
+    {
+        i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+        i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void reset_counters()
+    {
+        i2c.transactions = 0;
+        i2c.stops = 0;
+        i2c.repeated_starts = 0;
+    }
+
+    void load_words(uint8_t* regs, uint8_t reg, int16_t x, int16_t y, int16_t z)
+    {
+        const int16_t words[3] = { x, y, z };
+        for (int i = 0; i < 3; i++) {
+            regs[reg + 2 * i] = (uint8_t)(words[i] & 0xFF);
+            regs[reg + 2 * i + 1] = (uint8_t)((uint16_t) words[i] >> 8);
+        }
+    }
+
+    mbed::I2C i2c;
+};
+
+TEST_F(TestLSM9DS1I2C, begin_identifies_both_devices)
+{
+    LSM9DS1 imu(i2c);
+    reset_counters();
+    EXPECT_EQ((WHO_AM_I_AG_RSP << 8) | WHO_AM_I_M_RSP, imu.begin());
+    EXPECT_EQ(0u, imu.getBusErrors());
+
+    // Every read pairs a repeated-start sub-address write with one STOP
+    EXPECT_EQ(i2c.transactions - i2c.repeated_starts, i2c.stops);
+}
+
+TEST_F(TestLSM9DS1I2C, single_register_read_is_one_repeated_start_transaction)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    i2c.xg_regs[STATUS_REG_1] = 0x01;
+    reset_counters();
+
+    EXPECT_EQ(1, imu.accelAvailable());
+
+    // Sub-address write, repeated start, read, one STOP
+    EXPECT_EQ(2, i2c.transactions);
+    EXPECT_EQ(1, i2c.repeated_starts);
+    EXPECT_EQ(1, i2c.stops);
+}
+
+TEST_F(TestLSM9DS1I2C, accel_and_gyro_are_single_bursts)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    load_words(i2c.xg_regs, OUT_X_L_XL, 1000, -2000, 16384);
+    load_words(i2c.xg_regs, OUT_X_L_G, -1, 32767, -32768);
+    reset_counters();
+
+    EXPECT_EQ(0, imu.readAccel());
+    EXPECT_EQ(1000, imu.ax);
+    EXPECT_EQ(-2000, imu.ay);
+    EXPECT_EQ(16384, imu.az);
+
+    EXPECT_EQ(0, imu.readGyro());
+    EXPECT_EQ(-1, imu.gx);
+    EXPECT_EQ(32767, imu.gy);
+    EXPECT_EQ(-32768, imu.gz);
+
+    EXPECT_EQ(4, i2c.transactions);
+    EXPECT_EQ(2, i2c.stops);
+}
+
+TEST_F(TestLSM9DS1I2C, mag_burst_sets_auto_increment_bit)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    load_words(i2c.m_regs, OUT_X_L_M, 0x1234, -300, 0x0F0F);
+    reset_counters();
+
+    // The mock magnetometer only increments with the MSb set, so a missing
+    // bit would return the OUT_X_L_M byte six times
+    EXPECT_EQ(0, imu.readMag());
+    EXPECT_EQ(0x1234, imu.mx);
+    EXPECT_EQ(-300, imu.my);
+    EXPECT_EQ(0x0F0F, imu.mz);
+    EXPECT_EQ(2, i2c.transactions);
+}
+
+TEST_F(TestLSM9DS1I2C, bus_errors_are_reported)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    load_words(i2c.xg_regs, OUT_X_L_XL, 1, 2, 3);
+    ASSERT_EQ(0, imu.readAccel());
+    reset_counters();
+
+    i2c.nack = true;
+    load_words(i2c.xg_regs, OUT_X_L_XL, 4, 5, 6);
+    EXPECT_NE(0, imu.readAccel());
+    EXPECT_EQ(1, imu.ax);
+    EXPECT_EQ(2, imu.ay);
+    EXPECT_EQ(3, imu.az);
+    EXPECT_EQ(1u, imu.getBusErrors());
+
+    // The failed repeated-start write must still release the bus
+    EXPECT_EQ(1, i2c.transactions);
+    EXPECT_EQ(1, i2c.stops);
+
+    EXPECT_EQ(0, imu.accelAvailable());
+    EXPECT_EQ(2u, imu.getBusErrors());
+
+    i2c.nack = false;
+    EXPECT_EQ(0, imu.readAccel());
+    EXPECT_EQ(4, imu.ax);
+}
@@ -0,0 +1,25 @@
+
+####################
+# UNIT TESTS
+####################
+
+# The bus mocks must shadow mbed-os' drivers/I2C.h, drivers/SPI.h and
+# drivers/DigitalOut.h
+set(unittest-includes
+  devices/ST/LSM9DS1/stubs
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ST/LSM9DS1/
+)
+
+set(unittest-sources
+  ../devices/ST/LSM9DS1/LSM9DS1.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+)
+
+set(unittest-test-sources
+  devices/ST/LSM9DS1/I2C/test_LSM9DS1I2C.cpp
+)
@@ -0,0 +1,264 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+#include "LSM9DS1_MagCalibrator.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define FIELD_LSB 400.0
+
+class TestLSM9DS1MagCalibrator : public testing::Test {
+
+    virtual void SetUp()
+    {
+        // Soft iron stretches and shears the sphere, hard iron moves it far
+        // enough that every reading on an axis has the same sign
+        const double soft[3][3] = {
+            { 1.20, 0.10, -0.05 },
+            { 0.10, 0.85, 0.08 },
+            { -0.05, 0.08, 1.05 }
+        };
+        memcpy(distortion, soft, sizeof(distortion));
+        offset[0] = 1500;
+        offset[1] = -2000;
+        offset[2] = 900;
+        seed = 1;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    /** Uniform noise in [-amplitude, amplitude] */
+    double noise(double amplitude)
+    {
+        seed = seed * 1103515245u + 12345u;
+        return amplitude * ((double)((seed >> 8) & 0xFFFF) / 32767.5 - 1.0);
+    }
+
+    /** Reading for direction i of n spread over the sphere (Fibonacci lattice) */
+    void reading(int i, int n, double noise_lsb, int16_t out[3])
+    {
+        double z = 1.0 - (2.0 * i + 1.0) / n;
+        double r = sqrt(1.0 - z * z);
+        double phi = i * 2.399963229728653;
+        const double u[3] = { r * cos(phi), r * sin(phi), z };
+
+        for (int row = 0; row < 3; row++) {
+            double value = offset[row];
+            for (int col = 0; col < 3; col++) {
+                value += distortion[row][col] * u[col] * FIELD_LSB;
+            }
+            out[row] = (int16_t) lround(value + noise(noise_lsb));
+        }
+    }
+
+    void feed(LSM9DS1MagCalibrator& fit, int n, double noise_lsb)
+    {
+        for (int i = 0; i < n; i++) {
+            int16_t m[3];
+            reading(i, n, noise_lsb, m);
+            fit.add_sample(m[0], m[1], m[2]);
+        }
+    }
+
+    double distortion[3][3];
+    double offset[3];
+    uint32_t seed;
+};
+
+TEST_F(TestLSM9DS1MagCalibrator, recovers_hard_and_soft_iron)
+{
+    LSM9DS1MagCalibrator fit;
+    feed(fit, 500, 0);
+    ASSERT_EQ(0, fit.solve());
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_NEAR(offset[i], fit.get_offset()[i], 1.0);
+    }
+
+    // The correction undoes the distortion up to the radius scale
+    float soft_iron[3][3];
+    fit.get_soft_iron(soft_iron);
+    double scale = fit.get_radius() / FIELD_LSB;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            double product = 0;
+            for (int k = 0; k < 3; k++) {
+                product += soft_iron[i][k] * distortion[k][j];
+            }
+            EXPECT_NEAR((i == j) ? scale : 0.0, product, 0.01);
+        }
+    }
+    EXPECT_LT(fit.get_fit_error(), 0.005f);
+}
+
+TEST_F(TestLSM9DS1MagCalibrator, corrected_readings_lie_on_a_sphere)
+{
+    LSM9DS1MagCalibrator fit;
+    feed(fit, 300, 4);
+    ASSERT_EQ(0, fit.solve());
+
+    float soft_iron[3][3];
+    fit.get_soft_iron(soft_iron);
+    const float* hard_iron = fit.get_offset();
+
+    double worst = 0;
+    for (int i = 0; i < 50; i++) {
+        int16_t m[3];
+        reading(i * 6 + 1, 300, 0, m);
+        double norm = 0;
+        for (int row = 0; row < 3; row++) {
+            double value = 0;
+            for (int col = 0; col < 3; col++) {
+                value += soft_iron[row][col] * (m[col] - hard_iron[col]);
+            }
+            norm += value * value;
+        }
+        double error = fabs(sqrt(norm) - fit.get_radius()) / fit.get_radius();
+        worst = (error > worst) ? error : worst;
+    }
+    EXPECT_LT(worst, 0.02);
+
+    // About 1% of the field: uniform noise of 4 LSB on a ~400 LSB field
+    EXPECT_GT(fit.get_fit_error(), 0.001f);
+    EXPECT_LT(fit.get_fit_error(), 0.02f);
+}
+
+TEST_F(TestLSM9DS1MagCalibrator, incremental_solves_converge)
+{
+    LSM9DS1MagCalibrator fit;
+    EXPECT_NE(0, fit.solve());
+
+    // Solving part way through doesn't disturb the accumulation
+    for (int i = 0; i < 400; i++) {
+        int16_t m[3];
+        reading(i, 400, 2, m);
+        fit.add_sample(m[0], m[1], m[2]);
+        if (i == 100) {
+            EXPECT_EQ(0, fit.solve());
+        }
+    }
+    ASSERT_EQ(0, fit.solve());
+    EXPECT_EQ(400u, fit.get_samples());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_NEAR(offset[i], fit.get_offset()[i], 3.0);
+    }
+
+    fit.reset();
+    EXPECT_EQ(0u, fit.get_samples());
+    EXPECT_FALSE(fit.is_solved());
+}
+
+TEST_F(TestLSM9DS1MagCalibrator, rotation_in_one_plane_is_rejected)
+{
+    // Only rotated about Z: no information on the Z axis
+    LSM9DS1MagCalibrator fit;
+    for (int i = 0; i < 200; i++) {
+        double phi = i * 0.0314;
+        fit.add_sample((int16_t)(1500 + 400 * cos(phi)), (int16_t)(-2000 + 400 * sin(phi)), 900);
+    }
+    EXPECT_NE(0, fit.solve());
+    EXPECT_FALSE(fit.is_solved());
+
+    mbed::I2C i2c;
+    LSM9DS1 imu(i2c);
+    EXPECT_NE(0, fit.apply(imu));
+}
+
+TEST_F(TestLSM9DS1MagCalibrator, apply_loads_offsets_and_correction)
+{
+    LSM9DS1MagCalibrator fit;
+    feed(fit, 500, 0);
+    ASSERT_EQ(0, fit.solve());
+
+    mbed::I2C i2c;
+    i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+    i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    ASSERT_EQ(0, fit.apply(imu));
+
+    int16_t hard_iron[3];
+    for (int i = 0; i < 3; i++) {
+        hard_iron[i] = (int16_t)(i2c.m_regs[OFFSET_X_REG_L_M + 2 * i] |
+                                 (i2c.m_regs[OFFSET_X_REG_H_M + 2 * i] << 8));
+        EXPECT_EQ(imu.mBiasRaw[i], hard_iron[i]);
+        EXPECT_NEAR(offset[i], hard_iron[i], 1.0);
+    }
+
+    // The sensor subtracts the offset registers from its output, the
+    // driver applies the matrix
+    for (int n = 0; n < 10; n++) {
+        int16_t m[3];
+        reading(n * 37, 500, 0, m);
+        for (int i = 0; i < 3; i++) {
+            uint16_t out = (uint16_t)(m[i] - hard_iron[i]);
+            i2c.m_regs[OUT_X_L_M + 2 * i] = out & 0xFF;
+            i2c.m_regs[OUT_X_L_M + 2 * i + 1] = out >> 8;
+        }
+        ASSERT_EQ(0, imu.readMag());
+        double norm = sqrt((double) imu.mx * imu.mx + (double) imu.my * imu.my +
+                           (double) imu.mz * imu.mz);
+        EXPECT_NEAR(fit.get_radius(), norm, 0.01 * fit.get_radius());
+    }
+
+    imu.clearMagSoftIron();
+    ASSERT_EQ(0, imu.readMag());
+    EXPECT_EQ((int16_t)(i2c.m_regs[OUT_X_L_M] | (i2c.m_regs[OUT_X_L_M + 1] << 8)), imu.mx);
+}
+
+TEST_F(TestLSM9DS1MagCalibrator, calibrate_mag_clears_soft_iron)
+{
+    mbed::I2C i2c;
+    i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+    i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+
+    const float doubled[3][3] = { { 2, 0, 0 }, { 0, 2, 0 }, { 0, 0, 2 } };
+    imu.setMagSoftIron(doubled);
+
+    const int16_t raw[3] = { 1000, -3000, 200 };
+    for (int i = 0; i < 3; i++) {
+        i2c.m_regs[OUT_X_L_M + 2 * i] = (uint8_t)(raw[i] & 0xFF);
+        i2c.m_regs[OUT_X_L_M + 2 * i + 1] = (uint8_t)((uint16_t) raw[i] >> 8);
+    }
+    i2c.m_regs[STATUS_REG_M] = 0x08;
+
+    // The extremes come from the uncorrected readings
+    imu.calibrateMag(false);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(raw[i], imu.mBiasRaw[i]);
+    }
+
+    // And the old correction stays off
+    ASSERT_EQ(0, imu.readMag());
+    EXPECT_EQ(raw[0], imu.mx);
+}
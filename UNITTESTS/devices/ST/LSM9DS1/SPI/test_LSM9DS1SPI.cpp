@@ -0,0 +1,144 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+
+#include <stdint.h>
+
+#define CS_AG ((PinName) 1)
+#define CS_M ((PinName) 2)
+
+class TestLSM9DS1SPI : public testing::Test {
+
+    virtual void SetUp()
+    {
+        mbed::DigitalOut::reset();
+        spi.cs_ag = (int) CS_AG;
+        spi.cs_m = (int) CS_M;
+        spi.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+        spi.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void load_words(uint8_t* regs, uint8_t reg, int16_t x, int16_t y, int16_t z)
+    {
+        const int16_t words[3] = { x, y, z };
+        for (int i = 0; i < 3; i++) {
+            regs[reg + 2 * i] = (uint8_t)(words[i] & 0xFF);
+            regs[reg + 2 * i + 1] = (uint8_t)((uint16_t) words[i] >> 8);
+        }
+    }
+
+    mbed::SPI spi;
+};
+
+TEST_F(TestLSM9DS1SPI, begin_configures_bus_and_identifies_both_devices)
+{
+    LSM9DS1 imu(spi, CS_AG, CS_M);
+    EXPECT_EQ((WHO_AM_I_AG_RSP << 8) | WHO_AM_I_M_RSP, imu.begin());
+    EXPECT_EQ(0u, imu.getBusErrors());
+
+    EXPECT_EQ(3, spi.mode);
+    EXPECT_EQ(LSM9DS1_SPI_FREQUENCY, spi.hz);
+
+    // Mag reads stay enabled once initMag() has written the operating mode
+    EXPECT_TRUE(spi.m_regs[CTRL_REG3_M] & LSM9DS1_CTRL_REG3_M_SIM);
+    EXPECT_TRUE(spi.m_regs[CTRL_REG3_M] & LSM9DS1_CTRL_REG3_M_I2C_DISABLE);
+
+    EXPECT_EQ(0, spi.overlaps);
+    EXPECT_EQ(0, spi.locks);
+    EXPECT_EQ(1, mbed::DigitalOut::level((int) CS_AG));
+    EXPECT_EQ(1, mbed::DigitalOut::level((int) CS_M));
+}
+
+TEST_F(TestLSM9DS1SPI, readings_are_single_bursts)
+{
+    LSM9DS1 imu(spi, CS_AG, CS_M);
+    ASSERT_NE(0, imu.begin());
+    load_words(spi.xg_regs, OUT_X_L_XL, 1000, -2000, 16384);
+    load_words(spi.xg_regs, OUT_X_L_G, -1, 32767, -32768);
+    load_words(spi.m_regs, OUT_X_L_M, 0x1234, -300, 0x0F0F);
+    spi.frames = 0;
+
+    EXPECT_EQ(0, imu.readAccel());
+    EXPECT_EQ(1000, imu.ax);
+    EXPECT_EQ(-2000, imu.ay);
+    EXPECT_EQ(16384, imu.az);
+
+    EXPECT_EQ(0, imu.readGyro());
+    EXPECT_EQ(-1, imu.gx);
+    EXPECT_EQ(32767, imu.gy);
+    EXPECT_EQ(-32768, imu.gz);
+
+    // The mock magnetometer only increments with bit 6 set, so a missing
+    // bit would return the OUT_X_L_M byte six times
+    EXPECT_EQ(0, imu.readMag());
+    EXPECT_EQ(0x1234, imu.mx);
+    EXPECT_EQ(-300, imu.my);
+    EXPECT_EQ(0x0F0F, imu.mz);
+
+    EXPECT_EQ(3, spi.frames);
+}
+
+TEST_F(TestLSM9DS1SPI, writes_go_to_the_selected_die)
+{
+    LSM9DS1 imu(spi, CS_AG, CS_M);
+    ASSERT_NE(0, imu.begin());
+
+    imu.setGyroODR(3);
+    EXPECT_EQ(3, spi.xg_regs[CTRL_REG1_G] >> 5);
+
+    imu.setMagODR(5);
+    EXPECT_EQ(5, (spi.m_regs[CTRL_REG1_M] >> 2) & 0x07);
+}
+
+TEST_F(TestLSM9DS1SPI, bus_errors_are_reported)
+{
+    LSM9DS1 imu(spi, CS_AG, CS_M);
+    ASSERT_NE(0, imu.begin());
+    load_words(spi.xg_regs, OUT_X_L_XL, 1, 2, 3);
+    ASSERT_EQ(0, imu.readAccel());
+
+    spi.fail = true;
+    load_words(spi.xg_regs, OUT_X_L_XL, 4, 5, 6);
+    EXPECT_NE(0, imu.readAccel());
+    EXPECT_EQ(1, imu.ax);
+    EXPECT_EQ(2, imu.ay);
+    EXPECT_EQ(3, imu.az);
+    EXPECT_EQ(1u, imu.getBusErrors());
+
+    // Chip select and bus lock are released on failure too
+    EXPECT_EQ(1, mbed::DigitalOut::level((int) CS_AG));
+    EXPECT_EQ(0, spi.locks);
+
+    spi.fail = false;
+    EXPECT_EQ(0, imu.readAccel());
+    EXPECT_EQ(4, imu.ax);
+}
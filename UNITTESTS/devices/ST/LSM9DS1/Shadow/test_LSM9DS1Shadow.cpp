@@ -0,0 +1,191 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LSM9DS1.h"
+
+#include <stdint.h>
+
+class TestLSM9DS1Shadow : public testing::Test {
+
+    virtual void SetUp()
+    {
+        i2c.xg_regs[WHO_AM_I_XG] = WHO_AM_I_AG_RSP;
+        i2c.m_regs[WHO_AM_I_M] = WHO_AM_I_M_RSP;
+        // Power-on value, IF_ADD_INC set
+        i2c.xg_regs[CTRL_REG8] = 0x04;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void reset_counters()
+    {
+        i2c.transactions = 0;
+        i2c.stops = 0;
+        i2c.repeated_starts = 0;
+    }
+
+    mbed::I2C i2c;
+};
+
+TEST_F(TestLSM9DS1Shadow, begin_writes_the_configuration)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    EXPECT_EQ(0u, imu.getBusErrors());
+
+    // Default settings: 952 Hz gyro and accel, all axes, latched interrupts,
+    // 80 Hz ultra-high performance mag in continuous mode
+    EXPECT_EQ(0xC0, i2c.xg_regs[CTRL_REG1_G]);
+    EXPECT_EQ(0x3A, i2c.xg_regs[CTRL_REG4]);
+    EXPECT_EQ(0x38, i2c.xg_regs[CTRL_REG5_XL]);
+    EXPECT_EQ(0xC0, i2c.xg_regs[CTRL_REG6_XL]);
+    EXPECT_EQ(0x04, i2c.xg_regs[CTRL_REG8]);
+    EXPECT_EQ(0x7C, i2c.m_regs[CTRL_REG1_M]);
+    EXPECT_EQ(0x0C, i2c.m_regs[CTRL_REG4_M]);
+}
+
+TEST_F(TestLSM9DS1Shadow, read_modify_write_does_not_read_the_bus)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    reset_counters();
+
+    imu.setGyroScale(2000);
+    imu.setAccelODR(XL_ODR_119);
+    imu.setMagScale(12);
+    imu.configInt(XG_INT1, INT_DRDY_G, INT_ACTIVE_LOW);
+    imu.sleepGyro(true);
+    imu.enableFIFO(true);
+
+    // One write each, configInt() writes INT1_CTRL and CTRL_REG8
+    EXPECT_EQ(7, i2c.transactions);
+    EXPECT_EQ(0, i2c.repeated_starts);
+
+    EXPECT_EQ(0xD8, i2c.xg_regs[CTRL_REG1_G]);
+    EXPECT_EQ(0x60, i2c.xg_regs[CTRL_REG6_XL]);
+    EXPECT_EQ(0x40, i2c.m_regs[CTRL_REG2_M]);
+    EXPECT_EQ(INT_DRDY_G, i2c.xg_regs[INT1_CTRL]);
+    // IF_ADD_INC kept, H_LACTIVE set
+    EXPECT_EQ(0x24, i2c.xg_regs[CTRL_REG8] & 0x24);
+    EXPECT_EQ(0x40 | 0x02, i2c.xg_regs[CTRL_REG9]);
+}
+
+TEST_F(TestLSM9DS1Shadow, sync_picks_up_outside_changes)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+
+    // Changed behind the driver's back, the shadow still holds 0
+    i2c.xg_regs[CTRL_REG9] = 0x04;
+    ASSERT_EQ(0, imu.syncConfiguration());
+    imu.sleepGyro(true);
+    EXPECT_EQ(0x44, i2c.xg_regs[CTRL_REG9]);
+}
+
+TEST_F(TestLSM9DS1Shadow, deferred_changes_go_out_in_bursts)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    reset_counters();
+
+    imu.deferConfiguration();
+    imu.setGyroScale(500);
+    imu.setGyroODR(G_ODR_119);
+    imu.setAccelScale(8);
+    imu.configInt(XG_INT1, INT_FTH, INT_ACTIVE_HIGH, INT_PUSH_PULL);
+    imu.enableFIFO(true);
+    imu.setMagODR(M_ODR_40);
+    imu.setMagScale(16);
+    EXPECT_EQ(0, i2c.transactions);
+    EXPECT_EQ(0xC0, i2c.xg_regs[CTRL_REG1_G]);
+
+    // INT1_CTRL, CTRL_REG1_G, CTRL_REG6_XL to CTRL_REG9, CTRL_REG1_M and
+    // CTRL_REG2_M
+    ASSERT_EQ(0, imu.applyConfiguration());
+    EXPECT_EQ(4, i2c.transactions);
+
+    EXPECT_EQ(INT_FTH, i2c.xg_regs[INT1_CTRL]);
+    EXPECT_EQ(0x68, i2c.xg_regs[CTRL_REG1_G]);
+    EXPECT_EQ(0xD8, i2c.xg_regs[CTRL_REG6_XL]);
+    EXPECT_EQ(0x04, i2c.xg_regs[CTRL_REG8] & 0x24);
+    EXPECT_EQ(0x02, i2c.xg_regs[CTRL_REG9]);
+    EXPECT_EQ(0x78, i2c.m_regs[CTRL_REG1_M]);
+    EXPECT_EQ(0x60, i2c.m_regs[CTRL_REG2_M]);
+
+    // Back to write-through
+    reset_counters();
+    imu.sleepGyro(true);
+    EXPECT_EQ(1, i2c.transactions);
+}
+
+TEST_F(TestLSM9DS1Shadow, unchanged_registers_are_not_written)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+    reset_counters();
+
+    imu.deferConfiguration();
+    imu.setGyroScale(245);
+    imu.setAccelScale(2);
+    imu.setMagODR(M_ODR_80);
+    EXPECT_EQ(0, imu.applyConfiguration());
+    EXPECT_EQ(0, i2c.transactions);
+}
+
+TEST_F(TestLSM9DS1Shadow, failed_writes_stay_pending)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+
+    i2c.nack = true;
+    imu.setGyroScale(2000);
+    EXPECT_EQ(1u, imu.getBusErrors());
+    EXPECT_EQ(0xC0, i2c.xg_regs[CTRL_REG1_G]);
+
+    i2c.nack = false;
+    reset_counters();
+    EXPECT_EQ(0, imu.applyConfiguration());
+    EXPECT_EQ(1, i2c.transactions);
+    EXPECT_EQ(0xD8, i2c.xg_regs[CTRL_REG1_G]);
+}
+
+TEST_F(TestLSM9DS1Shadow, reset_bits_are_not_cached)
+{
+    LSM9DS1 imu(i2c);
+    ASSERT_NE(0, imu.begin());
+
+    // Read back while a software reset is in progress
+    i2c.xg_regs[CTRL_REG8] = 0x04 | LSM9DS1_CTRL_REG8_SW_RESET;
+    ASSERT_EQ(0, imu.syncConfiguration());
+
+    // A later read-modify-write must not reset the part again
+    imu.configInt(XG_INT1, 0, INT_ACTIVE_LOW, INT_PUSH_PULL);
+    EXPECT_EQ(0, i2c.xg_regs[CTRL_REG8] & LSM9DS1_CTRL_REG8_SW_RESET);
+    EXPECT_EQ(0x24, i2c.xg_regs[CTRL_REG8] & 0x24);
+}
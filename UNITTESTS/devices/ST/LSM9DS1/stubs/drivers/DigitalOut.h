@@ -0,0 +1,114 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_DIGITALOUT_H_
+#define EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_DIGITALOUT_H_
+
+#include "PinNames.h"
+
+namespace mbed {
+
+/**
+ * Host-side DigitalOut for the LSM9DS1 tests
+ *
+ * Pin levels are kept in a table shared by all instances so the SPI mock
+ * can see which chip select is asserted. Tests use small pin numbers.
+ */
+class DigitalOut {
+public:
+
+    static const int PINS = 16;
+
+    DigitalOut(PinName pin, int value = 0) : _pin((int) pin)
+    {
+        write(value);
+    }
+
+    void write(int value)
+    {
+        if (level(_pin) && !value) {
+            falls()[_pin]++;
+        }
+        levels()[_pin] = value ? 1 : 0;
+    }
+
+    int read()
+    {
+        return level(_pin);
+    }
+
+    int is_connected()
+    {
+        return 1;
+    }
+
+    DigitalOut& operator=(int value)
+    {
+        write(value);
+        return *this;
+    }
+
+    operator int()
+    {
+        return read();
+    }
+
+    static int level(int pin)
+    {
+        return levels()[pin];
+    }
+
+    /** Number of high to low transitions seen on pin */
+    static int fall_count(int pin)
+    {
+        return falls()[pin];
+    }
+
+    static void reset()
+    {
+        for (int i = 0; i < PINS; i++) {
+            levels()[i] = 1;
+            falls()[i] = 0;
+        }
+    }
+
+private:
+
+    static int* levels()
+    {
+        static int table[PINS];
+        return table;
+    }
+
+    static int* falls()
+    {
+        static int table[PINS];
+        return table;
+    }
+
+    int _pin;
+};
+
+}
+
+#endif /* EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_DIGITALOUT_H_ */
@@ -0,0 +1,209 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_I2C_H_
+#define EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_I2C_H_
+
+#include <stdint.h>
+#include <string.h>
+
+namespace mbed {
+
+/**
+ * Host-side I2C bus mock for the LSM9DS1 tests
+ *
+ * Models the accel/gyro and magnetometer register files behind their
+ * addresses and counts bus transactions. The accel/gyro always
+ * auto-increments (IF_ADD_INC), the magnetometer only when the MSb of
+ * the sub-address is set.
+ *
+ * With CTRL_REG9.FIFO_EN set the accel/gyro outputs read from a FIFO of
+ * frames (gyro XYZ, accel XYZ) filled with push_frame(). The address wraps
+ * from OUT_Z_H_G to OUT_X_L_XL and from OUT_Z_H_XL back to OUT_X_L_G,
+ * which pops the frame, and FIFO_SRC reflects the FIFO state.
+ */
+class I2C {
+public:
+
+    static const int FIFO_DEPTH = 32;
+    static const int FRAME_BYTES = 12;
+
+    I2C() : transactions(0), stops(0), repeated_starts(0), nack(false),
+            xg_address(0x6B), m_address(0x1E), fifo_count(0), fifo_overrun(false),
+            _pointer(0), _increment(false)
+    {
+        memset(xg_regs, 0, sizeof(xg_regs));
+        memset(m_regs, 0, sizeof(m_regs));
+    }
+
+    void frequency(int hz) { }
+
+    int write(int address, const char* data, int length, bool repeated = false)
+    {
+        transactions++;
+        if (nack || regs(address) == NULL) {
+            // A NACKed transfer is left open only if a repeated start was requested
+            if (!repeated) {
+                stops++;
+            }
+            return -1;
+        }
+        end(repeated);
+
+        uint8_t sub = (uint8_t) data[0];
+        _increment = (address == xg_address) || (sub & 0x80);
+        _pointer = sub & 0x7F;
+        for (int i = 1; i < length; i++) {
+            regs(address)[_pointer] = (uint8_t) data[i];
+            advance(address);
+        }
+        return 0;
+    }
+
+    int read(int address, char* data, int length, bool repeated = false)
+    {
+        transactions++;
+        if (nack || regs(address) == NULL) {
+            stops++;
+            return -1;
+        }
+        end(repeated);
+
+        for (int i = 0; i < length; i++) {
+            data[i] = (char) fetch(address);
+            advance(address);
+        }
+        return 0;
+    }
+
+    void start() { }
+
+    void stop()
+    {
+        stops++;
+    }
+
+    void lock() { }
+
+    void unlock() { }
+
+    /** Store a frame, dropping the oldest one when the FIFO is full */
+    void push_frame(const uint8_t* frame)
+    {
+        if (fifo_count == FIFO_DEPTH) {
+            memmove(fifo[0], fifo[1], (FIFO_DEPTH - 1) * FRAME_BYTES);
+            fifo_count--;
+            fifo_overrun = true;
+        }
+        memcpy(fifo[fifo_count++], frame, FRAME_BYTES);
+    }
+
+    uint8_t xg_regs[128];
+    uint8_t m_regs[128];
+
+    int transactions;
+    int stops;
+    int repeated_starts;
+    bool nack;
+
+    int xg_address;
+    int m_address;
+
+    uint8_t fifo[FIFO_DEPTH][FRAME_BYTES];
+    int fifo_count;
+    bool fifo_overrun;
+
+private:
+
+    uint8_t* regs(int address)
+    {
+        if (address == xg_address) {
+            return xg_regs;
+        }
+        if (address == m_address) {
+            return m_regs;
+        }
+        return NULL;
+    }
+
+    void end(bool repeated)
+    {
+        if (repeated) {
+            repeated_starts++;
+        } else {
+            stops++;
+        }
+    }
+
+    bool fifo_enabled(int address)
+    {
+        return (address == xg_address) && (xg_regs[0x23] & 0x02);
+    }
+
+    uint8_t fetch(int address)
+    {
+        if (!fifo_enabled(address)) {
+            return regs(address)[_pointer];
+        }
+
+        if (_pointer == 0x2F) {
+            uint8_t threshold = xg_regs[0x2E] & 0x1F;
+            return (fifo_count >= threshold ? 0x80 : 0) | (fifo_overrun ? 0x40 : 0) | fifo_count;
+        }
+        // Only the output registers read from the FIFO, 0 once it's empty
+        if (_pointer >= 0x18 && _pointer <= 0x1D) {
+            return fifo_count ? fifo[0][_pointer - 0x18] : 0;
+        }
+        if (_pointer >= 0x28 && _pointer <= 0x2D) {
+            return fifo_count ? fifo[0][6 + _pointer - 0x28] : 0;
+        }
+        return regs(address)[_pointer];
+    }
+
+    void advance(int address)
+    {
+        if (!_increment) {
+            return;
+        }
+
+        if (fifo_enabled(address) && _pointer == 0x1D) {
+            _pointer = 0x28;
+        } else if (fifo_enabled(address) && _pointer == 0x2D) {
+            _pointer = 0x18;
+            if (fifo_count > 0) {
+                memmove(fifo[0], fifo[1], (FIFO_DEPTH - 1) * FRAME_BYTES);
+                fifo_count--;
+                fifo_overrun = false;
+            }
+        } else {
+            _pointer = (_pointer + 1) & 0x7F;
+        }
+    }
+
+    uint8_t _pointer;
+    bool _increment;
+};
+
+}
+
+#endif /* EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_I2C_H_ */
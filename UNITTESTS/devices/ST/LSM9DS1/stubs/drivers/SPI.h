@@ -0,0 +1,189 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_SPI_H_
+#define EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_SPI_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "drivers/DigitalOut.h"
+
+namespace mbed {
+
+/**
+ * Host-side 4-wire SPI bus mock for the LSM9DS1 tests
+ *
+ * Models the accel/gyro and magnetometer register files behind their chip
+ * selects. The first byte after a chip select falling edge is the address
+ * byte (R/W in bit 7). The accel/gyro always auto-increments (IF_ADD_INC),
+ * the magnetometer only when bit 6 is set. Magnetometer reads return 0
+ * until CTRL_REG3_M.SIM enables them, like the real part.
+ */
+class SPI {
+public:
+
+    SPI() : frames(0), mode(-1), hz(0), locks(0), overlaps(0), fail(false),
+            cs_ag(1), cs_m(2), _regs(NULL), _falls(-1), _read(false),
+            _increment(false), _first(false), _pointer(0)
+    {
+        memset(xg_regs, 0, sizeof(xg_regs));
+        memset(m_regs, 0, sizeof(m_regs));
+    }
+
+    void format(int bits, int spi_mode = 0)
+    {
+        mode = spi_mode;
+    }
+
+    void frequency(int hz_)
+    {
+        hz = hz_;
+    }
+
+    int write(int value)
+    {
+        char rx = 0;
+        char tx = (char) value;
+        if (transfer(&tx, 1, &rx, 1) != 1) {
+            return 0xFF;
+        }
+        return (uint8_t) rx;
+    }
+
+    int write(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length)
+    {
+        return transfer(tx_buffer, tx_length, rx_buffer, rx_length);
+    }
+
+    void lock()
+    {
+        locks++;
+    }
+
+    void unlock()
+    {
+        locks--;
+    }
+
+    uint8_t xg_regs[128];
+    uint8_t m_regs[128];
+
+    int frames;
+    int mode;
+    int hz;
+    int locks;
+    int overlaps;
+    bool fail;
+
+    int cs_ag;
+    int cs_m;
+
+private:
+
+    int transfer(const char* tx, int tx_length, char* rx, int rx_length)
+    {
+        if (fail) {
+            return 0;
+        }
+
+        int selected = select();
+        if (selected < 0) {
+            return 0;
+        }
+
+        int length = (tx_length > rx_length) ? tx_length : rx_length;
+        for (int i = 0; i < length; i++) {
+            uint8_t out = (i < tx_length && tx != NULL) ? (uint8_t) tx[i] : 0xFF;
+            uint8_t in = clock(selected, out);
+            if (i < rx_length && rx != NULL) {
+                rx[i] = (char) in;
+            }
+        }
+        return length;
+    }
+
+    /** Chip select that is asserted, starts a new frame on a falling edge */
+    int select()
+    {
+        bool ag = !DigitalOut::level(cs_ag);
+        bool m = !DigitalOut::level(cs_m);
+        if (ag && m) {
+            overlaps++;
+            return -1;
+        }
+        if (!ag && !m) {
+            return -1;
+        }
+
+        int pin = ag ? cs_ag : cs_m;
+        int falls = DigitalOut::fall_count(pin);
+        if (_regs == NULL || falls != _falls || (ag != (_regs == xg_regs))) {
+            frames++;
+            _regs = ag ? xg_regs : m_regs;
+            _falls = falls;
+            _first = true;
+        }
+        return pin;
+    }
+
+    uint8_t clock(int pin, uint8_t out)
+    {
+        if (_first) {
+            _first = false;
+            _read = (out & 0x80);
+            if (pin == cs_ag) {
+                _increment = true;
+                _pointer = out & 0x7F;
+            } else {
+                _increment = (out & 0x40);
+                _pointer = out & 0x3F;
+            }
+            return 0;
+        }
+
+        uint8_t in = 0;
+        if (_read) {
+            if (_regs == xg_regs || (m_regs[0x22] & 0x04)) {
+                in = _regs[_pointer];
+            }
+        } else {
+            _regs[_pointer] = out;
+        }
+        if (_increment) {
+            _pointer = (_pointer + 1) & 0x7F;
+        }
+        return in;
+    }
+
+    uint8_t* _regs;
+    int _falls;
+    bool _read;
+    bool _increment;
+    bool _first;
+    uint8_t _pointer;
+};
+
+}
+
+#endif /* EP_OC_MCU_UNITTESTS_LSM9DS1_STUBS_SPI_H_ */
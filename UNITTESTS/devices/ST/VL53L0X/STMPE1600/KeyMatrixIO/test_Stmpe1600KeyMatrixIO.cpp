@@ -0,0 +1,161 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "Stmpe1600KeyMatrixIO.h"
+
+#include <stdint.h>
+
+extern "C" {
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return NULL;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return 0;
+}
+
+}
+
+/** Rows on GPIO 8/9, columns on GPIO 0-2, the other pins are not part of the matrix */
+static const uint8_t rows[] = { 8, 9 };
+static const uint8_t cols[] = { 0, 1, 2 };
+
+/**
+ * Scans a simulated 2 x 3 matrix wired to the mocked STMPE1600
+ *
+ * An input column reads low when a closed key connects it to a row that is
+ * an output set low, otherwise its external pull-up makes it read high.
+ */
+class TestStmpe1600KeyMatrixIO : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestStmpe1600KeyMatrixIO() : expander(&bus)
+    {
+        for(int r = 0; r < 2; r++) {
+            for(int c = 0; c < 3; c++) {
+                closed[r][c] = false;
+            }
+        }
+        bus.on_read = mbed::callback(this, &TestStmpe1600KeyMatrixIO::on_read);
+    }
+
+    uint8_t on_read(uint8_t reg)
+    {
+        if(reg != GPMR_0_7 && reg != GPMR_8_15) {
+            return bus.regs[reg];
+        }
+
+        uint16_t outputs = gpdr();
+        uint16_t levels = (bus.reg16(GPSR_0_7) & outputs) | ~outputs;
+        for(int r = 0; r < 2; r++) {
+            bool driven_low = (outputs & (1 << rows[r])) && !(bus.reg16(GPSR_0_7) & (1 << rows[r]));
+            for(int c = 0; c < 3; c++) {
+                if(driven_low && closed[r][c] && !(outputs & (1 << cols[c]))) {
+                    levels &= ~(1 << cols[c]);
+                }
+            }
+        }
+        return (reg == GPMR_0_7) ? (uint8_t) levels : (uint8_t)(levels >> 8);
+    }
+
+    uint16_t gpdr(void)
+    {
+        return bus.reg16(GPDR_0_7);
+    }
+
+    DevI2C bus;
+    Stmpe1600 expander;
+    bool closed[2][3];
+};
+
+TEST_F(TestStmpe1600KeyMatrixIO, idle_configuration)
+{
+    expander.set_gpio_dir(GPIO_15, OUTPUT);
+    expander.set_gpio_dir(GPIO_8, OUTPUT);
+
+    ep::Stmpe1600KeyMatrixIO io(expander, rows, 2, cols, 3);
+
+    // Rows and columns are inputs, rows are set low, GPIO_15 is still an output
+    EXPECT_EQ(0x8000u, gpdr());
+    EXPECT_EQ(0u, bus.reg16(GPSR_0_7) & 0x0300);
+}
+
+TEST_F(TestStmpe1600KeyMatrixIO, select_row)
+{
+    ep::Stmpe1600KeyMatrixIO io(expander, rows, 2, cols, 3);
+
+    int writes = bus.writes;
+    io.select_row(1);
+    EXPECT_EQ(0x0200u, gpdr());
+    io.select_row(0);
+    EXPECT_EQ(0x0100u, gpdr());
+    io.release_rows();
+    EXPECT_EQ(0x0000u, gpdr());
+
+    // One register write per row
+    EXPECT_EQ(writes + 3, bus.writes);
+}
+
+TEST_F(TestStmpe1600KeyMatrixIO, read_columns)
+{
+    ep::Stmpe1600KeyMatrixIO io(expander, rows, 2, cols, 3);
+    closed[0][1] = true;
+
+    io.select_row(0);
+    EXPECT_EQ(0x2u, io.read_columns());
+    io.select_row(1);
+    EXPECT_EQ(0x0u, io.read_columns());
+    io.release_rows();
+    EXPECT_EQ(0x0u, io.read_columns());
+}
+
+TEST_F(TestStmpe1600KeyMatrixIO, other_pins_reconfigured_while_scanning)
+{
+    ep::Stmpe1600KeyMatrixIO io(expander, rows, 2, cols, 3);
+
+    // The application changes pins outside the matrix between scans
+    io.select_row(0);
+    expander.set_gpio_dir(GPIO_4, OUTPUT);
+    io.select_row(1);
+    EXPECT_EQ(0x0210u, gpdr());
+    io.release_rows();
+    EXPECT_EQ(0x0010u, gpdr());
+
+    expander.set_gpio_dir(GPIO_4, INPUT);
+    io.select_row(0);
+    EXPECT_EQ(0x0100u, gpdr());
+}
@@ -0,0 +1,25 @@
+####################
+# UNIT TESTS
+####################
+
+# The DevI2C mock must shadow the X_NUCLEO_COMMON one, the mocks mbed-os' EventQueue, Kernel clock and Timeout
+set(unittest-includes
+  devices/ST/VL53L0X/STMPE1600/stubs
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+  ../devices/ST/VL53L0X/STMPE1600/
+)
+
+set(unittest-sources
+  ../drivers/src/VerticalCounterDebouncer.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+)
+
+set(unittest-test-sources
+  devices/ST/VL53L0X/STMPE1600/KeyMatrixIO/test_Stmpe1600KeyMatrixIO.cpp
+)
@@ -0,0 +1,76 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_STMPE1600_STUBS_DEVI2C_H_
+#define EP_OC_MCU_UNITTESTS_STMPE1600_STUBS_DEVI2C_H_
+
+#include "platform/Callback.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Host-side DevI2C mock for the STMPE1600 tests
+ *
+ * Models the register file of a single STMPE1600, multi-byte transfers
+ * continue at the next register. Reads go through on_read when it is set,
+ * so tests can model the pin levels.
+ */
+class DevI2C {
+public:
+
+    DevI2C() : writes(0)
+    {
+        memset(regs, 0, sizeof(regs));
+    }
+
+    int i2c_write(uint8_t *pBuffer, uint8_t DeviceAddr, uint8_t RegisterAddr, uint16_t NumByteToWrite)
+    {
+        for (uint16_t i = 0; i < NumByteToWrite; i++) {
+            regs[(RegisterAddr + i) % sizeof(regs)] = pBuffer[i];
+        }
+        writes++;
+        return 0;
+    }
+
+    int i2c_read(uint8_t *pBuffer, uint8_t DeviceAddr, uint8_t RegisterAddr, uint16_t NumByteToRead)
+    {
+        for (uint16_t i = 0; i < NumByteToRead; i++) {
+            uint8_t reg = (RegisterAddr + i) % sizeof(regs);
+            pBuffer[i] = on_read ? on_read(reg) : regs[reg];
+        }
+        return 0;
+    }
+
+    /** Returns a 16-bit register pair (low byte first, as on the chip) */
+    uint16_t reg16(uint8_t reg)
+    {
+        return (uint16_t)(regs[reg] | (regs[reg + 1] << 8));
+    }
+
+    uint8_t regs[0x18];
+    int writes;
+    mbed::Callback<uint8_t(uint8_t)> on_read;
+};
+
+#endif /* EP_OC_MCU_UNITTESTS_STMPE1600_STUBS_DEVI2C_H_ */
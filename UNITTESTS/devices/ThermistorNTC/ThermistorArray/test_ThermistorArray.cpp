@@ -0,0 +1,230 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "ThermistorArray.h"
+
+#include <math.h>
+
+/** 10k NTC on a 10k fixed pull-down, supplied by the ADC reference */
+#define R_FIXED_OHMS    10000.0f
+#define R_ROOM_OHMS     10000.0f
+#define BETA            3957.0f
+
+/** Exposes the filter state of the array */
+template<size_t N>
+class ThermistorArrayProbe : public ep::ThermistorArray<N> {
+public:
+
+    ThermistorArrayProbe(ep::ThermistorNTC* const (&channels)[N], uint8_t oversample,
+            uint8_t filter_shift) : ep::ThermistorArray<N>(channels, oversample, filter_shift) {
+    }
+
+    int32_t state(size_t channel) const {
+        return this->filter_state[channel];
+    }
+};
+
+/**
+ * Tests for the ThermistorArray scanner
+ *
+ * The thermistors sit on mocked AnalogIns, so the filter can be driven
+ * with exact ADC codes
+ */
+class TestThermistorArray : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestThermistorArray() :
+        div0(adc0, R_FIXED_OHMS), div1(adc1, R_FIXED_OHMS),
+        ntc0(div0, R_FIXED_OHMS, BETA, R_ROOM_OHMS),
+        ntc1(div1, R_FIXED_OHMS, BETA, R_ROOM_OHMS)
+    {
+        channels[0] = &ntc0;
+        channels[1] = &ntc1;
+    }
+
+    mbed::AnalogIn adc0;
+    mbed::AnalogIn adc1;
+    ep::ResistorDivider div0;
+    ep::ResistorDivider div1;
+    ep::ThermistorNTC ntc0;
+    ep::ThermistorNTC ntc1;
+    ep::ThermistorNTC* channels[2];
+};
+
+/** Each scan averages the configured number of samples per channel */
+TEST_F(TestThermistorArray, oversampling_averages_samples)
+{
+    ThermistorArrayProbe<2> array(channels, 4, 0);
+
+    const uint16_t codes[] = { 1000, 1001, 1002, 1003 };
+    adc0.set_sequence(codes, 4);
+    adc1.code = 3000;
+
+    array.scan();
+
+    EXPECT_EQ(4, adc0.reads);
+    EXPECT_EQ(4, adc1.reads);
+    EXPECT_EQ((4006 << 8) / 4, array.state(0));
+    EXPECT_EQ(3000 << 8, array.state(1));
+}
+
+/** The first scan seeds the filter, later scans follow y += (x - y)/2^shift */
+TEST_F(TestThermistorArray, step_response_is_first_order)
+{
+    ThermistorArrayProbe<2> array(channels, 1, 2);
+
+    adc0.code = 1000;
+    array.scan();
+    EXPECT_EQ(1000 << 8, array.state(0));
+
+    adc0.code = 2000;
+    double expected = 1000 << 8;
+    for(int i = 0; i < 40; i++) {
+        array.scan();
+        expected += ((2000 << 8) - expected) / 4.0;
+        EXPECT_NEAR(expected, array.state(0), 2.0) << "scan " << i;
+    }
+
+    // Settled to the input code, and the snapshot reflects it
+    EXPECT_EQ(ntc0.code_to_temperature(2000), array.get_temperature(0));
+}
+
+/** Rising and falling steps of the same size settle the same distance from the input */
+TEST_F(TestThermistorArray, step_response_is_symmetric)
+{
+    ThermistorArrayProbe<2> array(channels, 1, 3);
+
+    adc0.code = 1000;
+    adc1.code = 1600;
+    array.scan();
+
+    adc0.code = 1600;
+    adc1.code = 1000;
+    for(int i = 0; i < 80; i++) {
+        array.scan();
+        EXPECT_EQ(array.state(0) - (1000 << 8),
+                (1600 << 8) - array.state(1)) << "scan " << i;
+    }
+
+    // Neither direction is left more than half a step short of the input
+    EXPECT_LE(abs(array.state(0) - (1600 << 8)), 1 << 2);
+    EXPECT_LE(abs(array.state(1) - (1000 << 8)), 1 << 2);
+
+    // Small negative steps are not exaggerated by rounding toward -infinity
+    adc0.code = 1601;
+    adc1.code = 999;
+    array.scan();
+    EXPECT_EQ(array.state(0) - (1600 << 8), (1000 << 8) - array.state(1));
+}
+
+/** A filter shift of 0 passes the decimated samples straight through */
+TEST_F(TestThermistorArray, filter_disabled)
+{
+    ThermistorArrayProbe<2> array(channels, 1, 0);
+
+    adc0.code = 1000;
+    array.scan();
+    adc0.code = 40000;
+    array.scan();
+
+    EXPECT_EQ(40000 << 8, array.state(0));
+    EXPECT_EQ(ntc0.code_to_temperature(40000), array.get_temperature(0));
+}
+
+/** Readers only ever see complete scans, never a scan in progress */
+TEST_F(TestThermistorArray, snapshot_is_consistent)
+{
+    ep::ThermistorArray<2> array(channels, 1, 0);
+
+    ep::ThermistorArray<2>::snapshot_t initial = array.get_snapshot();
+    EXPECT_EQ(0u, initial.sequence);
+
+    adc0.code = 20000;
+    adc1.code = 30000;
+    array.scan();
+    ep::ThermistorArray<2>::snapshot_t first = array.get_snapshot();
+    EXPECT_EQ(1u, first.sequence);
+    EXPECT_EQ(ntc0.code_to_temperature(20000), first.celsius[0]);
+    EXPECT_EQ(ntc1.code_to_temperature(30000), first.celsius[1]);
+
+    // Sample channel 1 after channel 0 has already been converted
+    int checks = 0;
+    adc1.on_read = [&]() {
+        ep::ThermistorArray<2>::snapshot_t during = array.get_snapshot();
+        EXPECT_EQ(first.sequence, during.sequence);
+        EXPECT_EQ(first.celsius[0], during.celsius[0]);
+        EXPECT_EQ(first.celsius[1], during.celsius[1]);
+        checks++;
+    };
+
+    adc0.code = 25000;
+    adc1.code = 35000;
+    array.scan();
+    EXPECT_EQ(1, checks);
+
+    ep::ThermistorArray<2>::snapshot_t second = array.get_snapshot();
+    EXPECT_EQ(2u, second.sequence);
+    EXPECT_EQ(ntc0.code_to_temperature(25000), second.celsius[0]);
+    EXPECT_EQ(ntc1.code_to_temperature(35000), second.celsius[1]);
+    EXPECT_EQ(second.celsius[1], array.get_temperature(1));
+}
+
+/** Published snapshots match the cached one */
+TEST_F(TestThermistorArray, publishes_snapshots)
+{
+    ep::ThermistorArray<2> array(channels, 1, 0);
+    ep::BoundVariable<ep::ThermistorArray<2>::snapshot_t> published;
+
+    int count = 0;
+    ep::ThermistorArray<2>::snapshot_t last;
+    published.attach([&](ep::ThermistorArray<2>::snapshot_t snapshot) {
+        last = snapshot;
+        count++;
+    });
+    array.publish_to(&published);
+
+    adc0.code = 20000;
+    adc1.code = 30000;
+    array.scan();
+    array.scan();
+
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(2u, last.sequence);
+    EXPECT_EQ(array.get_snapshot().celsius[0], last.celsius[0]);
+    EXPECT_EQ(array.get_snapshot().celsius[1], last.celsius[1]);
+
+    array.publish_to(NULL);
+    array.scan();
+    EXPECT_EQ(2, count);
+}
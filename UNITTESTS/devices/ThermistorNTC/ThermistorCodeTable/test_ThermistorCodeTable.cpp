@@ -0,0 +1,145 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "ThermistorCodeTable.h"
+#include "ValueMapping.h"
+
+#include "ge1923.h"
+
+#include <math.h>
+
+/** Typical 10k NTC (GE 1923 series) on a 10k fixed resistor */
+#define R_FIXED_OHMS    10000.0f
+#define R_ROOM_OHMS     10000.0f
+
+/**
+ * Tests for the precomputed ADC code to temperature table
+ *
+ * Each table lookup is compared against the per-sample float conversion path
+ * (code -> ohms -> beta equation/ValueMapping) that ThermistorNTC otherwise uses
+ */
+class TestThermistorCodeTable : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    /**
+     * Checks every ADC code whose float-path temperature lies inside the
+     * given range and returns the worst absolute error of the table
+     */
+    float max_beta_error(const ep::ThermistorCodeTable& table, bool ntc_is_pull_up,
+            float min_temp, float max_temp) {
+        float max_error = 0.0f;
+        for(uint32_t code = 0; code <= 0xFFFF; code++) {
+            float expected = ep::ThermistorCodeTable::beta_to_celsius(
+                    ep::ThermistorCodeTable::code_to_ohms(code, R_FIXED_OHMS, ntc_is_pull_up),
+                    ge1923::beta_value, R_ROOM_OHMS);
+            if(expected < min_temp || expected > max_temp) {
+                continue;
+            }
+            float error = fabsf(table.lookup(code) - expected);
+            if(error > max_error) {
+                max_error = error;
+            }
+        }
+        return max_error;
+    }
+};
+
+/** Beta equation table, NTC as the pull-up */
+TEST_F(TestThermistorCodeTable, beta_pull_up_accuracy)
+{
+    ep::ThermistorCodeTable table;
+    EXPECT_FALSE(table.is_built());
+    table.build_from_beta(R_FIXED_OHMS, ge1923::beta_value, R_ROOM_OHMS, true);
+    EXPECT_TRUE(table.is_built());
+
+    EXPECT_LT(max_beta_error(table, true, -30.0f, 85.0f), 0.02f);
+}
+
+/** Beta equation table, NTC as the pull-down */
+TEST_F(TestThermistorCodeTable, beta_pull_down_accuracy)
+{
+    ep::ThermistorCodeTable table;
+    table.build_from_beta(R_FIXED_OHMS, ge1923::beta_value, R_ROOM_OHMS, false);
+
+    EXPECT_LT(max_beta_error(table, false, -30.0f, 85.0f), 0.02f);
+}
+
+/** Nominal resistance must read back as room temperature */
+TEST_F(TestThermistorCodeTable, beta_room_temperature)
+{
+    ep::ThermistorCodeTable table;
+    table.build_from_beta(R_FIXED_OHMS, ge1923::beta_value, R_ROOM_OHMS, true);
+
+    // R_ntc == R_fixed puts Vout at half scale
+    EXPECT_NEAR(table.lookup(0x8000), 25.0f, 0.01f);
+}
+
+/** Calibration table (ValueMapping) based table */
+TEST_F(TestThermistorCodeTable, calibration_table_accuracy)
+{
+    ep::LinearlyInterpolatedValueMapping ge1923_map(
+            mbed::make_const_Span(ge1923::calibration_table));
+
+    ep::ThermistorCodeTable table;
+    table.build_from_map(R_FIXED_OHMS, ge1923_map, true);
+
+    float max_error = 0.0f;
+    for(uint32_t code = 0; code <= 0xFFFF; code++) {
+        float expected = ge1923_map.lookup(
+                ep::ThermistorCodeTable::code_to_ohms(code, R_FIXED_OHMS, true));
+        if(expected < -30.0f || expected > 80.0f) {
+            continue;
+        }
+        float error = fabsf(table.lookup(code) - expected);
+        if(error > max_error) {
+            max_error = error;
+        }
+    }
+
+    EXPECT_LT(max_error, 0.1f);
+}
+
+/** The rails (open/shorted NTC) must still give finite, ordered results */
+TEST_F(TestThermistorCodeTable, rails_are_finite)
+{
+    ep::ThermistorCodeTable table;
+    table.build_from_beta(R_FIXED_OHMS, ge1923::beta_value, R_ROOM_OHMS, true);
+
+    EXPECT_TRUE(isfinite(table.lookup(0x0000)));
+    EXPECT_TRUE(isfinite(table.lookup(0xFFFF)));
+
+    // NTC as pull-up: higher Vout means lower resistance means higher temperature
+    EXPECT_LT(table.lookup(0x0000), table.lookup(0x8000));
+    EXPECT_LT(table.lookup(0x8000), table.lookup(0xFFFF));
+}
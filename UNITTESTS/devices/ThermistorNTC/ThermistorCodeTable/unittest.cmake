@@ -0,0 +1,22 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../devices/ThermistorNTC/
+  ../devices/ThermistorNTC/tables/
+  ../extensions/dsp/
+)
+
+set(unittest-sources
+  ../devices/ThermistorNTC/ThermistorCodeTable.cpp
+)
+
+set(unittest-test-sources
+  devices/ThermistorNTC/ThermistorCodeTable/test_ThermistorCodeTable.cpp
+)
@@ -0,0 +1,117 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "DebounceIntegrator.h"
+
+#include <stdint.h>
+
+class TestDebounceIntegrator : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+};
+
+TEST_F(TestDebounceIntegrator, integrates_like_debounce_in)
+{
+    ep::DebounceIntegrator integrator(0, 3);
+
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(1));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(0));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(1));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(1));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_RISE, integrator.update(1));
+    EXPECT_EQ(1, integrator.read());
+    EXPECT_TRUE(integrator.is_settled(1));
+
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(0));
+    EXPECT_FALSE(integrator.is_settled(0));
+    EXPECT_FALSE(integrator.is_settled(1));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(0));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_FALL, integrator.update(0));
+    EXPECT_EQ(0, integrator.read());
+}
+
+TEST_F(TestDebounceIntegrator, initial_state_is_settled)
+{
+    ep::DebounceIntegrator high(1, 5);
+    EXPECT_EQ(1, high.read());
+    EXPECT_TRUE(high.is_settled(1));
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, high.update(1));
+}
+
+TEST_F(TestDebounceIntegrator, set_samples_after_reset_high)
+{
+    // Constructed with the default 10 samples, then seated high
+    ep::DebounceIntegrator integrator;
+    integrator.reset(1);
+
+    // eg: DebounceIn(pin, 200)
+    integrator.set_samples(20);
+    EXPECT_TRUE(integrator.is_settled(1));
+
+    for(int i = 0; i < 19; i++) {
+        EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(0)) << "sample " << i;
+    }
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_FALL, integrator.update(0));
+    EXPECT_TRUE(integrator.is_settled(0));
+
+    // Shortening a settled debounce takes effect immediately as well
+    integrator.set_samples(4);
+    EXPECT_TRUE(integrator.is_settled(0));
+    for(int i = 0; i < 3; i++) {
+        EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, integrator.update(1)) << "sample " << i;
+    }
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_RISE, integrator.update(1));
+}
+
+TEST_F(TestDebounceIntegrator, set_samples_during_change)
+{
+    ep::DebounceIntegrator integrator(0, 10);
+
+    for(int i = 0; i < 8; i++) {
+        integrator.update(1);
+    }
+
+    // A change in progress is clamped, not restarted
+    integrator.set_samples(5);
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_RISE, integrator.update(1));
+}
+
+TEST_F(TestDebounceIntegrator, tickless_window_settles_after_set_samples)
+{
+    // eg: TicklessDebounceIn(pin, 100, 1000) with the pin high
+    ep::DebounceWindow window(1, 10);
+    window.set_samples(100);
+
+    EXPECT_TRUE(window.edge());
+    EXPECT_EQ(ep::DebounceIntegrator::EDGE_NONE, window.sample(1));
+    EXPECT_FALSE(window.active());
+}
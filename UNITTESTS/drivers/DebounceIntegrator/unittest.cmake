@@ -0,0 +1,16 @@
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../drivers/
+)
+
+set(unittest-sources
+)
+
+set(unittest-test-sources
+  drivers/DebounceIntegrator/test_DebounceIntegrator.cpp
+)
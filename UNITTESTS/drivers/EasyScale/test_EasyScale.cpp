@@ -0,0 +1,150 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "EasyScale.h"
+
+/** Exposes the mocked pin and timeout of an EasyScale */
+class TestableEasyScale : public EasyScale {
+
+public:
+
+    TestableEasyScale() : EasyScale(NC)
+    {
+    }
+
+    mbed::DigitalInOut &pin()
+    {
+        return es_ctrl_pin;
+    }
+
+    mbed::Timeout &timeout()
+    {
+        return _timeout;
+    }
+
+    /** Fires the timeout until the asynchronous transfer ends */
+    void finish()
+    {
+        for (int i = 0; (i < 1000) && _timeout.attached; i++) {
+            _timeout.fire();
+        }
+    }
+};
+
+class TestEasyScale : public testing::Test {
+
+    virtual void SetUp()
+    {
+        done_count = 0;
+        done_ack = false;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void on_done(bool ack)
+    {
+        done_count++;
+        done_ack = ack;
+    }
+
+    TestableEasyScale es;
+    int done_count;
+    bool done_ack;
+};
+
+TEST_F(TestEasyScale, blocking_calls_release_the_bus)
+{
+    EXPECT_TRUE(es.power_on());
+    EXPECT_FALSE(es.is_busy());
+    EXPECT_TRUE(es.set_brightness(16));
+    EXPECT_FALSE(es.is_busy());
+    EXPECT_TRUE(es.shutdown());
+    EXPECT_FALSE(es.is_busy());
+    EXPECT_EQ(0, es.pin().level);
+}
+
+TEST_F(TestEasyScale, blocking_calls_rejected_during_async)
+{
+    ASSERT_TRUE(es.set_brightness_async(16, EasyScale::DEVICE_ADDRESS_TPS61158,
+                                        mbed::callback(this, &TestEasyScale::on_done)));
+    ASSERT_TRUE(es.is_busy());
+
+    int level = es.pin().level;
+    int writes = es.pin().writes;
+
+    EXPECT_FALSE(es.set_brightness(31));
+    EXPECT_FALSE(es.power_on());
+    EXPECT_FALSE(es.shutdown());
+
+    /** The transfer in progress is left alone */
+    EXPECT_EQ(level, es.pin().level);
+    EXPECT_EQ(writes, es.pin().writes);
+    EXPECT_TRUE(es.is_busy());
+    EXPECT_TRUE(es.timeout().attached);
+
+    es.finish();
+    EXPECT_EQ(1, done_count);
+    EXPECT_TRUE(done_ack);
+    EXPECT_FALSE(es.is_busy());
+
+    EXPECT_TRUE(es.set_brightness(31));
+}
+
+TEST_F(TestEasyScale, async_calls_rejected_during_async)
+{
+    ASSERT_TRUE(es.power_on_async(mbed::callback(this, &TestEasyScale::on_done)));
+    EXPECT_FALSE(es.power_on_async());
+    EXPECT_FALSE(es.set_brightness_async(16));
+
+    es.finish();
+    EXPECT_EQ(1, done_count);
+    EXPECT_FALSE(es.is_busy());
+
+    EXPECT_TRUE(es.set_brightness_async(16));
+    es.finish();
+    EXPECT_FALSE(es.is_busy());
+}
+
+TEST_F(TestEasyScale, abort_stops_async_transfer)
+{
+    EXPECT_FALSE(es.abort());
+
+    ASSERT_TRUE(es.set_brightness_async(16, EasyScale::DEVICE_ADDRESS_TPS61158,
+                                        mbed::callback(this, &TestEasyScale::on_done)));
+    es.timeout().fire();
+    ASSERT_TRUE(es.timeout().attached);
+
+    EXPECT_TRUE(es.abort());
+    EXPECT_FALSE(es.is_busy());
+    EXPECT_FALSE(es.timeout().attached);
+    EXPECT_EQ(1, es.pin().level);
+    EXPECT_EQ(0, done_count);
+
+    EXPECT_TRUE(es.set_brightness(16));
+}
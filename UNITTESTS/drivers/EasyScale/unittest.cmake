@@ -0,0 +1,23 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' Timeout, DigitalInOut and wait API
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+)
+
+set(unittest-sources
+  ../drivers/src/EasyScale.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+)
+
+set(unittest-test-sources
+  drivers/EasyScale/test_EasyScale.cpp
+)
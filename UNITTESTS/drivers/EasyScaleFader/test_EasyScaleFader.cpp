@@ -0,0 +1,331 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "EasyScaleFader.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+using namespace std::chrono;
+
+/** Lets the test clock out transfers and see what is on the bus */
+class TestableEasyScale : public EasyScale {
+
+public:
+
+    TestableEasyScale() : EasyScale(NC)
+    {
+    }
+
+    /** True while a brightness frame (rather than the power on sequence) is in flight */
+    bool sending_frame(void) const
+    {
+        return _busy && (_step_count > EasyScaleWaveform::PowerOnSteps);
+    }
+
+    /** Runs the remaining steps of the current transfer */
+    void complete(void)
+    {
+        while(_timeout.attached) {
+            _timeout.fire();
+        }
+    }
+};
+
+/** Exposes the fade state of the fader */
+class EasyScaleFaderProbe : public EasyScaleFader {
+
+public:
+
+    EasyScaleFaderProbe(EasyScale& easyscale, events::EventQueue& queue) :
+        EasyScaleFader(easyscale, queue)
+    {
+    }
+
+    uint32_t next_change(uint8_t start, uint8_t target, uint32_t duration_ms,
+            easing_t easing, uint32_t elapsed_ms)
+    {
+        _start_level = start;
+        _target = target;
+        _duration_ms = duration_ms;
+        _easing = easing;
+        return next_change_ms(elapsed_ms, level_at(start, target, elapsed_ms, duration_ms, easing));
+    }
+};
+
+class TestEasyScaleFader : public testing::Test {
+
+    virtual void SetUp()
+    {
+        rtos::Kernel::Clock::set(0);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestEasyScaleFader() : fader(easyscale, queue)
+    {
+    }
+
+    /**
+     * Runs the queue for the given time, completing each frame of the fader
+     * as soon as it starts, and records the levels sent
+     */
+    void run(milliseconds ms)
+    {
+        int64_t end = rtos::Kernel::Clock::now().time_since_epoch().count() + ms.count();
+        while(queue.dispatch_one(end)) {
+            if(easyscale.sending_frame()) {
+                frames.push_back(fader.get_level());
+                easyscale.complete();
+            }
+        }
+        rtos::Kernel::Clock::set(end);
+    }
+
+    static const EasyScaleFader::easing_t easings[4];
+
+    TestableEasyScale easyscale;
+    events::EventQueue queue;
+    EasyScaleFaderProbe fader;
+    std::vector<uint8_t> frames;
+};
+
+const EasyScaleFader::easing_t TestEasyScaleFader::easings[4] = {
+    EasyScaleFader::EASE_LINEAR, EasyScaleFader::EASE_IN,
+    EasyScaleFader::EASE_OUT, EasyScaleFader::EASE_IN_OUT
+};
+
+TEST_F(TestEasyScaleFader, level_at_end_points)
+{
+    for(int i = 0; i < 4; i++) {
+        EXPECT_EQ(3, EasyScaleFader::level_at(3, 28, 0, 500, easings[i]));
+        EXPECT_EQ(28, EasyScaleFader::level_at(3, 28, 500, 500, easings[i]));
+        EXPECT_EQ(28, EasyScaleFader::level_at(3, 28, 900, 500, easings[i]));
+        EXPECT_EQ(28, EasyScaleFader::level_at(3, 28, 0, 0, easings[i]));
+    }
+}
+
+TEST_F(TestEasyScaleFader, level_at_easing)
+{
+    // Half way through a 0 to 31 fade, rounded to nearest
+    EXPECT_EQ(16, EasyScaleFader::level_at(0, 31, 500, 1000, EasyScaleFader::EASE_LINEAR));   // 15.5
+    EXPECT_EQ(8, EasyScaleFader::level_at(0, 31, 500, 1000, EasyScaleFader::EASE_IN));        // 7.75
+    EXPECT_EQ(23, EasyScaleFader::level_at(0, 31, 500, 1000, EasyScaleFader::EASE_OUT));      // 23.25
+    EXPECT_EQ(16, EasyScaleFader::level_at(0, 31, 500, 1000, EasyScaleFader::EASE_IN_OUT));   // 15.5
+
+    // A quarter of the way
+    EXPECT_EQ(8, EasyScaleFader::level_at(0, 31, 250, 1000, EasyScaleFader::EASE_LINEAR));    // 7.75
+    EXPECT_EQ(2, EasyScaleFader::level_at(0, 31, 250, 1000, EasyScaleFader::EASE_IN));        // 1.94
+    EXPECT_EQ(14, EasyScaleFader::level_at(0, 31, 250, 1000, EasyScaleFader::EASE_OUT));      // 13.56
+    EXPECT_EQ(4, EasyScaleFader::level_at(0, 31, 250, 1000, EasyScaleFader::EASE_IN_OUT));    // 3.875
+
+    // Fading down mirrors fading up
+    EXPECT_EQ(15, EasyScaleFader::level_at(31, 0, 500, 1000, EasyScaleFader::EASE_LINEAR));
+    EXPECT_EQ(23, EasyScaleFader::level_at(31, 0, 500, 1000, EasyScaleFader::EASE_IN));
+}
+
+TEST_F(TestEasyScaleFader, level_at_is_monotonic)
+{
+    for(int i = 0; i < 4; i++) {
+        uint8_t up = 0;
+        uint8_t down = 31;
+        for(uint32_t t = 0; t <= 1000; t++) {
+            uint8_t level = EasyScaleFader::level_at(0, 31, t, 1000, easings[i]);
+            EXPECT_GE(level, up) << "easing " << i << " t " << t;
+            up = level;
+
+            level = EasyScaleFader::level_at(31, 0, t, 1000, easings[i]);
+            EXPECT_LE(level, down) << "easing " << i << " t " << t;
+            down = level;
+        }
+    }
+}
+
+TEST_F(TestEasyScaleFader, next_change_ms)
+{
+    for(int i = 0; i < 4; i++) {
+        for(uint32_t elapsed = 0; elapsed < 700; elapsed += 7) {
+            uint8_t level = EasyScaleFader::level_at(5, 25, elapsed, 700, easings[i]);
+
+            // First later time at which the level differs, or the end of the fade
+            uint32_t expected = elapsed + 1;
+            while(expected < 700 &&
+                    EasyScaleFader::level_at(5, 25, expected, 700, easings[i]) == level) {
+                expected++;
+            }
+
+            EXPECT_EQ(expected, fader.next_change(5, 25, 700, easings[i], elapsed))
+                    << "easing " << i << " elapsed " << elapsed;
+        }
+    }
+}
+
+TEST_F(TestEasyScaleFader, fade_sends_each_level_once)
+{
+    fader.fade_to(31, milliseconds(310));
+    run(milliseconds(400));
+
+    ASSERT_EQ(31u, frames.size());
+    for(uint8_t i = 0; i < 31; i++) {
+        EXPECT_EQ(i + 1, frames[i]);
+    }
+    EXPECT_EQ(31, fader.get_level());
+    EXPECT_FALSE(fader.is_fading());
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestEasyScaleFader, requests_are_coalesced)
+{
+    fader.fade_to(31, milliseconds(0));
+    fader.fade_to(10, milliseconds(0));
+    fader.fade_to(20, milliseconds(0));
+    EXPECT_EQ(1u, queue.pending());
+
+    run(milliseconds(10));
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(20, frames[0]);
+    EXPECT_FALSE(fader.is_fading());
+}
+
+TEST_F(TestEasyScaleFader, superseded_fade_is_dropped)
+{
+    fader.fade_to(31, milliseconds(310));
+    run(milliseconds(100));
+    ASSERT_EQ(10u, frames.size());
+
+    fader.fade_to(0, milliseconds(0));
+    run(milliseconds(400));
+
+    ASSERT_EQ(11u, frames.size());
+    EXPECT_EQ(0, frames[10]);
+    EXPECT_EQ(0, fader.get_level());
+    EXPECT_FALSE(fader.is_fading());
+}
+
+TEST_F(TestEasyScaleFader, waits_for_foreign_transfer)
+{
+    // The bus is taken by a transfer that won't call the fader back
+    ASSERT_TRUE(easyscale.power_on_async());
+    fader.fade_to(12, milliseconds(0));
+    run(milliseconds(20));
+
+    EXPECT_TRUE(frames.empty());
+    EXPECT_EQ(0, fader.get_level());
+    EXPECT_TRUE(fader.is_fading());
+
+    easyscale.complete();
+    run(milliseconds(20));
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(12, frames[0]);
+    EXPECT_FALSE(fader.is_fading());
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestEasyScaleFader, no_polling_while_own_frame_in_flight)
+{
+    fader.fade_to(5, milliseconds(0));
+    queue.dispatch_one(0);
+    ASSERT_TRUE(easyscale.sending_frame());
+
+    // Only on_frame_done() brings the fader back
+    EXPECT_EQ(0u, queue.pending());
+    easyscale.complete();
+    EXPECT_EQ(1u, queue.pending());
+    run(milliseconds(10));
+    EXPECT_EQ(5, fader.get_level());
+    EXPECT_FALSE(fader.is_fading());
+}
+
+TEST_F(TestEasyScaleFader, request_retried_when_queue_full)
+{
+    queue.set_capacity(0);
+    fader.fade_to(5, milliseconds(0));
+    EXPECT_EQ(0u, queue.pending());
+
+    queue.set_capacity(SIZE_MAX);
+    fader.fade_to(7, milliseconds(0));
+    EXPECT_EQ(1u, queue.pending());
+    run(milliseconds(10));
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(7, frames[0]);
+}
+
+TEST_F(TestEasyScaleFader, destructor_cancels_request)
+{
+    EasyScaleFader* temp = new EasyScaleFader(easyscale, queue);
+    temp->fade_to(5, milliseconds(0));
+    EXPECT_EQ(1u, queue.pending());
+
+    delete temp;
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestEasyScaleFader, destructor_aborts_frame_in_flight)
+{
+    EasyScaleFader* temp = new EasyScaleFader(easyscale, queue);
+    temp->fade_to(5, milliseconds(0));
+    queue.dispatch_one(0);
+    ASSERT_TRUE(easyscale.sending_frame());
+
+    delete temp;
+    EXPECT_FALSE(easyscale.is_busy());
+    EXPECT_EQ(0u, queue.pending());
+
+    // Nothing calls back into the deleted fader
+    easyscale.complete();
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestEasyScaleFader, destructor_cancels_frame_done_event)
+{
+    EasyScaleFader* temp = new EasyScaleFader(easyscale, queue);
+    temp->fade_to(5, milliseconds(0));
+    queue.dispatch_one(0);
+    ASSERT_TRUE(easyscale.sending_frame());
+    easyscale.complete();
+    ASSERT_EQ(1u, queue.pending());
+
+    delete temp;
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestEasyScaleFader, destructor_cancels_timer)
+{
+    EasyScaleFader* temp = new EasyScaleFader(easyscale, queue);
+    temp->fade_to(31, milliseconds(3100));
+    queue.dispatch_one(0);
+    ASSERT_EQ(1u, queue.pending());
+
+    delete temp;
+    EXPECT_EQ(0u, queue.pending());
+}
@@ -0,0 +1,25 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' EventQueue, Kernel clock, Timeout,
+# DigitalInOut and wait API
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+)
+
+set(unittest-sources
+  ../drivers/src/EasyScale.cpp
+  ../drivers/src/EasyScaleFader.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+)
+
+set(unittest-test-sources
+  drivers/EasyScaleFader/test_EasyScaleFader.cpp
+)
@@ -0,0 +1,238 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "EasyScaleWaveform.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** EasyScale data rate limits (TPS61158 datasheet) */
+#define EASYSCALE_MIN_BIT_US    6       /* 160kHz */
+#define EASYSCALE_MAX_BIT_US    588     /* 1.7kHz */
+#define EASYSCALE_MIN_EOS_US    2
+#define EASYSCALE_MIN_START_US  2
+
+#define TPS61158_ADDRESS        0x58
+
+/** A period of constant level on the simulated control line */
+struct segment_t {
+    int level;
+    uint32_t duration_us;
+    bool driven;        /** false while the master has released the line */
+};
+
+/**
+ * Replays waveform steps onto a simulated control line with a TPS61158
+ * slave that acknowledges frames addressed to it
+ */
+class WaveformSimulator {
+
+public:
+
+    WaveformSimulator(uint32_t latency_us = 0) : latency_us(latency_us), ack_sampled(false), ack(false) { }
+
+    void play(const easyscale_step_t* steps, size_t count, bool slave_acks) {
+        for(size_t i = 0; i < count; i++) {
+            const easyscale_step_t& step = steps[i];
+            switch(step.action) {
+                case easyscale_step_t::DRIVE_LOW:
+                    push(0, step.duration_us, true);
+                    break;
+                case easyscale_step_t::DRIVE_HIGH:
+                    push(1, step.duration_us, true);
+                    break;
+                case easyscale_step_t::RELEASE:
+                    // Pull-up, unless the slave is acknowledging
+                    push(slave_acks ? 0 : 1, step.duration_us, false);
+                    break;
+                case easyscale_step_t::SAMPLE_ACK:
+                    ack_sampled = true;
+                    ack = (segments.back().level == 0);
+                    push(segments.back().level, step.duration_us, false);
+                    break;
+            }
+        }
+    }
+
+    /** Decodes bits from driven low/high pairs, checking each bit's timing */
+    std::vector<uint8_t> decode_bytes(void) {
+        std::vector<uint8_t> bytes;
+        std::vector<segment_t> merged;
+        for(size_t i = 0; i < segments.size(); i++) {
+            if(!merged.empty() && merged.back().level == segments[i].level &&
+                    merged.back().driven == segments[i].driven) {
+                merged.back().duration_us += segments[i].duration_us;
+            } else {
+                merged.push_back(segments[i]);
+            }
+        }
+
+        uint8_t current = 0;
+        int bits = 0;
+        for(size_t i = 0; i + 1 < merged.size(); i++) {
+            const segment_t& low = merged[i];
+            const segment_t& high = merged[i + 1];
+            if(!low.driven || !high.driven || low.level != 0 || high.level != 1) {
+                continue;
+            }
+
+            uint32_t bit_us = low.duration_us + high.duration_us;
+            if(bits == 8) {
+                // EOS then start between bytes
+                EXPECT_GE(low.duration_us, (uint32_t) EASYSCALE_MIN_EOS_US);
+                EXPECT_GE(high.duration_us, (uint32_t) EASYSCALE_MIN_START_US);
+                bytes.push_back(current);
+                current = 0;
+                bits = 0;
+                i++;
+                continue;
+            }
+
+            EXPECT_GE(bit_us, (uint32_t) EASYSCALE_MIN_BIT_US);
+            EXPECT_LE(bit_us, (uint32_t) EASYSCALE_MAX_BIT_US);
+
+            bool one = high.duration_us > low.duration_us;
+            if(one) {
+                EXPECT_GE(high.duration_us, 2 * low.duration_us) << "bit " << bits;
+            } else {
+                EXPECT_GE(low.duration_us, 2 * high.duration_us) << "bit " << bits;
+            }
+            current = (current << 1) | (one ? 1 : 0);
+            bits++;
+            i++;
+        }
+        if(bits == 8) {
+            bytes.push_back(current);
+        }
+        return bytes;
+    }
+
+    uint32_t total_us(void) const {
+        uint32_t total = 0;
+        for(size_t i = 0; i < segments.size(); i++) {
+            total += segments[i].duration_us;
+        }
+        return total;
+    }
+
+    std::vector<segment_t> segments;
+    uint32_t latency_us;
+    bool ack_sampled;
+    bool ack;
+
+private:
+
+    void push(int level, uint32_t duration_us, bool driven) {
+        segment_t segment = { level, duration_us + (duration_us ? latency_us : 0), driven };
+        segments.push_back(segment);
+    }
+};
+
+class TestEasyScaleWaveform : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    easyscale_step_t steps[EasyScaleWaveform::MaxSteps];
+};
+
+TEST_F(TestEasyScaleWaveform, fast_frame_decodes)
+{
+    size_t count = EasyScaleWaveform::build_frame(TPS61158_ADDRESS, 17,
+            EasyScaleWaveform::fast_timing(), steps);
+    ASSERT_EQ((size_t) EasyScaleWaveform::FrameSteps, count);
+
+    WaveformSimulator sim;
+    sim.play(steps, count, true);
+
+    std::vector<uint8_t> bytes = sim.decode_bytes();
+    ASSERT_EQ(2u, bytes.size());
+    EXPECT_EQ(TPS61158_ADDRESS, bytes[0]);
+    EXPECT_EQ(0x80 | 17, bytes[1]);
+    EXPECT_TRUE(sim.ack_sampled);
+    EXPECT_TRUE(sim.ack);
+
+    // Same timing as the original blocking implementation
+    EXPECT_EQ(16u * 50 + 5 + 5 + 5 + 10 + 900, sim.total_us());
+}
+
+TEST_F(TestEasyScaleWaveform, brightness_is_masked)
+{
+    size_t count = EasyScaleWaveform::build_frame(TPS61158_ADDRESS, 0xFF,
+            EasyScaleWaveform::fast_timing(), steps);
+
+    WaveformSimulator sim;
+    sim.play(steps, count, false);
+
+    std::vector<uint8_t> bytes = sim.decode_bytes();
+    ASSERT_EQ(2u, bytes.size());
+    EXPECT_EQ(0x9F, bytes[1]);
+    EXPECT_FALSE(sim.ack);
+}
+
+TEST_F(TestEasyScaleWaveform, slow_frame_tolerates_latency)
+{
+    size_t count = EasyScaleWaveform::build_frame(TPS61158_ADDRESS, 5,
+            EasyScaleWaveform::slow_timing(), steps);
+
+    // Every Timeout-driven step is stretched by interrupt latency
+    for(uint32_t latency = 0; latency <= 40; latency += 10) {
+        WaveformSimulator sim(latency);
+        sim.play(steps, count, true);
+
+        std::vector<uint8_t> bytes = sim.decode_bytes();
+        ASSERT_EQ(2u, bytes.size()) << "latency " << latency;
+        EXPECT_EQ(TPS61158_ADDRESS, bytes[0]);
+        EXPECT_EQ(0x85, bytes[1]);
+        EXPECT_TRUE(sim.ack);
+    }
+}
+
+TEST_F(TestEasyScaleWaveform, power_on_sequence)
+{
+    size_t count = EasyScaleWaveform::build_power_on(steps);
+    ASSERT_EQ((size_t) EasyScaleWaveform::PowerOnSteps, count);
+
+    WaveformSimulator sim;
+    sim.play(steps, count, false);
+
+    // High past the detect delay (100us), then low past the detection time (450us)
+    ASSERT_EQ(3u, sim.segments.size());
+    EXPECT_EQ(1, sim.segments[0].level);
+    EXPECT_GT(sim.segments[0].duration_us, 100u);
+    EXPECT_EQ(0, sim.segments[1].level);
+    EXPECT_GT(sim.segments[1].duration_us, 450u);
+    EXPECT_EQ(1, sim.segments[2].level);
+
+    // Within the detection window (3.5ms)
+    EXPECT_LT(sim.total_us(), 3500u);
+}
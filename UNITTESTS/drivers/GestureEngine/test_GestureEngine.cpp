@@ -0,0 +1,221 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "GestureEngine.h"
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std::chrono;
+
+extern "C" {
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return NULL;
+}
+
+/** Edge timestamps follow the mocked Kernel clock */
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return (us_timestamp_t) rtos::Kernel::Clock::now().time_since_epoch().count() * 1000;
+}
+
+}
+
+/** Button whose edges are driven by the test, as if from interrupt context */
+class FakeButton : public ep::ButtonIn {
+
+public:
+
+    FakeButton() : ep::ButtonIn(false), pressed(false)
+    {
+    }
+
+    virtual int status()
+    {
+        return pressed;
+    }
+
+    void press(void)
+    {
+        pressed = true;
+        _internal_press_handler();
+    }
+
+    void release(void)
+    {
+        pressed = false;
+        _internal_release_handler();
+    }
+
+    bool pressed;
+};
+
+class TestGestureEngine : public testing::Test {
+
+    virtual void SetUp()
+    {
+        rtos::Kernel::Clock::set(0);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    void on_gesture(const ep::gesture_t& gesture)
+    {
+        gestures.push_back(gesture);
+    }
+
+    /** Lets time pass without any events, eg: while the queue is busy elsewhere */
+    void advance(milliseconds ms)
+    {
+        rtos::Kernel::Clock::set(rtos::Kernel::Clock::now().time_since_epoch().count() + ms.count());
+    }
+
+    events::EventQueue queue;
+    FakeButton a;
+    FakeButton b;
+    std::vector<ep::gesture_t> gestures;
+};
+
+TEST_F(TestGestureEngine, click)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    ep::GestureEngine<2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+
+    a.press();
+    queue.dispatch_for(100ms);
+    a.release();
+    queue.dispatch_for(1000ms);
+
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(0, gestures[0].button);
+    EXPECT_EQ(1, gestures[0].count);
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestGestureEngine, edges_keep_their_time_while_queue_is_busy)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    ep::GestureEngine<2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+
+    // A 100 ms press, only processed after the hold time has passed
+    a.press();
+    advance(100ms);
+    a.release();
+    advance(900ms);
+    queue.dispatch_for(1000ms);
+
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+}
+
+TEST_F(TestGestureEngine, release_survives_full_queue)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    ep::GestureEngine<2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+
+    a.press();
+    queue.dispatch_for(100ms);
+    ASSERT_EQ(1u, queue.pending());
+
+    // The hold timer fills the queue, so the release can't be posted
+    queue.set_capacity(1);
+    a.release();
+    EXPECT_EQ(1u, queue.pending());
+    queue.set_capacity(SIZE_MAX);
+
+    // The timer picks up the buffered release, so the button doesn't become held
+    queue.dispatch_for(2000ms);
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(TestGestureEngine, single_drain_event_for_several_edges)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    ep::GestureEngine<2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+
+    a.press();
+    b.press();
+    EXPECT_EQ(1u, queue.pending());
+
+    queue.dispatch_for(50ms);
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CHORD, gestures[0].type);
+    EXPECT_EQ(0x3u, gestures[0].mask);
+}
+
+TEST_F(TestGestureEngine, overflow_resynchronizes_buttons)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    ep::GestureEngine<2, 2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+
+    // Both releases are dropped because the buffer is full before the queue runs
+    a.press();
+    b.press();
+    advance(10ms);
+    a.release();
+    b.release();
+    queue.dispatch_for(5000ms);
+
+    // The lost releases are caught up with, so nothing is left held
+    for(size_t i = 0; i < gestures.size(); i++) {
+        EXPECT_NE(ep::gesture_t::HOLD_START, gestures[i].type);
+    }
+    EXPECT_EQ(0u, queue.pending());
+
+    // Later presses are recognized normally
+    gestures.clear();
+    b.press();
+    queue.dispatch_for(100ms);
+    b.release();
+    queue.dispatch_for(1000ms);
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(1, gestures[0].button);
+}
+
+TEST_F(TestGestureEngine, destructor_cancels_events)
+{
+    ep::ButtonIn* const buttons[] = { &a, &b };
+    {
+        ep::GestureEngine<2> engine(buttons, queue, mbed::callback(this, &TestGestureEngine::on_gesture));
+        a.press();
+        queue.dispatch_for(10ms);
+        a.release();
+        EXPECT_EQ(2u, queue.pending());
+    }
+
+    EXPECT_EQ(0u, queue.pending());
+    a.press();
+    EXPECT_EQ(0u, queue.pending());
+}
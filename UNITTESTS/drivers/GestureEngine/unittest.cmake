@@ -0,0 +1,23 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' EventQueue, Kernel clock and Timeout
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+)
+
+set(unittest-sources
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_critical_stub.c
+)
+
+set(unittest-test-sources
+  drivers/GestureEngine/test_GestureEngine.cpp
+)
@@ -0,0 +1,201 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "GestureRecognizer.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Tests for the gesture recognizer core
+ *
+ * Time is simulated: the test advances a clock and polls the recognizer
+ * whenever its next deadline is reached, as GestureEngine does with its timer
+ */
+class TestGestureRecognizer : public testing::Test {
+
+    virtual void SetUp()
+    {
+        now = 0;
+        gestures.clear();
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestGestureRecognizer() : now(0),
+        recognizer(mbed::callback(this, &TestGestureRecognizer::sink)) { }
+
+    void sink(const ep::gesture_t& gesture) {
+        gestures.push_back(gesture);
+    }
+
+    /** Advances the simulated clock, servicing deadlines on the way */
+    void advance(uint32_t ms) {
+        uint32_t end = now + ms;
+        uint32_t deadline;
+        while(recognizer.next_deadline(deadline) && (int32_t)(end - deadline) >= 0) {
+            now = deadline;
+            recognizer.poll(now);
+        }
+        now = end;
+    }
+
+    void click(uint8_t button, uint32_t held_ms = 50) {
+        recognizer.press(button, now);
+        advance(held_ms);
+        recognizer.release(button, now);
+    }
+
+    uint32_t now;
+    ep::GestureRecognizer<4> recognizer;
+    std::vector<ep::gesture_t> gestures;
+};
+
+TEST_F(TestGestureRecognizer, single_click_after_window)
+{
+    click(0);
+    advance(299);
+    EXPECT_EQ(0u, gestures.size());
+
+    advance(1);
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(0, gestures[0].button);
+    EXPECT_EQ(1, gestures[0].count);
+
+    uint32_t deadline;
+    EXPECT_FALSE(recognizer.next_deadline(deadline));
+}
+
+TEST_F(TestGestureRecognizer, double_click)
+{
+    click(1);
+    advance(150);
+    click(1);
+    advance(1000);
+
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(1, gestures[0].button);
+    EXPECT_EQ(2, gestures[0].count);
+}
+
+TEST_F(TestGestureRecognizer, triple_click_reported_immediately)
+{
+    click(2);
+    advance(100);
+    click(2);
+    advance(100);
+    click(2);
+
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(3, gestures[0].count);
+}
+
+TEST_F(TestGestureRecognizer, hold_repeat_accelerates)
+{
+    recognizer.press(0, now);
+    advance(3000);
+    recognizer.release(0, now);
+
+    ASSERT_GE(gestures.size(), 5u);
+    EXPECT_EQ(ep::gesture_t::HOLD_START, gestures[0].type);
+    EXPECT_EQ(ep::gesture_t::HOLD_END, gestures.back().type);
+
+    // Repeats are numbered and come faster and faster down to the minimum interval
+    size_t repeats = gestures.size() - 2;
+    for(size_t i = 0; i < repeats; i++) {
+        EXPECT_EQ(ep::gesture_t::HOLD_REPEAT, gestures[i + 1].type);
+        EXPECT_EQ(i + 1, gestures[i + 1].count);
+    }
+
+    // 400, 300, 225, 168, 126, 94, 70, 52, 50, 50 ... within the 2400 ms after the hold started
+    EXPECT_GT(repeats, 15u);
+    EXPECT_LT(repeats, 40u);
+
+    // No click from the held press
+    for(size_t i = 0; i < gestures.size(); i++) {
+        EXPECT_NE(ep::gesture_t::CLICK, gestures[i].type);
+    }
+}
+
+TEST_F(TestGestureRecognizer, chord)
+{
+    recognizer.press(1, now);
+    advance(30);
+    recognizer.press(3, now);
+    advance(1000);
+    recognizer.release(1, now);
+    recognizer.release(3, now);
+    advance(1000);
+
+    // Only the chord, no hold or click from its buttons
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CHORD, gestures[0].type);
+    EXPECT_EQ(0x0Au, gestures[0].mask);
+    EXPECT_EQ(1, gestures[0].button);
+}
+
+TEST_F(TestGestureRecognizer, slow_second_press_is_not_a_chord)
+{
+    recognizer.press(0, now);
+    advance(200);
+    recognizer.press(1, now);
+    advance(50);
+    recognizer.release(1, now);
+    recognizer.release(0, now);
+    advance(1000);
+
+    ASSERT_EQ(2u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[1].type);
+}
+
+TEST_F(TestGestureRecognizer, one_deadline_for_all_buttons)
+{
+    recognizer.press(0, now);
+    advance(100);
+    recognizer.press(1, now);
+
+    // Earliest deadline is button 0's hold time
+    uint32_t deadline;
+    ASSERT_TRUE(recognizer.next_deadline(deadline));
+    EXPECT_EQ(600u, deadline);
+}
+
+TEST_F(TestGestureRecognizer, clock_wraps)
+{
+    now = 0xFFFFFF00;
+    click(0);
+    advance(1000);
+
+    ASSERT_EQ(1u, gestures.size());
+    EXPECT_EQ(ep::gesture_t::CLICK, gestures[0].type);
+}
@@ -0,0 +1,289 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "KeyMatrix.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/** Fake time source for the edge timestamps of MatrixButton */
+static us_timestamp_t fake_now_us = 0;
+
+extern "C" {
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return NULL;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return fake_now_us;
+}
+
+}
+
+/**
+ * Simulated key matrix
+ *
+ * Without diodes a closed key connects its row and column, so the selected
+ * row reads every column reachable through closed keys, ghosts included.
+ */
+template<uint8_t R, uint8_t C>
+class FakeKeyMatrixIO : public ep::KeyMatrixIO {
+
+public:
+
+    FakeKeyMatrixIO(bool diodes = false) : diodes(diodes), selected(-1)
+    {
+        for(uint8_t r = 0; r < R; r++) {
+            for(uint8_t c = 0; c < C; c++) {
+                closed[r][c] = false;
+            }
+        }
+    }
+
+    virtual void select_row(uint8_t row)
+    {
+        selected = row;
+    }
+
+    virtual void release_rows(void)
+    {
+        selected = -1;
+    }
+
+    virtual uint32_t read_columns(void)
+    {
+        if(selected < 0) {
+            return 0;
+        }
+        if(diodes) {
+            uint32_t cols = 0;
+            for(uint8_t c = 0; c < C; c++) {
+                cols |= closed[selected][c] ? (1UL << c) : 0;
+            }
+            return cols;
+        }
+
+        // Flood fill through closed keys, starting from the driven row
+        uint32_t rows = (1UL << selected);
+        uint32_t cols = 0;
+        bool grown = true;
+        while(grown) {
+            grown = false;
+            for(uint8_t r = 0; r < R; r++) {
+                for(uint8_t c = 0; c < C; c++) {
+                    if(!closed[r][c]) {
+                        continue;
+                    }
+                    bool row_reached = rows & (1UL << r);
+                    bool col_reached = cols & (1UL << c);
+                    if(row_reached != col_reached) {
+                        rows |= (1UL << r);
+                        cols |= (1UL << c);
+                        grown = true;
+                    }
+                }
+            }
+        }
+        return cols;
+    }
+
+    bool closed[R][C];
+    bool diodes;
+    int selected;
+};
+
+class TestKeyMatrix : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestKeyMatrix() : matrix(io, 2)
+    {
+        matrix.attach(mbed::callback(this, &TestKeyMatrix::on_key));
+    }
+
+    void on_key(size_t key, bool pressed)
+    {
+        events.push_back(std::make_pair(key, pressed));
+    }
+
+    /** Scans until a change would have been accepted */
+    void settle(void)
+    {
+        for(int i = 0; i < 4; i++) {
+            matrix.scan();
+        }
+    }
+
+    FakeKeyMatrixIO<4, 4> io;
+    ep::KeyMatrix<4, 4> matrix;
+    std::vector<std::pair<size_t, bool> > events;
+};
+
+TEST_F(TestKeyMatrix, single_key)
+{
+    io.closed[2][3] = true;
+    settle();
+    io.closed[2][3] = false;
+    settle();
+
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(std::make_pair((size_t) 11, true), events[0]);
+    EXPECT_EQ(std::make_pair((size_t) 11, false), events[1]);
+    EXPECT_EQ(-1, io.selected);
+}
+
+TEST_F(TestKeyMatrix, rectangle_ghost_suppressed)
+{
+    io.closed[0][0] = true;
+    settle();
+    io.closed[0][1] = true;
+    settle();
+    ASSERT_EQ(2u, events.size());
+
+    // Third corner of the rectangle, (1, 1) now reads as closed too
+    io.closed[1][0] = true;
+    io.select_row(1);
+    ASSERT_EQ(0x3u, io.read_columns());
+
+    settle();
+    EXPECT_EQ(2u, events.size());
+    EXPECT_EQ(0, matrix.read(matrix.key_index(1, 1)));
+    EXPECT_EQ(0, matrix.read(matrix.key_index(1, 0)));
+    EXPECT_EQ(1, matrix.read(matrix.key_index(0, 0)));
+    EXPECT_EQ(1, matrix.read(matrix.key_index(0, 1)));
+
+    // Releasing one corner resolves the rectangle
+    io.closed[0][1] = false;
+    settle();
+    ASSERT_EQ(4u, events.size());
+    EXPECT_EQ(std::make_pair(matrix.key_index(0, 1), false), events[2]);
+    EXPECT_EQ(std::make_pair(matrix.key_index(1, 0), true), events[3]);
+    EXPECT_EQ(0, matrix.read(matrix.key_index(1, 1)));
+}
+
+TEST_F(TestKeyMatrix, anti_ghosting_disabled)
+{
+    matrix.set_anti_ghosting(false);
+
+    io.closed[0][0] = true;
+    io.closed[0][1] = true;
+    io.closed[1][0] = true;
+    settle();
+
+    EXPECT_EQ(4u, events.size());
+    EXPECT_EQ(1, matrix.read(matrix.key_index(1, 0)));
+    EXPECT_EQ(1, matrix.read(matrix.key_index(1, 1)));
+}
+
+TEST_F(TestKeyMatrix, diodes_do_not_ghost)
+{
+    io.diodes = true;
+    matrix.set_anti_ghosting(false);
+
+    io.closed[0][0] = true;
+    io.closed[0][1] = true;
+    io.closed[1][0] = true;
+    settle();
+
+    EXPECT_EQ(3u, events.size());
+    EXPECT_EQ(0, matrix.read(matrix.key_index(1, 1)));
+}
+
+TEST_F(TestKeyMatrix, bouncing_key_debounced)
+{
+    matrix.set_samples(3);
+    const size_t key = matrix.key_index(3, 2);
+
+    // Bounce on press: never 3 consecutive closed scans
+    const bool press[] = { true, false, true, true, false, true, true };
+    for(size_t i = 0; i < sizeof(press); i++) {
+        io.closed[3][2] = press[i];
+        matrix.scan();
+        EXPECT_EQ(0u, events.size()) << "scan " << i;
+    }
+
+    // Third consecutive closed scan confirms the press
+    matrix.scan();
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(std::make_pair(key, true), events[0]);
+
+    // Bounce on release
+    const bool release[] = { false, true, false, false, true };
+    for(size_t i = 0; i < sizeof(release); i++) {
+        io.closed[3][2] = release[i];
+        matrix.scan();
+        EXPECT_EQ(1u, events.size()) << "scan " << i;
+    }
+    EXPECT_EQ(1, matrix.read(key));
+
+    io.closed[3][2] = false;
+    for(int i = 0; i < 3; i++) {
+        matrix.scan();
+    }
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(std::make_pair(key, false), events[1]);
+}
+
+TEST_F(TestKeyMatrix, matrix_button)
+{
+    ep::MatrixButton button(matrix, 1, 2);
+
+    fake_now_us = 1000;
+    io.closed[1][2] = true;
+    settle();
+    EXPECT_EQ(1, button.status());
+
+    fake_now_us = 51000;
+    io.closed[1][2] = false;
+    settle();
+    EXPECT_EQ(0, button.status());
+    EXPECT_EQ(50000u, button.get_last_press_duration_us());
+}
+
+TEST_F(TestKeyMatrix, scans_on_queue)
+{
+    events::EventQueue queue;
+    matrix.start(queue, std::chrono::milliseconds(5));
+
+    io.closed[1][2] = true;
+    queue.dispatch_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(std::make_pair(matrix.key_index(1, 2), true), events[0]);
+
+    matrix.stop();
+    EXPECT_EQ(0u, queue.pending());
+}
@@ -0,0 +1,23 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' EventQueue, Kernel clock and Timeout
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+)
+
+set(unittest-sources
+  ../drivers/src/VerticalCounterDebouncer.cpp
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+)
+
+set(unittest-test-sources
+  drivers/KeyMatrix/test_KeyMatrix.cpp
+)
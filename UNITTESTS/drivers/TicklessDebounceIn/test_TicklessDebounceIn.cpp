@@ -0,0 +1,281 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "TicklessDebounceIn.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/** Sampling period and window length used by the tests (TicklessDebounceIn defaults) */
+#define SAMPLE_PERIOD_US    10000
+#define SAMPLES             10
+
+/** Simulated time, also the time source of the edge timestamps */
+static us_timestamp_t fake_now_us = 0;
+
+extern "C" {
+
+const ticker_data_t *get_lp_ticker_data(void)
+{
+    return NULL;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return fake_now_us;
+}
+
+}
+
+/** Exposes the mocked pin and timeout of a TicklessDebounceIn */
+class TestableTicklessDebounceIn : public ep::TicklessDebounceIn {
+
+public:
+
+    TestableTicklessDebounceIn(PinName pin) : ep::TicklessDebounceIn(pin)
+    {
+    }
+
+    mbed::InterruptIn& irq(void)
+    {
+        return _irq;
+    }
+
+    mbed::LowPowerTimeout& timeout(void)
+    {
+        return _timeout;
+    }
+};
+
+/**
+ * Drives a TicklessDebounceIn through its InterruptIn and LowPowerTimeout
+ * mocks against a simulated time source with 1 us resolution
+ */
+class TestTicklessDebounceIn : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    TestTicklessDebounceIn() : input(NULL), timeout_at(0), samples_taken(0)
+    {
+    }
+
+    /** Creates the input with the pin at the given level */
+    void create(int initial_level)
+    {
+        fake_now_us = 0;
+        mbed::InterruptIn::initial_level() = initial_level;
+        input = new TestableTicklessDebounceIn(P0_0);
+        input->rise(mbed::callback(this, &TestTicklessDebounceIn::on_rise));
+        input->fall(mbed::callback(this, &TestTicklessDebounceIn::on_fall));
+    }
+
+    virtual ~TestTicklessDebounceIn()
+    {
+        delete input;
+    }
+
+    /** Adds a raw level change at the given time */
+    void edge_at(us_timestamp_t time_us, int new_level)
+    {
+        changes.push_back(std::make_pair(time_us, new_level));
+    }
+
+    /** Adds a burst of contact bounce starting at the given time, ending at new_level */
+    void bounce(us_timestamp_t start_us, int new_level)
+    {
+        int level = new_level;
+        for(int i = 0; i < 6; i++) {
+            edge_at(start_us + (i * 700), level);
+            level = !level;
+        }
+        edge_at(start_us + 6 * 700, new_level);
+    }
+
+    /** Runs the simulation until the given time, pin changes go first at equal times */
+    void run_until(us_timestamp_t end_us)
+    {
+        size_t next_change = 0;
+        while(true) {
+            mbed::LowPowerTimeout& timeout = input->timeout();
+            bool change_due = next_change < changes.size();
+            if(change_due && (!timeout.attached || changes[next_change].first <= timeout_at)) {
+                if(changes[next_change].first > end_us) {
+                    break;
+                }
+                fake_now_us = changes[next_change].first;
+                bool was_attached = timeout.attached;
+                input->irq().set(changes[next_change++].second);
+                if(!was_attached && timeout.attached) {
+                    timeout_at = fake_now_us + timeout.delay.count();
+                }
+            } else if(timeout.attached) {
+                if(timeout_at > end_us) {
+                    break;
+                }
+                fake_now_us = timeout_at;
+                samples_taken++;
+                timeout.fire();
+                if(timeout.attached) {
+                    timeout_at = fake_now_us + timeout.delay.count();
+                }
+            } else {
+                break;
+            }
+        }
+        fake_now_us = end_us;
+    }
+
+    void on_rise(void)
+    {
+        events.push_back(std::make_pair(fake_now_us, 1));
+    }
+
+    void on_fall(void)
+    {
+        events.push_back(std::make_pair(fake_now_us, 0));
+    }
+
+    TestableTicklessDebounceIn* input;
+    us_timestamp_t timeout_at;
+    int samples_taken;
+    std::vector<std::pair<us_timestamp_t, int> > changes;
+    std::vector<std::pair<us_timestamp_t, int> > events;   /** (time, new level) reported to the application */
+};
+
+TEST_F(TestTicklessDebounceIn, starts_at_pin_level)
+{
+    create(1);
+
+    EXPECT_EQ(1, input->read());
+    EXPECT_FALSE(input->is_sampling());
+    EXPECT_TRUE(input->irq().enabled);
+    EXPECT_FALSE(input->timeout().attached);
+
+    input->mode(PullUp);
+    EXPECT_EQ(PullUp, input->irq().pull);
+}
+
+TEST_F(TestTicklessDebounceIn, press_and_release)
+{
+    create(1);
+
+    // Active low button pressed at 100 ms and released at 600 ms, both with bounce
+    bounce(100000, 0);
+    bounce(600000, 1);
+    run_until(2000000);
+
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(0, events[0].second);
+    EXPECT_EQ(1, events[1].second);
+
+    // Edges are confirmed within a few sample periods of the bounce
+    EXPECT_LT(events[0].first, 100000 + (SAMPLES + 2) * SAMPLE_PERIOD_US);
+    EXPECT_LT(events[1].first, 600000 + (SAMPLES + 2) * SAMPLE_PERIOD_US);
+
+    // Back to interrupt-only once stable
+    EXPECT_FALSE(input->is_sampling());
+    EXPECT_FALSE(input->timeout().attached);
+    EXPECT_TRUE(input->irq().enabled);
+    EXPECT_EQ(1, input->read());
+
+    // A polling DebounceIn would have sampled 200 times over these 2 seconds
+    EXPECT_LE(samples_taken, 2 * (SAMPLES + 2));
+}
+
+TEST_F(TestTicklessDebounceIn, interrupt_disabled_while_sampling)
+{
+    create(1);
+
+    edge_at(100000, 0);
+    run_until(100000);
+
+    EXPECT_TRUE(input->is_sampling());
+    EXPECT_FALSE(input->irq().enabled);
+    EXPECT_TRUE(input->timeout().attached);
+    EXPECT_EQ(SAMPLE_PERIOD_US, input->timeout().delay.count());
+}
+
+TEST_F(TestTicklessDebounceIn, rejects_glitch)
+{
+    create(1);
+
+    // 5 ms glitch is shorter than the debounce time
+    edge_at(100000, 0);
+    edge_at(105000, 1);
+    run_until(500000);
+
+    EXPECT_EQ(0u, events.size());
+    EXPECT_EQ(1, input->read());
+    EXPECT_FALSE(input->is_sampling());
+    EXPECT_EQ(1, samples_taken);
+}
+
+TEST_F(TestTicklessDebounceIn, catches_edge_at_window_close)
+{
+    create(1);
+
+    // Glitch sampled once, then the level changes again while the interrupt is disabled
+    edge_at(100000, 0);
+    edge_at(105000, 1);
+    edge_at(109000, 0);
+    run_until(500000);
+
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(0, events[0].second);
+    EXPECT_EQ(0, input->read());
+}
+
+TEST_F(TestTicklessDebounceIn, edge_timestamps)
+{
+    create(1);
+
+    ep::edge_event_t storage[4];
+    ep::EdgeEventRing ring(storage);
+    input->attach_event_ring(&ring);
+
+    bounce(100000, 0);
+    run_until(500000);
+
+    // The raw edge is the one that opened the window, the edge is confirmed after SAMPLES periods
+    EXPECT_EQ(100000u, input->last_raw_edge_us());
+    EXPECT_EQ(100000u + SAMPLES * SAMPLE_PERIOD_US, input->last_edge_us());
+
+    ep::edge_event_t event;
+    ASSERT_TRUE(ring.pop(event));
+    EXPECT_EQ(ep::edge_event_t::FALL, event.type);
+    EXPECT_EQ(input->last_raw_edge_us(), event.raw_us);
+    EXPECT_EQ(input->last_edge_us(), event.confirmed_us);
+    EXPECT_EQ(input, event.source);
+    EXPECT_FALSE(ring.pop(event));
+}
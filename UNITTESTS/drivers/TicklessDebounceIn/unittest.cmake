@@ -0,0 +1,25 @@
+####################
+# UNIT TESTS
+####################
+
+# The mocks must shadow mbed-os' InterruptIn and LowPowerTimeout
+set(unittest-includes
+  mocks
+  ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../drivers/
+)
+
+set(unittest-sources
+)
+
+set(unittest-test-sources
+  drivers/TicklessDebounceIn/test_TicklessDebounceIn.cpp
+)
+
+set(DEVICE_FLAGS "-DDEVICE_INTERRUPTIN -DDEVICE_LPTICKER")
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${DEVICE_FLAGS}")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${DEVICE_FLAGS}")
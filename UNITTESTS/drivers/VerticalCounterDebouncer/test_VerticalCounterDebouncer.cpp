@@ -0,0 +1,262 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "VerticalCounterDebouncer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+/** Number of inputs used for the benchmark (typical keypad/IO expander board) */
+#define BENCH_INPUTS    24
+#define BENCH_SAMPLES   100000
+
+/**
+ * Scalar reference for a single input: accepts a change after `samples`
+ * consecutive disagreeing samples
+ */
+struct ScalarDebouncer {
+    int state;
+    int count;
+    int samples;
+
+    bool update(int raw) {
+        if(raw == state) {
+            count = 0;
+            return false;
+        }
+        if(++count >= samples) {
+            state = raw;
+            count = 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+/** Mirror of the per-pin integrator in DebounceIn::_callback() */
+struct DebounceInModel {
+    int shadow;
+    int prev_shadow;
+    int counter;
+    int samples;
+    int edges;
+
+    void callback(int raw) {
+        if(raw) {
+            if(counter < samples) {
+                counter++;
+            }
+            if(counter == samples) {
+                shadow = 1;
+                if(shadow != prev_shadow) {
+                    prev_shadow = shadow;
+                    edges++;
+                }
+            }
+        } else {
+            if(counter > 0) {
+                counter--;
+            }
+            if(counter == 0) {
+                shadow = 0;
+                if(shadow != prev_shadow) {
+                    prev_shadow = shadow;
+                    edges++;
+                }
+            }
+        }
+    }
+};
+
+class TestVerticalCounterDebouncer : public testing::Test {
+
+    virtual void SetUp()
+    {
+        srand(1234);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    /** Random raw word where each input bounces with ~1/8 probability */
+    uint32_t bouncy(uint32_t level) {
+        uint32_t noise = 0;
+        for(int i = 0; i < 3; i++) {
+            noise = (i == 0) ? (uint32_t) rand() : (noise & (uint32_t) rand());
+        }
+        return level ^ noise;
+    }
+};
+
+TEST_F(TestVerticalCounterDebouncer, requires_consecutive_samples)
+{
+    ep::VerticalCounterDebouncer deb(0, 4);
+
+    // Three samples is not enough
+    for(int i = 0; i < 3; i++) {
+        EXPECT_EQ(0u, deb.update(0x1));
+    }
+
+    // A single glitch back to the debounced level restarts the count
+    EXPECT_EQ(0u, deb.update(0x0));
+    for(int i = 0; i < 3; i++) {
+        EXPECT_EQ(0u, deb.update(0x1));
+    }
+    EXPECT_EQ(0x1u, deb.update(0x1));
+    EXPECT_EQ(0x1u, deb.state());
+
+    // Stable input produces no further edges
+    EXPECT_EQ(0u, deb.update(0x1));
+}
+
+TEST_F(TestVerticalCounterDebouncer, inputs_are_independent)
+{
+    ep::VerticalCounterDebouncer deb(0xFFFF0000, 2);
+
+    EXPECT_EQ(0u, deb.update(0x0000FFFF));
+    EXPECT_EQ(0xFFFFFFFFu, deb.update(0x0000FFFF));
+    EXPECT_EQ(0x0000FFFFu, deb.state());
+}
+
+TEST_F(TestVerticalCounterDebouncer, matches_scalar_reference)
+{
+    for(uint8_t samples = 1; samples <= ep::VerticalCounterDebouncer::MaxSamples; samples++) {
+        ep::VerticalCounterDebouncer deb(0, samples);
+        ScalarDebouncer ref[32];
+        for(int i = 0; i < 32; i++) {
+            ref[i].state = 0;
+            ref[i].count = 0;
+            ref[i].samples = samples;
+        }
+
+        uint32_t level = 0;
+        for(int n = 0; n < 5000; n++) {
+            if((n % 97) == 0) {
+                level = (uint32_t) rand();
+            }
+            uint32_t raw = bouncy(level);
+
+            uint32_t expected_changed = 0;
+            for(int i = 0; i < 32; i++) {
+                if(ref[i].update((raw >> i) & 1)) {
+                    expected_changed |= (1UL << i);
+                }
+            }
+
+            ASSERT_EQ(expected_changed, deb.update(raw)) << "samples=" << (int) samples << " n=" << n;
+        }
+    }
+}
+
+TEST_F(TestVerticalCounterDebouncer, samples_are_clamped)
+{
+    ep::VerticalCounterDebouncer deb(0, 0);
+    EXPECT_EQ(1, deb.get_samples());
+    deb.set_samples(200);
+    EXPECT_EQ(ep::VerticalCounterDebouncer::MaxSamples, deb.get_samples());
+}
+
+TEST_F(TestVerticalCounterDebouncer, set_samples_during_change)
+{
+    ep::VerticalCounterDebouncer deb(0, 10);
+
+    // Input 0 is 8 samples into a change, input 1 is 2 samples in
+    for(int i = 0; i < 8; i++) {
+        EXPECT_EQ(0u, deb.update((i < 6) ? 0x1 : 0x3));
+    }
+
+    // Lowering the threshold below input 0's count clamps it instead of letting it wrap
+    deb.set_samples(5);
+    EXPECT_EQ(0x1u, deb.update(0x3));
+    EXPECT_EQ(0u, deb.update(0x3));
+    EXPECT_EQ(0x2u, deb.update(0x3));
+    EXPECT_EQ(0x3u, deb.state());
+
+    // Raising it again leaves changes in progress alone
+    deb.set_samples(3);
+    deb.update(0x0);
+    deb.set_samples(15);
+    for(int i = 0; i < 13; i++) {
+        EXPECT_EQ(0u, deb.update(0x0)) << "sample " << i;
+    }
+    EXPECT_EQ(0x3u, deb.update(0x0));
+}
+
+/**
+ * Compares one word update of the vertical counters against running the
+ * DebounceIn per-pin ticker callback once for each input
+ */
+TEST_F(TestVerticalCounterDebouncer, benchmark_against_debounce_in)
+{
+    static uint32_t raw[BENCH_SAMPLES];
+    uint32_t level = 0;
+    for(int n = 0; n < BENCH_SAMPLES; n++) {
+        if((n % 200) == 0) {
+            level = (uint32_t) rand();
+        }
+        raw[n] = bouncy(level) & ((1UL << BENCH_INPUTS) - 1);
+    }
+
+    DebounceInModel pins[BENCH_INPUTS] = {};
+    for(int i = 0; i < BENCH_INPUTS; i++) {
+        pins[i].samples = 10;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(int n = 0; n < BENCH_SAMPLES; n++) {
+        for(int i = 0; i < BENCH_INPUTS; i++) {
+            pins[i].callback((raw[n] >> i) & 1);
+        }
+    }
+    auto scalar_time = std::chrono::steady_clock::now() - start;
+
+    ep::VerticalCounterDebouncer deb(0, 10);
+    volatile uint32_t edges = 0;
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < BENCH_SAMPLES; n++) {
+        edges = edges + __builtin_popcount(deb.update(raw[n]));
+    }
+    auto vertical_time = std::chrono::steady_clock::now() - start;
+
+    int scalar_edges = 0;
+    for(int i = 0; i < BENCH_INPUTS; i++) {
+        scalar_edges += pins[i].edges;
+    }
+
+    printf("%d inputs x %d samples: %d x DebounceIn %lld us (%d edges), "
+            "VerticalCounterDebouncer %lld us (%u edges)\n",
+            BENCH_INPUTS, BENCH_SAMPLES, BENCH_INPUTS,
+            (long long) std::chrono::duration_cast<std::chrono::microseconds>(scalar_time).count(),
+            scalar_edges,
+            (long long) std::chrono::duration_cast<std::chrono::microseconds>(vertical_time).count(),
+            (unsigned) edges);
+
+    EXPECT_GT(edges, 0u);
+}
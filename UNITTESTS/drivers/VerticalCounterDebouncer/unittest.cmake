@@ -0,0 +1,17 @@
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../drivers/
+)
+
+set(unittest-sources
+  ../drivers/src/VerticalCounterDebouncer.cpp
+)
+
+set(unittest-test-sources
+  drivers/VerticalCounterDebouncer/test_VerticalCounterDebouncer.cpp
+)
@@ -0,0 +1,99 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "LockFreeRing.h"
+
+#include <stdint.h>
+
+class TestLockFreeRing : public testing::Test {
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+public:
+
+    uint32_t storage[8];
+};
+
+TEST_F(TestLockFreeRing, push_pop_in_order)
+{
+    ep::LockFreeRing<uint32_t> ring(storage);
+    uint32_t value;
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.pop(value));
+
+    for(uint32_t i = 0; i < 5; i++) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    EXPECT_EQ(5u, ring.size());
+
+    for(uint32_t i = 0; i < 5; i++) {
+        ASSERT_TRUE(ring.pop(value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(TestLockFreeRing, full_ring_drops)
+{
+    ep::LockFreeRing<uint32_t> ring(storage);
+
+    for(uint32_t i = 0; i < ring.capacity(); i++) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    EXPECT_FALSE(ring.push(100));
+    EXPECT_FALSE(ring.push(101));
+    EXPECT_EQ(2u, ring.dropped());
+
+    // Oldest elements are kept
+    uint32_t value;
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(0u, value);
+    EXPECT_TRUE(ring.push(8));
+}
+
+TEST_F(TestLockFreeRing, indices_wrap)
+{
+    ep::LockFreeRing<uint32_t> ring(storage);
+    uint32_t value;
+
+    // Many more operations than the ring size
+    for(uint32_t i = 0; i < 1000; i++) {
+        ASSERT_TRUE(ring.push(i));
+        ASSERT_TRUE(ring.push(i + 1));
+        ASSERT_TRUE(ring.pop(value));
+        EXPECT_EQ(i, value);
+        ASSERT_TRUE(ring.pop(value));
+        EXPECT_EQ(i + 1, value);
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(0u, ring.dropped());
+}
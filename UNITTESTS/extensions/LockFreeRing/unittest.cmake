@@ -0,0 +1,19 @@
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  .
+  ../
+  ../../mbed-os/
+  ../../mbed-os/platform/
+  ../extensions/
+)
+
+set(unittest-sources
+  ../../mbed-os/UNITTESTS/stubs/mbed_assert_stub.cpp
+)
+
+set(unittest-test-sources
+  extensions/LockFreeRing/test_LockFreeRing.cpp
+)
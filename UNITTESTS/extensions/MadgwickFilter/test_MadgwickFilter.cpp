@@ -0,0 +1,342 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "MadgwickFilter.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace {
+
+typedef ep::MadgwickFilter<float> FloatFilter;
+typedef ep::MadgwickFilter<ep::Fixed<24> > FixedFilter;
+
+const float PI = 3.14159265f;
+
+// 2000 dps gyro, 2 g accel
+const float GYRO_SCALE = 0.07f * PI / 180.0f;
+const float ACCEL_LSB_PER_G = 16384.0f;
+const float RATE_HZ = 200.0f;
+
+// Same layout as lsm9ds1_fifo_sample_t
+struct fifo_sample_t {
+    int16_t gx, gy, gz;
+    int16_t ax, ay, az;
+    uint32_t timestamp_us;
+};
+
+struct Quaternion {
+    float w, x, y, z;
+};
+
+Quaternion multiply(const Quaternion& a, const Quaternion& b)
+{
+    Quaternion r = {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+    };
+    return r;
+}
+
+Quaternion axis_angle(float x, float y, float z, float angle)
+{
+    float s = sinf(angle / 2);
+    Quaternion r = { cosf(angle / 2), x * s, y * s, z * s };
+    return r;
+}
+
+/** Earth frame vector as seen in the sensor frame of orientation q: q* v q */
+void to_sensor(const Quaternion& q, const float v[3], float out[3])
+{
+    Quaternion conj = { q.w, -q.x, -q.y, -q.z };
+    Quaternion p = { 0, v[0], v[1], v[2] };
+    Quaternion r = multiply(multiply(conj, p), q);
+    out[0] = r.x;
+    out[1] = r.y;
+    out[2] = r.z;
+}
+
+void to_raw(const float v[3], float scale, int16_t out[3])
+{
+    for (int i = 0; i < 3; i++) {
+        out[i] = (int16_t) lrintf(v[i] * scale);
+    }
+}
+
+/** Cosine of the angle between the filter orientation and q */
+template<typename Filter>
+float agreement(const Filter& filter, const Quaternion& q)
+{
+    float e[4];
+    filter.get_quaternion(e);
+    return fabsf(e[0] * q.w + e[1] * q.x + e[2] * q.y + e[3] * q.z);
+}
+
+const float GRAVITY[3] = { 0.0f, 0.0f, 1.0f };
+
+// Inclination of about 60 degrees, in arbitrary units like the raw readings
+const float FIELD[3] = { 0.25f, 0.0f, 0.43f };
+
+// 0.1 degree of error on the rotation angle
+const float CLOSE = 0.9999996f;
+
+}
+
+template<typename Filter>
+void converges_to_static_tilt()
+{
+    Filter filter(GYRO_SCALE, 1.0f / RATE_HZ, 0.5f);
+
+    // Roll 30, pitch -20 degrees. Yaw is not observable without a magnetometer.
+    Quaternion truth = multiply(axis_angle(0, 1, 0, -20 * PI / 180), axis_angle(1, 0, 0, 30 * PI / 180));
+    float a[3];
+    int16_t accel[3];
+    const int16_t gyro[3] = { 0, 0, 0 };
+    to_sensor(truth, GRAVITY, a);
+    to_raw(a, ACCEL_LSB_PER_G, accel);
+
+    // Converges fast, then settles with a lower gain to reduce the ripple
+    // left by the fixed gradient step
+    for (int i = 0; i < 2000; i++) {
+        filter.update(gyro, accel);
+    }
+    filter.set_beta(0.01f);
+    for (int i = 0; i < 400; i++) {
+        filter.update(gyro, accel);
+    }
+
+    float roll, pitch, yaw;
+    filter.get_euler(&roll, &pitch, &yaw);
+    EXPECT_NEAR(30.0f, roll * 180 / PI, 0.1f);
+    EXPECT_NEAR(-20.0f, pitch * 180 / PI, 0.1f);
+}
+
+TEST(TestMadgwickFilter, float_converges_to_static_tilt)
+{
+    converges_to_static_tilt<FloatFilter>();
+}
+
+TEST(TestMadgwickFilter, fixed_converges_to_static_tilt)
+{
+    converges_to_static_tilt<FixedFilter>();
+}
+
+template<typename Filter>
+void integrates_constant_rate()
+{
+    Filter filter(GYRO_SCALE, 1.0f / RATE_HZ);
+
+    // 90 dps about Z for 2 s, gravity stays on Z so only the gyro sees it
+    const int16_t gyro[3] = { 0, 0, (int16_t) lrintf(90.0f / 0.07f) };
+    const int16_t accel[3] = { 0, 0, (int16_t) ACCEL_LSB_PER_G };
+    for (int i = 0; i < 2 * RATE_HZ; i++) {
+        filter.update(gyro, accel);
+    }
+
+    float roll, pitch, yaw;
+    filter.get_euler(&roll, &pitch, &yaw);
+    float turned = fabsf(yaw * 180 / PI);
+    EXPECT_NEAR(180.0f, turned, 0.5f);
+    EXPECT_NEAR(0.0f, roll, 1e-3f);
+    EXPECT_NEAR(0.0f, pitch, 1e-3f);
+}
+
+TEST(TestMadgwickFilter, float_integrates_constant_rate)
+{
+    integrates_constant_rate<FloatFilter>();
+}
+
+TEST(TestMadgwickFilter, fixed_integrates_constant_rate)
+{
+    integrates_constant_rate<FixedFilter>();
+}
+
+template<typename Filter>
+void marg_converges_to_heading()
+{
+    Filter filter(GYRO_SCALE, 1.0f / RATE_HZ, 0.5f);
+
+    // Yaw 60, roll 20 degrees
+    Quaternion truth = multiply(axis_angle(0, 0, 1, 60 * PI / 180), axis_angle(1, 0, 0, 20 * PI / 180));
+    float v[3];
+    int16_t accel[3], mag[3];
+    const int16_t gyro[3] = { 0, 0, 0 };
+    to_sensor(truth, GRAVITY, v);
+    to_raw(v, ACCEL_LSB_PER_G, accel);
+    to_sensor(truth, FIELD, v);
+    to_raw(v, 6842.0f, mag);
+
+    for (int i = 0; i < 3000; i++) {
+        filter.update(gyro, accel, mag);
+    }
+    filter.set_beta(0.01f);
+    for (int i = 0; i < 400; i++) {
+        filter.update(gyro, accel, mag);
+    }
+
+    EXPECT_GT(agreement(filter, truth), CLOSE);
+}
+
+TEST(TestMadgwickFilter, float_marg_converges_to_heading)
+{
+    marg_converges_to_heading<FloatFilter>();
+}
+
+TEST(TestMadgwickFilter, fixed_marg_converges_to_heading)
+{
+    marg_converges_to_heading<FixedFilter>();
+}
+
+TEST(TestMadgwickFilter, fixed_tracks_float_on_synthetic_motion)
+{
+    FloatFilter reference(GYRO_SCALE, 1.0f / RATE_HZ);
+    FixedFilter fixed(GYRO_SCALE, 1.0f / RATE_HZ);
+
+    // 10 s of wobbling about all three axes, with the matching accel and
+    // mag readings. Starts at rest at the identity so that both filters
+    // are converged from the first sample.
+    Quaternion truth = { 1, 0, 0, 0 };
+    float worst = 1.0f;
+    float worst_truth = 1.0f;
+    for (int i = 0; i < 10 * RATE_HZ; i++) {
+        float t = i / RATE_HZ;
+        float rate[3] = {
+            1.5f * sinf(2 * PI * 0.5f * t),
+            1.0f * sinf(2 * PI * 0.3f * t),
+            2.0f * sinf(2 * PI * 0.2f * t)
+        };
+
+        int16_t gyro[3], accel[3], mag[3];
+        float v[3];
+        to_raw(rate, 1.0f / GYRO_SCALE, gyro);
+        to_sensor(truth, GRAVITY, v);
+        to_raw(v, ACCEL_LSB_PER_G, accel);
+        to_sensor(truth, FIELD, v);
+        to_raw(v, 6842.0f, mag);
+
+        reference.update(gyro, accel, mag);
+        fixed.update(gyro, accel, mag);
+
+        // Advance the truth by the gyro reading
+        float norm = sqrtf(rate[0] * rate[0] + rate[1] * rate[1] + rate[2] * rate[2]);
+        if (norm > 0) {
+            truth = multiply(truth, axis_angle(rate[0] / norm, rate[1] / norm, rate[2] / norm, norm / RATE_HZ));
+        }
+
+        float q[4];
+        reference.get_quaternion(q);
+        Quaternion r = { q[0], q[1], q[2], q[3] };
+        float a = agreement(fixed, r);
+        worst = a < worst ? a : worst;
+        a = agreement(fixed, truth);
+        worst_truth = a < worst_truth ? a : worst_truth;
+    }
+
+    // Within 0.1 degree of the float filter, 1 degree of the truth
+    EXPECT_GT(worst, CLOSE);
+    EXPECT_GT(worst_truth, cosf(0.5f * PI / 180));
+}
+
+TEST(TestMadgwickFilter, batch_matches_single_updates)
+{
+    fifo_sample_t samples[16];
+    for (int i = 0; i < 16; i++) {
+        samples[i].gx = (int16_t)(100 * i);
+        samples[i].gy = (int16_t)(-50 * i);
+        samples[i].gz = 300;
+        samples[i].ax = (int16_t)(200 * i);
+        samples[i].ay = -1000;
+        samples[i].az = 16000;
+        samples[i].timestamp_us = 0;
+    }
+
+    FixedFilter single(GYRO_SCALE, 1.0f / RATE_HZ);
+    FixedFilter batch(GYRO_SCALE, 1.0f / RATE_HZ);
+    for (int i = 0; i < 16; i++) {
+        single.update(&samples[i].gx, &samples[i].ax);
+    }
+    batch.update_batch(&samples[0].gx, &samples[0].ax, 16, sizeof(samples[0]));
+
+    float a[4], b[4];
+    single.get_quaternion(a);
+    batch.get_quaternion(b);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(a[i], b[i]);
+    }
+}
+
+TEST(TestMadgwickFilter, zero_accel_is_gyro_only)
+{
+    FloatFilter filter(GYRO_SCALE, 1.0f / RATE_HZ);
+    const int16_t gyro[3] = { 0, 0, 0 };
+    const int16_t accel[3] = { 0, 0, 0 };
+    filter.update(gyro, accel);
+
+    float q[4];
+    filter.get_quaternion(q);
+    EXPECT_FLOAT_EQ(1.0f, q[0]);
+    EXPECT_FLOAT_EQ(0.0f, q[1]);
+}
+
+template<typename Filter>
+double nanoseconds_per_update(bool with_mag)
+{
+    const int COUNT = 200000;
+    Filter filter(GYRO_SCALE, 1.0f / RATE_HZ);
+    int16_t gyro[3] = { 120, -80, 40 };
+    int16_t accel[3] = { 800, -1200, 16000 };
+    int16_t mag[3] = { 1500, 200, 2900 };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < COUNT; i++) {
+        gyro[0] = (int16_t)(i & 0xFF);
+        if (with_mag) {
+            filter.update(gyro, accel, mag);
+        } else {
+            filter.update(gyro, accel);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    // Keeps the loop from being optimized away
+    float q[4];
+    filter.get_quaternion(q);
+    EXPECT_NEAR(1.0f, q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1e-3f);
+
+    return elapsed.count() / COUNT;
+}
+
+TEST(TestMadgwickFilter, benchmark_update_cost)
+{
+    // Host timings, only meaningful relative to each other
+    printf("[ BENCHMARK] float IMU  %7.1f ns/update\n", nanoseconds_per_update<FloatFilter>(false));
+    printf("[ BENCHMARK] fixed IMU  %7.1f ns/update\n", nanoseconds_per_update<FixedFilter>(false));
+    printf("[ BENCHMARK] float MARG %7.1f ns/update\n", nanoseconds_per_update<FloatFilter>(true));
+    printf("[ BENCHMARK] fixed MARG %7.1f ns/update\n", nanoseconds_per_update<FixedFilter>(true));
+}
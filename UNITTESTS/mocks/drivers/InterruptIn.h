@@ -0,0 +1,119 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MOCKS_INTERRUPTIN_H_
+#define EP_OC_MCU_UNITTESTS_MOCKS_INTERRUPTIN_H_
+
+#include "PinNames.h"
+#include "platform/Callback.h"
+
+namespace mbed {
+
+/**
+ * Host-side InterruptIn mock
+ *
+ * set() changes the pin level and, while the interrupt is enabled, runs
+ * the rise or fall callback like a real edge would. New pins start at
+ * initial_level().
+ */
+class InterruptIn {
+public:
+
+    InterruptIn(PinName pin) : level(initial_level()), enabled(true), pull(PullDefault)
+    {
+    }
+
+    InterruptIn(PinName pin, PinMode mode) : level(initial_level()), enabled(true), pull(mode)
+    {
+    }
+
+    int read()
+    {
+        return level;
+    }
+
+    operator int()
+    {
+        return read();
+    }
+
+    void mode(PinMode mode)
+    {
+        pull = mode;
+    }
+
+    void rise(Callback<void()> func)
+    {
+        _rise = func;
+    }
+
+    void fall(Callback<void()> func)
+    {
+        _fall = func;
+    }
+
+    void enable_irq()
+    {
+        enabled = true;
+    }
+
+    void disable_irq()
+    {
+        enabled = false;
+    }
+
+    /** Drives the pin to the given level */
+    void set(int value)
+    {
+        int old = level;
+        level = value;
+        if (!enabled || value == old) {
+            return;
+        }
+        if (value && _rise) {
+            _rise();
+        } else if (!value && _fall) {
+            _fall();
+        }
+    }
+
+    /** Level of pins constructed from now on */
+    static int &initial_level()
+    {
+        static int value = 0;
+        return value;
+    }
+
+    int level;
+    bool enabled;
+    PinMode pull;
+
+private:
+
+    Callback<void()> _rise;
+    Callback<void()> _fall;
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_MOCKS_INTERRUPTIN_H_ */
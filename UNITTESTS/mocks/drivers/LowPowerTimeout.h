@@ -0,0 +1,37 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MOCKS_LOWPOWERTIMEOUT_H_
+#define EP_OC_MCU_UNITTESTS_MOCKS_LOWPOWERTIMEOUT_H_
+
+#include "drivers/Timeout.h"
+
+namespace mbed {
+
+/** Host-side LowPowerTimeout mock, behaves like the Timeout mock */
+class LowPowerTimeout : public Timeout {
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_MOCKS_LOWPOWERTIMEOUT_H_ */
@@ -0,0 +1,79 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MOCKS_TIMEOUT_H_
+#define EP_OC_MCU_UNITTESTS_MOCKS_TIMEOUT_H_
+
+#include "platform/Callback.h"
+
+#include <chrono>
+#include <stdint.h>
+
+namespace mbed {
+
+/**
+ * Host-side Timeout mock
+ *
+ * Only records the attached callback and delay, fire() runs it
+ */
+class Timeout {
+public:
+
+    Timeout() : attached(false), delay(0)
+    {
+    }
+
+    void attach(Callback<void()> func, std::chrono::microseconds t)
+    {
+        _func = func;
+        delay = t;
+        attached = true;
+    }
+
+    void attach_us(Callback<void()> func, uint64_t t)
+    {
+        attach(func, std::chrono::microseconds(t));
+    }
+
+    void detach()
+    {
+        attached = false;
+    }
+
+    void fire()
+    {
+        attached = false;
+        _func();
+    }
+
+    bool attached;
+    std::chrono::microseconds delay;
+
+private:
+
+    Callback<void()> _func;
+};
+
+} // namespace mbed
+
+#endif /* EP_OC_MCU_UNITTESTS_MOCKS_TIMEOUT_H_ */
@@ -0,0 +1,159 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MOCKS_EVENTQUEUE_H_
+#define EP_OC_MCU_UNITTESTS_MOCKS_EVENTQUEUE_H_
+
+#include "platform/Callback.h"
+#include "rtos/Kernel.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace events {
+
+/**
+ * Host-side EventQueue mock
+ *
+ * Events are kept in a list and only run by dispatch_for(), which advances
+ * the mocked Kernel clock to each event's due time. Like a real queue, posting
+ * fails and returns 0 once set_capacity() events are pending.
+ */
+class EventQueue {
+public:
+
+    EventQueue() : _next_id(1), _capacity(SIZE_MAX)
+    {
+    }
+
+    template<typename T, typename R>
+    int call(T* obj, R (T::*method)())
+    {
+        return post(0, mbed::callback(obj, method));
+    }
+
+    template<typename T, typename R>
+    int call_in(std::chrono::milliseconds ms, T* obj, R (T::*method)())
+    {
+        return post(ms.count(), mbed::callback(obj, method));
+    }
+
+    template<typename F>
+    int call_every(std::chrono::milliseconds ms, F f)
+    {
+        return post(ms.count(), mbed::Callback<void()>(f), ms.count());
+    }
+
+    bool cancel(int id)
+    {
+        for (size_t i = 0; i < _events.size(); i++) {
+            if (_events[i].id == id) {
+                _events.erase(_events.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Runs all events due in the next ms milliseconds, in order */
+    void dispatch_for(std::chrono::milliseconds ms)
+    {
+        int64_t end = now() + ms.count();
+        while (dispatch_one(end)) {
+        }
+        rtos::Kernel::Clock::set(end);
+    }
+
+    /** Runs the earliest event due by the given time, if any */
+    bool dispatch_one(int64_t until)
+    {
+        size_t next = _events.size();
+        for (size_t i = 0; i < _events.size(); i++) {
+            if (_events[i].due <= until && (next == _events.size() || _events[i].due < _events[next].due)) {
+                next = i;
+            }
+        }
+        if (next == _events.size()) {
+            return false;
+        }
+
+        event_t event = _events[next];
+        _events.erase(_events.begin() + next);
+        if (event.due > now()) {
+            rtos::Kernel::Clock::set(event.due);
+        }
+        if (event.period) {
+            // Requeued before it runs so the event can cancel itself
+            event_t again = event;
+            again.due += event.period;
+            _events.push_back(again);
+        }
+        event.func();
+        return true;
+    }
+
+    size_t pending() const
+    {
+        return _events.size();
+    }
+
+    /** Sets the number of pending events at which posting starts to fail */
+    void set_capacity(size_t events)
+    {
+        _capacity = events;
+    }
+
+private:
+
+    struct event_t {
+        int id;
+        int64_t due;
+        int64_t period;
+        mbed::Callback<void()> func;
+    };
+
+    static int64_t now()
+    {
+        return rtos::Kernel::Clock::now().time_since_epoch().count();
+    }
+
+    int post(int64_t delay, mbed::Callback<void()> func, int64_t period = 0)
+    {
+        if (_events.size() >= _capacity) {
+            return 0;
+        }
+        event_t event = { _next_id++, now() + delay, period, func };
+        _events.push_back(event);
+        return event.id;
+    }
+
+    int _next_id;
+    size_t _capacity;
+    std::vector<event_t> _events;
+};
+
+} // namespace events
+
+#endif /* EP_OC_MCU_UNITTESTS_MOCKS_EVENTQUEUE_H_ */
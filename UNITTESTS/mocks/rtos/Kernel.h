@@ -0,0 +1,65 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_UNITTESTS_MOCKS_KERNEL_H_
+#define EP_OC_MCU_UNITTESTS_MOCKS_KERNEL_H_
+
+#include <chrono>
+#include <stdint.h>
+
+namespace rtos {
+namespace Kernel {
+
+/**
+ * Host-side Kernel clock mock, only moves when set() is called
+ */
+struct Clock {
+    typedef std::chrono::milliseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<Clock> time_point;
+    static const bool is_steady = true;
+
+    static time_point now()
+    {
+        return time_point(duration(ms()));
+    }
+
+    static void set(int64_t now_ms)
+    {
+        ms() = now_ms;
+    }
+
+private:
+
+    static int64_t& ms()
+    {
+        static int64_t now_ms = 0;
+        return now_ms;
+    }
+};
+
+} // namespace Kernel
+} // namespace rtos
+
+#endif /* EP_OC_MCU_UNITTESTS_MOCKS_KERNEL_H_ */
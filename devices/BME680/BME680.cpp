@@ -26,12 +26,18 @@
 #include "platform/mbed_debug.h"
 #include "rtos/ThisThread.h"
 
+using namespace std::chrono;
+using rtos::Kernel::Clock;
+
 static mbed::I2C* bme680_i2c;
 
 BME680::BME680(mbed::I2C* i2c, uint8_t adr) {
 	bme680_i2c = i2c;
     _filterEnabled = _tempEnabled = _humEnabled = _presEnabled = _gasEnabled = false;
     _adr = adr;
+    _reading = false;
+    _queue = nullptr;
+    _readingEvent = 0;
 }
 
 bool BME680::begin() {
@@ -60,12 +66,37 @@ bool BME680::begin() {
 /**
  * Performs a full reading of all 4 sensors in the BME680.
  * Assigns the internal BME680#temperature, BME680#pressure, BME680#humidity and BME680#gas_resistance member variables
+ * Sleeps the calling thread until the reading completes, see startReading() for a non-blocking alternative.
  * @return True on success, False on failure
  */
 bool BME680::performReading(void) {
+    Clock::time_point readyAt = startReading();
+    if (readyAt == Clock::time_point())
+        return false;
+
+    /* Sleep till the measurement is expected to be complete */
+    rtos::ThisThread::sleep_until(readyAt);
+
+    int result;
+    while ((result = pollReading()) == 0)
+        delay_msec(BME680_POLL_PERIOD_MS);
+
+    return (result > 0);
+}
+
+/**
+ * Starts a full reading of all 4 sensors in the BME680 and returns without waiting for it.
+ * Call pollReading() once the returned time has passed to fetch the result.
+ * @return Time at which the reading is expected to be complete,
+ * Clock::time_point() on failure or if a reading is already in progress
+ */
+Clock::time_point BME680::startReading() {
     uint8_t set_required_settings = 0;
     int8_t result;
 
+    if (_reading)
+        return Clock::time_point();
+
     /* Select the power mode */
     /* Must be set before writing the sensor configuration */
     gas_sensor.power_mode = BME680_FORCED_MODE;
@@ -86,28 +117,110 @@ bool BME680::performReading(void) {
     result = bme680_set_sensor_settings(set_required_settings, &gas_sensor);
     debug("Set settings, result %d \r\n", result);
     if (result != BME680_OK)
-        return false;
+        return Clock::time_point();
 
     /* Set the power mode */
     result = bme680_set_sensor_mode(&gas_sensor);
     debug("Set power mode, result %d \r\n", result);
     if (result != BME680_OK)
-        return false;
+        return Clock::time_point();
 
-    /* Get the total measurement duration so as to sleep or wait till the
-     * measurement is complete */
+    /* Get the total measurement duration, heater time included */
     uint16_t meas_period;
     bme680_get_profile_dur(&meas_period, &gas_sensor);
 
-    /* Delay till the measurement is ready */
-    delay_msec(meas_period);
+    _reading = true;
+    _readyAt = Clock::now() + milliseconds(meas_period);
+    return _readyAt;
+}
 
+/**
+ * Starts a full reading like startReading(), and fetches it from the given event queue
+ * once it is complete. done is called from the event queue with true on success.
+ * @return Time at which the reading is expected to be complete,
+ * Clock::time_point() on failure (done is not called then)
+ */
+Clock::time_point BME680::startReading(events::EventQueue* queue, mbed::Callback<void(bool)> done) {
+    Clock::time_point readyAt = startReading();
+    if (readyAt == Clock::time_point())
+        return readyAt;
+
+    _queue = queue;
+    _readingDone = done;
+    _readingEvent = _queue->call_in(duration_cast<milliseconds>(readyAt - Clock::now()),
+                                    this, &BME680::completeReading);
+    if (_readingEvent == 0) {
+        _reading = false;
+        return Clock::time_point();
+    }
+
+    return readyAt;
+}
+
+/**
+ * Fetches the reading started by startReading() if it is complete.
+ * Does not touch the bus before the expected completion time.
+ * @return 1 when the reading was fetched, 0 while it is still in progress,
+ * -1 on failure or if no reading was started
+ */
+int BME680::pollReading() {
+    if (!_reading)
+        return -1;
+
+    Clock::time_point now = Clock::now();
+    if (now < _readyAt)
+        return 0;
+
+    /* Check the new data flag first, bme680_get_sensor_data() would
+     * otherwise sleep between its own retries */
+    uint8_t status;
+    int8_t result = bme680_get_regs(BME680_FIELD0_ADDR, &status, 1, &gas_sensor);
+    if (result != BME680_OK) {
+        _reading = false;
+        return -1;
+    }
+    if (!(status & BME680_NEW_DATA_MSK)) {
+        if (now < _readyAt + milliseconds(BME680_READING_TIMEOUT_MS))
+            return 0;
+        _reading = false;
+        return -1;
+    }
+
+    _reading = false;
     result = bme680_get_sensor_data(&data, &gas_sensor);
     debug("Get sensor data, result %d \r\n", result);
     if (result != BME680_OK)
-        return false;
+        return -1;
 
-    return true;
+    return 1;
+}
+
+/**
+ * Forgets the reading in progress, its completion callback won't be called.
+ * The sensor still completes the measurement and goes back to sleep on its own.
+ */
+void BME680::cancelReading() {
+    if (_readingEvent) {
+        _queue->cancel(_readingEvent);
+        _readingEvent = 0;
+    }
+    _reading = false;
+}
+
+void BME680::completeReading() {
+    int result = pollReading();
+    if (result == 0) {
+        // Not ready yet, check again a poll period later
+        _readingEvent = _queue->call_in(milliseconds(BME680_POLL_PERIOD_MS), this, &BME680::completeReading);
+        if (_readingEvent != 0)
+            return;
+        _reading = false;
+        result = -1;
+    }
+
+    _readingEvent = 0;
+    if (_readingDone)
+        _readingDone(result > 0);
 }
 
 bool BME680::isGasHeatingSetupStable() {
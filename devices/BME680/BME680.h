@@ -26,9 +26,16 @@
 
 #include "bme680_driver.h"
 #include "drivers/I2C.h"
+#include "events/EventQueue.h"
+#include "platform/Callback.h"
+#include "rtos/Kernel.h"
 
 #define BME680_DEFAULT_ADDRESS (0x76 << 1)  // The default I2C address (shifted for MBed 8 bit address)
 
+// How long past its expected completion time a reading may take before
+// pollReading() gives up on it
+#define BME680_READING_TIMEOUT_MS 100
+
 /**
  * BME680 Class for I2C usage.
  * Wraps the Bosch library for Mbed usage.
@@ -51,6 +58,14 @@ public:
 
     bool performReading();
 
+    rtos::Kernel::Clock::time_point startReading();
+
+    rtos::Kernel::Clock::time_point startReading(events::EventQueue* queue, mbed::Callback<void(bool)> done);
+
+    int pollReading();
+
+    void cancelReading();
+
     bool isGasHeatingSetupStable();
 
     int16_t getRawTemperature();
@@ -72,6 +87,15 @@ private:
     struct bme680_field_data data;
     uint8_t _adr;
 
+    // Forced mode reading in progress, see startReading()
+    bool _reading;
+    rtos::Kernel::Clock::time_point _readyAt;
+    events::EventQueue* _queue;
+    mbed::Callback<void(bool)> _readingDone;
+    int _readingEvent;
+
+    void completeReading();
+
     // BME680 - hardware interface
     static int8_t i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
 
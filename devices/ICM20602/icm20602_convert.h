@@ -0,0 +1,165 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_CONVERT_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_CONVERT_H_
+
+#include "icm20602_fifo.h"
+
+#include <stddef.h>
+
+#define ICM20602_STANDARD_GRAVITY   9.80665f
+#define ICM20602_DEG_TO_RAD         0.017453292519943295f
+
+// Temperature sensor: degC = raw / sensitivity + offset
+#define ICM20602_TEMP_SENSITIVITY   326.8f
+#define ICM20602_TEMP_OFFSET        25.0f
+
+/** One sample in SI units */
+struct icm20602_si_sample_t {
+    float accel[3];     // m/s^2
+    float temp;         // degC
+    float gyro[3];      // rad/s
+};
+
+/**
+ * Converts raw ICM20602 samples to SI units
+ *
+ * Each axis is corrected as (raw * resolution - bias) * scale. The
+ * resolution, bias and scale are folded into a single gain and offset per
+ * channel when they change, so the conversion is one multiply-add per
+ * channel with no branches, which the compiler can vectorize.
+ */
+class ICM20602Converter {
+public:
+
+    /**
+     * @param[in] accel_res Accelerometer resolution in g per LSB
+     * @param[in] gyro_res Gyroscope resolution in degrees per second per LSB
+     */
+    ICM20602Converter(float accel_res = 2.0f / 32768.0f, float gyro_res = 1000.0f / 32768.0f)
+    {
+        for (int i = 0; i < 3; i++) {
+            _accel_bias[i] = 0.0f;
+            _accel_scale[i] = 1.0f;
+            _gyro_bias[i] = 0.0f;
+            _gyro_scale[i] = 1.0f;
+        }
+        set_resolution(accel_res, gyro_res);
+    }
+
+    /**
+     * Sets the sensor resolution, as returned by ICM20602::setAccRange/setGyroRange
+     *
+     * @param[in] accel_res Accelerometer resolution in g per LSB
+     * @param[in] gyro_res Gyroscope resolution in degrees per second per LSB
+     */
+    void set_resolution(float accel_res, float gyro_res)
+    {
+        _accel_res = accel_res * ICM20602_STANDARD_GRAVITY;
+        _gyro_res = gyro_res * ICM20602_DEG_TO_RAD;
+        update();
+    }
+
+    /**
+     * Sets the accelerometer calibration
+     * @param[in] bias Per-axis offset in m/s^2, subtracted before scaling
+     * @param[in] scale Per-axis scale factor
+     */
+    void set_accel_calibration(const float bias[3], const float scale[3])
+    {
+        for (int i = 0; i < 3; i++) {
+            _accel_bias[i] = bias[i];
+            _accel_scale[i] = scale[i];
+        }
+        update();
+    }
+
+    /**
+     * Sets the gyroscope calibration
+     * @param[in] bias Per-axis offset in rad/s, subtracted before scaling
+     * @param[in] scale Per-axis scale factor
+     */
+    void set_gyro_calibration(const float bias[3], const float scale[3])
+    {
+        for (int i = 0; i < 3; i++) {
+            _gyro_bias[i] = bias[i];
+            _gyro_scale[i] = scale[i];
+        }
+        update();
+    }
+
+    /**
+     * Converts a batch of samples
+     * @param[in] raw Raw samples
+     * @param[out] si Converted samples, may not alias raw
+     * @param[in] count Number of samples
+     */
+    void convert(const icm20602_sample_t* raw, icm20602_si_sample_t* si, size_t count) const
+    {
+        for (size_t n = 0; n < count; n++) {
+            si[n].accel[0] = raw[n].accel[0] * _gain[0] + _offset[0];
+            si[n].accel[1] = raw[n].accel[1] * _gain[1] + _offset[1];
+            si[n].accel[2] = raw[n].accel[2] * _gain[2] + _offset[2];
+            si[n].temp     = raw[n].temp     * _gain[3] + _offset[3];
+            si[n].gyro[0]  = raw[n].gyro[0]  * _gain[4] + _offset[4];
+            si[n].gyro[1]  = raw[n].gyro[1]  * _gain[5] + _offset[5];
+            si[n].gyro[2]  = raw[n].gyro[2]  * _gain[6] + _offset[6];
+        }
+    }
+
+    /** Converts a single sample */
+    void convert(const icm20602_sample_t& raw, icm20602_si_sample_t& si) const
+    {
+        convert(&raw, &si, 1);
+    }
+
+protected:
+
+    void update()
+    {
+        for (int i = 0; i < 3; i++) {
+            _gain[i] = _accel_res * _accel_scale[i];
+            _offset[i] = -_accel_bias[i] * _accel_scale[i];
+            _gain[4 + i] = _gyro_res * _gyro_scale[i];
+            _offset[4 + i] = -_gyro_bias[i] * _gyro_scale[i];
+        }
+        _gain[3] = 1.0f / ICM20602_TEMP_SENSITIVITY;
+        _offset[3] = ICM20602_TEMP_OFFSET;
+    }
+
+    /** Resolution in SI units per LSB */
+    float _accel_res;
+    float _gyro_res;
+
+    float _accel_bias[3];
+    float _accel_scale[3];
+    float _gyro_bias[3];
+    float _gyro_scale[3];
+
+    /** Folded gain and offset, in icm20602_sample_t channel order */
+    float _gain[7];
+    float _offset[7];
+};
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_CONVERT_H_ */
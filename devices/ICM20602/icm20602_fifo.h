@@ -0,0 +1,132 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_FIFO_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_FIFO_H_
+
+#include "icm20602_regs.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Number of bytes from ICM20602_ACCEL_XOUT_H to ICM20602_GYRO_ZOUT_L
+#define ICM20602_SAMPLE_BYTES 14
+
+// FIFO capacity in bytes
+#define ICM20602_FIFO_SIZE 1008
+
+// Whole accel/temp/gyro frames that fit in the FIFO
+#define ICM20602_FIFO_MAX_FRAMES (ICM20602_FIFO_SIZE / ICM20602_SAMPLE_BYTES)
+
+/** One accelerometer/temperature/gyroscope sample in raw sensor units */
+struct icm20602_sample_t {
+    int16_t accel[3];   // X, Y, Z
+    int16_t temp;
+    int16_t gyro[3];    // X, Y, Z
+};
+
+/**
+ * Decodes the 14 data register bytes starting at ICM20602_ACCEL_XOUT_H
+ *
+ * FIFO frames use the same layout when both accel and gyro are enabled
+ */
+inline void icm20602_decode_sample(const uint8_t* raw, icm20602_sample_t& sample)
+{
+    // Registers are big-endian: accel X/Y/Z, temp, gyro X/Y/Z
+    for (int i = 0; i < 3; i++) {
+        sample.accel[i] = (int16_t)((raw[2 * i] << 8) | raw[2 * i + 1]);
+        sample.gyro[i] = (int16_t)((raw[8 + 2 * i] << 8) | raw[8 + 2 * i + 1]);
+    }
+    sample.temp = (int16_t)((raw[6] << 8) | raw[7]);
+}
+
+/**
+ * Drains all complete frames from the FIFO in a single burst
+ *
+ * Bus is anything with the ICM20602 register accessors:
+ *   uint8_t readByte(uint8_t reg);
+ *   int     readBytes(uint8_t reg, uint8_t* data, int length);
+ *
+ * The raw bytes are read straight into the caller's buffer and decoded
+ * in place, so no intermediate copy of the FIFO is needed.
+ *
+ * The FIFO is expected to run with ICM20602_CONFIG_FIFO_MODE set, in which
+ * case an overflow drops the newest data and the frames already stored stay
+ * aligned. Overflow is reported if either the FIFO_OFLOW status bit is set
+ * or the FIFO has no room left for another frame.
+ *
+ * @param[in] bus Register access
+ * @param[out] samples Destination buffer
+ * @param[in] max_samples Capacity of samples
+ * @param[out] overflow Set to true if samples were lost since the last drain (optional)
+ * @retval number of frames read, or -1 on bus error
+ */
+template<typename Bus>
+int icm20602_fifo_drain(Bus& bus, icm20602_sample_t* samples, size_t max_samples, bool* overflow = NULL)
+{
+    static_assert(sizeof(icm20602_sample_t) == ICM20602_SAMPLE_BYTES,
+            "icm20602_sample_t must be packed to decode in place");
+
+    // Reading INT_STATUS clears it
+    uint8_t status = bus.readByte(ICM20602_INT_STATUS);
+
+    // COUNTL must be read to latch COUNTH, so read both in one burst
+    uint8_t count_bytes[2];
+    if (bus.readBytes(ICM20602_FIFO_COUNTH, count_bytes, 2)) {
+        return -1;
+    }
+    size_t count = (size_t)((count_bytes[0] << 8) | count_bytes[1]);
+    if (count > ICM20602_FIFO_SIZE) {
+        count = ICM20602_FIFO_SIZE;
+    }
+
+    if (overflow) {
+        *overflow = (status & ICM20602_INT_FIFO_OFLOW)
+                || (ICM20602_FIFO_SIZE - count) < ICM20602_SAMPLE_BYTES;
+    }
+
+    size_t frames = count / ICM20602_SAMPLE_BYTES;
+    if (frames > max_samples) {
+        frames = max_samples;
+    }
+    if (frames == 0) {
+        return 0;
+    }
+
+    // FIFO_R_W does not auto-increment, so one burst pops every frame
+    uint8_t* raw = (uint8_t*) samples;
+    if (bus.readBytes(ICM20602_FIFO_R_W, raw, (int)(frames * ICM20602_SAMPLE_BYTES))) {
+        return -1;
+    }
+
+    uint8_t frame[ICM20602_SAMPLE_BYTES];
+    for (size_t i = 0; i < frames; i++) {
+        memcpy(frame, raw + i * ICM20602_SAMPLE_BYTES, ICM20602_SAMPLE_BYTES);
+        icm20602_decode_sample(frame, samples[i]);
+    }
+
+    return (int) frames;
+}
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_FIFO_H_ */
@@ -23,51 +23,54 @@
 
 #include "icm20602_i2c.h"
 
-// Acc Full Scale Range  +-2G 4G 8G 16G
-enum Ascale {
-    AFS_2G = 0,
-    AFS_4G,
-    AFS_8G,
-    AFS_16G
-};
-
-// Gyro Full Scale Range +-250 500 1000 2000 Degrees per second
-enum Gscale {
-    GFS_250DPS = 0,
-    GFS_500DPS,
-    GFS_1000DPS,
-    GFS_2000DPS
-};
-
-// Scale resolutions per LSB for the sensors
-float aRes, gRes;
-int Ascale = AFS_2G;
-int Gscale = GFS_1000DPS;
+#include <stdio.h>
 
 void ICM20602::writeByte(uint8_t ICM20602_reg, uint8_t ICM20602_data)
 {
-    char data_out[2];
-    data_out[0] = ICM20602_reg;
-    data_out[1] = ICM20602_data;
-    ICM20602_i2c.write(ICM20602_slave_addr, data_out, 2, 0);
+    transport.write(ICM20602_reg, &ICM20602_data, 1);
 }
 
 uint8_t ICM20602::readByte(uint8_t ICM20602_reg)
 {
-    char data_out[1], data_in[1];
-    data_out[0] = ICM20602_reg;
-    ICM20602_i2c.write(ICM20602_slave_addr, data_out, 1, 1);
-    ICM20602_i2c.read(ICM20602_slave_addr, data_in, 1, 0);
-    return (data_in[0]);
+    uint8_t data_in = 0;
+    transport.read(ICM20602_reg, &data_in, 1);
+    return data_in;
 }
 
+int ICM20602::readBytes(uint8_t ICM20602_reg, uint8_t* data, int length)
+{
+    return transport.read(ICM20602_reg, data, length);
+}
+
+int16_t ICM20602::readWord(uint8_t ICM20602_reg_h)
+{
+    uint8_t data[2] = { 0, 0 };
+    readBytes(ICM20602_reg_h, data, 2);
+    return (int16_t)((data[0] << 8) | data[1]);
+}
+
+#if DEVICE_I2C
 ICM20602::ICM20602(mbed::I2C& i2c, uint8_t slaveAddress)
-    : ICM20602_i2c(i2c),
-    ICM20602_slave_addr(slaveAddress)
+    : owned_transport(new ICM20602I2CTransport(i2c, slaveAddress)),
+    transport(*owned_transport)
+{
+    init();
+}
+#endif
+
+ICM20602::ICM20602(ICM20602Transport& transport)
+    : transport(transport)
 {
     init();
 }
 
+ICM20602::~ICM20602()
+{
+    if (owned_transport != nullptr) {
+        delete owned_transport;
+    }
+}
+
 // Communication test: WHO_AM_I register reading
 void ICM20602::whoAmI()
 {
@@ -92,75 +95,163 @@ bool ICM20602::isOnline() {
 
 void ICM20602::init()
 {
+    if (transport.disable_i2c()) {
+        writeByte(ICM20602_I2C_IF, ICM20602_I2C_IF_DIS);
+    }
     writeByte(ICM20602_PWR_MGMT_1, 0x00);    // CLK_SEL=0: internal 8MHz, TEMP_DIS=0, SLEEP=0
     writeByte(ICM20602_SMPLRT_DIV, 0x07);  // Gyro output sample rate = Gyro Output Rate/(1+SMPLRT_DIV)
     writeByte(ICM20602_CONFIG, 0x01); //176Hz     // set TEMP_OUT_L, DLPF=3 (Fs=1KHz):0x03
 //    ICM20602_WriteByte(ICM20602_GYRO_CONFIG, 0x00); // bit[4:3] 0=+-250d/s,1=+-500d/s,2=+-1000d/s,3=+-2000d/s :0x18
 //    ICM20602_WriteByte(ICM20602_ACCEL_CONFIG, 0x00);// bit[4:3] 0=+-2g,1=+-4g,2=+-8g,3=+-16g, ACC_HPF=On (5Hz):0x01
-    setAccRange(Ascale);
-    setGyroRange(Gscale);
+    setAccRange(accScale);
+    setGyroRange(gyroScale);
 }
 
 int16_t ICM20602::getAccXvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_ACCEL_XOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_ACCEL_XOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_ACCEL_XOUT_H);
 }
 
 int16_t ICM20602::getAccYvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_ACCEL_YOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_ACCEL_YOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_ACCEL_YOUT_H);
 }
 
 int16_t ICM20602::getAccZvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_ACCEL_ZOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_ACCEL_ZOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_ACCEL_ZOUT_H);
 }
 
 int16_t ICM20602::getGyrXvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_GYRO_XOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_GYRO_XOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_GYRO_XOUT_H);
 }
 
 int16_t ICM20602::getGyrYvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_GYRO_YOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_GYRO_YOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_GYRO_YOUT_H);
 }
 
 int16_t ICM20602::getGyrZvalue()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_GYRO_ZOUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_GYRO_ZOUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_GYRO_ZOUT_H);
 }
 
 int16_t ICM20602::getIMUTemp()
 {
-    uint8_t LoByte, HiByte;
-    LoByte = readByte(ICM20602_TEMP_OUT_L); // read Accelerometer X_Low  value
-    HiByte = readByte(ICM20602_TEMP_OUT_H); // read Accelerometer X_High value
-    return ((HiByte << 8) | LoByte);
+    return readWord(ICM20602_TEMP_OUT_H);
+}
+
+bool ICM20602::read_all(icm20602_sample_t& sample)
+{
+    uint8_t raw[ICM20602_SAMPLE_BYTES];
+    if (readBytes(ICM20602_ACCEL_XOUT_H, raw, ICM20602_SAMPLE_BYTES)) {
+        return false;
+    }
+    decodeSample(raw, sample);
+    return true;
+}
+
+void ICM20602::decodeSample(const uint8_t* raw, icm20602_sample_t& sample)
+{
+    icm20602_decode_sample(raw, sample);
+}
+
+void ICM20602::setSampleRateDivider(uint8_t div)
+{
+    writeByte(ICM20602_SMPLRT_DIV, div);
+}
+
+void ICM20602::enableFifo()
+{
+    writeByte(ICM20602_USER_CTRL, 0x00);
+    writeByte(ICM20602_FIFO_EN, 0x00);
+    writeByte(ICM20602_CONFIG, readByte(ICM20602_CONFIG) | ICM20602_CONFIG_FIFO_MODE);
+    writeByte(ICM20602_USER_CTRL, ICM20602_USER_CTRL_FIFO_RST);
+    readByte(ICM20602_INT_STATUS);      // clear any stale overflow flag
+    writeByte(ICM20602_FIFO_EN, ICM20602_FIFO_EN_GYRO | ICM20602_FIFO_EN_ACCEL);
+    writeByte(ICM20602_USER_CTRL, ICM20602_USER_CTRL_FIFO_EN);
+}
+
+void ICM20602::disableFifo()
+{
+    writeByte(ICM20602_FIFO_EN, 0x00);
+    writeByte(ICM20602_USER_CTRL, 0x00);
+}
+
+void ICM20602::resetFifo()
+{
+    writeByte(ICM20602_USER_CTRL, ICM20602_USER_CTRL_FIFO_EN | ICM20602_USER_CTRL_FIFO_RST);
+}
+
+bool ICM20602::setFifoWatermark(uint16_t frames)
+{
+    // A larger watermark would never be reached (and overflows the 10-bit threshold)
+    if (frames > ICM20602_FIFO_MAX_FRAMES) {
+        return false;
+    }
+
+    uint16_t bytes = frames * ICM20602_SAMPLE_BYTES;
+    writeByte(ICM20602_FIFO_WM_TH1, (bytes >> 8) & 0x03);
+    writeByte(ICM20602_FIFO_WM_TH2, bytes & 0xFF);
+    return true;
+}
+
+void ICM20602::enableInterrupts(uint8_t sources)
+{
+    writeByte(ICM20602_INT_PIN_CFG, 0x00);
+    writeByte(ICM20602_INT_ENABLE, sources);
+}
+
+void ICM20602::enableWakeOnMotion(uint16_t threshold_mg, uint8_t rate_divider)
+{
+    if (threshold_mg > ICM20602_WOM_MAX_MG) {
+        threshold_mg = ICM20602_WOM_MAX_MG;
+    }
+    uint8_t threshold = threshold_mg / ICM20602_WOM_LSB_MG;
+
+    // Accel running, gyro in standby, no cycling while configuring
+    writeByte(ICM20602_PWR_MGMT_1, 0x00);
+    writeByte(ICM20602_PWR_MGMT_2, ICM20602_PWR_STBY_GYRO);
+    writeByte(ICM20602_ACCEL_CONFIG2, ICM20602_ACCEL_FCHOICE_B | 0x01);
+
+    enableInterrupts(ICM20602_INT_WOM);
+    writeByte(ICM20602_ACCEL_WOM_X_THR, threshold);
+    writeByte(ICM20602_ACCEL_WOM_Y_THR, threshold);
+    writeByte(ICM20602_ACCEL_WOM_Z_THR, threshold);
+    writeByte(ICM20602_ACCEL_INTEL_CTRL, ICM20602_ACCEL_INTEL_EN | ICM20602_ACCEL_INTEL_MODE);
+
+    setSampleRateDivider(rate_divider);
+    writeByte(ICM20602_PWR_MGMT_1, ICM20602_PWR_CYCLE);
+}
+
+void ICM20602::disableWakeOnMotion()
+{
+    writeByte(ICM20602_PWR_MGMT_1, 0x00);
+    writeByte(ICM20602_INT_ENABLE, 0x00);
+    writeByte(ICM20602_ACCEL_INTEL_CTRL, 0x00);
+    writeByte(ICM20602_ACCEL_CONFIG2, 0x00);
+    writeByte(ICM20602_PWR_MGMT_2, 0x00);
+}
+
+int ICM20602::readFifo(icm20602_sample_t* samples, size_t max_samples, bool* overflow)
+{
+    bool lost = false;
+    int n = icm20602_fifo_drain(*this, samples, max_samples, &lost);
+    if (lost) {
+        fifo_overflows++;
+    }
+    if (overflow) {
+        *overflow = lost;
+    }
+    return n;
 }
 
 
 // Calculates Acc resolution
 float ICM20602::setAccRange(int Ascale)
 {
+    accScale = Ascale;
     switch (Ascale) {
         case AFS_2G:
             aRes = 2.0 / 32768.0;
@@ -176,12 +267,14 @@ float ICM20602::setAccRange(int Ascale)
             break;
     }
     writeByte(ICM20602_ACCEL_CONFIG, Ascale << 3); // bit[4:3] 0=+-2g,1=+-4g,2=+-8g,3=+-16g, ACC_HPF=On (5Hz)
+    converter.set_resolution(aRes, gRes);
     return aRes;
 }
 
 // Calculates Gyro resolution
 float ICM20602::setGyroRange(int Gscale)
 {
+    gyroScale = Gscale;
     switch (Gscale) {
         case GFS_250DPS:
             gRes = 250.0 / 32768.0;
@@ -197,5 +290,16 @@ float ICM20602::setGyroRange(int Gscale)
             break;
     }
     writeByte(ICM20602_GYRO_CONFIG, Gscale << 3); // bit[4:3] 0=+-250d/s,1=+-500d/s,2=+-1000d/s,3=+-2000d/s
+    converter.set_resolution(aRes, gRes);
     return gRes;
 }
+
+bool ICM20602::read_si(icm20602_si_sample_t& sample)
+{
+    icm20602_sample_t raw;
+    if (!read_all(raw)) {
+        return false;
+    }
+    converter.convert(raw, sample);
+    return true;
+}
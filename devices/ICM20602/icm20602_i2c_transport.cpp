@@ -0,0 +1,55 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "icm20602_i2c_transport.h"
+
+#include <string.h>
+
+ICM20602I2CTransport::ICM20602I2CTransport(mbed::I2C& i2c, uint8_t address)
+    : _i2c(i2c),
+    _address(address)
+{
+}
+
+int ICM20602I2CTransport::read(uint8_t reg, uint8_t* data, int length)
+{
+    char reg_out = reg;
+    int err = _i2c.write(_address, &reg_out, 1, true);
+    if (err) {
+        // Release the bus after the failed repeated start
+        _i2c.stop();
+        return err;
+    }
+    return _i2c.read(_address, (char*) data, length, false);
+}
+
+int ICM20602I2CTransport::write(uint8_t reg, const uint8_t* data, int length)
+{
+    char data_out[1 + ICM20602_I2C_MAX_WRITE];
+    if (length > ICM20602_I2C_MAX_WRITE) {
+        return -1;
+    }
+    data_out[0] = reg;
+    memcpy(&data_out[1], data, length);
+    return _i2c.write(_address, data_out, 1 + length, false);
+}
@@ -0,0 +1,60 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_I2C_TRANSPORT_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_I2C_TRANSPORT_H_
+
+#include "icm20602_transport.h"
+
+#include "drivers/I2C.h"
+
+// Longest register write sent in one I2C transaction
+#ifndef ICM20602_I2C_MAX_WRITE
+#define ICM20602_I2C_MAX_WRITE 16
+#endif
+
+/**
+ * ICM20602 register access over I2C (up to 400 kHz)
+ *
+ * Reads use a repeated start between the register address and the data.
+ */
+class ICM20602I2CTransport : public ICM20602Transport {
+public:
+
+    /**
+     * @param[in] i2c Bus the sensor is on
+     * @param[in] address 8-bit slave address
+     */
+    ICM20602I2CTransport(mbed::I2C& i2c, uint8_t address);
+
+    virtual int read(uint8_t reg, uint8_t* data, int length);
+
+    virtual int write(uint8_t reg, const uint8_t* data, int length);
+
+private:
+
+    mbed::I2C& _i2c;
+    uint8_t _address;
+};
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_I2C_TRANSPORT_H_ */
@@ -0,0 +1,175 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_REGS_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_REGS_H_
+
+#define ICM20602_SELF_TEST_X_ACCEL  0x0D
+#define ICM20602_SELF_TEST_Y_ACCEL  0x0E    
+#define ICM20602_SELF_TEST_Z_ACCEL  0x0F
+//#define SELF_TEST_A      0x10
+#define ICM20602_XG_OFFS_USRH     0x13  // User-defined trim values for gyroscope; supported in MPU-6050?
+#define ICM20602_XG_OFFS_USRL     0x14
+#define ICM20602_YG_OFFS_USRH     0x15
+#define ICM20602_YG_OFFS_USRL     0x16
+#define ICM20602_ZG_OFFS_USRH     0x17
+#define ICM20602_ZG_OFFS_USRL     0x18
+#define ICM20602_SMPLRT_DIV       0x19
+#define ICM20602_CONFIG           0x1A
+#define ICM20602_GYRO_CONFIG      0x1B
+#define ICM20602_ACCEL_CONFIG     0x1C
+#define ICM20602_ACCEL_CONFIG2    0x1D  // Free-fall
+#define ICM20602_LP_MODE_CFG      0x1E  // Free-fall
+#define ICM20602_ACCEL_WOM_THR    0x1F  // Motion detection threshold bits [7:0]
+#define ICM20602_ACCEL_WOM_X_THR  0x20  // Wake-on-motion thresholds, LSB = 4 mg
+#define ICM20602_ACCEL_WOM_Y_THR  0x21
+#define ICM20602_ACCEL_WOM_Z_THR  0x22
+#define ICM20602_FIFO_EN          0x23
+//#define I2C_MST_CTRL     0x24   
+//#define I2C_SLV0_ADDR    0x25
+//#define I2C_SLV0_REG     0x26
+//#define I2C_SLV0_CTRL    0x27
+//#define I2C_SLV1_ADDR    0x28
+//#define I2C_SLV1_REG     0x29
+//#define I2C_SLV1_CTRL    0x2A
+//#define I2C_SLV2_ADDR    0x2B
+//#define I2C_SLV2_REG     0x2C
+//#define I2C_SLV2_CTRL    0x2D
+//#define I2C_SLV3_ADDR    0x2E
+//#define I2C_SLV3_REG     0x2F
+//#define I2C_SLV3_CTRL    0x30
+//#define I2C_SLV4_ADDR    0x31
+//#define I2C_SLV4_REG     0x32
+//#define I2C_SLV4_DO      0x33
+//#define I2C_SLV4_CTRL    0x34
+//#define I2C_SLV4_DI      0x35
+#define ICM20602_FSYNC_INT        0x36
+#define ICM20602_INT_PIN_CFG      0x37
+#define ICM20602_INT_ENABLE       0x38
+#define ICM20602_FIFO_WM_INT_STATUS 0x39
+#define ICM20602_INT_STATUS       0x3A
+#define ICM20602_ACCEL_XOUT_H     0x3B
+#define ICM20602_ACCEL_XOUT_L     0x3C
+#define ICM20602_ACCEL_YOUT_H     0x3D
+#define ICM20602_ACCEL_YOUT_L     0x3E
+#define ICM20602_ACCEL_ZOUT_H     0x3F
+#define ICM20602_ACCEL_ZOUT_L     0x40
+#define ICM20602_TEMP_OUT_H       0x41
+#define ICM20602_TEMP_OUT_L       0x42
+#define ICM20602_GYRO_XOUT_H      0x43
+#define ICM20602_GYRO_XOUT_L      0x44
+#define ICM20602_GYRO_YOUT_H      0x45
+#define ICM20602_GYRO_YOUT_L      0x46
+#define ICM20602_GYRO_ZOUT_H      0x47
+#define ICM20602_GYRO_ZOUT_L      0x48
+//#define EXT_SENS_DATA_00 0x49
+//#define EXT_SENS_DATA_01 0x4A
+//#define EXT_SENS_DATA_02 0x4B
+//#define EXT_SENS_DATA_03 0x4C
+//#define EXT_SENS_DATA_04 0x4D
+//#define EXT_SENS_DATA_05 0x4E
+//#define EXT_SENS_DATA_06 0x4F
+#define ICM20602_SELF_TEST_X_GYRO 0x50
+#define ICM20602_SELF_TEST_y_GYRO 0x51
+#define ICM20602_SELF_TEST_z_GYRO 0x52
+//#define EXT_SENS_DATA_10 0x53
+//#define EXT_SENS_DATA_11 0x54
+//#define EXT_SENS_DATA_12 0x55
+//#define EXT_SENS_DATA_13 0x56
+//#define EXT_SENS_DATA_14 0x57
+//#define EXT_SENS_DATA_15 0x58
+//#define EXT_SENS_DATA_16 0x59
+//#define EXT_SENS_DATA_17 0x5A
+//#define EXT_SENS_DATA_18 0x5B
+//#define EXT_SENS_DATA_19 0x5C
+//#define EXT_SENS_DATA_20 0x5D
+//#define EXT_SENS_DATA_21 0x5E
+//#define EXT_SENS_DATA_22 0x5F
+#define ICM20602_FIFO_WM_TH1      0x60  // Watermark bits [9:8]
+#define ICM20602_FIFO_WM_TH2      0x61  // Watermark bits [7:0]
+//#define I2C_SLV0_DO      0x63
+//#define I2C_SLV1_DO      0x64
+//#define I2C_SLV2_DO      0x65
+//#define I2C_SLV3_DO      0x66
+//#define I2C_MST_DELAY_CTRL 0x67
+#define ICM20602_SIGNAL_PATH_RESET  0x68
+#define ICM20602_ACCEL_INTEL_CTRL   0x69
+#define ICM20602_USER_CTRL        0x6A  // Bit 7 enable DMP, bit 3 reset DMP
+#define ICM20602_PWR_MGMT_1       0x6B  // Device defaults to the SLEEP mode
+#define ICM20602_PWR_MGMT_2       0x6C
+//#define DMP_BANK         0x6D  // Activates a specific bank in the DMP
+//#define DMP_RW_PNT       0x6E  // Set read/write pointer to a specific start address in specified DMP bank
+//#define DMP_REG          0x6F  // Register in DMP from which to read or to which to write
+#define ICM20602_I2C_IF           0x70
+//#define DMP_REG_2        0x71
+#define ICM20602_FIFO_COUNTH      0x72
+#define ICM20602_FIFO_COUNTL      0x73
+#define ICM20602_FIFO_R_W         0x74
+#define ICM20602_WHO_AM_I         0x75 // Should return 0x68
+
+// I2C_IF bits
+#define ICM20602_I2C_IF_DIS         0x40  // SPI only
+
+// FIFO_EN bits
+#define ICM20602_FIFO_EN_GYRO       0x10  // Gyroscope and temperature
+#define ICM20602_FIFO_EN_ACCEL      0x08
+
+// USER_CTRL bits
+#define ICM20602_USER_CTRL_FIFO_EN  0x40
+#define ICM20602_USER_CTRL_FIFO_RST 0x04
+
+// CONFIG bits
+#define ICM20602_CONFIG_FIFO_MODE   0x40  // Stop writing when the FIFO is full
+
+// ACCEL_CONFIG2 bits
+#define ICM20602_ACCEL_FCHOICE_B    0x08  // Bypass the accel DLPF
+
+// ACCEL_INTEL_CTRL bits
+#define ICM20602_ACCEL_INTEL_EN     0x80
+#define ICM20602_ACCEL_INTEL_MODE   0x40  // Compare each sample with the previous one
+
+// PWR_MGMT_1 bits
+#define ICM20602_PWR_CYCLE          0x20  // Accel duty cycling
+
+// PWR_MGMT_2 bits
+#define ICM20602_PWR_STBY_GYRO      0x07  // Gyro X/Y/Z standby
+
+// Wake-on-motion threshold resolution and range
+#define ICM20602_WOM_LSB_MG         4
+#define ICM20602_WOM_MAX_MG         1020
+
+// INT_PIN_CFG bits
+#define ICM20602_INT_PIN_ACTIVE_LOW 0x80
+#define ICM20602_INT_PIN_OPEN_DRAIN 0x40
+#define ICM20602_INT_PIN_LATCH      0x20  // Hold the pin until cleared instead of a 50 us pulse
+#define ICM20602_INT_PIN_RD_CLEAR   0x10  // Clear on any read instead of INT_STATUS read
+
+// FIFO_WM_INT_STATUS bits
+#define ICM20602_FIFO_WM_INT        0x40
+
+// INT_ENABLE/INT_STATUS bits
+#define ICM20602_INT_WOM            0xE0  // X, Y and Z wake-on-motion
+#define ICM20602_INT_FIFO_OFLOW     0x10
+#define ICM20602_INT_DATA_RDY       0x01
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_REGS_H_ */
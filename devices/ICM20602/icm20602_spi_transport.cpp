@@ -0,0 +1,112 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "icm20602_spi_transport.h"
+#include "icm20602_fifo.h"
+#include "icm20602_regs.h"
+
+#include <string.h>
+
+static_assert(ICM20602_SPI_BURST_MAX >= ICM20602_SAMPLE_BYTES,
+        "ICM20602_SPI_BURST_MAX must hold a whole sample");
+
+ICM20602SPITransport::ICM20602SPITransport(mbed::SPI& spi, PinName cs)
+    : _spi(spi),
+    _cs(nullptr)
+{
+    if (cs != NC) {
+        _cs = new mbed::DigitalOut(cs, 1);
+    }
+}
+
+ICM20602SPITransport::~ICM20602SPITransport()
+{
+    if (_cs != nullptr) {
+        delete _cs;
+    }
+}
+
+void ICM20602SPITransport::assert_cs()
+{
+    if (_cs != nullptr) {
+        *_cs = 0;
+    }
+}
+
+void ICM20602SPITransport::deassert_cs()
+{
+    if (_cs != nullptr) {
+        *_cs = 1;
+    }
+}
+
+int ICM20602SPITransport::read(uint8_t reg, uint8_t* data, int length)
+{
+    return transfer(reg | ICM20602_SPI_READ, nullptr, data, length);
+}
+
+int ICM20602SPITransport::write(uint8_t reg, const uint8_t* data, int length)
+{
+    return transfer(reg & ~ICM20602_SPI_READ, data, nullptr, length);
+}
+
+int ICM20602SPITransport::transfer(uint8_t addr, const uint8_t* tx, uint8_t* rx, int length)
+{
+    char tx_buf[ICM20602_SPI_BURST_MAX + 1];
+    char rx_buf[ICM20602_SPI_BURST_MAX + 1];
+    int err = 0;
+
+    _spi.lock();
+    while (length > 0 && !err) {
+        int n = (length < ICM20602_SPI_BURST_MAX) ? length : ICM20602_SPI_BURST_MAX;
+
+        // A hardware chip select only stays asserted for one SPI::write(),
+        // so the address goes out in the same call as the data
+        tx_buf[0] = (char) addr;
+        assert_cs();
+        int count;
+        if (tx != nullptr) {
+            memcpy(tx_buf + 1, tx, n);
+            count = _spi.write(tx_buf, n + 1, nullptr, 0);
+            tx += n;
+        } else {
+            count = _spi.write(tx_buf, 1, rx_buf, n + 1);
+            memcpy(rx, rx_buf + 1, n);
+            rx += n;
+        }
+        deassert_cs();
+
+        if (count != n + 1) {
+            err = -1;
+        }
+
+        // Every FIFO_R_W byte pops the FIFO, other accesses resume where this burst ended
+        if ((addr & ~ICM20602_SPI_READ) != ICM20602_FIFO_R_W) {
+            addr += n;
+        }
+        length -= n;
+    }
+    _spi.unlock();
+
+    return err;
+}
@@ -0,0 +1,81 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_SPI_TRANSPORT_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_SPI_TRANSPORT_H_
+
+#include "icm20602_transport.h"
+
+#include "drivers/SPI.h"
+#include "drivers/DigitalOut.h"
+
+// Set in the register address byte to read
+#define ICM20602_SPI_READ 0x80
+
+// Longest access sent under one chip select assertion, longer ones are split.
+// Must hold a sample (14 bytes) so data registers are always read in one go.
+#ifndef ICM20602_SPI_BURST_MAX
+#define ICM20602_SPI_BURST_MAX 64
+#endif
+
+/**
+ * ICM20602 register access over SPI
+ *
+ * The SPI bus must be configured for mode 0 or 3, 8-bit format, up to
+ * 1 MHz for configuration registers and up to 10 MHz for data and FIFO reads.
+ *
+ * The register address and the data are sent in a single SPI::write(), so
+ * a hardware chip select (cs = NC) frames the whole access. Accesses longer
+ * than ICM20602_SPI_BURST_MAX bytes (only FIFO reads in practice) are split
+ * into several such bursts, each starting with the register address.
+ */
+class ICM20602SPITransport : public ICM20602Transport {
+public:
+
+    /**
+     * @param[in] spi Bus the sensor is on
+     * @param[in] cs Chip select, defaults to NC (CS handled by SPI in this case)
+     */
+    ICM20602SPITransport(mbed::SPI& spi, PinName cs = NC);
+
+    virtual ~ICM20602SPITransport();
+
+    virtual int read(uint8_t reg, uint8_t* data, int length);
+
+    virtual int write(uint8_t reg, const uint8_t* data, int length);
+
+    virtual bool disable_i2c() const { return true; }
+
+private:
+
+    /** Runs an access as bursts of up to ICM20602_SPI_BURST_MAX bytes */
+    int transfer(uint8_t addr, const uint8_t* tx, uint8_t* rx, int length);
+
+    void assert_cs();
+    void deassert_cs();
+
+    mbed::SPI& _spi;
+    mbed::DigitalOut* _cs;
+};
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_SPI_TRANSPORT_H_ */
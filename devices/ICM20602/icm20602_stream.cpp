@@ -0,0 +1,314 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "icm20602_stream.h"
+
+#include "hal/us_ticker_api.h"
+#include "platform/mbed_atomic.h"
+#include "platform/mbed_critical.h"
+
+#include <stdlib.h>
+
+using namespace std::chrono;
+
+ICM20602Stream::ICM20602Stream(ICM20602& imu, PinName int_pin,
+        events::EventQueue& queue, ICM20602SampleRing& ring)
+    : _imu(imu),
+    _irq(int_pin),
+    _queue(queue),
+    _ring(ring),
+    _mode(DATA_READY),
+    _running(false),
+    _period_us(1000),
+    _watermark(0),
+    _wom_threshold_mg(100),
+    _wom_divider(49),
+    _auto(false),
+    _auto_mode(DATA_READY),
+    _auto_divider(0),
+    _auto_watermark(0),
+    _quiet_us(0),
+    _last_motion_us(0),
+    _quiet_event(0),
+    _motion_counts(0),
+    _have_previous(false),
+    _pending(false),
+    _irq_us(0),
+    _event_id(0),
+    _missed(0),
+    _bus_errors(0)
+{
+}
+
+ICM20602Stream::~ICM20602Stream()
+{
+    stop();
+}
+
+bool ICM20602Stream::start(mode_t mode, uint8_t rate_divider, uint16_t watermark_frames)
+{
+    if (mode == FIFO_WATERMARK
+            && (watermark_frames == 0 || watermark_frames > ICM20602_FIFO_MAX_FRAMES)) {
+        return false;
+    }
+
+    stop();
+
+    _auto = false;
+    _configure(mode, rate_divider, watermark_frames);
+
+    _running = true;
+    _irq.rise(mbed::callback(this, &ICM20602Stream::_irq_handler));
+    return true;
+}
+
+bool ICM20602Stream::start_auto(mode_t mode, milliseconds quiet_period,
+        uint8_t rate_divider, uint16_t watermark_frames)
+{
+    if (mode == WAKE_ON_MOTION || (mode == FIFO_WATERMARK
+            && (watermark_frames == 0 || watermark_frames > ICM20602_FIFO_MAX_FRAMES))) {
+        return false;
+    }
+
+    stop();
+
+    _auto = true;
+    _auto_mode = mode;
+    _auto_divider = rate_divider;
+    _auto_watermark = watermark_frames;
+    _quiet_us = duration_cast<microseconds>(quiet_period).count();
+    _configure(WAKE_ON_MOTION, _wom_divider, 0);
+
+    _running = true;
+    _irq.rise(mbed::callback(this, &ICM20602Stream::_irq_handler));
+    return true;
+}
+
+void ICM20602Stream::stop()
+{
+    if (!_running) {
+        return;
+    }
+
+    _irq.rise(nullptr);
+    _running = false;
+
+    if (_pending) {
+        _queue.cancel(_event_id);
+        _pending = false;
+    }
+    if (_quiet_event) {
+        _queue.cancel(_quiet_event);
+        _quiet_event = 0;
+    }
+
+    _teardown();
+}
+
+void ICM20602Stream::_configure(mode_t mode, uint8_t rate_divider, uint16_t watermark_frames)
+{
+    _mode = mode;
+    _watermark = watermark_frames;
+    // Assumes the DLPF is enabled (see ICM20602::init), so the internal rate is 1 kHz
+    _period_us = 1000 * (1 + (uint32_t) rate_divider);
+    _have_previous = false;
+
+    if (mode == WAKE_ON_MOTION) {
+        _imu.enableWakeOnMotion(_wom_threshold_mg, rate_divider);
+        return;
+    }
+
+    // Software motion threshold in raw accel counts, for start_auto()
+    _motion_counts = (int32_t)(_wom_threshold_mg / (1000.0f * _imu.getAccResolution()));
+
+    _imu.setSampleRateDivider(rate_divider);
+    if (mode == FIFO_WATERMARK) {
+        _imu.setFifoWatermark(watermark_frames);
+        _imu.enableFifo();
+        // The watermark drives the pin on its own, an overflow also wakes us to drain
+        _imu.enableInterrupts(ICM20602_INT_FIFO_OFLOW);
+    } else {
+        _imu.disableFifo();
+        _imu.enableInterrupts(ICM20602_INT_DATA_RDY);
+    }
+}
+
+void ICM20602Stream::_teardown()
+{
+    if (_mode == WAKE_ON_MOTION) {
+        _imu.disableWakeOnMotion();
+        return;
+    }
+
+    _imu.enableInterrupts(0);
+    if (_mode == FIFO_WATERMARK) {
+        _imu.disableFifo();
+    }
+}
+
+void ICM20602Stream::_irq_handler()
+{
+    if (_pending) {
+        // In FIFO mode the data is still buffered by the sensor, only a
+        // data-ready sample is overwritten before it could be read
+        if (_mode == DATA_READY) {
+            core_util_atomic_incr_u32(&_missed, 1);
+        }
+        return;
+    }
+
+    _irq_us = ticker_read_us(get_us_ticker_data());
+    _pending = true;
+    _event_id = _queue.call(this, &ICM20602Stream::_service);
+    if (!_event_id) {
+        // The queue is full: nothing will read this interrupt's data, let
+        // the next interrupt try again
+        _pending = false;
+        core_util_atomic_incr_u32(&_missed, 1);
+    }
+}
+
+void ICM20602Stream::_service()
+{
+    // Re-arm before the bus read so an interrupt during the read is not lost
+    core_util_critical_section_enter();
+    us_timestamp_t irq_us = _irq_us;
+    _pending = false;
+    core_util_critical_section_exit();
+
+    if (!_running) {
+        return;
+    }
+
+    if (_mode == WAKE_ON_MOTION) {
+        if (_auto) {
+            _teardown();
+            _configure(_auto_mode, _auto_divider, _auto_watermark);
+            _last_motion_us = irq_us;
+            _quiet_event = _queue.call_in(duration_cast<milliseconds>(microseconds(_quiet_us)),
+                    this, &ICM20602Stream::_quiet_check);
+        }
+        if (_on_motion) {
+            _on_motion(true);
+        }
+        return;
+    }
+
+    size_t pushed = _ring.size();
+    if (_mode == FIFO_WATERMARK) {
+        _drain_fifo(irq_us);
+    } else {
+        _read_sample(irq_us);
+    }
+
+    if (_on_data && _ring.size() != pushed) {
+        _on_data();
+    }
+}
+
+void ICM20602Stream::_read_sample(us_timestamp_t irq_us)
+{
+    icm20602_sample_t sample;
+    if (!_imu.read_all(sample)) {
+        _bus_errors++;
+        return;
+    }
+    _push(sample, irq_us);
+}
+
+void ICM20602Stream::_drain_fifo(us_timestamp_t irq_us)
+{
+    // The interrupt fired as frame number _watermark was written, later
+    // frames are dated forward and earlier ones backward from it
+    int32_t index = 1 - (int32_t) _watermark;
+
+    while (true) {
+        bool overflow = false;
+        int n = _imu.readFifo(_burst, ICM20602_STREAM_BURST_FRAMES, &overflow);
+        if (n < 0) {
+            _bus_errors++;
+            return;
+        }
+        if (overflow) {
+            core_util_atomic_incr_u32(&_missed, 1);
+        }
+
+        for (int i = 0; i < n; i++, index++) {
+            _push(_burst[i], irq_us + (int64_t) index * _period_us);
+        }
+
+        if (n < ICM20602_STREAM_BURST_FRAMES) {
+            return;
+        }
+    }
+}
+
+void ICM20602Stream::_push(const icm20602_sample_t& sample, us_timestamp_t timestamp_us)
+{
+    icm20602_timed_sample_t s;
+    s.sample = sample;
+    s.timestamp_us = timestamp_us;
+    _ring.push(s);
+
+    if (!_auto) {
+        return;
+    }
+
+    // Same test as the sensor's wake-on-motion: any axis moved more than
+    // the threshold since the previous sample
+    if (_have_previous) {
+        for (int i = 0; i < 3; i++) {
+            if (abs(sample.accel[i] - _previous[i]) > _motion_counts) {
+                _last_motion_us = timestamp_us;
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        _previous[i] = sample.accel[i];
+    }
+    _have_previous = true;
+}
+
+void ICM20602Stream::_quiet_check()
+{
+    _quiet_event = 0;
+    if (!_running || _mode == WAKE_ON_MOTION) {
+        return;
+    }
+
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    us_timestamp_t quiet_end = _last_motion_us + _quiet_us;
+    if (now < quiet_end) {
+        // Motion was seen since this check was scheduled, wait out the remainder
+        _quiet_event = _queue.call_in(duration_cast<milliseconds>(microseconds(quiet_end - now)) + 1ms,
+                this, &ICM20602Stream::_quiet_check);
+        return;
+    }
+
+    _teardown();
+    _configure(WAKE_ON_MOTION, _wom_divider, 0);
+    if (_on_motion) {
+        _on_motion(false);
+    }
+}
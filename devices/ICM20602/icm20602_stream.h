@@ -0,0 +1,231 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_STREAM_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_STREAM_H_
+
+#include "icm20602_i2c.h"
+
+#include "extensions/LockFreeRing.h"
+
+#include "drivers/InterruptIn.h"
+#include "events/EventQueue.h"
+#include "hal/ticker_api.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+
+#include <stdint.h>
+#include <chrono>
+
+// Frames read per FIFO burst (sets the size of the stream's scratch buffer)
+#ifndef ICM20602_STREAM_BURST_FRAMES
+#define ICM20602_STREAM_BURST_FRAMES 16
+#endif
+
+/** Sample with the time it was taken (microseconds, us ticker) */
+struct icm20602_timed_sample_t {
+    icm20602_sample_t sample;
+    us_timestamp_t timestamp_us;
+};
+
+/** Ring of timestamped samples, filled by ICM20602Stream and drained by a consumer thread */
+typedef ep::LockFreeRing<icm20602_timed_sample_t> ICM20602SampleRing;
+
+/**
+ * Interrupt-driven acquisition for the ICM20602
+ *
+ * The sensor's INT pin triggers on an InterruptIn. The ISR only timestamps
+ * the event and defers the I2C burst read to an EventQueue; decoded samples
+ * are pushed into a lock-free ring that a consumer thread drains.
+ *
+ * In DATA_READY mode every sample raises an interrupt and is read with
+ * ICM20602::read_all(). In FIFO_WATERMARK mode the sensor buffers samples
+ * and interrupts once the watermark is reached, so the MCU only wakes every
+ * watermark_frames samples; frame timestamps are reconstructed from the
+ * interrupt time and the sample period.
+ *
+ * In WAKE_ON_MOTION mode the gyro sleeps and the accelerometer is duty
+ * cycled; no samples are produced, the motion callback is called when
+ * the sensor reports motion. start_auto() combines the modes: it waits in
+ * WAKE_ON_MOTION, streams at full rate once motion is seen and returns to
+ * WAKE_ON_MOTION after a quiet period without motion.
+ *
+ * Example:
+ * @code
+ * static icm20602_timed_sample_t storage[64];
+ * ICM20602SampleRing ring(storage);
+ * ICM20602Stream stream(imu, IMU_INT, *mbed_event_queue(), ring);
+ * stream.start(ICM20602Stream::FIFO_WATERMARK, 0, 20); // 1 kHz, wake every 20 ms
+ *
+ * // Or: sleep until moved, stream while moving, sleep again after 10 s at rest
+ * stream.set_wake_on_motion(60);
+ * stream.start_auto(ICM20602Stream::FIFO_WATERMARK, 10s, 0, 20);
+ * @endcode
+ *
+ * @note The ring's producer is the EventQueue, so only one other context may pop from it
+ */
+class ICM20602Stream : private mbed::NonCopyable<ICM20602Stream> {
+public:
+
+    enum mode_t {
+        DATA_READY,         /** Interrupt and read on every sample */
+        FIFO_WATERMARK,     /** Interrupt when the FIFO reaches the watermark, read in bursts */
+        WAKE_ON_MOTION      /** Low power, interrupt on motion only */
+    };
+
+    /**
+     * @param[in] imu Sensor to read
+     * @param[in] int_pin Pin connected to the sensor INT output
+     * @param[in] queue Queue the bus reads are deferred to
+     * @param[in] ring Destination of the samples
+     */
+    ICM20602Stream(ICM20602& imu, PinName int_pin, events::EventQueue& queue, ICM20602SampleRing& ring);
+
+    ~ICM20602Stream();
+
+    /**
+     * Starts acquisition
+     *
+     * @param[in] mode Interrupt source
+     * @param[in] rate_divider Output data rate is 1 kHz / (1 + rate_divider)
+     * @param[in] watermark_frames FIFO_WATERMARK only: samples per interrupt, 1 to ICM20602_FIFO_MAX_FRAMES
+     * @return false if watermark_frames is out of range (acquisition is not started)
+     */
+    bool start(mode_t mode, uint8_t rate_divider = 0,
+            uint16_t watermark_frames = ICM20602_STREAM_BURST_FRAMES);
+
+    /**
+     * Starts automatic switching between WAKE_ON_MOTION and streaming
+     *
+     * While streaming, motion is detected in software from the samples read,
+     * with the same threshold and sample-to-sample comparison as the sensor's
+     * wake-on-motion logic.
+     *
+     * @param[in] mode Streaming mode used while in motion, DATA_READY or FIFO_WATERMARK
+     * @param[in] quiet_period Time without motion before returning to WAKE_ON_MOTION
+     * @param[in] rate_divider Streaming output data rate is 1 kHz / (1 + rate_divider)
+     * @param[in] watermark_frames FIFO_WATERMARK only: samples per interrupt, 1 to ICM20602_FIFO_MAX_FRAMES
+     * @return false if mode or watermark_frames is invalid (acquisition is not started)
+     */
+    bool start_auto(mode_t mode, std::chrono::milliseconds quiet_period, uint8_t rate_divider = 0,
+            uint16_t watermark_frames = ICM20602_STREAM_BURST_FRAMES);
+
+    /**
+     * Sets the wake-on-motion configuration, used from the next start
+     *
+     * @param[in] threshold_mg Motion threshold, 4 mg resolution, up to 1020 mg
+     * @param[in] rate_divider Accel duty cycle rate is 1 kHz / (1 + rate_divider)
+     */
+    void set_wake_on_motion(uint16_t threshold_mg, uint8_t rate_divider = 49) {
+        _wom_threshold_mg = threshold_mg;
+        _wom_divider = rate_divider;
+    }
+
+    /** Stops acquisition and releases the INT pin */
+    void stop();
+
+    /** Returns the mode the sensor is currently in */
+    mode_t get_mode() const { return _mode; }
+
+    /** Returns true between start() and stop() */
+    bool is_running() const { return _running; }
+
+    /**
+     * Attach a function called from the EventQueue after new samples were pushed
+     */
+    void attach(mbed::Callback<void()> func) { _on_data = func; }
+
+    /**
+     * Attach a function called from the EventQueue when motion starts (true)
+     * and, with start_auto(), when the quiet period ends (false)
+     */
+    void attach_motion(mbed::Callback<void(bool)> func) { _on_motion = func; }
+
+    /** Samples dropped because the ring was full */
+    uint32_t get_dropped() const { return _ring.dropped(); }
+
+    /**
+     * Samples lost before they could be read: data-ready interrupts that
+     * arrived before the previous sample was read, interrupts that could not
+     * be posted because the queue was full, or sensor FIFO overflows
+     */
+    uint32_t get_missed() const { return core_util_atomic_load_u32(&_missed); }
+
+    /** Deferred reads that failed on the bus */
+    uint32_t get_bus_errors() const { return _bus_errors; }
+
+    /** Sample period in microseconds */
+    uint32_t get_period_us() const { return _period_us; }
+
+protected:
+
+    void _configure(mode_t mode, uint8_t rate_divider, uint16_t watermark_frames);
+    void _teardown();
+    void _irq_handler();
+    void _service();
+    void _read_sample(us_timestamp_t irq_us);
+    void _drain_fifo(us_timestamp_t irq_us);
+    void _push(const icm20602_sample_t& sample, us_timestamp_t timestamp_us);
+    void _quiet_check();
+
+    ICM20602& _imu;
+    mbed::InterruptIn _irq;
+    events::EventQueue& _queue;
+    ICM20602SampleRing& _ring;
+
+    mbed::Callback<void()> _on_data;
+    mbed::Callback<void(bool)> _on_motion;
+
+    mode_t _mode;
+    bool _running;
+    uint32_t _period_us;
+    uint16_t _watermark;
+
+    /** Wake-on-motion configuration */
+    uint16_t _wom_threshold_mg;
+    uint8_t _wom_divider;
+
+    /** start_auto() state: streaming configuration, quiet period and last motion */
+    bool _auto;
+    mode_t _auto_mode;
+    uint8_t _auto_divider;
+    uint16_t _auto_watermark;
+    us_timestamp_t _quiet_us;
+    us_timestamp_t _last_motion_us;
+    int _quiet_event;
+    int32_t _motion_counts;
+    bool _have_previous;
+    int16_t _previous[3];
+
+    /** Set by the ISR until the deferred read runs, and the time it was raised */
+    volatile bool _pending;
+    volatile us_timestamp_t _irq_us;
+    int _event_id;
+
+    volatile uint32_t _missed;
+    uint32_t _bus_errors;
+
+    icm20602_sample_t _burst[ICM20602_STREAM_BURST_FRAMES];
+};
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_STREAM_H_ */
@@ -0,0 +1,60 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ICM20602_ICM20602_TRANSPORT_H_
+#define EP_OC_MCU_DEVICES_ICM20602_ICM20602_TRANSPORT_H_
+
+#include <stdint.h>
+
+/**
+ * Register access to an ICM20602
+ *
+ * Multi-byte accesses auto-increment the register address, except for
+ * ICM20602_FIFO_R_W where every byte pops the FIFO. Implementations must
+ * perform each call as a single bus transaction.
+ */
+class ICM20602Transport {
+public:
+
+    virtual ~ICM20602Transport() { }
+
+    /**
+     * Reads consecutive registers
+     * @retval 0 on success, non-zero on bus failure
+     */
+    virtual int read(uint8_t reg, uint8_t* data, int length) = 0;
+
+    /**
+     * Writes consecutive registers
+     * @retval 0 on success, non-zero on bus failure
+     */
+    virtual int write(uint8_t reg, const uint8_t* data, int length) = 0;
+
+    /**
+     * Returns true if the I2C interface should be disabled on init
+     * (set for SPI so bus noise can never switch the part to I2C mode)
+     */
+    virtual bool disable_i2c() const { return false; }
+};
+
+#endif /* EP_OC_MCU_DEVICES_ICM20602_ICM20602_TRANSPORT_H_ */
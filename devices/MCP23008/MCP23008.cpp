@@ -37,6 +37,11 @@ void MCP23008::set_output_pins ( uint8_t pins ) {
     write_register ( IODIR, value & ~pins );
 }
 
+void MCP23008::set_directions ( uint8_t mask, uint8_t inputs ) {
+    uint8_t value = read_register ( IODIR );
+    write_register ( IODIR, ( value & ~mask ) | ( inputs & mask ) );
+}
+
 void MCP23008::write_outputs ( uint8_t values ) {
     write_register ( GPIO, values );
 }
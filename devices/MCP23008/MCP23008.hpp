@@ -61,6 +61,19 @@ public:
      */
     void set_output_pins ( uint8_t pins );
 
+    /** Set the direction of several pins at once
+     *
+     * Unlike set_input_pins/set_output_pins this can make some pins inputs and
+     * others outputs in one read-modify-write of the IODIR register. Example:
+     * set_directions ( Pin_GP0 | Pin_GP1, Pin_GP1 );
+     * Makes GP1 an input and GP0 an output, the other pins keep their direction.
+     *
+     * @param mask A bitmask of the pins to change.
+     * @param inputs A bitmask of the pins in mask to set to input mode, the
+     * others in mask are set to output mode.
+     */
+    void set_directions ( uint8_t mask, uint8_t inputs );
+
     /** Write to the output pins.
      *
      * This function is used to set output pins on or off.
@@ -0,0 +1,105 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_MCP23008_MCP23008KEYMATRIXIO_H_
+#define EP_OC_MCU_DEVICES_MCP23008_MCP23008KEYMATRIXIO_H_
+
+#include "MCP23008.hpp"
+
+#include "drivers/KeyMatrix.h"
+
+namespace ep
+{
+
+    /**
+     * KeyMatrix backend scanning through an MCP23008 IO expander
+     *
+     * Row pins are outputs latched low; a row is selected by making it the only
+     * row configured as an output, so unselected rows are high impedance.
+     * Column pins use the internal pull-ups (a closed key reads low).
+     *
+     * Each row costs one IODIR read-modify-write and one GPIO read. Only the
+     * row bits of IODIR are changed while scanning, so expander pins that are
+     * not part of the matrix can be reconfigured at any time.
+     */
+    class MCP23008KeyMatrixIO : public KeyMatrixIO
+    {
+
+    public:
+
+        /**
+         * Constructor
+         * @param[in] mcp MCP23008 the matrix is connected to
+         * @param[in] rows Expander pin numbers (0-7) of the rows, in row order
+         * @param[in] num_rows Number of rows
+         * @param[in] cols Expander pin numbers (0-7) of the columns, in column order
+         * @param[in] num_cols Number of columns
+         */
+        MCP23008KeyMatrixIO(MCP23008& mcp, const uint8_t* rows, uint8_t num_rows,
+                const uint8_t* cols, uint8_t num_cols) : _mcp(mcp), _rows(rows),
+                _num_rows(num_rows), _cols(cols), _num_cols(num_cols), _row_mask(0) {
+            uint8_t col_mask = 0;
+            for(uint8_t c = 0; c < num_cols; c++) {
+                col_mask |= (1 << cols[c]);
+            }
+            for(uint8_t r = 0; r < num_rows; r++) {
+                _row_mask |= (1 << rows[r]);
+            }
+
+            /** Rows and columns are inputs while idle, other pins are left as they are */
+            _mcp.set_directions(_row_mask | col_mask, _row_mask | col_mask);
+            _mcp.set_pullups(_mcp.get_pullups() | col_mask);
+            _mcp.write_outputs(_mcp.read_outputs() & ~_row_mask);
+        }
+
+        virtual void select_row(uint8_t row) {
+            _mcp.set_directions(_row_mask, _row_mask & ~(1 << _rows[row]));
+        }
+
+        virtual void release_rows(void) {
+            _mcp.set_directions(_row_mask, _row_mask);
+        }
+
+        virtual uint32_t read_columns(void) {
+            uint8_t inputs = _mcp.read_inputs();
+            uint32_t closed = 0;
+            for(uint8_t c = 0; c < _num_cols; c++) {
+                if(!(inputs & (1 << _cols[c]))) {
+                    closed |= (1UL << c);
+                }
+            }
+            return closed;
+        }
+
+    private:
+
+        MCP23008& _mcp;
+        const uint8_t* _rows;
+        uint8_t _num_rows;
+        const uint8_t* _cols;
+        uint8_t _num_cols;
+        uint8_t _row_mask;
+    };
+}
+
+#endif /* EP_OC_MCU_DEVICES_MCP23008_MCP23008KEYMATRIXIO_H_ */
@@ -24,43 +24,253 @@
 #include "ResistorDivider.h"
 
 #include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include "platform/Callback.h"
 
 using namespace ep;
 
+/** Full scale of the normalized 16-bit ADC code */
+#define RESISTOR_DIVIDER_FULL_SCALE 0xFFFFUL
+
+/** Rounds a known (positive) float parameter to an integer, unknown parameters become 0 */
+static uint32_t to_u32(float value) {
+    return (value > 0.0f) ? (uint32_t)(value + 0.5f) : 0;
+}
+
 ResistorDivider::ResistorDivider(mbed::AnalogIn& adc_in, float r_pd, float r_pu,
-        float vin_volts) : adc_in(adc_in), r_pu(r_pu), r_pd(r_pd), vin_volts(vin_volts) {
+        float vin_volts) : adc_in(adc_in), r_pu(r_pu), r_pd(r_pd), vin_volts(vin_volts),
+        last_code(0), oversample(1), ratiometric(false), ref_adc(NULL), zero_adc(NULL),
+        ref_expected_code(0), gain_q16(1UL << 16), offset_q16(0), cal_queue(NULL), cal_event_id(0) {
 
     /** Exactly 2 of the given parameters must be > 0.0f (ie: they are known/fixed parameters) */
     MBED_ASSERT(((r_pd <= 0.0f) + (r_pu <= 0.0f) + (vin_volts <= 0.0f)) == 1);
 
+    /** Precompute the integer parameters so the integer getters don't do float math */
+    r_pu_ohms_u32 = to_u32(r_pu);
+    r_pd_ohms_u32 = to_u32(r_pd);
+    vin_mv = to_u32(vin_volts * 1000.0f);
+    vref_volts = adc_in.get_reference_voltage();
+    vref_mv = to_u32(vref_volts * 1000.0f);
+
+}
+
+uint16_t ResistorDivider::measure(void) {
+    last_code = correct(sample_average(adc_in));
+    return last_code;
+}
+
+void ResistorDivider::set_oversampling(uint8_t samples) {
+    oversample = (samples == 0) ? 1 : samples;
+}
+
+void ResistorDivider::set_ratiometric(bool enable) {
+    /** Vin must be known to calculate ratiometrically */
+    MBED_ASSERT(!enable || (vin_volts >= 0.0f));
+    ratiometric = enable;
+}
+
+void ResistorDivider::set_reference_channel(mbed::AnalogIn& ref_adc, float ref_r_pd,
+        float ref_r_pu, mbed::AnalogIn* zero_adc) {
+    MBED_ASSERT((ref_r_pd > 0.0f) && (ref_r_pu > 0.0f));
+    this->ref_adc = &ref_adc;
+    this->zero_adc = zero_adc;
+    ref_expected_code = (uint16_t)((RESISTOR_DIVIDER_FULL_SCALE * ref_r_pd) / (ref_r_pu + ref_r_pd) + 0.5f);
+}
+
+void ResistorDivider::recalibrate(void) {
+    if(ref_adc == NULL) {
+        return;
+    }
+
+    int32_t zero_code = (zero_adc != NULL) ? sample_average(*zero_adc) : 0;
+    int32_t span = (int32_t) sample_average(*ref_adc) - zero_code;
+
+    // A reference that reads at or below zero is a hardware fault, keep the last good correction
+    if(span <= 0) {
+        return;
+    }
+
+    // corrected = (code - zero) * expected / (ref - zero) = (code * gain + offset) >> 16
+    uint32_t gain = (uint32_t)((((uint64_t) ref_expected_code << 16) + (span >> 1)) / span);
+    int64_t offset = -((int64_t) zero_code * gain);
+    if(offset < INT32_MIN) {
+        offset = INT32_MIN;
+    }
+
+    core_util_critical_section_enter();
+    gain_q16 = gain;
+    offset_q16 = (int32_t) offset;
+    core_util_critical_section_exit();
+}
+
+void ResistorDivider::start_calibration(events::EventQueue& queue, std::chrono::milliseconds period) {
+    stop_calibration();
+    recalibrate();
+    cal_queue = &queue;
+    cal_event_id = queue.call_every(period, mbed::callback(this, &ResistorDivider::recalibrate));
+}
+
+void ResistorDivider::stop_calibration(void) {
+    if(cal_queue != NULL) {
+        cal_queue->cancel(cal_event_id);
+        cal_queue = NULL;
+        cal_event_id = 0;
+    }
 }
 
-float ResistorDivider::get_R_pu_ohms(void) {
+void ResistorDivider::reset_calibration(void) {
+    core_util_critical_section_enter();
+    gain_q16 = (1UL << 16);
+    offset_q16 = 0;
+    core_util_critical_section_exit();
+}
+
+float ResistorDivider::get_R_pu_ohms(bool new_measurement) {
     // Return known value, if available
     if(r_pu >= 0.0f) {
         return r_pu;
     } else {
+        if(ratiometric) {
+            // Rpu = Rpd * (full scale - code) / code
+            float code = vout_code(new_measurement);
+            return (r_pd * ((RESISTOR_DIVIDER_FULL_SCALE - code) / code));
+        }
         // Calculate pu
-        return (r_pd * ((vin_volts / adc_in.read_voltage()) - 1.0f));
+        return (r_pd * ((vin_volts / vout_volts(new_measurement)) - 1.0f));
     }
 }
 
-float ResistorDivider::get_R_pd_ohms(void) {
+float ResistorDivider::get_R_pd_ohms(bool new_measurement) {
     // Return known value, if available
     if(r_pd >= 0.0f) {
         return r_pd;
     } else {
+        if(ratiometric) {
+            // Rpd = Rpu * code / (full scale - code)
+            float code = vout_code(new_measurement);
+            return (r_pu * (code / (RESISTOR_DIVIDER_FULL_SCALE - code)));
+        }
         // Calculate pd
-        return (r_pu * (1.0f / ((vin_volts / adc_in.read_voltage()) - 1.0f)));
+        return (r_pu * (1.0f / ((vin_volts / vout_volts(new_measurement)) - 1.0f)));
     }
 }
 
-float ResistorDivider::get_Vin_volts(void) {
+float ResistorDivider::get_Vin_volts(bool new_measurement) {
     // Return known value, if available
     if(vin_volts >= 0.0f) {
         return vin_volts;
     } else {
         // Calculate vin_volts
-        return (((r_pu + r_pd) / r_pd) * adc_in.read_voltage());
+        return (((r_pu + r_pd) / r_pd) * vout_volts(new_measurement));
+    }
+}
+
+uint32_t ResistorDivider::get_R_pu_ohms_u32(bool new_measurement) {
+    // Return known value, if available
+    if(r_pu_ohms_u32 != 0) {
+        return r_pu_ohms_u32;
+    }
+
+    uint64_t vout_scaled, vin_scaled;
+    ratio(new_measurement, vout_scaled, vin_scaled);
+    if(vout_scaled == 0) {
+        return UINT32_MAX;
+    } else if(vout_scaled >= vin_scaled) {
+        return 0;
+    }
+
+    // Rpu = Rpd * (Vin - Vout) / Vout
+    uint64_t r = ((uint64_t) r_pd_ohms_u32 * (vin_scaled - vout_scaled)
+            + (vout_scaled >> 1)) / vout_scaled;
+    return (r > UINT32_MAX) ? UINT32_MAX : (uint32_t) r;
+}
+
+uint32_t ResistorDivider::get_R_pd_ohms_u32(bool new_measurement) {
+    // Return known value, if available
+    if(r_pd_ohms_u32 != 0) {
+        return r_pd_ohms_u32;
+    }
+
+    uint64_t vout_scaled, vin_scaled;
+    ratio(new_measurement, vout_scaled, vin_scaled);
+    if(vout_scaled >= vin_scaled) {
+        return UINT32_MAX;
+    }
+
+    // Rpd = Rpu * Vout / (Vin - Vout)
+    uint64_t diff = vin_scaled - vout_scaled;
+    uint64_t r = ((uint64_t) r_pu_ohms_u32 * vout_scaled + (diff >> 1)) / diff;
+    return (r > UINT32_MAX) ? UINT32_MAX : (uint32_t) r;
+}
+
+uint32_t ResistorDivider::get_Vin_mv(bool new_measurement) {
+    // Return known value, if available
+    if(vin_mv != 0) {
+        return vin_mv;
+    }
+
+    // Vin = Vout * (Rpu + Rpd) / Rpd
+    uint64_t vout_scaled = (uint64_t) vout_code(new_measurement) * reference_mv();
+    uint64_t den = (uint64_t) r_pd_ohms_u32 * RESISTOR_DIVIDER_FULL_SCALE;
+    if(den == 0) {
+        return UINT32_MAX;
+    }
+    uint64_t v = (vout_scaled * ((uint64_t) r_pu_ohms_u32 + r_pd_ohms_u32) + (den >> 1)) / den;
+    return (v > UINT32_MAX) ? UINT32_MAX : (uint32_t) v;
+}
+
+void ResistorDivider::ratio(bool new_measurement, uint64_t& vout_scaled, uint64_t& vin_scaled) {
+    if(ratiometric) {
+        vout_scaled = vout_code(new_measurement);
+        vin_scaled = RESISTOR_DIVIDER_FULL_SCALE;
+    } else {
+        vout_scaled = (uint64_t) vout_code(new_measurement) * reference_mv();
+        vin_scaled = (uint64_t) vin_mv * RESISTOR_DIVIDER_FULL_SCALE;
+    }
+}
+
+uint16_t ResistorDivider::sample_average(mbed::AnalogIn& adc) {
+    if(oversample <= 1) {
+        return adc.read_u16();
+    }
+
+    uint32_t sum = 0;
+    for(uint8_t i = 0; i < oversample; i++) {
+        sum += adc.read_u16();
+    }
+    return (uint16_t)((sum + (oversample >> 1)) / oversample);
+}
+
+uint16_t ResistorDivider::correct(uint16_t code) const {
+    // The gain and offset must come from the same calibration
+    core_util_critical_section_enter();
+    uint32_t gain = gain_q16;
+    int32_t offset = offset_q16;
+    core_util_critical_section_exit();
+
+    int64_t corrected = (((int64_t) code * gain) + offset + (1L << 15)) >> 16;
+    if(corrected < 0) {
+        return 0;
+    } else if(corrected > (int64_t) RESISTOR_DIVIDER_FULL_SCALE) {
+        return (uint16_t) RESISTOR_DIVIDER_FULL_SCALE;
+    }
+    return (uint16_t) corrected;
+}
+
+uint16_t ResistorDivider::vout_code(bool new_measurement) {
+    return new_measurement ? measure() : last_code;
+}
+
+float ResistorDivider::vout_volts(bool new_measurement) {
+    return vout_code(new_measurement) * (adc_in.get_reference_voltage() / (float) RESISTOR_DIVIDER_FULL_SCALE);
+}
+
+uint32_t ResistorDivider::reference_mv(void) {
+    // The application may change the reference at any time through the AnalogIn
+    float vref = adc_in.get_reference_voltage();
+    if(vref != vref_volts) {
+        vref_volts = vref;
+        vref_mv = to_u32(vref * 1000.0f);
     }
+    return vref_mv;
 }
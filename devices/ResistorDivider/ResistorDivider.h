@@ -28,6 +28,10 @@
 #if DEVICE_ANALOGIN
 
 #include "drivers/AnalogIn.h"
+#include "events/EventQueue.h"
+
+#include <stdint.h>
+#include <chrono>
 
 namespace ep
 {
@@ -91,38 +95,219 @@ namespace ep
         ResistorDivider(mbed::AnalogIn& adc_in, float r_pd,
                 float r_pu = UnknownVal, float vin_volts = MBED_CONF_TARGET_DEFAULT_ADC_VREF);
 
+        ~ResistorDivider() {
+            stop_calibration();
+        }
+
         /**
          * Returns the known or calculated resistance
          * of the pull-up resistor in the divider circuit (in ohms)
          *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
          * @returns pull-up resistor's value in ohms
          */
-        float get_R_pu_ohms(void);
+        float get_R_pu_ohms(bool new_measurement = true);
 
         /**
          * Returns the known or calculated resistance
          * of the pull-down resistor in the divider circuit (in ohms)
          *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
          * @returns pull-down resistor's value in ohms
          */
-        float get_R_pd_ohms(void);
+        float get_R_pd_ohms(bool new_measurement = true);
 
         /**
          * Returns the known or calculated voltage
          * of V_in in the divider circuit (in volts)
          *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
          * @returns V_in voltage of divider circuit
          */
-        float get_Vin_volts(void);
+        float get_Vin_volts(bool new_measurement = true);
+
+        /**
+         * Integer-only version of get_R_pu_ohms
+         *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
+         * @returns pull-up resistor's value in ohms, UINT32_MAX if Vout is at ground
+         */
+        uint32_t get_R_pu_ohms_u32(bool new_measurement = true);
+
+        /**
+         * Integer-only version of get_R_pd_ohms
+         *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
+         * @returns pull-down resistor's value in ohms, UINT32_MAX if Vout is at Vin
+         */
+        uint32_t get_R_pd_ohms_u32(bool new_measurement = true);
+
+        /**
+         * Integer-only version of get_Vin_volts
+         *
+         * @param[in] new_measurement (optional) If false, the calculation uses the
+         * last measurement instead of taking a new one
+         *
+         * @returns V_in voltage of divider circuit in millivolts, UINT32_MAX if Rpd rounds to 0 ohms
+         */
+        uint32_t get_Vin_mv(bool new_measurement = true);
+
+        /**
+         * Takes a raw sample of Vout
+         *
+         * @returns Vout as a raw ADC code, normalized to the range 0x0 - 0xFFFF
+         *
+         * @note This is a single sample, it is not oversampled or cached. The
+         * calibration correction (if any) is applied.
+         */
+        uint16_t read_u16(void) {
+            return correct(adc_in.read_u16());
+        }
+
+        /**
+         * Measures Vout, averaging the configured number of samples,
+         * and caches the result for the getters
+         *
+         * @returns Vout as a raw ADC code, normalized to the range 0x0 - 0xFFFF
+         */
+        uint16_t measure(void);
+
+        /**
+         * Returns the last measurement of Vout taken by measure() or
+         * any of the getters
+         *
+         * @returns Vout as a raw ADC code, normalized to the range 0x0 - 0xFFFF
+         */
+        uint16_t get_last_measurement(void) const {
+            return last_code;
+        }
+
+        /**
+         * Sets the number of ADC samples averaged for each measurement
+         *
+         * @param[in] samples Number of samples to average (1 to disable oversampling)
+         */
+        void set_oversampling(uint8_t samples);
+
+        /**
+         * Enables or disables ratiometric mode
+         *
+         * In ratiometric mode the divider is assumed to be powered from the
+         * ADC's reference supply, so the unknown resistance is calculated purely
+         * from the ratio of the ADC code to full scale. Neither Vin nor the
+         * reference voltage enter the calculation, so supply drift cancels out.
+         *
+         * @param[in] enable true to calculate resistances ratiometrically
+         *
+         * @note Ratiometric mode cannot be used when Vin is the unknown parameter
+         */
+        void set_ratiometric(bool enable);
+
+        /**
+         * Sets up a reference channel used to correct the gain and offset of measurements
+         *
+         * The reference channel measures a divider with known, fixed resistors that is
+         * powered from the same supply as the measured divider. An optional zero channel
+         * (tied to ground) is used to correct the ADC's offset.
+         *
+         * The correction is calculated by recalibrate() and applied to every
+         * subsequent measurement as a single fixed-point multiply-add.
+         *
+         * @param[in] ref_adc AnalogIn measuring the reference divider
+         * @param[in] ref_r_pd Reference divider's pull-down resistance (in ohms)
+         * @param[in] ref_r_pu Reference divider's pull-up resistance (in ohms)
+         * @param[in] zero_adc (optional) AnalogIn tied to ground, NULL if not available
+         */
+        void set_reference_channel(mbed::AnalogIn& ref_adc, float ref_r_pd, float ref_r_pu,
+                mbed::AnalogIn* zero_adc = NULL);
+
+        /**
+         * Measures the reference (and zero) channel and updates the cached
+         * gain/offset correction
+         *
+         * @note Has no effect if no reference channel has been set
+         */
+        void recalibrate(void);
+
+        /**
+         * Schedules recalibrate() to run periodically on the given EventQueue
+         *
+         * @param[in] queue EventQueue to run the calibration on
+         * @param[in] period Interval between calibrations
+         */
+        void start_calibration(events::EventQueue& queue, std::chrono::milliseconds period);
+
+        /**
+         * Stops periodic calibration started with start_calibration()
+         */
+        void stop_calibration(void);
+
+        /**
+         * Discards the cached correction so measurements are returned uncorrected
+         */
+        void reset_calibration(void);
 
     protected:
 
+        /** Returns Vout as a raw code, taking a new measurement if requested */
+        uint16_t vout_code(bool new_measurement);
+
+        /** Returns Vout in volts, taking a new measurement if requested */
+        float vout_volts(bool new_measurement);
+
+        /**
+         * Returns the ADC reference voltage in millivolts
+         *
+         * @note follows AnalogIn::set_reference_voltage(), the conversion is
+         * only redone when the reference voltage changes
+         */
+        uint32_t reference_mv(void);
+
+        /** Returns Vout and Vin on a common scale for the integer resistance calculations */
+        void ratio(bool new_measurement, uint64_t& vout_scaled, uint64_t& vin_scaled);
+
+        /** Returns the average of the configured number of samples of the given channel */
+        uint16_t sample_average(mbed::AnalogIn& adc);
+
+        /** Applies the cached gain/offset correction to a raw code */
+        uint16_t correct(uint16_t code) const;
+
         mbed::AnalogIn& adc_in; /** AnalogIn object used to take measurements of Vout with */
 
         float r_pu;         /** Given value of Rpu in the divider circuit (0.0f if unknown) */
         float r_pd;         /** Given value of Rpd in the divider circuit (0.0f if unknown) */
         float vin_volts;    /** Given value of Vin in the divider circuit (0.0f if unknown) */
 
+        uint32_t r_pu_ohms_u32; /** Given value of Rpu rounded to the nearest ohm */
+        uint32_t r_pd_ohms_u32; /** Given value of Rpd rounded to the nearest ohm */
+        uint32_t vin_mv;        /** Given value of Vin rounded to the nearest millivolt */
+        float vref_volts;       /** ADC reference voltage vref_mv was converted from */
+        uint32_t vref_mv;       /** ADC reference voltage in millivolts */
+
+        uint16_t last_code;     /** Last (averaged) measurement of Vout */
+        uint8_t oversample;     /** Number of ADC samples averaged for each measurement */
+        bool ratiometric;       /** Calculate resistances from the code ratio only */
+
+        mbed::AnalogIn* ref_adc;    /** Reference divider channel (NULL if not used) */
+        mbed::AnalogIn* zero_adc;   /** Grounded channel for offset correction (NULL if not used) */
+        uint16_t ref_expected_code; /** Ideal code of the reference divider */
+
+        uint32_t gain_q16;      /** Cached gain correction (Q16.16) */
+        int32_t offset_q16;     /** Cached offset correction, pre-multiplied by the gain (Q16.16) */
+
+        events::EventQueue* cal_queue;  /** Queue running periodic calibration (NULL if not running) */
+        int cal_event_id;               /** Event ID of the periodic calibration */
+
     };
 }
 
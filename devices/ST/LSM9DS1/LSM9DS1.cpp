@@ -27,6 +27,8 @@ Distributed as-is; no warranty is given.
 
 #include "platform/mbed_assert.h"
 
+#include <string.h>
+
 //#include <Wire.h> // Wire library is used for I2C
 //#include <SPI.h>  // SPI library is used for...SPI.
 
@@ -39,13 +41,74 @@ Distributed as-is; no warranty is given.
 #define LSM9DS1_COMMUNICATION_TIMEOUT 1000
 
 float magSensitivity[4] = {0.00014, 0.00029, 0.00043, 0.00058};
+// Gyro (and FIFO frame) period in us for each ODR_G setting
+static const uint32_t gyroPeriodUs[8] = {0, 67114, 16807, 8403, 4202, 2101, 1050, 0};
+// Writable configuration registers, as runs of consecutive addresses.
+// Everything else is read-only, reserved or output data.
+static const struct {
+    bool mag;
+    uint8_t first, last;
+} configRuns[] = {
+    {false, ACT_THS, INT2_CTRL},
+    {false, CTRL_REG1_G, ORIENT_CFG_G},
+    {false, CTRL_REG4, CTRL_REG10},
+    {false, FIFO_CTRL, FIFO_CTRL},
+    {false, INT_GEN_CFG_G, INT_GEN_DUR_G},
+    {true, OFFSET_X_REG_L_M, OFFSET_Z_REG_H_M},
+    {true, CTRL_REG1_M, CTRL_REG5_M},
+    {true, INT_CFG_M, INT_CFG_M},
+    {true, INT_THS_L_M, INT_THS_H_M},
+};
+#define CONFIG_RUNS (sizeof(configRuns) / sizeof(configRuns[0]))
+
+// Shadow slot of a configuration register, -1 if it isn't one
+static int shadowSlot(bool mag, uint8_t subAddress)
+{
+    for (size_t i = 0; i < CONFIG_RUNS; i++)
+    {
+        if ((configRuns[i].mag == mag) && (subAddress >= configRuns[i].first) &&
+            (subAddress <= configRuns[i].last))
+            return subAddress - (mag ? LSM9DS1_M_SHADOW_FIRST : LSM9DS1_XG_SHADOW_FIRST);
+    }
+    return -1;
+}
+
+// Register value as kept in the shadow: without the self-clearing reset
+// bits, so that read-modify-write never sets them again
+static uint8_t shadowValue(bool mag, uint8_t subAddress, uint8_t data)
+{
+    if (!mag && (subAddress == CTRL_REG8))
+        return data & ~(LSM9DS1_CTRL_REG8_BOOT | LSM9DS1_CTRL_REG8_SW_RESET);
+    if (mag && (subAddress == CTRL_REG2_M))
+        return data & ~(LSM9DS1_CTRL_REG2_M_REBOOT | LSM9DS1_CTRL_REG2_M_SOFT_RST);
+    return data;
+}
 // extern Serial pc;
 
 LSM9DS1::LSM9DS1(mbed::I2C& i2c, uint8_t xgAddr, uint8_t mAddr)
-    : i2c(i2c)
+    : _i2c(&i2c), _spi(nullptr), _csAG(nullptr), _csM(nullptr)
 {
     init(IMU_MODE_I2C, xgAddr, mAddr); // dont know about 0xD6 or 0x3B
 }
+
+LSM9DS1::LSM9DS1(mbed::SPI& spi, PinName csAG, PinName csM)
+    : _i2c(nullptr), _spi(&spi), _csAG(nullptr), _csM(nullptr)
+{
+    // Each die has its own chip select, the "addresses" just tell them apart
+    _csAG = new mbed::DigitalOut(csAG, 1);
+    _csM = new mbed::DigitalOut(csM, 1);
+    init(IMU_MODE_SPI, LSM9DS1_SPI_AG, LSM9DS1_SPI_M);
+}
+
+LSM9DS1::~LSM9DS1()
+{
+    if (_csAG != nullptr) {
+        delete _csAG;
+    }
+    if (_csM != nullptr) {
+        delete _csM;
+    }
+}
 /*
 LSM9DS1::LSM9DS1()
 {
@@ -147,6 +210,13 @@ void LSM9DS1::init(interface_mode interface, uint8_t xgAddr, uint8_t mAddr)
         mBiasRaw[i] = 0;
     }
     _autoCalc = false;
+    _busErrors = 0;
+    _fifoOverflows = 0;
+    _magSoftIron = false;
+    memset(&_xgShadow, 0, sizeof(_xgShadow));
+    memset(&_mShadow, 0, sizeof(_mShadow));
+    _shadowValid = false;
+    _deferConfig = false;
 }
 
 
@@ -178,6 +248,11 @@ uint16_t LSM9DS1::begin()
     
     if (whoAmICombined != ((WHO_AM_I_AG_RSP << 8) | WHO_AM_I_M_RSP))
         return 0;
+
+    // Cache the configuration registers, and stage the init writes so that
+    // only the registers that change go out, a few bursts in all
+    syncConfiguration();
+    deferConfiguration();
     
     // Gyro initialization stuff:
     initGyro(); // This will "turn on" the gyro. Setting up interrupts, etc.
@@ -188,6 +263,8 @@ uint16_t LSM9DS1::begin()
     // Magnetometer initialization stuff:
     initMag(); // "Turn on" all axes of the mag. Set up interrupts, etc.
 
+    applyConfiguration();
+
     // Once everything is initialized, return the WHO_AM_I registers we read:
     return whoAmICombined;
 }
@@ -381,6 +458,9 @@ void LSM9DS1::calibrateMag(bool loadIn)
     int16_t magMin[3] = {0, 0, 0};
     int16_t magMax[3] = {0, 0, 0}; // The road warrior
     
+    // The extremes must be taken from uncorrected readings
+    clearMagSoftIron();
+    
     for (i=0; i<128; i++)
     {
         while (!magAvailable())
@@ -392,8 +472,10 @@ void LSM9DS1::calibrateMag(bool loadIn)
         magTemp[2] = mz;
         for (j = 0; j < 3; j++)
         {
-            if (magTemp[j] > magMax[j]) magMax[j] = magTemp[j];
-            if (magTemp[j] < magMin[j]) magMin[j] = magTemp[j];
+            // Start from the first reading, not zero, in case an axis
+            // never changes sign
+            if ((i == 0) || (magTemp[j] > magMax[j])) magMax[j] = magTemp[j];
+            if ((i == 0) || (magTemp[j] < magMin[j])) magMin[j] = magTemp[j];
         }
     }
     for (j = 0; j < 3; j++)
@@ -405,6 +487,19 @@ void LSM9DS1::calibrateMag(bool loadIn)
     }
     
 }
+void LSM9DS1::setMagSoftIron(const float matrix[3][3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            float q = matrix[i][j] * (1 << LSM9DS1_SOFT_IRON_Q);
+            _magSoftIronQ[i][j] = (int32_t)(q < 0 ? q - 0.5f : q + 0.5f);
+        }
+    }
+    _magSoftIron = true;
+}
+
 void LSM9DS1::magOffset(uint8_t axis, int16_t offset)
 {
     if (axis > 2)
@@ -465,6 +560,9 @@ void LSM9DS1::initMag()
     tempRegValue = 0;
     if (settings.mag.lowPowerEnable) tempRegValue |= (1<<5);
     tempRegValue |= (settings.mag.operatingMode & 0x3);
+    // Keep the SPI port readable (see initSPI)
+    if (settings.device.commInterface == IMU_MODE_SPI)
+        tempRegValue |= LSM9DS1_CTRL_REG3_M_I2C_DISABLE | LSM9DS1_CTRL_REG3_M_SIM;
     mWriteByte(CTRL_REG3_M, tempRegValue); // Continuous conversion mode
     
     // CTRL_REG4_M (Default value: 0x00)
@@ -514,10 +612,12 @@ uint8_t LSM9DS1::magAvailable(lsm9ds1_axis axis)
     return ((status & (1<<axis)) >> axis);
 }
 
-void LSM9DS1::readAccel()
+int LSM9DS1::readAccel()
 {
     uint8_t temp[6]; // We'll read six bytes from the accelerometer into temp   
-    xgReadBytes(OUT_X_L_XL, temp, 6); // Read 6 bytes, beginning at OUT_X_L_XL
+    int err = xgReadBytes(OUT_X_L_XL, temp, 6); // Read 6 bytes, beginning at OUT_X_L_XL
+    if (err)
+        return err;
     ax = (temp[1] << 8) | temp[0]; // Store x-axis values into ax
     ay = (temp[3] << 8) | temp[2]; // Store y-axis values into ay
     az = (temp[5] << 8) | temp[4]; // Store z-axis values into az
@@ -527,6 +627,7 @@ void LSM9DS1::readAccel()
         ay -= aBiasRaw[Y_AXIS];
         az -= aBiasRaw[Z_AXIS];
     }
+    return 0;
 }
 
 int16_t LSM9DS1::readAccel(lsm9ds1_axis axis)
@@ -542,13 +643,31 @@ int16_t LSM9DS1::readAccel(lsm9ds1_axis axis)
     return value;
 }
 
-void LSM9DS1::readMag()
+int LSM9DS1::readMag()
 {
     uint8_t temp[6]; // We'll read six bytes from the mag into temp 
-    mReadBytes(OUT_X_L_M, temp, 6); // Read 6 bytes, beginning at OUT_X_L_M
+    int err = mReadBytes(OUT_X_L_M, temp, 6); // Read 6 bytes, beginning at OUT_X_L_M
+    if (err)
+        return err;
     mx = (temp[1] << 8) | temp[0]; // Store x-axis values into mx
     my = (temp[3] << 8) | temp[2]; // Store y-axis values into my
     mz = (temp[5] << 8) | temp[4]; // Store z-axis values into mz
+    if (_magSoftIron)
+    {
+        const int64_t raw[3] = {mx, my, mz};
+        int16_t * out[3] = {&mx, &my, &mz};
+        for (int i = 0; i < 3; i++)
+        {
+            int64_t value = _magSoftIronQ[i][0] * raw[0] + _magSoftIronQ[i][1] * raw[1] +
+                            _magSoftIronQ[i][2] * raw[2];
+            // Round, then saturate to the 16-bit output range
+            value = (value + (1 << (LSM9DS1_SOFT_IRON_Q - 1))) >> LSM9DS1_SOFT_IRON_Q;
+            if (value > INT16_MAX) value = INT16_MAX;
+            if (value < INT16_MIN) value = INT16_MIN;
+            *out[i] = value;
+        }
+    }
+    return 0;
 }
 
 int16_t LSM9DS1::readMag(lsm9ds1_axis axis)
@@ -558,17 +677,22 @@ int16_t LSM9DS1::readMag(lsm9ds1_axis axis)
     return (temp[1] << 8) | temp[0];
 }
 
-void LSM9DS1::readTemp()
+int LSM9DS1::readTemp()
 {
     uint8_t temp[2]; // We'll read two bytes from the temperature sensor into temp  
-    xgReadBytes(OUT_TEMP_L, temp, 2); // Read 2 bytes, beginning at OUT_TEMP_L
+    int err = xgReadBytes(OUT_TEMP_L, temp, 2); // Read 2 bytes, beginning at OUT_TEMP_L
+    if (err)
+        return err;
     temperature = ((int16_t)temp[1] << 8) | temp[0];
+    return 0;
 }
 
-void LSM9DS1::readGyro()
+int LSM9DS1::readGyro()
 {
     uint8_t temp[6]; // We'll read six bytes from the gyro into temp
-    xgReadBytes(OUT_X_L_G, temp, 6); // Read 6 bytes, beginning at OUT_X_L_G
+    int err = xgReadBytes(OUT_X_L_G, temp, 6); // Read 6 bytes, beginning at OUT_X_L_G
+    if (err)
+        return err;
     gx = (temp[1] << 8) | temp[0]; // Store x-axis values into gx
     gy = (temp[3] << 8) | temp[2]; // Store y-axis values into gy
     gz = (temp[5] << 8) | temp[4]; // Store z-axis values into gz
@@ -578,6 +702,7 @@ void LSM9DS1::readGyro()
         gy -= gBiasRaw[Y_AXIS];
         gz -= gBiasRaw[Z_AXIS];
     }
+    return 0;
 }
 
 int16_t LSM9DS1::readGyro(lsm9ds1_axis axis)
@@ -616,7 +741,7 @@ float LSM9DS1::calcMag(int16_t mag)
 void LSM9DS1::setGyroScale(uint16_t gScl)
 {
     // Read current value of CTRL_REG1_G:
-    uint8_t ctrl1RegValue = xgReadByte(CTRL_REG1_G);
+    uint8_t ctrl1RegValue = xgReadShadow(CTRL_REG1_G);
     // Mask out scale bits (3 & 4):
     ctrl1RegValue &= 0xE7;
     switch (gScl)
@@ -641,7 +766,7 @@ void LSM9DS1::setGyroScale(uint16_t gScl)
 void LSM9DS1::setAccelScale(uint8_t aScl)
 {
     // We need to preserve the other bytes in CTRL_REG6_XL. So, first read it:
-    uint8_t tempRegValue = xgReadByte(CTRL_REG6_XL);
+    uint8_t tempRegValue = xgReadShadow(CTRL_REG6_XL);
     // Mask out accel scale bits:
     tempRegValue &= 0xE7;
     
@@ -672,7 +797,7 @@ void LSM9DS1::setAccelScale(uint8_t aScl)
 void LSM9DS1::setMagScale(uint8_t mScl)
 {
     // We need to preserve the other bytes in CTRL_REG6_XM. So, first read it:
-    uint8_t temp = mReadByte(CTRL_REG2_M);
+    uint8_t temp = mReadShadow(CTRL_REG2_M);
     // Then mask out the mag scale bits:
     temp &= 0xFF^(0x3 << 5);
     
@@ -711,7 +836,7 @@ void LSM9DS1::setGyroODR(uint8_t gRate)
     if ((gRate & 0x07) != 0)
     {
         // We need to preserve the other bytes in CTRL_REG1_G. So, first read it:
-        uint8_t temp = xgReadByte(CTRL_REG1_G);
+        uint8_t temp = xgReadShadow(CTRL_REG1_G);
         // Then mask out the gyro ODR bits:
         temp &= 0xFF^(0x7 << 5);
         temp |= (gRate & 0x07) << 5;
@@ -728,7 +853,7 @@ void LSM9DS1::setAccelODR(uint8_t aRate)
     if ((aRate & 0x07) != 0)
     {
         // We need to preserve the other bytes in CTRL_REG1_XM. So, first read it:
-        uint8_t temp = xgReadByte(CTRL_REG6_XL);
+        uint8_t temp = xgReadShadow(CTRL_REG6_XL);
         // Then mask out the accel ODR bits:
         temp &= 0x1F;
         // Then shift in our new ODR bits:
@@ -742,7 +867,7 @@ void LSM9DS1::setAccelODR(uint8_t aRate)
 void LSM9DS1::setMagODR(uint8_t mRate)
 {
     // We need to preserve the other bytes in CTRL_REG5_XM. So, first read it:
-    uint8_t temp = mReadByte(CTRL_REG1_M);
+    uint8_t temp = mReadShadow(CTRL_REG1_M);
     // Then mask out the mag ODR bits:
     temp &= 0xFF^(0x7 << 2);
     // Then shift in our new ODR bits:
@@ -793,7 +918,7 @@ void LSM9DS1::configInt(interrupt_select interrupt, uint8_t generator,
     
     // Configure CTRL_REG8
     uint8_t temp;
-    temp = xgReadByte(CTRL_REG8);
+    temp = xgReadShadow(CTRL_REG8);
     
     if (activeLow) temp |= (1<<5);
     else temp &= ~(1<<5);
@@ -934,7 +1059,7 @@ uint8_t LSM9DS1::getMagIntSrc()
 
 void LSM9DS1::sleepGyro(bool enable)
 {
-    uint8_t temp = xgReadByte(CTRL_REG9);
+    uint8_t temp = xgReadShadow(CTRL_REG9);
     if (enable) temp |= (1<<6);
     else temp &= ~(1<<6);
     xgWriteByte(CTRL_REG9, temp);
@@ -942,7 +1067,7 @@ void LSM9DS1::sleepGyro(bool enable)
 
 void LSM9DS1::enableFIFO(bool enable)
 {
-    uint8_t temp = xgReadByte(CTRL_REG9);
+    uint8_t temp = xgReadShadow(CTRL_REG9);
     if (enable) temp |= (1<<1);
     else temp &= ~(1<<1);
     xgWriteByte(CTRL_REG9, temp);
@@ -961,6 +1086,112 @@ uint8_t LSM9DS1::getFIFOSamples()
     return (xgReadByte(FIFO_SRC) & 0x3F);
 }
 
+int LSM9DS1::startFIFOStream(uint8_t watermark, h_lactive activeLow, pp_od pushPull)
+{
+    // Frames are gyro + accel pairs, which needs the gyro running
+    if (!settings.gyro.enabled || (watermark == 0))
+        return -1;
+
+    uint32_t errors = _busErrors;
+    // Going through bypass mode empties the FIFO
+    setFIFO(FIFO_OFF, 0x00);
+    enableFIFO(true);
+    setFIFO(FIFO_CONT, watermark);
+    configInt(XG_INT1, INT_FTH, activeLow, pushPull);
+    return (_busErrors != errors) ? -1 : 0;
+}
+
+int LSM9DS1::stopFIFOStream()
+{
+    uint32_t errors = _busErrors;
+    xgWriteByte(INT1_CTRL, 0x00);
+    setFIFO(FIFO_OFF, 0x00);
+    enableFIFO(false);
+    return (_busErrors != errors) ? -1 : 0;
+}
+
+int LSM9DS1::getFIFOConfig(lsm9ds1_fifo_config_t & config)
+{
+    uint32_t errors = _busErrors;
+    config.fifoCtrl = xgReadShadow(FIFO_CTRL);
+    config.int1Ctrl = xgReadShadow(INT1_CTRL);
+    config.ctrlReg8 = xgReadShadow(CTRL_REG8);
+    config.fifoEnabled = (xgReadShadow(CTRL_REG9) & (1<<1)) != 0;
+    return (_busErrors != errors) ? -1 : 0;
+}
+
+int LSM9DS1::setFIFOConfig(const lsm9ds1_fifo_config_t & config)
+{
+    uint32_t errors = _busErrors;
+    // Going through bypass mode empties the FIFO
+    setFIFO(FIFO_OFF, 0x00);
+    enableFIFO(config.fifoEnabled);
+    xgWriteByte(FIFO_CTRL, config.fifoCtrl);
+    // Never write back BOOT (bit 7) or SW_RESET (bit 0)
+    xgWriteByte(CTRL_REG8, config.ctrlReg8 & ~((1<<7) | (1<<0)));
+    xgWriteByte(INT1_CTRL, config.int1Ctrl);
+    return (_busErrors != errors) ? -1 : 0;
+}
+
+int LSM9DS1::readFIFOStream(lsm9ds1_fifo_sample_t * samples, uint8_t max, uint32_t timestamp_us)
+{
+    uint8_t src;
+    if (xgReadBytes(FIFO_SRC, &src, 1))
+        return -1;
+
+    // In continuous mode the oldest frames are overwritten once the FIFO
+    // is full, OVRN stays set until the next read
+    if (src & FIFO_SRC_OVRN)
+        _fifoOverflows++;
+
+    uint8_t stored = src & FIFO_SRC_FSS;
+    uint8_t count = (stored < max) ? stored : max;
+    if (count == 0)
+        return 0;
+
+    // The gyro and accel outputs aren't adjacent, but with the FIFO enabled
+    // the auto-incremented address wraps from OUT_Z_H_G (1Dh) to OUT_X_L_XL
+    // (28h), and from OUT_Z_H_XL (2Dh) back to OUT_X_L_G (18h) popping the
+    // frame. All frames therefore come out of one burst from OUT_X_L_G.
+    uint8_t * raw = (uint8_t *) samples;
+    if (xgReadBytes(OUT_X_L_G, raw, count * LSM9DS1_FIFO_FRAME_BYTES))
+        return -1;
+
+    // Decode in place starting with the last frame: a sample is larger than
+    // its raw frame, so only frames already decoded get overwritten.
+    // The newest frame stored was sampled at about timestamp_us.
+    uint32_t period = getFIFOPeriod();
+    for (int i = count - 1; i >= 0; i--)
+    {
+        uint8_t frame[LSM9DS1_FIFO_FRAME_BYTES];
+        memcpy(frame, raw + (i * LSM9DS1_FIFO_FRAME_BYTES), sizeof(frame));
+
+        lsm9ds1_fifo_sample_t * sample = &samples[i];
+        sample->gx = (frame[1] << 8) | frame[0];
+        sample->gy = (frame[3] << 8) | frame[2];
+        sample->gz = (frame[5] << 8) | frame[4];
+        sample->ax = (frame[7] << 8) | frame[6];
+        sample->ay = (frame[9] << 8) | frame[8];
+        sample->az = (frame[11] << 8) | frame[10];
+        if (_autoCalc)
+        {
+            sample->gx -= gBiasRaw[X_AXIS];
+            sample->gy -= gBiasRaw[Y_AXIS];
+            sample->gz -= gBiasRaw[Z_AXIS];
+            sample->ax -= aBiasRaw[X_AXIS];
+            sample->ay -= aBiasRaw[Y_AXIS];
+            sample->az -= aBiasRaw[Z_AXIS];
+        }
+        sample->timestamp_us = timestamp_us - (stored - 1 - i) * period;
+    }
+    return count;
+}
+
+uint32_t LSM9DS1::getFIFOPeriod()
+{
+    return gyroPeriodUs[settings.gyro.sampleRate & 0x07];
+}
+
 void LSM9DS1::constrainScales()
 {
     if ((settings.gyro.scale != 245) && (settings.gyro.scale != 500) && 
@@ -982,25 +1213,143 @@ void LSM9DS1::constrainScales()
     }
 }
 
-void LSM9DS1::xgWriteByte(uint8_t subAddress, uint8_t data)
+int LSM9DS1::syncConfiguration()
+{
+    uint32_t errors = _busErrors;
+    _shadowValid = false;
+
+    // One burst per run, runs don't cross the output data registers (which
+    // are remapped onto the FIFO when it is enabled)
+    for (size_t i = 0; i < CONFIG_RUNS; i++)
+    {
+        bool mag = configRuns[i].mag;
+        uint8_t * dest = (mag ? _mShadow.regs : _xgShadow.regs) + shadowSlot(mag, configRuns[i].first);
+        uint16_t count = configRuns[i].last - configRuns[i].first + 1;
+        if (mag)
+            mReadBytes(configRuns[i].first, dest, count);
+        else
+            xgReadBytes(configRuns[i].first, dest, count);
+    }
+    _xgShadow.regs[CTRL_REG8 - LSM9DS1_XG_SHADOW_FIRST] =
+        shadowValue(false, CTRL_REG8, _xgShadow.regs[CTRL_REG8 - LSM9DS1_XG_SHADOW_FIRST]);
+    _mShadow.regs[CTRL_REG2_M - LSM9DS1_M_SHADOW_FIRST] =
+        shadowValue(true, CTRL_REG2_M, _mShadow.regs[CTRL_REG2_M - LSM9DS1_M_SHADOW_FIRST]);
+    _xgShadow.dirty = 0;
+    _mShadow.dirty = 0;
+
+    if (_busErrors != errors)
+        return -1;
+    _shadowValid = true;
+    return 0;
+}
+
+int LSM9DS1::applyConfiguration()
+{
+    uint32_t errors = _busErrors;
+    _deferConfig = false;
+
+    // Rewriting the unchanged registers between two pending ones is cheaper
+    // than starting another transfer, so each run takes a single burst
+    for (size_t i = 0; i < CONFIG_RUNS; i++)
+    {
+        bool mag = configRuns[i].mag;
+        ConfigShadow& shadow = mag ? _mShadow : _xgShadow;
+        int base = shadowSlot(mag, configRuns[i].first);
+        int first = base;
+        int last = base + (configRuns[i].last - configRuns[i].first);
+        while ((first <= last) && !(shadow.dirty & ((uint64_t) 1 << first)))
+            first++;
+        while ((last >= first) && !(shadow.dirty & ((uint64_t) 1 << last)))
+            last--;
+        if (first > last)
+            continue;
+
+        uint8_t subAddress = configRuns[i].first + (first - base);
+        uint8_t count = last - first + 1;
+        int err = mag ? mWriteBytes(subAddress, shadow.regs + first, count)
+                      : xgWriteBytes(subAddress, shadow.regs + first, count);
+        if (!err)
+            shadow.dirty &= ~((((uint64_t) 1 << count) - 1) << first);
+    }
+    return (_busErrors != errors) ? -1 : 0;
+}
+
+int LSM9DS1::shadowWrite(bool mag, uint8_t subAddress, uint8_t data)
 {
-    // Whether we're using I2C or SPI, write a byte using the
+    ConfigShadow& shadow = mag ? _mShadow : _xgShadow;
+    int slot = shadowSlot(mag, subAddress);
+    uint64_t bit = 0;
+    if (slot >= 0)
+    {
+        bit = (uint64_t) 1 << slot;
+        uint8_t cached = shadowValue(mag, subAddress, data);
+        if (_deferConfig && _shadowValid && (cached == data))
+        {
+            // Only stage actual changes, a pending register stays pending
+            if (cached != shadow.regs[slot])
+                shadow.dirty |= bit;
+            shadow.regs[slot] = cached;
+            return 0;
+        }
+        shadow.regs[slot] = cached;
+    }
+
+    int err = mag ? mWriteBytes(subAddress, &data, 1) : xgWriteBytes(subAddress, &data, 1);
+    // A failed write is retried by applyConfiguration()
+    if (err)
+        shadow.dirty |= bit;
+    else
+        shadow.dirty &= ~bit;
+    return err;
+}
+
+int LSM9DS1::xgWriteByte(uint8_t subAddress, uint8_t data)
+{
+    return shadowWrite(false, subAddress, data);
+}
+
+int LSM9DS1::mWriteByte(uint8_t subAddress, uint8_t data)
+{
+    return shadowWrite(true, subAddress, data);
+}
+
+int LSM9DS1::xgWriteBytes(uint8_t subAddress, const uint8_t * src, uint8_t count)
+{
+    // Whether we're using I2C or SPI, write using the
     // gyro-specific I2C address or SPI CS pin.
     if (settings.device.commInterface == IMU_MODE_I2C) {
-        I2CwriteByte(_xgAddress, subAddress, data);
+        return I2CwriteBytes(_xgAddress, subAddress, src, count);
     } else if (settings.device.commInterface == IMU_MODE_SPI) {
-        SPIwriteByte(_xgAddress, subAddress, data);
+        return SPIwriteBytes(_xgAddress, subAddress, src, count);
     }
+    return 0;
 }
 
-void LSM9DS1::mWriteByte(uint8_t subAddress, uint8_t data)
+int LSM9DS1::mWriteBytes(uint8_t subAddress, const uint8_t * src, uint8_t count)
 {
-    // Whether we're using I2C or SPI, write a byte using the
-    // accelerometer-specific I2C address or SPI CS pin.
+    // Whether we're using I2C or SPI, write using the
+    // magnetometer-specific I2C address or SPI CS pin.
     if (settings.device.commInterface == IMU_MODE_I2C)
-        return I2CwriteByte(_mAddress, subAddress, data);
+        return I2CwriteBytes(_mAddress, subAddress, src, count);
     else if (settings.device.commInterface == IMU_MODE_SPI)
-        return SPIwriteByte(_mAddress, subAddress, data);
+        return SPIwriteBytes(_mAddress, subAddress, src, count);
+    return 0;
+}
+
+uint8_t LSM9DS1::xgReadShadow(uint8_t subAddress)
+{
+    int slot = shadowSlot(false, subAddress);
+    if (_shadowValid && (slot >= 0))
+        return _xgShadow.regs[slot];
+    return xgReadByte(subAddress);
+}
+
+uint8_t LSM9DS1::mReadShadow(uint8_t subAddress)
+{
+    int slot = shadowSlot(true, subAddress);
+    if (_shadowValid && (slot >= 0))
+        return _mShadow.regs[slot];
+    return mReadByte(subAddress);
 }
 
 uint8_t LSM9DS1::xgReadByte(uint8_t subAddress)
@@ -1021,15 +1370,16 @@ uint8_t LSM9DS1::xgReadByte(uint8_t subAddress)
     return 0;
 }
 
-void LSM9DS1::xgReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count)
+int LSM9DS1::xgReadBytes(uint8_t subAddress, uint8_t * dest, uint16_t count)
 {
     // Whether we're using I2C or SPI, read multiple bytes using the
     // gyro-specific I2C address or SPI CS pin.
     if (settings.device.commInterface == IMU_MODE_I2C) {
-        I2CreadBytes(_xgAddress, subAddress, dest, count);
+        return I2CreadBytes(_xgAddress, subAddress, dest, count);
     } else if (settings.device.commInterface == IMU_MODE_SPI) {
-        SPIreadBytes(_xgAddress, subAddress, dest, count);
+        return SPIreadBytes(_xgAddress, subAddress, dest, count);
     }
+    return 0;
 }
 
 uint8_t LSM9DS1::mReadByte(uint8_t subAddress)
@@ -1050,47 +1400,67 @@ uint8_t LSM9DS1::mReadByte(uint8_t subAddress)
     
 }
 
-void LSM9DS1::mReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count)
+int LSM9DS1::mReadBytes(uint8_t subAddress, uint8_t * dest, uint16_t count)
 {
     // Whether we're using I2C or SPI, read multiple bytes using the
     // accelerometer-specific I2C address or SPI CS pin.
     if (settings.device.commInterface == IMU_MODE_I2C)
-        I2CreadBytes(_mAddress, subAddress, dest, count);
+        return I2CreadBytes(_mAddress, subAddress, dest, count);
     else if (settings.device.commInterface == IMU_MODE_SPI)
-        SPIreadBytes(_mAddress, subAddress, dest, count);
+        return SPIreadBytes(_mAddress, subAddress, dest, count);
+    return 0;
 }
 
 void LSM9DS1::initSPI()
 {
-    /* 
-    pinMode(_xgAddress, OUTPUT);
-    digitalWrite(_xgAddress, HIGH);
-    pinMode(_mAddress, OUTPUT);
-    digitalWrite(_mAddress, HIGH);
-    
-    SPI.begin();
-    // Maximum SPI frequency is 10MHz, could divide by 2 here:
-    SPI.setClockDivider(SPI_CLOCK_DIV2);
-    // Data is read and written MSb first.
-    SPI.setBitOrder(MSBFIRST);
-    // Data is captured on rising edge of clock (CPHA = 0)
-    // Base value of the clock is HIGH (CPOL = 1)
-    SPI.setDataMode(SPI_MODE0);
-    */
+    // Both dies run SPI mode 3 (SPC idles high, data captured on the
+    // rising edge), MSb first, at up to 10 MHz
+    _spi->format(8, 3);
+    _spi->frequency(LSM9DS1_SPI_FREQUENCY);
+
+    // The magnetometer powers up with its SPI port write-only (SIM = 0),
+    // enable reads before WHO_AM_I_M is checked. Disabling its I2C port
+    // also keeps SPI traffic on the shared lines from being decoded as I2C.
+    // initMag() keeps these bits set and writes the operating mode.
+    mWriteByte(CTRL_REG3_M, LSM9DS1_CTRL_REG3_M_I2C_DISABLE |
+               LSM9DS1_CTRL_REG3_M_SIM | 0x03);
 }
 
-void LSM9DS1::SPIwriteByte(uint8_t csPin, uint8_t subAddress, uint8_t data)
+mbed::DigitalOut* LSM9DS1::SPIchipSelect(uint8_t csPin)
 {
-    /*
-    digitalWrite(csPin, LOW); // Initiate communication
-    
+    return (csPin == _mAddress) ? _csM : _csAG;
+}
+
+int LSM9DS1::SPIwriteByte(uint8_t csPin, uint8_t subAddress, uint8_t data)
+{
+    return SPIwriteBytes(csPin, subAddress, &data, 1);
+}
+
+int LSM9DS1::SPIwriteBytes(uint8_t csPin, uint8_t subAddress,
+                            const uint8_t * src, uint8_t count)
+{
+    MBED_ASSERT(count <= LSM9DS1_WRITE_BURST_MAX);
+
     // If write, bit 0 (MSB) should be 0
-    // If single write, bit 1 should be 0
-    SPI.transfer(subAddress & 0x3F); // Send Address
-    SPI.transfer(data); // Send data
-    
-    digitalWrite(csPin, HIGH); // Close communication
-    */
+    // Mag only: if multiple write, bit 1 should be 1
+    char tx[1 + LSM9DS1_WRITE_BURST_MAX];
+    tx[0] = (char) (subAddress & 0x3F);
+    if ((csPin == _mAddress) && count > 1)
+        tx[0] |= LSM9DS1_SPI_M_INC;
+    memcpy(tx + 1, src, count);
+    mbed::DigitalOut* cs = SPIchipSelect(csPin);
+
+    _spi->lock();
+    *cs = 0; // Initiate communication
+    int written = _spi->write(tx, 1 + count, nullptr, 0);
+    *cs = 1; // Close communication
+    _spi->unlock();
+
+    if (written != 1 + count) {
+        _busErrors++;
+        return -1;
+    }
+    return 0;
 }
 
 uint8_t LSM9DS1::SPIreadByte(uint8_t csPin, uint8_t subAddress)
@@ -1098,29 +1468,37 @@ uint8_t LSM9DS1::SPIreadByte(uint8_t csPin, uint8_t subAddress)
     uint8_t temp;
     // Use the multiple read function to read 1 byte. 
     // Value is returned to `temp`.
-    SPIreadBytes(csPin, subAddress, &temp, 1);
+    if (SPIreadBytes(csPin, subAddress, &temp, 1))
+        return 0;
     return temp;
 }
 
-void LSM9DS1::SPIreadBytes(uint8_t csPin, uint8_t subAddress,
-                            uint8_t * dest, uint8_t count)
+int LSM9DS1::SPIreadBytes(uint8_t csPin, uint8_t subAddress,
+                            uint8_t * dest, uint16_t count)
 {
     // To indicate a read, set bit 0 (msb) of first byte to 1
-    uint8_t rAddress = 0x80 | (subAddress & 0x3F);
+    uint8_t rAddress = LSM9DS1_SPI_READ | (subAddress & 0x3F);
     // Mag SPI port is different. If we're reading multiple bytes, 
     // set bit 1 to 1. The remaining six bytes are the address to be read
+    // (the accel/gyro auto-increments through IF_ADD_INC instead)
     if ((csPin == _mAddress) && count > 1)
-        rAddress |= 0x40;
-    
-    /* 
-    digitalWrite(csPin, LOW); // Initiate communication
-    SPI.transfer(rAddress);
-    for (int i=0; i<count; i++)
-    {
-        dest[i] = SPI.transfer(0x00); // Read into destination array
+        rAddress |= LSM9DS1_SPI_M_INC;
+    mbed::DigitalOut* cs = SPIchipSelect(csPin);
+
+    // Address and data go out under a single chip select assertion, the
+    // data is clocked straight into the destination array
+    _spi->lock();
+    *cs = 0; // Initiate communication
+    _spi->write(rAddress);
+    int read = _spi->write(nullptr, 0, (char *) dest, count);
+    *cs = 1; // Close communication
+    _spi->unlock();
+
+    if (read != count) {
+        _busErrors++;
+        return -1;
     }
-    digitalWrite(csPin, HIGH); // Close communication
-    */
+    return 0;
 }
 
 void LSM9DS1::initI2C()
@@ -1133,83 +1511,56 @@ void LSM9DS1::initI2C()
 }
 
 // Wire.h read and write protocols
-void LSM9DS1::I2CwriteByte(uint8_t address, uint8_t subAddress, uint8_t data)
+int LSM9DS1::I2CwriteByte(uint8_t address, uint8_t subAddress, uint8_t data)
 {
-    /* 
-    Wire.beginTransmission(address);  // Initialize the Tx buffer
-    Wire.write(subAddress);           // Put slave register address in Tx buffer
-    Wire.write(data);                 // Put data in Tx buffer
-    Wire.endTransmission();           // Send the Tx buffer
-    */
-    char temp_data[2] = {subAddress, data};
-    i2c.write(address, temp_data, 2);
+    return I2CwriteBytes(address, subAddress, &data, 1);
+}
+
+int LSM9DS1::I2CwriteBytes(uint8_t address, uint8_t subAddress,
+                            const uint8_t * src, uint8_t count)
+{
+    MBED_ASSERT(count <= LSM9DS1_WRITE_BURST_MAX);
+
+    // Same auto-increment rule as I2CreadBytes()
+    if ((address == _mAddress) && (count > 1))
+        subAddress |= 0x80;
+
+    char temp_data[1 + LSM9DS1_WRITE_BURST_MAX];
+    temp_data[0] = (char) subAddress;
+    memcpy(temp_data + 1, src, count);
+    int err = _i2c->write(address, temp_data, 1 + count);
+    if (err)
+        _busErrors++;
+    return err;
 }
 
 uint8_t LSM9DS1::I2CreadByte(uint8_t address, uint8_t subAddress)
 {
-    /* 
-    int timeout = LSM9DS1_COMMUNICATION_TIMEOUT;
-    uint8_t data; // `data` will store the register data    
-    
-    Wire.beginTransmission(address);         // Initialize the Tx buffer
-    Wire.write(subAddress);                  // Put slave register address in Tx buffer
-    Wire.endTransmission(true);             // Send the Tx buffer, but send a restart to keep connection alive
-    Wire.requestFrom(address, (uint8_t) 1);  // Read one byte from slave register address 
-    while ((Wire.available() < 1) && (timeout-- > 0))
-        delay(1);
-    
-    if (timeout <= 0)
-        return 255; //! Bad! 255 will be misinterpreted as a good value.
-    
-    data = Wire.read();                      // Fill Rx buffer with result
-    return data;                             // Return data read from slave register
-    */
-    char data;
-    char temp[1] = {subAddress};
-    
-    i2c.write(address, temp, 1);
-    //i2c.write(address & 0xFE);
-    temp[1] = 0x00;
-    i2c.write(address, temp, 1);
-    //i2c.write( address | 0x01);
-    int a = i2c.read(address, &data, 1);
+    uint8_t data;
+    if (I2CreadBytes(address, subAddress, &data, 1))
+        return 0;
     return data;
 }
 
-uint8_t LSM9DS1::I2CreadBytes(uint8_t address, uint8_t subAddress, uint8_t * dest, uint8_t count)
-{  
-    /* 
-    int timeout = LSM9DS1_COMMUNICATION_TIMEOUT;
-    Wire.beginTransmission(address);   // Initialize the Tx buffer
-    // Next send the register to be read. OR with 0x80 to indicate multi-read.
-    Wire.write(subAddress | 0x80);     // Put slave register address in Tx buffer
-
-    Wire.endTransmission(true);             // Send the Tx buffer, but send a restart to keep connection alive
-    uint8_t i = 0;
-    Wire.requestFrom(address, count);  // Read bytes from slave register address 
-    while ((Wire.available() < count) && (timeout-- > 0))
-        delay(1);
-    if (timeout <= 0)
-        return -1;
-    
-    for (int i=0; i<count;)
-    {
-        if (Wire.available())
-        {
-            dest[i++] = Wire.read();
-        }
-    }
-    return count;
-    */
-    int i;
-    char temp_dest[count];
-    char temp[1] = {subAddress};
-    i2c.write(address, temp, 1);
-    i2c.read(address, temp_dest, count);
-    
-    //i2c doesn't take uint8_ts, but rather chars so do this nasty af conversion
-    for (i=0; i < count; i++) {
-        dest[i] = temp_dest[i];    
+int LSM9DS1::I2CreadBytes(uint8_t address, uint8_t subAddress, uint8_t * dest, uint16_t count)
+{
+    // The magnetometer only auto-increments the register address when the
+    // MSb of the sub-address is set (the accel/gyro uses IF_ADD_INC instead)
+    if ((address == _mAddress) && (count > 1))
+        subAddress |= 0x80;
+
+    // Write the sub-address and read back with a repeated start, directly
+    // into the destination buffer
+    char reg = subAddress;
+    int err = _i2c->write(address, &reg, 1, true);
+    if (err) {
+        // Release the bus, the failed write left it without a STOP
+        _i2c->stop();
+    } else {
+        err = _i2c->read(address, (char *) dest, count);
     }
-    return count;
+
+    if (err)
+        _busErrors++;
+    return err;
 }
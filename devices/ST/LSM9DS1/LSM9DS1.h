@@ -30,6 +30,9 @@ Distributed as-is; no warranty is given.
 //#endif
 
 #include "drivers/I2C.h"
+#include "drivers/SPI.h"
+#include "drivers/DigitalOut.h"
+#include "platform/NonCopyable.h"
 #include <stdint.h>
 #include "LSM9DS1_Registers.h"
 #include "LSM9DS1_Types.h"
@@ -37,6 +40,32 @@ Distributed as-is; no warranty is given.
 #define LSM9DS1_AG_ADDR(sa0)    ((sa0) == 0 ? 0x6A : 0x6B)
 #define LSM9DS1_M_ADDR(sa1)     ((sa1) == 0 ? 0x1C : 0x1E)
 
+// In SPI mode the "addresses" only identify which die's chip select to use
+#define LSM9DS1_SPI_AG          0
+#define LSM9DS1_SPI_M           1
+
+#define LSM9DS1_SPI_FREQUENCY   10000000
+#define LSM9DS1_SPI_READ        0x80    // R/W bit of the address byte
+#define LSM9DS1_SPI_M_INC       0x40    // Mag only: auto-increment (M/S bit)
+
+#define LSM9DS1_CTRL_REG3_M_I2C_DISABLE 0x80
+#define LSM9DS1_CTRL_REG3_M_SIM         0x04
+
+// Self-clearing reset bits, never kept in the configuration shadow
+#define LSM9DS1_CTRL_REG8_BOOT          0x80
+#define LSM9DS1_CTRL_REG8_SW_RESET      0x01
+#define LSM9DS1_CTRL_REG2_M_REBOOT      0x08
+#define LSM9DS1_CTRL_REG2_M_SOFT_RST    0x04
+
+// Configuration shadow: the writable registers of each die are cached at
+// their offset from its FIRST register. Both blocks fit LSM9DS1_SHADOW_SIZE.
+#define LSM9DS1_XG_SHADOW_FIRST     ACT_THS
+#define LSM9DS1_M_SHADOW_FIRST      OFFSET_X_REG_L_M
+#define LSM9DS1_SHADOW_SIZE         (INT_GEN_DUR_G - ACT_THS + 1)
+
+// Longest run of writable registers (ACT_THS to INT2_CTRL)
+#define LSM9DS1_WRITE_BURST_MAX     10
+
 enum lsm9ds1_axis {
     X_AXIS,
     Y_AXIS,
@@ -44,7 +73,34 @@ enum lsm9ds1_axis {
     ALL_AXIS
 };
 
-class LSM9DS1
+#define LSM9DS1_FIFO_DEPTH          32
+#define LSM9DS1_FIFO_FRAME_BYTES    12  // Gyro XYZ then accel XYZ
+
+#define FIFO_SRC_FTH                0x80
+#define FIFO_SRC_OVRN               0x40
+#define FIFO_SRC_FSS                0x3F
+
+// One gyro + accel frame drained from the FIFO by readFIFOStream(). Raw
+// readings, with the calibrate() biases removed like readGyro()/readAccel().
+struct lsm9ds1_fifo_sample_t {
+    int16_t gx, gy, gz;
+    int16_t ax, ay, az;
+    uint32_t timestamp_us;
+};
+
+// FIFO and INT1 setup changed by startFIFOStream()/stopFIFOStream(), see
+// getFIFOConfig()
+struct lsm9ds1_fifo_config_t {
+    uint8_t fifoCtrl;   // FIFO_CTRL
+    uint8_t int1Ctrl;   // INT1_CTRL
+    uint8_t ctrlReg8;   // CTRL_REG8, INT1 polarity and output type
+    bool fifoEnabled;   // CTRL_REG9.FIFO_EN
+};
+
+// Fractional bits of the soft-iron correction applied by readMag()
+#define LSM9DS1_SOFT_IRON_Q         14
+
+class LSM9DS1 : private mbed::NonCopyable<LSM9DS1>
 {
 public:
     IMUSettings settings;
@@ -74,6 +130,18 @@ public:
     
     */
     LSM9DS1(mbed::I2C& i2c, uint8_t xgAddr = LSM9DS1_AG_ADDR(1), uint8_t mAddr = LSM9DS1_M_ADDR(1));
+
+    /** LSM9DS1 -- SPI constructor (4-wire)
+    * The accel/gyro and magnetometer dies share the bus but have their own
+    * chip selects. begin() sets the bus to mode 3 at LSM9DS1_SPI_FREQUENCY
+    * and enables reads on the magnetometer's SPI port.
+    *  - spi = Bus the sensor is on
+    *  - csAG = Chip select of the accel/gyroscope (CS_A/G)
+    *  - csM = Chip select of the magnetometer (CS_M)
+    */
+    LSM9DS1(mbed::SPI& spi, PinName csAG, PinName csM);
+
+    ~LSM9DS1();
     //LSM9DS1(interface_mode interface, uint8_t xgAddr, uint8_t mAddr);
     //LSM9DS1();
        
@@ -85,8 +153,29 @@ public:
     uint16_t begin();
     
     void calibrate(bool autoCalc = true);
+    /** calibrateMag() -- Hard-iron calibration from the per-axis extremes
+    * Clears the soft-iron correction (see setMagSoftIron()) before sampling,
+    * it was fitted around the previous offsets. Set it again afterwards.
+    */
     void calibrateMag(bool loadIn = true);
     void magOffset(uint8_t axis, int16_t offset);
+
+    /** setAutoCalc() -- Subtract gBiasRaw/aBiasRaw from gyro and accel
+    * readings (set by calibrate(true) or LSM9DS1Calibration)
+    */
+    void setAutoCalc(bool enable) { _autoCalc = enable; }
+    bool getAutoCalc() const { return _autoCalc; }
+
+    /** setMagSoftIron() -- Set the soft-iron correction applied by readMag()
+    * The matrix multiplies the hard-iron corrected reading (see magOffset()),
+    * it is stored in fixed point with LSM9DS1_SOFT_IRON_Q fractional bits.
+    * Input:
+    *  - matrix = 3x3 correction, row-major. Entries must be within +/-2.
+    */
+    void setMagSoftIron(const float matrix[3][3]);
+
+    //! clearMagSoftIron() -- Stop applying the soft-iron correction
+    void clearMagSoftIron() { _magSoftIron = false; }
     
     /** accelAvailable() -- Polls the accelerometer status register to check
     * if new data is available.
@@ -124,8 +213,9 @@ public:
     * This function will read all six gyroscope output registers.
     * The readings are stored in the class' gx, gy, and gz variables. Read
     * those _after_ calling readGyro().
+    * Output: 0 on success, non-zero bus error (gx, gy and gz are unchanged)
     */
-    void readGyro();
+    int readGyro();
     
     /** int16_t readGyro(axis) -- Read a specific axis of the gyroscope.
     * [axis] can be any of X_AXIS, Y_AXIS, or Z_AXIS.
@@ -140,8 +230,9 @@ public:
     * This function will read all six accelerometer output registers.
     * The readings are stored in the class' ax, ay, and az variables. Read
     * those _after_ calling readAccel().
+    * Output: 0 on success, non-zero bus error (ax, ay and az are unchanged)
     */
-    void readAccel();
+    int readAccel();
     
     /** int16_t readAccel(axis) -- Read a specific axis of the accelerometer.
     * [axis] can be any of X_AXIS, Y_AXIS, or Z_AXIS.
@@ -155,12 +246,16 @@ public:
     /** readMag() -- Read the magnetometer output registers.
     * This function will read all six magnetometer output registers.
     * The readings are stored in the class' mx, my, and mz variables. Read
-    * those _after_ calling readMag().
+    * those _after_ calling readMag(). The soft-iron correction, if set,
+    * is applied to them.
+    * Output: 0 on success, non-zero bus error (mx, my and mz are unchanged)
     */
-    void readMag();
+    int readMag();
     
     /** int16_t readMag(axis) -- Read a specific axis of the magnetometer.
     * [axis] can be any of X_AXIS, Y_AXIS, or Z_AXIS.
+    * The soft-iron correction needs all three axes and is not applied here,
+    * use readMag() for corrected readings.
     * Input:
     *  - axis: can be either X_AXIS, Y_AXIS, or Z_AXIS.
     * Output:
@@ -172,8 +267,9 @@ public:
     * This function will read two temperature output registers.
     * The combined readings are stored in the class' temperature variables. Read
     * those _after_ calling readTemp().
+    * Output: 0 on success, non-zero bus error (temperature is unchanged)
     */
-    void readTemp();
+    int readTemp();
     
     /** calcGyro() -- Convert from RAW signed 16-bit value to degrees per second
     * This function reads in a signed 16-bit value and returns the scaled
@@ -358,6 +454,76 @@ public:
     
     //! getFIFOSamples() - Get number of FIFO samples
     uint8_t getFIFOSamples();
+
+    /** startFIFOStream() - Stream gyro + accel frames through the FIFO
+    * Empties the FIFO, puts it in continuous mode and routes the FIFO
+    * threshold interrupt to INT1. Frames are stored at the gyro ODR.
+    * Input:
+    *  - watermark: Frames stored before INT1 asserts, 1-31
+    *  - activeLow, pushPull: INT1 configuration, see configInt()
+    * Output: 0 on success, non-zero bus error or gyro disabled
+    */
+    int startFIFOStream(uint8_t watermark, h_lactive activeLow = INT_ACTIVE_HIGH,
+                        pp_od pushPull = INT_PUSH_PULL);
+
+    //! stopFIFOStream() - Disable the FIFO and its INT1 interrupt
+    int stopFIFOStream();
+
+    /** getFIFOConfig() / setFIFOConfig() - Save and restore the FIFO setup
+    * Lets code that streams temporarily (eg: LSM9DS1Calibration) put back
+    * the FIFO mode, threshold and INT1 routing the application had.
+    * setFIFOConfig() empties the FIFO first.
+    * Output: 0 on success, non-zero bus error
+    */
+    int getFIFOConfig(lsm9ds1_fifo_config_t & config);
+    int setFIFOConfig(const lsm9ds1_fifo_config_t & config);
+
+    /** readFIFOStream() - Drain the FIFO in one burst
+    * Call from thread context once INT1 asserts. Frames are returned
+    * oldest first, with timestamps spaced by getFIFOPeriod().
+    * Input:
+    *  - samples: Destination, also used as the raw read buffer
+    *  - max: Capacity of samples, up to LSM9DS1_FIFO_DEPTH
+    *  - timestamp_us: Time of the call, the newest frame stored is
+    *    stamped with it
+    * Output: Number of frames read, negative on bus error
+    */
+    int readFIFOStream(lsm9ds1_fifo_sample_t * samples, uint8_t max, uint32_t timestamp_us);
+
+    //! getFIFOPeriod() - Time between FIFO frames in us (gyro ODR)
+    uint32_t getFIFOPeriod();
+
+    //! getFIFOOverflows() - Number of drains that found frames overwritten
+    uint32_t getFIFOOverflows() const { return _fifoOverflows; }
+
+    //! getBusErrors() - Number of register accesses that failed on the bus
+    uint32_t getBusErrors() const { return _busErrors; }
+
+    /** syncConfiguration() - Reload the configuration register shadow
+    * begin() reads every writable configuration register into a cache,
+    * which the read-modify-write setters use instead of the bus. Call this
+    * again if the registers changed behind the driver's back (eg: a reset
+    * or power cycle of the part alone).
+    * Output: 0 on success, non-zero bus error (the shadow is then unused)
+    */
+    int syncConfiguration();
+
+    /** deferConfiguration() - Stage configuration changes in the shadow
+    * Until applyConfiguration(), setters and the config*() functions only
+    * update the shadow. Registers written more than once keep their last
+    * value, so don't defer sequences that depend on intermediate writes or
+    * wait on the part: calibrate() and the FIFO stream functions.
+    * Has no effect before begin().
+    */
+    void deferConfiguration() { _deferConfig = true; }
+
+    /** applyConfiguration() - Write the changed configuration registers
+    * Registers changed since deferConfiguration(), or whose write failed,
+    * are written in one auto-increment burst per run of writable
+    * registers. Writes then go straight through again.
+    * Output: 0 on success, non-zero bus error (failed registers stay pending)
+    */
+    int applyConfiguration();
         
 
 protected:  
@@ -373,6 +539,29 @@ protected:
     // _autoCalc keeps track of whether we're automatically subtracting off
     // accelerometer and gyroscope bias calculated in calibrate().
     bool _autoCalc;
+
+    // _busErrors counts failed register accesses, including single-byte
+    // reads whose return value can't carry an error
+    uint32_t _busErrors;
+
+    // _fifoOverflows counts readFIFOStream() calls that found OVRN set
+    uint32_t _fifoOverflows;
+
+    // _magSoftIronQ is the soft-iron correction applied by readMag() when
+    // _magSoftIron is set, in LSM9DS1_SOFT_IRON_Q fixed point
+    bool _magSoftIron;
+    int32_t _magSoftIronQ[3][3];
+
+    // Write-through cache of the configuration registers of one die, see
+    // syncConfiguration(). Bit n of dirty is set while regs[n] still has to
+    // be written.
+    struct ConfigShadow {
+        uint8_t regs[LSM9DS1_SHADOW_SIZE];
+        uint64_t dirty;
+    };
+    ConfigShadow _xgShadow, _mShadow;
+    bool _shadowValid;
+    bool _deferConfig;
     
     // init() -- Sets up gyro, accel, and mag settings to default.
     // - interface - Sets the interface mode (IMU_MODE_I2C or IMU_MODE_SPI)
@@ -431,15 +620,15 @@ protected:
     //  - * dest = A pointer to an array of uint8_t's. Values read will be
     //      stored in here on return.
     //  - count = The number of bytes to be read.
-    // Output: No value is returned, but the `dest` array will store
-    //  the data read upon exit.
-    void mReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count);
+    // Output: 0 on success, non-zero bus error. The `dest` array will
+    //  store the data read upon exit.
+    int mReadBytes(uint8_t subAddress, uint8_t * dest, uint16_t count);
     
     // gWriteByte() -- Write a byte to a register in the gyroscope.
     // Input:
     //  - subAddress = Register to be written to.
     //  - data = data to be written to the register.
-    void mWriteByte(uint8_t subAddress, uint8_t data);
+    int mWriteByte(uint8_t subAddress, uint8_t data);
     
     // xmReadByte() -- Read a byte from a register in the accel/mag sensor
     // Input:
@@ -455,15 +644,36 @@ protected:
     //  - * dest = A pointer to an array of uint8_t's. Values read will be
     //      stored in here on return.
     //  - count = The number of bytes to be read.
-    // Output: No value is returned, but the `dest` array will store
-    //  the data read upon exit.
-    void xgReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count);
+    // Output: 0 on success, non-zero bus error. The `dest` array will
+    //  store the data read upon exit.
+    int xgReadBytes(uint8_t subAddress, uint8_t * dest, uint16_t count);
     
     // xmWriteByte() -- Write a byte to a register in the accel/mag sensor.
     // Input:
     //  - subAddress = Register to be written to.
     //  - data = data to be written to the register.
-    void xgWriteByte(uint8_t subAddress, uint8_t data);
+    int xgWriteByte(uint8_t subAddress, uint8_t data);
+
+    // xgWriteBytes() / mWriteBytes() -- Burst write to consecutive registers,
+    // without going through the configuration shadow.
+    // Input:
+    //  - subAddress = First register to be written to.
+    //  - * src = Bytes to be written, up to LSM9DS1_WRITE_BURST_MAX.
+    //  - count = Number of registers to be written.
+    // Output: 0 on success, non-zero bus error
+    int xgWriteBytes(uint8_t subAddress, const uint8_t * src, uint8_t count);
+    int mWriteBytes(uint8_t subAddress, const uint8_t * src, uint8_t count);
+
+    // xgReadShadow() / mReadShadow() -- Read a configuration register from
+    // the shadow, or from the part if it isn't shadowed.
+    uint8_t xgReadShadow(uint8_t subAddress);
+    uint8_t mReadShadow(uint8_t subAddress);
+
+    // shadowWrite() -- Write a register of either die, updating the shadow
+    // if it is a configuration register. The write is only staged while
+    // deferred, unless it sets a self-clearing reset bit.
+    // Output: 0 on success or staged, non-zero bus error
+    int shadowWrite(bool mag, uint8_t subAddress, uint8_t data);
     
     // calcgRes() -- Calculate the resolution of the gyroscope.
     // This function will set the value of the gRes variable. gScale must
@@ -489,34 +699,48 @@ protected:
     // SPI Functions //
     ///////////////////
     // initSPI() -- Initialize the SPI hardware.
-    // This function will setup all SPI pins and related hardware.
+    // This function sets the bus format and frequency and enables reads
+    // on the magnetometer's SPI port.
     void initSPI();
+
+    // SPIchipSelect() -- Chip select of the die identified by csPin
+    // (LSM9DS1_SPI_AG or LSM9DS1_SPI_M).
+    mbed::DigitalOut* SPIchipSelect(uint8_t csPin);
     
     // SPIwriteByte() -- Write a byte out of SPI to a register in the device
     // Input:
     //  - csPin = The chip select pin of the slave device.
     //  - subAddress = The register to be written to.
     //  - data = Byte to be written to the register.
-    void SPIwriteByte(uint8_t csPin, uint8_t subAddress, uint8_t data);
+    // Output: 0 on success, non-zero bus error
+    int SPIwriteByte(uint8_t csPin, uint8_t subAddress, uint8_t data);
+
+    // SPIwriteBytes() -- Write up to LSM9DS1_WRITE_BURST_MAX consecutive
+    // registers under one chip select assertion.
+    // Output: 0 on success, non-zero bus error
+    int SPIwriteBytes(uint8_t csPin, uint8_t subAddress,
+                      const uint8_t * src, uint8_t count);
     
     // SPIreadByte() -- Read a single byte from a register over SPI.
     // Input:
     //  - csPin = The chip select pin of the slave device.
     //  - subAddress = The register to be read from.
     // Output:
-    //  - The byte read from the requested address.
+    //  - The byte read from the requested address, 0 on bus error
+    //    (counted in _busErrors).
     uint8_t SPIreadByte(uint8_t csPin, uint8_t subAddress);
     
     // SPIreadBytes() -- Read a series of bytes, starting at a register via SPI
+    // The whole burst is clocked out under one chip select assertion.
     // Input:
     //  - csPin = The chip select pin of a slave device.
     //  - subAddress = The register to begin reading.
     //  - * dest = Pointer to an array where we'll store the readings.
     //  - count = Number of registers to be read.
-    // Output: No value is returned by the function, but the registers read are
+    // Output: 0 on success, non-zero bus error. The registers read are
     //      all stored in the *dest array given.
-    void SPIreadBytes(uint8_t csPin, uint8_t subAddress, 
-                            uint8_t * dest, uint8_t count);
+    int SPIreadBytes(uint8_t csPin, uint8_t subAddress, 
+                            uint8_t * dest, uint16_t count);
     
     ///////////////////
     // I2C Functions //
@@ -530,28 +754,42 @@ protected:
     //  - address = The 7-bit I2C address of the slave device.
     //  - subAddress = The register to be written to.
     //  - data = Byte to be written to the register.
-    void I2CwriteByte(uint8_t address, uint8_t subAddress, uint8_t data);
+    // Output: 0 on success, non-zero bus error
+    int I2CwriteByte(uint8_t address, uint8_t subAddress, uint8_t data);
+
+    // I2CwriteBytes() -- Write up to LSM9DS1_WRITE_BURST_MAX consecutive
+    // registers in one transaction.
+    // Output: 0 on success, non-zero bus error
+    int I2CwriteBytes(uint8_t address, uint8_t subAddress,
+                      const uint8_t * src, uint8_t count);
     
     // I2CreadByte() -- Read a single byte from a register over I2C.
     // Input:
     //  - address = The 7-bit I2C address of the slave device.
     //  - subAddress = The register to be read from.
     // Output:
-    //  - The byte read from the requested address.
+    //  - The byte read from the requested address, 0 on bus error
+    //    (counted in _busErrors).
     uint8_t I2CreadByte(uint8_t address, uint8_t subAddress);
     
-    // I2CreadBytes() -- Read a series of bytes, starting at a register via SPI
+    // I2CreadBytes() -- Read a series of bytes, starting at a register via I2C
+    // The register address is written and the data read back in one
+    // repeated-start transaction, straight into *dest.
     // Input:
     //  - address = The 7-bit I2C address of the slave device.
     //  - subAddress = The register to begin reading.
     //  - * dest = Pointer to an array where we'll store the readings.
     //  - count = Number of registers to be read.
-    // Output: No value is returned by the function, but the registers read are
+    // Output: 0 on success, non-zero bus error. The registers read are
     //      all stored in the *dest array given.
-    uint8_t I2CreadBytes(uint8_t address, uint8_t subAddress, uint8_t * dest, uint8_t count);
+    int I2CreadBytes(uint8_t address, uint8_t subAddress, uint8_t * dest, uint16_t count);
     
 private:
-    mbed::I2C& i2c;
+    // Only the bus matching settings.device.commInterface is set
+    mbed::I2C* _i2c;
+    mbed::SPI* _spi;
+    mbed::DigitalOut* _csAG;
+    mbed::DigitalOut* _csM;
 };
 
 #endif // SFE_LSM9DS1_H //
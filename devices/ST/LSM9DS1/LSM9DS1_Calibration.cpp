@@ -0,0 +1,269 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "LSM9DS1_Calibration.h"
+
+using namespace std::chrono;
+
+// Mag sample period in ms for each DO setting of CTRL_REG1_M
+static const uint16_t mag_period_ms[8] = { 1600, 800, 400, 200, 100, 50, 25, 13 };
+
+LSM9DS1Calibration::LSM9DS1Calibration(LSM9DS1& imu, events::EventQueue& queue)
+    : _imu(imu),
+    _queue(queue),
+    _state(IDLE),
+    _event_id(0),
+    _interval(1),
+    _total(0),
+    _count(0),
+    _apply(false),
+    _saved_auto_calc(false),
+    _saved_fifo()
+{
+}
+
+LSM9DS1Calibration::~LSM9DS1Calibration()
+{
+    cancel();
+}
+
+int LSM9DS1Calibration::start_accel_gyro(uint16_t samples, bool autoCalc)
+{
+    if (_state != IDLE || samples == 0) {
+        return -1;
+    }
+
+    // The application may be using the FIFO itself, put it back afterwards
+    if (_imu.getFIFOConfig(_saved_fifo)) {
+        return -1;
+    }
+
+    // Average raw readings, any previous bias must not be subtracted
+    _saved_auto_calc = _imu.getAutoCalc();
+    _imu.setAutoCalc(false);
+
+    if (_imu.startFIFOStream(LSM9DS1_CALIBRATION_POLL_FRAMES)) {
+        _imu.setFIFOConfig(_saved_fifo);
+        _imu.setAutoCalc(_saved_auto_calc);
+        return -1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        _gyro_sum[i] = 0;
+        _accel_sum[i] = 0;
+    }
+
+    uint32_t interval_us = _imu.getFIFOPeriod() * LSM9DS1_CALIBRATION_POLL_FRAMES;
+    _interval = duration_cast<milliseconds>(microseconds(interval_us));
+    if (_interval < 1ms) {
+        _interval = 1ms;
+    }
+
+    _state = ACCEL_GYRO;
+    _total = samples;
+    _count = 0;
+    _apply = autoCalc;
+    if (_schedule()) {
+        _teardown(false);
+        _state = IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+int LSM9DS1Calibration::start_mag(uint16_t samples, bool loadIn)
+{
+    // A disabled magnetometer never has data ready, don't poll forever
+    if (_state != IDLE || samples == 0 || !_imu.settings.mag.enabled) {
+        return -1;
+    }
+
+    // Measure without the offsets loaded by a previous calibration
+    if (loadIn) {
+        uint32_t errors = _imu.getBusErrors();
+        for (int i = 0; i < 3; i++) {
+            _imu.magOffset(i, 0);
+        }
+        if (_imu.getBusErrors() != errors) {
+            return -1;
+        }
+    }
+
+    // The extremes must be taken from uncorrected readings
+    _imu.clearMagSoftIron();
+
+    _interval = milliseconds(mag_period_ms[_imu.settings.mag.sampleRate & 0x07]);
+
+    _state = MAG;
+    _total = samples;
+    _count = 0;
+    _apply = loadIn;
+    if (_schedule()) {
+        _state = IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+void LSM9DS1Calibration::cancel()
+{
+    if (_state == IDLE) {
+        return;
+    }
+
+    if (_event_id) {
+        _queue.cancel(_event_id);
+        _event_id = 0;
+    }
+    _teardown(false);
+    _state = IDLE;
+}
+
+int LSM9DS1Calibration::_schedule()
+{
+    _event_id = _queue.call_in(_interval, this, &LSM9DS1Calibration::_poll);
+    return _event_id ? 0 : -1;
+}
+
+void LSM9DS1Calibration::_poll()
+{
+    _event_id = 0;
+
+    int err = (_state == ACCEL_GYRO) ? _poll_accel_gyro() : _poll_mag();
+    if (err) {
+        _finish(err);
+        return;
+    }
+
+    if (_on_progress) {
+        _on_progress(_count, _total);
+    }
+
+    if (_count < _total) {
+        // The queue is full, nothing would ever poll again
+        if (_schedule()) {
+            _finish(-1);
+        }
+        return;
+    }
+
+    if (_state == ACCEL_GYRO) {
+        _apply_accel_gyro();
+    } else {
+        _apply_mag();
+    }
+    _finish(0);
+}
+
+int LSM9DS1Calibration::_poll_accel_gyro()
+{
+    // Drain everything stored so far, extra frames are discarded
+    int read;
+    do {
+        read = _imu.readFIFOStream(_burst, LSM9DS1_CALIBRATION_BURST_FRAMES, 0);
+        if (read < 0) {
+            return read;
+        }
+
+        for (int i = 0; (i < read) && (_count < _total); i++, _count++) {
+            _gyro_sum[0] += _burst[i].gx;
+            _gyro_sum[1] += _burst[i].gy;
+            _gyro_sum[2] += _burst[i].gz;
+            _accel_sum[0] += _burst[i].ax;
+            _accel_sum[1] += _burst[i].ay;
+            _accel_sum[2] += _burst[i].az;
+        }
+    } while (read == LSM9DS1_CALIBRATION_BURST_FRAMES);
+
+    return 0;
+}
+
+int LSM9DS1Calibration::_poll_mag()
+{
+    if (!_imu.magAvailable()) {
+        return 0;
+    }
+
+    int err = _imu.readMag();
+    if (err) {
+        return -1;
+    }
+
+    const int16_t reading[3] = { _imu.mx, _imu.my, _imu.mz };
+    for (int i = 0; i < 3; i++) {
+        // Start from the first sample, not zero, so axes that never change
+        // sign are handled
+        if (_count == 0 || reading[i] > _mag_max[i]) {
+            _mag_max[i] = reading[i];
+        }
+        if (_count == 0 || reading[i] < _mag_min[i]) {
+            _mag_min[i] = reading[i];
+        }
+    }
+    _count++;
+    return 0;
+}
+
+void LSM9DS1Calibration::_apply_accel_gyro()
+{
+    // The sensor faces up, so Z carries 1 g
+    int32_t one_g = (int32_t)(1.0f / _imu.calcAccel(1));
+    _accel_sum[2] -= one_g * _count;
+
+    for (int i = 0; i < 3; i++) {
+        _imu.gBiasRaw[i] = _gyro_sum[i] / _count;
+        _imu.gBias[i] = _imu.calcGyro(_imu.gBiasRaw[i]);
+        _imu.aBiasRaw[i] = _accel_sum[i] / _count;
+        _imu.aBias[i] = _imu.calcAccel(_imu.aBiasRaw[i]);
+    }
+}
+
+void LSM9DS1Calibration::_apply_mag()
+{
+    for (int i = 0; i < 3; i++) {
+        _imu.mBiasRaw[i] = ((int32_t) _mag_max[i] + _mag_min[i]) / 2;
+        _imu.mBias[i] = _imu.calcMag(_imu.mBiasRaw[i]);
+        if (_apply) {
+            _imu.magOffset(i, _imu.mBiasRaw[i]);
+        }
+    }
+}
+
+void LSM9DS1Calibration::_finish(int status)
+{
+    _teardown(status == 0);
+    _state = IDLE;
+
+    // Called last, the callback may start another calibration
+    if (_on_done) {
+        _on_done(status);
+    }
+}
+
+void LSM9DS1Calibration::_teardown(bool success)
+{
+    if (_state == ACCEL_GYRO) {
+        _imu.setFIFOConfig(_saved_fifo);
+        _imu.setAutoCalc(_saved_auto_calc || (success && _apply));
+    }
+}
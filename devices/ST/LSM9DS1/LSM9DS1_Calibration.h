@@ -0,0 +1,174 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_CALIBRATION_H_
+#define EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_CALIBRATION_H_
+
+#include "LSM9DS1.h"
+
+#include "events/EventQueue.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+
+#include <stdint.h>
+#include <chrono>
+
+// FIFO frames stored between two accel/gyro polls (sets the poll interval)
+#ifndef LSM9DS1_CALIBRATION_POLL_FRAMES
+#define LSM9DS1_CALIBRATION_POLL_FRAMES 16
+#endif
+
+// Frames read per FIFO burst (sets the size of the calibration's scratch buffer)
+#ifndef LSM9DS1_CALIBRATION_BURST_FRAMES
+#define LSM9DS1_CALIBRATION_BURST_FRAMES 8
+#endif
+
+/**
+ * Non-blocking LSM9DS1 calibration
+ *
+ * Computes the same biases as LSM9DS1::calibrate() and
+ * LSM9DS1::calibrateMag(), but as state machines stepped from an
+ * EventQueue instead of busy-waiting on the bus:
+ *
+ * - Accel/gyro: the FIFO streams in continuous mode and is drained in
+ *   bursts every LSM9DS1_CALIBRATION_POLL_FRAMES sample periods. The sensor
+ *   must be at rest, facing up.
+ * - Mag: the data-ready status is polled once per mag sample period and
+ *   the per-axis extremes are tracked while the sensor is rotated.
+ *
+ * Progress is reported after every poll and the completion callback gets
+ * the final status. Other code must not access the sensor while a
+ * calibration runs.
+ *
+ * Example:
+ * @code
+ * LSM9DS1Calibration cal(imu, *mbed_event_queue());
+ * cal.attach(callback(on_calibrated));
+ * cal.start_accel_gyro();
+ * @endcode
+ *
+ * @note Call start/cancel from the EventQueue's thread, or while it is not dispatching
+ */
+class LSM9DS1Calibration : private mbed::NonCopyable<LSM9DS1Calibration> {
+public:
+
+    enum state_t {
+        IDLE,
+        ACCEL_GYRO,     /** Collecting accel/gyro samples from the FIFO */
+        MAG             /** Collecting mag samples */
+    };
+
+    /**
+     * @param[in] imu Sensor to calibrate, begin() must have succeeded
+     * @param[in] queue Queue the polls run on
+     */
+    LSM9DS1Calibration(LSM9DS1& imu, events::EventQueue& queue);
+
+    /** Cancels a calibration in progress */
+    ~LSM9DS1Calibration();
+
+    /**
+     * Starts the accel/gyro bias calibration
+     *
+     * On success gBias/gBiasRaw and aBias/aBiasRaw are updated. Readings are
+     * taken without bias correction, the previous setting is restored if the
+     * calibration fails or is cancelled. The FIFO and INT1 setup is always
+     * restored (see LSM9DS1::getFIFOConfig).
+     *
+     * @param[in] samples Number of samples averaged
+     * @param[in] autoCalc Enable bias correction (LSM9DS1::setAutoCalc) on success
+     * @return 0 on success, non-zero if busy, the gyro is disabled, on bus
+     *         error or if the first poll could not be queued
+     */
+    int start_accel_gyro(uint16_t samples = 32, bool autoCalc = true);
+
+    /**
+     * Starts the magnetometer hard-iron calibration
+     *
+     * On success mBias/mBiasRaw are updated to the center of the per-axis
+     * extremes seen. The soft-iron correction (LSM9DS1::setMagSoftIron) is
+     * cleared when the calibration starts and is not restored.
+     *
+     * @param[in] samples Number of samples taken
+     * @param[in] loadIn Clear the offset registers first and load the new
+     *            offsets (LSM9DS1::magOffset) on success
+     * @return 0 on success, non-zero if busy, the magnetometer is disabled,
+     *         on bus error or if the first poll could not be queued
+     */
+    int start_mag(uint16_t samples = 128, bool loadIn = true);
+
+    /** Stops the calibration in progress without calling the completion callback */
+    void cancel();
+
+    /** Returns the calibration in progress */
+    state_t get_state() const { return _state; }
+
+    /**
+     * Attach a function called from the EventQueue when a calibration ends,
+     * with 0 on success, or a negative bus error or queue failure
+     */
+    void attach(mbed::Callback<void(int)> func) { _on_done = func; }
+
+    /**
+     * Attach a function called from the EventQueue after each poll, with
+     * the number of samples taken and the total
+     */
+    void attach_progress(mbed::Callback<void(uint16_t, uint16_t)> func) { _on_progress = func; }
+
+private:
+
+    int _schedule();
+    void _poll();
+    int _poll_accel_gyro();
+    int _poll_mag();
+    void _apply_accel_gyro();
+    void _apply_mag();
+    void _finish(int status);
+    void _teardown(bool success);
+
+    LSM9DS1& _imu;
+    events::EventQueue& _queue;
+
+    mbed::Callback<void(int)> _on_done;
+    mbed::Callback<void(uint16_t, uint16_t)> _on_progress;
+
+    state_t _state;
+    int _event_id;
+    std::chrono::milliseconds _interval;
+
+    uint16_t _total;
+    uint16_t _count;
+    bool _apply;
+    bool _saved_auto_calc;
+    lsm9ds1_fifo_config_t _saved_fifo;
+
+    /** Accel/gyro sums, and mag extremes */
+    int32_t _gyro_sum[3];
+    int32_t _accel_sum[3];
+    int16_t _mag_min[3];
+    int16_t _mag_max[3];
+
+    lsm9ds1_fifo_sample_t _burst[LSM9DS1_CALIBRATION_BURST_FRAMES];
+};
+
+#endif /* EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_CALIBRATION_H_ */
@@ -0,0 +1,312 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "LSM9DS1_MagCalibrator.h"
+#include "LSM9DS1.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+/** Solves a x = b for symmetric a given by its upper triangle, -1 if singular */
+int solve_linear(const double a_upper[][LSM9DS1MagCalibrator::PARAMS], const double* b, double* x)
+{
+    const int n = LSM9DS1MagCalibrator::PARAMS;
+    double a[n][n + 1];
+
+    double largest = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            a[i][j] = (j >= i) ? a_upper[i][j] : a_upper[j][i];
+        }
+        a[i][n] = b[i];
+        if (fabs(a[i][i]) > largest) {
+            largest = fabs(a[i][i]);
+        }
+    }
+
+    // Gaussian elimination with partial pivoting
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(a[pivot][col]) <= largest * 1e-12) {
+            return -1;
+        }
+        if (pivot != col) {
+            for (int j = col; j <= n; j++) {
+                double t = a[col][j];
+                a[col][j] = a[pivot][j];
+                a[pivot][j] = t;
+            }
+        }
+        for (int row = col + 1; row < n; row++) {
+            double f = a[row][col] / a[col][col];
+            for (int j = col; j <= n; j++) {
+                a[row][j] -= f * a[col][j];
+            }
+        }
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        double sum = a[i][n];
+        for (int j = i + 1; j < n; j++) {
+            sum -= a[i][j] * x[j];
+        }
+        x[i] = sum / a[i][i];
+    }
+    return 0;
+}
+
+/** Eigen decomposition of a symmetric 3x3 matrix (cyclic Jacobi), columns of v are the vectors */
+void eigen_symmetric(const double m[3][3], double values[3], double v[3][3])
+{
+    double a[3][3];
+    memcpy(a, m, sizeof(a));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            v[i][j] = (i == j) ? 1 : 0;
+        }
+    }
+
+    for (int sweep = 0; sweep < 32; sweep++) {
+        double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        if (off < 1e-15 * (fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]))) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0) {
+                    continue;
+                }
+                // Rotation that zeroes a[p][q]
+                double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                double t = ((theta >= 0) ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                double c = 1 / sqrt(t * t + 1);
+                double s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        values[i] = a[i][i];
+    }
+}
+
+}
+
+LSM9DS1MagCalibrator::LSM9DS1MagCalibrator()
+{
+    reset();
+}
+
+void LSM9DS1MagCalibrator::reset()
+{
+    _scale = 0;
+    _samples = 0;
+    memset(_dtd, 0, sizeof(_dtd));
+    memset(_dtr, 0, sizeof(_dtr));
+    _rtr = 0;
+
+    _solved = false;
+    memset(_offset, 0, sizeof(_offset));
+    memset(_soft_iron, 0, sizeof(_soft_iron));
+    _radius = 0;
+    _fit_error = 0;
+}
+
+void LSM9DS1MagCalibrator::add_sample(int16_t mx, int16_t my, int16_t mz)
+{
+    if (_samples == 0) {
+        // Work in units of about the field magnitude
+        _scale = sqrt((double) mx * mx + (double) my * my + (double) mz * mz);
+        if (_scale < 1) {
+            _scale = 1;
+        }
+    }
+
+    double x = mx / _scale;
+    double y = my / _scale;
+    double z = mz / _scale;
+    // The trace constraint moves x^2 + y^2 + z^2 to the right hand side
+    const double row[PARAMS] = {
+        x * x + y * y - 2 * z * z, x * x + z * z - 2 * y * y,
+        2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z, 1
+    };
+    double rhs = x * x + y * y + z * z;
+
+    for (int i = 0; i < PARAMS; i++) {
+        for (int j = i; j < PARAMS; j++) {
+            _dtd[i][j] += row[i] * row[j];
+        }
+        _dtr[i] += row[i] * rhs;
+    }
+    _rtr += rhs * rhs;
+    _samples++;
+}
+
+int LSM9DS1MagCalibrator::solve()
+{
+    _solved = false;
+    if (_samples < PARAMS) {
+        return -1;
+    }
+
+    double u[PARAMS];
+    if (solve_linear(_dtd, _dtr, u)) {
+        return -1;
+    }
+
+    // x'Ax + 2b'x + j = 0, centered: (x - c)'A(x - c) = c'Ac - j with c = -inv(A) b
+    const double a[3][3] = {
+        { u[0] + u[1] - 1, u[2], u[3] },
+        { u[2], u[0] - 2 * u[1] - 1, u[4] },
+        { u[3], u[4], u[1] - 2 * u[0] - 1 }
+    };
+    const double b[3] = { u[5], u[6], u[7] };
+
+    double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                 a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                 a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    if (fabs(det) < 1e-12) {
+        return -1;
+    }
+    const double inv[3][3] = {
+        { (a[1][1] * a[2][2] - a[1][2] * a[2][1]) / det,
+          (a[0][2] * a[2][1] - a[0][1] * a[2][2]) / det,
+          (a[0][1] * a[1][2] - a[0][2] * a[1][1]) / det },
+        { (a[1][2] * a[2][0] - a[1][0] * a[2][2]) / det,
+          (a[0][0] * a[2][2] - a[0][2] * a[2][0]) / det,
+          (a[0][2] * a[1][0] - a[0][0] * a[1][2]) / det },
+        { (a[1][0] * a[2][1] - a[1][1] * a[2][0]) / det,
+          (a[0][1] * a[2][0] - a[0][0] * a[2][1]) / det,
+          (a[0][0] * a[1][1] - a[0][1] * a[1][0]) / det }
+    };
+
+    double center[3];
+    for (int i = 0; i < 3; i++) {
+        center[i] = -(inv[i][0] * b[0] + inv[i][1] * b[1] + inv[i][2] * b[2]);
+    }
+    double k = -u[8];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            k += center[i] * a[i][j] * center[j];
+        }
+    }
+    if (k == 0) {
+        return -1;
+    }
+
+    // Shape of the ellipsoid (x - c)'M(x - c) = 1, must be positive definite
+    double shape[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            shape[i][j] = a[i][j] / k;
+        }
+    }
+    double values[3];
+    double vectors[3][3];
+    eigen_symmetric(shape, values, vectors);
+    if (values[0] <= 0 || values[1] <= 0 || values[2] <= 0) {
+        return -1;
+    }
+
+    // Semi-axes are 1/sqrt(value), map them onto a sphere of their
+    // geometric mean: soft_iron = radius * sqrt(M)
+    double radius = pow(values[0] * values[1] * values[2], -1.0 / 6.0);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            double sum = 0;
+            for (int e = 0; e < 3; e++) {
+                sum += vectors[i][e] * sqrt(values[e]) * vectors[j][e];
+            }
+            _soft_iron[i][j] = (float)(radius * sum);
+        }
+        _offset[i] = (float)(center[i] * _scale);
+    }
+    _radius = (float)(radius * _scale);
+
+    // Algebraic residual |Du - r|^2 = u'D'Du - 2u'D'r + r'r, the quadric's
+    // value at each sample. A sample off the surface by a fraction e of the
+    // radius has a residual of about 2ke.
+    double residual = _rtr;
+    for (int i = 0; i < PARAMS; i++) {
+        double row = 0;
+        for (int j = 0; j < PARAMS; j++) {
+            row += ((j >= i) ? _dtd[i][j] : _dtd[j][i]) * u[j];
+        }
+        residual += u[i] * row - 2 * u[i] * _dtr[i];
+    }
+    if (residual < 0) {
+        residual = 0;
+    }
+    _fit_error = (float)(sqrt(residual / _samples) / (2 * fabs(k)));
+
+    _solved = true;
+    return 0;
+}
+
+void LSM9DS1MagCalibrator::get_soft_iron(float matrix[3][3]) const
+{
+    memcpy(matrix, _soft_iron, sizeof(_soft_iron));
+}
+
+int LSM9DS1MagCalibrator::apply(LSM9DS1& imu) const
+{
+    if (!_solved) {
+        return -1;
+    }
+
+    uint32_t errors = imu.getBusErrors();
+    for (int i = 0; i < 3; i++) {
+        float offset = _offset[i];
+        imu.mBiasRaw[i] = (int16_t)(offset < 0 ? offset - 0.5f : offset + 0.5f);
+        imu.mBias[i] = imu.calcMag(imu.mBiasRaw[i]);
+        imu.magOffset(i, imu.mBiasRaw[i]);
+    }
+    imu.setMagSoftIron(_soft_iron);
+
+    return (imu.getBusErrors() != errors) ? -1 : 0;
+}
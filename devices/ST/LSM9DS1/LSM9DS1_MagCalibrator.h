@@ -0,0 +1,145 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_MAGCALIBRATOR_H_
+#define EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_MAGCALIBRATOR_H_
+
+#include <stdint.h>
+
+class LSM9DS1;
+
+/**
+ * Incremental ellipsoid fit for magnetometer hard/soft-iron calibration
+ *
+ * Readings taken while the sensor is rotated through as many orientations
+ * as possible lie on an ellipsoid: shifted by the hard-iron offset and
+ * stretched by soft-iron effects. Each sample updates the normal equations
+ * of the least squares fit of the quadric
+ *
+ *   a x^2 + b y^2 + c z^2 + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z + j = 0
+ *
+ * with the trace constrained to a + b + c = -3, which leaves 9 parameters and
+ * works wherever the ellipsoid is relative to the origin (the hard-iron
+ * offset is often larger than the field). Memory stays constant whatever
+ * the number of samples. solve() then
+ * extracts the center (hard-iron offset) and the symmetric matrix that maps
+ * the ellipsoid back onto a sphere of the same mean radius (soft-iron
+ * correction). A corrected reading is soft_iron * (raw - offset).
+ *
+ * The solver has no bus access and can run on the host. apply() loads the
+ * result into an LSM9DS1: the offset into the magnetometer's offset
+ * registers, the matrix into LSM9DS1::setMagSoftIron().
+ *
+ * Example:
+ * @code
+ * LSM9DS1MagCalibrator fit;
+ * imu.clearMagSoftIron();
+ * for (int axis = 0; axis < 3; axis++) {
+ *     imu.magOffset(axis, 0);
+ * }
+ * while (fit.get_samples() < 500) {
+ *     if (imu.magAvailable() && imu.readMag() == 0) {
+ *         fit.add_sample(imu.mx, imu.my, imu.mz);
+ *     }
+ * }
+ * if (fit.solve() == 0 && fit.get_fit_error() < 0.02f) {
+ *     fit.apply(imu);
+ * }
+ * @endcode
+ *
+ * @note Feed readings taken with the offset registers cleared and without
+ * a soft-iron correction set
+ */
+class LSM9DS1MagCalibrator {
+public:
+
+    /** Fit parameters */
+    static const int PARAMS = 9;
+
+    LSM9DS1MagCalibrator();
+
+    /** Discards all samples and the last solution */
+    void reset();
+
+    /** Adds a raw magnetometer reading to the fit */
+    void add_sample(int16_t mx, int16_t my, int16_t mz);
+
+    /** Number of samples added since the last reset */
+    uint32_t get_samples() const { return _samples; }
+
+    /**
+     * Solves the fit with the samples added so far
+     *
+     * Can be called repeatedly while samples keep coming in.
+     *
+     * @return 0 on success, -1 with too few samples, samples that don't span
+     * all three axes or a result that is not an ellipsoid
+     */
+    int solve();
+
+    /** Returns true once solve() succeeded */
+    bool is_solved() const { return _solved; }
+
+    /** Hard-iron offset in raw LSB, from the last solve() */
+    const float* get_offset() const { return _offset; }
+
+    /** Soft-iron correction (row-major), from the last solve() */
+    void get_soft_iron(float matrix[3][3]) const;
+
+    /** Mean field magnitude in raw LSB, the radius corrected readings have */
+    float get_radius() const { return _radius; }
+
+    /**
+     * RMS distance of the samples from the fitted ellipsoid, relative to its
+     * size (0.01 is about 1% of the field). Large values mean noisy data or
+     * magnetic disturbances during collection.
+     */
+    float get_fit_error() const { return _fit_error; }
+
+    /**
+     * Loads the last solution: offsets through LSM9DS1::magOffset() and the
+     * matrix through LSM9DS1::setMagSoftIron()
+     *
+     * @return 0 on success, -1 if not solved or on bus error
+     */
+    int apply(LSM9DS1& imu) const;
+
+private:
+
+    /** Scale the first sample sets, keeps the sums well conditioned */
+    double _scale;
+    uint32_t _samples;
+
+    /** Normal equations: upper triangle of D'D, D'r and r'r */
+    double _dtd[PARAMS][PARAMS];
+    double _dtr[PARAMS];
+    double _rtr;
+
+    bool _solved;
+    float _offset[3];
+    float _soft_iron[3][3];
+    float _radius;
+    float _fit_error;
+};
+
+#endif /* EP_OC_MCU_DEVICES_ST_LSM9DS1_LSM9DS1_MAGCALIBRATOR_H_ */
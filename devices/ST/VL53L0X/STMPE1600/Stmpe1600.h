@@ -309,6 +309,17 @@ public:
         return false;
     }
 
+    /**
+     * @brief       Set the direction of several pins with a single register write
+     * @param[in]   mask The pins to change (bit n = GPIO_n), other pins keep their direction
+     * @param[in]   outputs The pins in mask to set as outputs, the others in mask become inputs
+     */
+    void set_gpio_dir_mask(uint16_t mask, uint16_t outputs)
+    {
+        gpdr0_15 = (gpdr0_15 & ~mask) | (outputs & mask);
+        write_16bit_reg(GPDR_0_7, &gpdr0_15);
+    }
+
     /**
      * @brief       Read a 16 bits register
      * @param[in]   The register address
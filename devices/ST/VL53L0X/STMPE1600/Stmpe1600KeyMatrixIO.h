@@ -0,0 +1,106 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_ST_VL53L0X_STMPE1600_STMPE1600KEYMATRIXIO_H_
+#define EP_OC_MCU_DEVICES_ST_VL53L0X_STMPE1600_STMPE1600KEYMATRIXIO_H_
+
+#include "Stmpe1600.h"
+
+#include "drivers/KeyMatrix.h"
+
+namespace ep
+{
+
+    /**
+     * KeyMatrix backend scanning through a STMPE1600 IO expander
+     *
+     * Row pins are latched low; a row is selected by making it the only row
+     * configured as an output, so unselected rows are high impedance. Columns
+     * need external pull-ups (a closed key reads low).
+     *
+     * Each row costs one 16-bit GPDR write and one 16-bit GPMR read. Directions
+     * go through the driver's GPDR copy and only the row bits change while
+     * scanning, so pins that are not part of the matrix can be reconfigured
+     * with Stmpe1600::set_gpio_dir() at any time.
+     */
+    class Stmpe1600KeyMatrixIO : public KeyMatrixIO
+    {
+
+    public:
+
+        /**
+         * Constructor
+         * @param[in] expander STMPE1600 the matrix is connected to
+         * @param[in] rows Expander pin numbers (0-15) of the rows, in row order
+         * @param[in] num_rows Number of rows
+         * @param[in] cols Expander pin numbers (0-15) of the columns, in column order
+         * @param[in] num_cols Number of columns
+         */
+        Stmpe1600KeyMatrixIO(Stmpe1600& expander, const uint8_t* rows, uint8_t num_rows,
+                const uint8_t* cols, uint8_t num_cols) : _expander(expander), _rows(rows),
+                _num_rows(num_rows), _cols(cols), _num_cols(num_cols), _row_mask(0) {
+            uint16_t col_mask = 0;
+            for(uint8_t r = 0; r < num_rows; r++) {
+                _expander.clear_gpio((ExpGpioPinName) rows[r]);
+                _row_mask |= (1 << rows[r]);
+            }
+            for(uint8_t c = 0; c < num_cols; c++) {
+                col_mask |= (1 << cols[c]);
+            }
+
+            /** Rows and columns are inputs while idle, other pins are left as they are */
+            _expander.set_gpio_dir_mask(_row_mask | col_mask, 0);
+        }
+
+        virtual void select_row(uint8_t row) {
+            _expander.set_gpio_dir_mask(_row_mask, (uint16_t)(1 << _rows[row]));
+        }
+
+        virtual void release_rows(void) {
+            _expander.set_gpio_dir_mask(_row_mask, 0);
+        }
+
+        virtual uint32_t read_columns(void) {
+            uint16_t inputs;
+            _expander.read_16bit_reg(GPMR_0_7, &inputs);
+            uint32_t closed = 0;
+            for(uint8_t c = 0; c < _num_cols; c++) {
+                if(!(inputs & (1 << _cols[c]))) {
+                    closed |= (1UL << c);
+                }
+            }
+            return closed;
+        }
+
+    private:
+
+        Stmpe1600& _expander;
+        const uint8_t* _rows;
+        uint8_t _num_rows;
+        const uint8_t* _cols;
+        uint8_t _num_cols;
+        uint16_t _row_mask;
+    };
+}
+
+#endif /* EP_OC_MCU_DEVICES_ST_VL53L0X_STMPE1600_STMPE1600KEYMATRIXIO_H_ */
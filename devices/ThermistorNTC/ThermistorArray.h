@@ -0,0 +1,271 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORARRAY_H_
+#define EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORARRAY_H_
+
+#include "ThermistorNTC.h"
+
+#include "extensions/BoundVariable.h"
+
+#include "events/EventQueue.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_assert.h"
+
+#include <chrono>
+
+namespace ep
+{
+
+    /**
+     * Scans a group of NTC thermistors and caches their temperatures
+     *
+     * Each scan takes a burst of samples from every channel, averages
+     * (decimates) them and runs the result through a per-channel first-order
+     * IIR low-pass filter. The filtered values are converted to temperature
+     * once per scan and published as a single snapshot, so all of the
+     * temperatures in a snapshot come from the same scan.
+     *
+     * Consumers read the cached snapshot instead of triggering conversions.
+     * Optionally, each new snapshot can be published through a BoundVariable
+     * to notify interested parties.
+     *
+     * Filtering is done on the raw ADC codes in fixed-point, with a
+     * coefficient of 1/(2^filter_shift):
+     *
+     * y[n] = y[n-1] + (x[n] - y[n-1])/(2^filter_shift)
+     *
+     * Example:
+     * @code
+     * ep::ThermistorNTC* channels[] = { &ntc0, &ntc1, &ntc2, &ntc3 };
+     * ep::ThermistorArray<4> ntc_array(channels);
+     *
+     * int main(void) {
+     *     ntc_array.start(queue, 100ms);
+     *     queue.dispatch_forever();
+     * }
+     * @endcode
+     *
+     * @tparam N Number of channels in the array
+     *
+     * @note Scanning is done from the EventQueue's thread since AnalogIn
+     * cannot be read from interrupt context
+     */
+    template<size_t N>
+    class ThermistorArray : private mbed::NonCopyable<ThermistorArray<N>>
+    {
+    public:
+
+        /** Temperatures from a single scan of the array */
+        typedef struct snapshot_t {
+            float celsius[N];   /** Filtered temperature of each channel in degrees celsius */
+            uint32_t sequence;  /** Number of scans completed, 0 if nothing has been scanned yet */
+        } snapshot_t;
+
+    public:
+
+        /**
+         * Create a thermistor array
+         *
+         * @param[in] channels Thermistors to scan, in channel order
+         * @param[in] oversample (optional) Number of samples averaged per channel in each scan
+         * @param[in] filter_shift (optional) IIR filter coefficient is 1/(2^filter_shift), 0 disables filtering
+         */
+        ThermistorArray(ThermistorNTC* const (&channels)[N], uint8_t oversample = 8,
+                uint8_t filter_shift = 2) : queue(NULL), event_id(0),
+                oversample(oversample), filter_shift(filter_shift),
+                published(NULL) {
+
+            MBED_ASSERT(oversample > 0);
+            MBED_ASSERT(filter_shift < 16);
+
+            for(size_t i = 0; i < N; i++) {
+                MBED_ASSERT(channels[i] != NULL);
+                this->channels[i] = channels[i];
+                filter_state[i] = 0;
+                snapshot.celsius[i] = 0.0f;
+            }
+            snapshot.sequence = 0;
+        }
+
+        ~ThermistorArray() {
+            stop();
+        }
+
+        /**
+         * Start scanning the array periodically
+         *
+         * @param[in] queue EventQueue to scan from
+         * @param[in] period Time between scans
+         */
+        void start(events::EventQueue& queue, std::chrono::milliseconds period) {
+            stop();
+            this->queue = &queue;
+            event_id = queue.call_every(period, mbed::callback(this, &ThermistorArray::scan));
+        }
+
+        /**
+         * Stop scanning the array periodically
+         */
+        void stop(void) {
+            if(queue != NULL && event_id != 0) {
+                queue->cancel(event_id);
+            }
+            queue = NULL;
+            event_id = 0;
+        }
+
+        /**
+         * Scan all channels once and publish a new snapshot
+         *
+         * @note This is called periodically once the array is started, but
+         * may also be called directly by the application
+         */
+        void scan(void) {
+
+            snapshot_t latest;
+
+            for(size_t i = 0; i < N; i++) {
+
+                // Oversample and decimate
+                uint32_t sum = 0;
+                for(uint8_t j = 0; j < oversample; j++) {
+                    sum += channels[i]->read_u16();
+                }
+                int32_t average = (int32_t) ((sum << 8) / oversample); // Q8
+
+                // Seed the filter with the first value
+                if(snapshot.sequence == 0) {
+                    filter_state[i] = average;
+                } else {
+                    filter_state[i] += filter_step(average - filter_state[i]);
+                }
+
+                latest.celsius[i] = channels[i]->code_to_temperature(
+                        (uint16_t) ((filter_state[i] + (1 << 7)) >> 8));
+            }
+
+            core_util_critical_section_enter();
+            latest.sequence = snapshot.sequence + 1;
+            snapshot = latest;
+            core_util_critical_section_exit();
+
+            if(published != NULL) {
+                published->set(latest);
+            }
+        }
+
+        /**
+         * Get a consistent copy of the most recent scan
+         */
+        snapshot_t get_snapshot(void) const {
+            core_util_critical_section_enter();
+            snapshot_t copy = snapshot;
+            core_util_critical_section_exit();
+            return copy;
+        }
+
+        /**
+         * Get the most recent temperature of a single channel
+         *
+         * @param[in] channel Channel index
+         * @retval Filtered temperature in degrees celsius
+         */
+        float get_temperature(size_t channel) const {
+            MBED_ASSERT(channel < N);
+            core_util_critical_section_enter();
+            float celsius = snapshot.celsius[channel];
+            core_util_critical_section_exit();
+            return celsius;
+        }
+
+        /**
+         * Publish each new snapshot through a BoundVariable
+         *
+         * @param[in] variable BoundVariable to set after each scan, NULL to stop publishing
+         *
+         * @note The BoundVariable's handlers are executed from the scanning context
+         */
+        void publish_to(BoundVariable<snapshot_t> *variable) {
+            published = variable;
+        }
+
+        /**
+         * Set the number of samples averaged per channel in each scan
+         */
+        void set_oversampling(uint8_t oversample) {
+            MBED_ASSERT(oversample > 0);
+            this->oversample = oversample;
+        }
+
+        /**
+         * Set the IIR filter coefficient to 1/(2^filter_shift)
+         *
+         * @param[in] filter_shift Filter coefficient shift, 0 disables filtering
+         */
+        void set_filter_shift(uint8_t filter_shift) {
+            MBED_ASSERT(filter_shift < 16);
+            this->filter_shift = filter_shift;
+        }
+
+    protected:
+
+        /**
+         * Scale a filter input step by the IIR coefficient
+         *
+         * Rounds half away from zero, so the output settles as close to the
+         * input from above as from below. A plain arithmetic shift rounds
+         * toward -infinity and would bias the filtered value low.
+         */
+        int32_t filter_step(int32_t delta) const {
+            if(filter_shift == 0) {
+                return delta;
+            }
+            int32_t half = (1 << (filter_shift - 1));
+            if(delta < 0) {
+                return -((half - delta) >> filter_shift);
+            }
+            return ((delta + half) >> filter_shift);
+        }
+
+        ThermistorNTC *channels[N];     /** Thermistors in the array */
+
+        events::EventQueue *queue;      /** EventQueue scans are scheduled on, if started */
+        int event_id;                   /** Periodic scan event id, 0 if not started */
+
+        uint8_t oversample;             /** Samples averaged per channel in each scan */
+        uint8_t filter_shift;           /** IIR filter coefficient shift */
+
+        int32_t filter_state[N];        /** IIR filter output of each channel (ADC code, Q8) */
+
+        snapshot_t snapshot;            /** Most recent scan */
+
+        BoundVariable<snapshot_t> *published; /** BoundVariable to publish snapshots through, if given */
+
+    };
+
+}
+
+#endif /* EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORARRAY_H_ */
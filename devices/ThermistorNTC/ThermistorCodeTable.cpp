@@ -0,0 +1,106 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "ThermistorCodeTable.h"
+
+#include "math.h"
+
+#define ROOM_TEMP_KELVIN 298.15f
+
+#define KELVIN_TO_CELSIUS(x) ((x) - 273.15f)
+
+/** Full scale ADC code */
+#define ADC_CODE_MAX 0xFFFF
+
+using namespace ep;
+
+ThermistorCodeTable::ThermistorCodeTable() : built(false) {
+    for(int i = 0; i <= Segments; i++) {
+        table[i] = 0.0f;
+    }
+}
+
+void ThermistorCodeTable::build_from_beta(float r_fixed, float beta,
+        float r_room_temp, bool ntc_is_pull_up) {
+    for(int i = 0; i <= Segments; i++) {
+        float r_ntc = code_to_ohms(entry_code(i), r_fixed, ntc_is_pull_up);
+        table[i] = beta_to_celsius(r_ntc, beta, r_room_temp);
+    }
+    built = true;
+}
+
+void ThermistorCodeTable::build_from_map(float r_fixed, ValueMapping& map,
+        bool ntc_is_pull_up) {
+    for(int i = 0; i <= Segments; i++) {
+        float r_ntc = code_to_ohms(entry_code(i), r_fixed, ntc_is_pull_up);
+        table[i] = map.lookup(r_ntc);
+    }
+    built = true;
+}
+
+float ThermistorCodeTable::code_to_ohms(uint16_t code, float r_fixed,
+        bool ntc_is_pull_up) {
+
+    // Keep away from the rails so the ratio is always finite and non-zero
+    if(code < 1) {
+        code = 1;
+    } else if(code > (ADC_CODE_MAX - 1)) {
+        code = (ADC_CODE_MAX - 1);
+    }
+
+    /**
+     * Vout/Vin = code/ADC_CODE_MAX = Rpd/(Rpu + Rpd)
+     *
+     * Rpu = Rpd * (ADC_CODE_MAX - code)/code
+     * Rpd = Rpu * code/(ADC_CODE_MAX - code)
+     */
+    float counts_low = (float) code;
+    float counts_high = (float) (ADC_CODE_MAX - code);
+    if(ntc_is_pull_up) {
+        return (r_fixed * (counts_high / counts_low));
+    } else {
+        return (r_fixed * (counts_low / counts_high));
+    }
+}
+
+float ThermistorCodeTable::beta_to_celsius(float r_ntc, float beta,
+        float r_room_temp) {
+    /**
+     * 1/T = 1/TO + (1/β) ⋅ ln(R/RO)
+     *
+     * (Beta is generally given to result with temperature in Kelvin)
+     */
+    float temp_k = (beta * ROOM_TEMP_KELVIN)/
+            (beta + (ROOM_TEMP_KELVIN * logf(r_ntc/r_room_temp)));
+
+    return KELVIN_TO_CELSIUS(temp_k);
+}
+
+uint16_t ThermistorCodeTable::entry_code(int index) {
+    // The last boundary (0x10000) is not representable, use full scale instead
+    uint32_t code = ((uint32_t) index << FractionBits);
+    if(code > ADC_CODE_MAX) {
+        code = ADC_CODE_MAX;
+    }
+    return (uint16_t) code;
+}
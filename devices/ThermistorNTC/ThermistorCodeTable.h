@@ -0,0 +1,155 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORCODETABLE_H_
+#define EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORCODETABLE_H_
+
+#include "ValueMapping.h"
+
+#include <stdint.h>
+
+namespace ep
+{
+
+    /**
+     * Precomputed ADC code to temperature table for an NTC thermistor
+     *
+     * Converting an ADC sample to a temperature normally takes several float
+     * divisions (volts -> ohms) followed by either a logf (beta equation) or
+     * a search through a ValueMapping table. This class does all of that work
+     * once, up front, for a set of evenly spaced raw ADC codes (as returned by
+     * `AnalogIn::read_u16`). Each conversion afterwards is a shift to find the
+     * table index and a single linear interpolation between two entries.
+     *
+     * The table assumes the divider is ratiometric, ie: the voltage across the
+     * divider is the same as the ADC reference voltage, so only the fixed
+     * resistance and the NTC parameters affect the result.
+     *
+     * Example:
+     * @code
+     * ep::ThermistorCodeTable ntc_table;
+     *
+     * ep::ThermistorNTC ntc(r_div, 10000.0f, 3957.0f, 10000.0f);
+     *
+     * int main(void) {
+     *     // Builds the table from the ThermistorNTC's parameters
+     *     ntc.use_code_table(&ntc_table);
+     *     printf("temperature: %.2fC\r\n", ntc.get_temperature());
+     * }
+     * @endcode
+     *
+     * @note The table occupies (Segments + 1) floats (~1kB) of RAM
+     */
+    class ThermistorCodeTable
+    {
+    public:
+
+        /** Number of ADC code bits used to index the table */
+        static constexpr int ResolutionBits = 8;
+
+        /** Number of linear segments in the table */
+        static constexpr int Segments = (1 << ResolutionBits);
+
+        /** Number of ADC code bits used for interpolation within a segment */
+        static constexpr int FractionBits = (16 - ResolutionBits);
+
+    public:
+
+        ThermistorCodeTable();
+
+        /**
+         * Fill the table using the beta equation
+         *
+         * @param[in] r_fixed Fixed resistance in voltage divider sense circuit (ohms)
+         * @param[in] beta Beta value for thermistor given by device's datasheet
+         * @param[in] r_room_temp Nominal resistance of NTC thermistor (ohms) @ room temperature (25C)
+         * @param[in] ntc_is_pull_up (optional) True if the NTC is the pull-up resistor in the divider circuit
+         */
+        void build_from_beta(float r_fixed, float beta, float r_room_temp, bool ntc_is_pull_up = true);
+
+        /**
+         * Fill the table using a resistance (ohms) to temperature (C) calibration table
+         *
+         * @param[in] r_fixed Fixed resistance in voltage divider sense circuit (ohms)
+         * @param[in] map ValueMapping object that provides the resistance (ohms) to temperature (C) table
+         * @param[in] ntc_is_pull_up (optional) True if the NTC is the pull-up resistor in the divider circuit
+         */
+        void build_from_map(float r_fixed, ValueMapping& map, bool ntc_is_pull_up = true);
+
+        /**
+         * Returns true if the table has been filled by one of the build functions
+         */
+        bool is_built(void) const {
+            return built;
+        }
+
+        /**
+         * Convert a raw ADC code to temperature
+         *
+         * @param[in] code Raw ADC sample of the divider output (0 - 0xFFFF)
+         * @retval Temperature in degrees celsius
+         */
+        float lookup(uint16_t code) const {
+            int index = (code >> FractionBits);
+            int fraction = (code & ((1 << FractionBits) - 1));
+            float t0 = table[index];
+            return t0 + ((table[index+1] - t0) * (fraction * (1.0f / (1 << FractionBits))));
+        }
+
+        /**
+         * Calculate the NTC's resistance from a raw ADC code
+         *
+         * @param[in] code Raw ADC sample of the divider output (0 - 0xFFFF)
+         * @param[in] r_fixed Fixed resistance in voltage divider sense circuit (ohms)
+         * @param[in] ntc_is_pull_up True if the NTC is the pull-up resistor in the divider circuit
+         * @retval Resistance of the NTC in ohms
+         *
+         * @note Codes at either end of the range are clamped so the result is always finite
+         */
+        static float code_to_ohms(uint16_t code, float r_fixed, bool ntc_is_pull_up);
+
+        /**
+         * Calculate temperature from the NTC's resistance using the β (beta) equation
+         *
+         * @param[in] r_ntc Resistance of the NTC (ohms)
+         * @param[in] beta Beta value for thermistor given by device's datasheet
+         * @param[in] r_room_temp Nominal resistance of NTC thermistor (ohms) @ room temperature (25C)
+         * @retval Temperature in degrees celsius
+         */
+        static float beta_to_celsius(float r_ntc, float beta, float r_room_temp);
+
+    protected:
+
+        /** Returns the ADC code represented by the given table entry */
+        static uint16_t entry_code(int index);
+
+    protected:
+
+        float table[Segments + 1];  /** Temperature (C) at each segment boundary */
+        bool built;                 /** True once the table has been filled */
+
+    };
+
+}
+
+#endif /* EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORCODETABLE_H_ */
@@ -23,30 +23,29 @@
 
 #include "ThermistorNTC.h"
 
-#include "math.h"
-
 #if DEVICE_ANALOGIN
 
-#define ROOM_TEMP_KELVIN 298.15f
-
-#define KELVIN_TO_CELSIUS(x) x-273.15f;
-
 using namespace ep;
 
 ThermistorNTC::ThermistorNTC(ResistorDivider& r_div, float r_fixed,
         ValueMapping* map, bool ntc_is_pull_up) : r_div(r_div),
-        r_to_t_map(map), beta_val(0.0f), r_fixed_ohms(r_fixed),
+        r_to_t_map(map), code_table(NULL), beta_val(0.0f), r_fixed_ohms(r_fixed),
         r_room_temp_ohms(0.0f), ntc_is_pull_up(ntc_is_pull_up) {
 }
 
 ThermistorNTC::ThermistorNTC(ResistorDivider& r_div, float r_fixed, float beta,
         float r_room_temp, bool ntc_is_pull_up) : r_div(r_div),
-        r_to_t_map(NULL), beta_val(beta), r_fixed_ohms(r_fixed),
+        r_to_t_map(NULL), code_table(NULL), beta_val(beta), r_fixed_ohms(r_fixed),
         r_room_temp_ohms(r_room_temp), ntc_is_pull_up(ntc_is_pull_up) {
 }
 
 float ThermistorNTC::get_temperature(void) {
 
+    // Precomputed table mode, convert the raw ADC code directly
+    if(code_table != NULL) {
+        return code_table->lookup(r_div.measure());
+    }
+
     // Get the thermistor's resistance
     float r_thermistor;
     if(ntc_is_pull_up) {
@@ -59,19 +58,43 @@ float ThermistorNTC::get_temperature(void) {
     if(r_to_t_map != NULL) {
         return r_to_t_map->lookup(r_thermistor);
     } else {
-        /**
-         * Otherwise, just calculate using β (beta) equation
-         * 1/T = 1/TO + (1/β) ⋅ ln(R/RO)
-         *
-         * (Beta is generally given to result with temperature in Kelvin)
-         */
-        float temp_k = (beta_val * ROOM_TEMP_KELVIN)/
-                (beta_val + (ROOM_TEMP_KELVIN * logf(r_thermistor/r_room_temp_ohms)));
-
-        return KELVIN_TO_CELSIUS(temp_k);
+        // Otherwise, just calculate using β (beta) equation
+        return ThermistorCodeTable::beta_to_celsius(r_thermistor,
+                beta_val, r_room_temp_ohms);
+    }
+}
+
+float ThermistorNTC::code_to_temperature(uint16_t code) {
+
+    if(code_table != NULL) {
+        return code_table->lookup(code);
+    }
+
+    float r_thermistor = ThermistorCodeTable::code_to_ohms(code,
+            r_fixed_ohms, ntc_is_pull_up);
+
+    if(r_to_t_map != NULL) {
+        return r_to_t_map->lookup(r_thermistor);
+    } else {
+        return ThermistorCodeTable::beta_to_celsius(r_thermistor,
+                beta_val, r_room_temp_ohms);
     }
 }
 
+void ThermistorNTC::use_code_table(ThermistorCodeTable *table) {
+
+    if(table != NULL) {
+        if(r_to_t_map != NULL) {
+            table->build_from_map(r_fixed_ohms, *r_to_t_map, ntc_is_pull_up);
+        } else {
+            table->build_from_beta(r_fixed_ohms, beta_val,
+                    r_room_temp_ohms, ntc_is_pull_up);
+        }
+    }
+
+    code_table = table;
+}
+
 
 #endif /** DEVICE_ANALOGIN */
 
@@ -31,6 +31,7 @@
 #define EP_OC_MCU_DEVICES_THERMISTORNTC_THERMISTORNTC_H_
 
 #include "ResistorDivider.h"
+#include "ThermistorCodeTable.h"
 
 #include "ValueMapping.h"
 
@@ -154,11 +155,51 @@ namespace ep
          */
         virtual float get_temperature(void);
 
+        /**
+         * Switch to (or away from) the precomputed ADC code lookup mode
+         *
+         * The given table is filled using this thermistor's parameters (beta value
+         * or calibration table) and from then on each call to get_temperature only
+         * takes a raw ADC sample, an index and an interpolation.
+         *
+         * @param[in] table Table to build and use for conversions, NULL to go back to
+         * converting each sample through the resistance
+         *
+         * @note The code table assumes the divider is supplied by the ADC reference voltage
+         *
+         * @note The table is owned by the application and must outlive this object
+         */
+        void use_code_table(ThermistorCodeTable *table);
+
+        /**
+         * Takes a raw sample of the divider output
+         *
+         * @returns Raw ADC code, normalized to the range 0x0 - 0xFFFF
+         */
+        uint16_t read_u16(void) {
+            return r_div.read_u16();
+        }
+
+        /**
+         * Convert a raw ADC code (see read_u16) to temperature
+         *
+         * Uses the code table if one is in use, otherwise converts the code
+         * to the thermistor's resistance and then to temperature.
+         *
+         * @param[in] code Raw ADC sample of the divider output
+         * @retval Temperature in degrees celsius
+         *
+         * @note Like the code table, this assumes the divider is supplied by
+         * the ADC reference voltage
+         */
+        float code_to_temperature(uint16_t code);
+
     protected:
 
         ResistorDivider& r_div;     /** ResistorDivider used to measure the thermistor's resistance */
 
         ValueMapping *r_to_t_map;   /** ValueMapping for resistance to temperature, if given */
+        ThermistorCodeTable *code_table; /** Precomputed ADC code to temperature table, if used */
         float beta_val;             /** Beta value for thermistor given by datasheet, if given */
         float r_fixed_ohms;         /** Fixed resistance in voltage divider sense circuit in ohms */
         float r_room_temp_ohms;     /** Nominal temperature of thermistor at room temp in ohms, if given */
@@ -24,6 +24,8 @@
 #ifndef DRIVERS_BUTTONIN_H_
 #define DRIVERS_BUTTONIN_H_
 
+#include "EdgeEvent.h"
+
 #include "drivers/Timeout.h"
 #include "platform/Callback.h"
 #include "platform/NonCopyable.h"
@@ -55,7 +57,8 @@ namespace ep
 			ButtonIn(bool active_low, mbed::Callback<void(ButtonIn*)> sp_cb = NULL,
 					mbed::Callback<void(ButtonIn*)> lp_cb = NULL) : _is_active_low(active_low), _timeout(), _timeout_scheduled(false),
 			_long_press_delay_ms(BUTTON_IN_DEFAULT_LONG_PRESS_DELAY_MS),
-			_short_press_cb(sp_cb), _long_press_cb(lp_cb)
+			_short_press_cb(sp_cb), _long_press_cb(lp_cb),
+			_event_ring(NULL), _edge_observer(NULL), _press_us(0), _last_press_duration_us(0)
 			{ }
 
 			virtual ~ButtonIn() { }
@@ -111,6 +114,38 @@ namespace ep
 				_long_press_cb = func;
 			}
 
+			/**
+			 * Attach a ring that receives a timestamped PRESS/RELEASE event for each press
+			 * @param[in] ring Ring to push events to, or NULL to set as none
+			 *
+			 * @note events are pushed in the interrupt context, drain the ring from a thread
+			 */
+			void attach_event_ring(EdgeEventRing* ring)
+			{
+				_event_ring = ring;
+			}
+
+			/**
+			 * Attach an observer that is called with the PRESS/RELEASE event of each press
+			 * @param[in] func Observer callback, or NULL to set as none
+			 *
+			 * @note callback is called in the interrupt context
+			 * @see GestureEngine
+			 */
+			void attach_edge_observer(mbed::Callback<void(ButtonIn*, const edge_event_t&)> func)
+			{
+				_edge_observer = func;
+			}
+
+			/**
+			 * Returns how long the last completed press was held
+			 * @retval Press duration in microseconds (confirmed press to confirmed release)
+			 */
+			uint32_t get_last_press_duration_us(void)
+			{
+				return _last_press_duration_us;
+			}
+
 			/**
 			 * Internal long press callback
 			 */
@@ -129,6 +164,15 @@ namespace ep
 			 */
 			void _internal_press_handler(void)
 			{
+				us_timestamp_t raw_us, confirmed_us;
+				_edge_times(raw_us, confirmed_us);
+				_press_us = confirmed_us;
+				_push_event(edge_event_t::PRESS, raw_us, confirmed_us, 0);
+
+				// Buttons without press callbacks (eg: driven by a GestureEngine) don't need a timeout
+				if(!_short_press_cb && !_long_press_cb)
+					return;
+
 				// Start a timeout for desired delay
 				_timeout_scheduled = true;
 				_timeout.attach_us(
@@ -141,6 +185,11 @@ namespace ep
 			 */
 			void _internal_release_handler(void)
 			{
+				us_timestamp_t raw_us, confirmed_us;
+				_edge_times(raw_us, confirmed_us);
+				_last_press_duration_us = (uint32_t)(confirmed_us - _press_us);
+				_push_event(edge_event_t::RELEASE, raw_us, confirmed_us, _last_press_duration_us);
+
 				// Timeout is scheduled, cancel it and call short press handler
 				if(_timeout_scheduled)
 				{
@@ -153,9 +202,35 @@ namespace ep
 
 		protected:
 
+			/**
+			 * Returns the raw and confirmed times of the edge being handled
+			 *
+			 * Child classes with a debouncer should override this to report
+			 * when the raw input actually changed
+			 */
+			virtual void _edge_times(us_timestamp_t& raw_us, us_timestamp_t& confirmed_us)
+			{
+				confirmed_us = edge_timestamp_us();
+				raw_us = confirmed_us;
+			}
+
 			/*!< Indicates whether this button is active high or active low */
 			bool _is_active_low;
 
+		private:
+
+			void _push_event(edge_event_t::type_t type, us_timestamp_t raw_us,
+					us_timestamp_t confirmed_us, uint32_t duration_us)
+			{
+				edge_event_t event = { type, raw_us, confirmed_us, duration_us, this };
+
+				if(_event_ring)
+					_event_ring->push(event);
+
+				if(_edge_observer)
+					_edge_observer(this, event);
+			}
+
 		private:
 
 			/** Timeout for executing long press callbacks */
@@ -170,6 +245,18 @@ namespace ep
 			/*!< Application short and long press callbacks */
 			mbed::Callback<void(ButtonIn*)> _short_press_cb;
 			mbed::Callback<void(ButtonIn*)> _long_press_cb;
+
+			/*!< Optional ring of timestamped press/release events */
+			EdgeEventRing* _event_ring;
+
+			/*!< Optional observer of press/release events */
+			mbed::Callback<void(ButtonIn*, const edge_event_t&)> _edge_observer;
+
+			/*!< Time the current/last press was confirmed */
+			us_timestamp_t _press_us;
+
+			/*!< Duration of the last completed press in microseconds */
+			uint32_t _last_press_duration_us;
 	};
 }
 
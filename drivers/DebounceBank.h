@@ -0,0 +1,207 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if defined(DEVICE_LPTICKER) || defined(DEVICE_LOWPOWERTIMER)
+
+#ifndef DRIVERS_DEBOUNCEBANK_H_
+#define DRIVERS_DEBOUNCEBANK_H_
+
+#include "VerticalCounterDebouncer.h"
+
+#include "drivers/LowPowerTicker.h"
+#include "drivers/DigitalIn.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_assert.h"
+
+#include <stddef.h>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Debounces many DigitalIn pins from a single shared low power ticker
+	 *
+	 * Where each DebounceIn runs its own ticker, a DebounceBank samples all of
+	 * its pins from one ticker event and debounces up to 32 of them per word
+	 * operation using a VerticalCounterDebouncer.
+	 *
+	 * Example:
+	 * @code
+	 * static const PinName keys[] = { P0_2, P0_3, P0_4 };
+	 * ep::DebounceBank<3> bank(keys);
+	 *
+	 * bank.rise(0, callback(on_key0_released));
+	 * bank.fall(0, callback(on_key0_pressed));
+	 * @endcode
+	 *
+	 * @tparam N Number of pins in the bank
+	 */
+	template<size_t N>
+	class DebounceBank : private mbed::NonCopyable<DebounceBank<N> >
+	{
+
+		public:
+
+			/** Number of 32-pin lanes needed for N pins */
+			static constexpr size_t Lanes = (N + 31) / 32;
+
+			/**
+			 * Constructor
+			 *
+			 * @param[in] pins Pins to debounce, index n of the bank is pins[n]
+			 * @param[in] debounce_ms The number of milliseconds to debounce
+			 * @param[in] sample_period_us The sampling period in microseconds
+			 *
+			 * @note The number of samples (debounce_ms / sample period) is limited
+			 * to VerticalCounterDebouncer::MaxSamples
+			 */
+			DebounceBank(const PinName (&pins)[N], unsigned int debounce_ms = 100,
+					unsigned int sample_period_us = 10000) : _sample_period_us(sample_period_us) {
+				MBED_ASSERT(sample_period_us > 0);
+				for(size_t i = 0; i < N; i++) {
+					_inputs[i] = new mbed::DigitalIn(pins[i]);
+				}
+
+				uint32_t raw[Lanes];
+				sample(raw);
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					_debouncers[lane].reset(raw[lane]);
+				}
+
+				set_debounce(debounce_ms);
+				_ticker.attach_us(mbed::callback(this, &DebounceBank::_callback), sample_period_us);
+			}
+
+			~DebounceBank() {
+				_ticker.detach();
+				for(size_t i = 0; i < N; i++) {
+					delete _inputs[i];
+				}
+			}
+
+			/** Sets the debounce time in milliseconds
+			 * @note rounds down to a multiple of the sample period
+			 * @param debounce_ms
+			 */
+			void set_debounce(unsigned int debounce_ms) {
+				unsigned int samples = ((unsigned long) debounce_ms * 1000) / _sample_period_us;
+				if(samples > VerticalCounterDebouncer::MaxSamples) {
+					samples = VerticalCounterDebouncer::MaxSamples;
+				}
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					_debouncers[lane].set_samples(samples);
+				}
+			}
+
+			/** Attach a function to call when a rising edge occurs on a debounced pin
+			 *
+			 *  @param index Index of the pin in the bank
+			 *  @param func A pointer to a void function, or 0 to set as none
+			 *
+			 *  @note called in the interrupt context
+			 */
+			void rise(size_t index, mbed::Callback<void()> func) {
+				MBED_ASSERT(index < N);
+				_rise[index] = func;
+			}
+
+			/** Attach a function to call when a falling edge occurs on a debounced pin
+			 *
+			 *  @param index Index of the pin in the bank
+			 *  @param func A pointer to a void function, or 0 to set as none
+			 *
+			 *  @note called in the interrupt context
+			 */
+			void fall(size_t index, mbed::Callback<void()> func) {
+				MBED_ASSERT(index < N);
+				_fall[index] = func;
+			}
+
+			/** Read the debounced value of a pin
+			 *  @param index Index of the pin in the bank
+			 */
+			int read(size_t index) const {
+				MBED_ASSERT(index < N);
+				return (_debouncers[index / 32].state() >> (index % 32)) & 1;
+			}
+
+			/** Read the debounced values of 32 pins at once
+			 *  @param lane Lane index, bit n of the result is pin (lane * 32 + n)
+			 */
+			uint32_t read_lane(size_t lane) const {
+				MBED_ASSERT(lane < Lanes);
+				return _debouncers[lane].state();
+			}
+
+		protected:
+
+			/** Reads the raw level of every pin into lane words */
+			void sample(uint32_t (&raw)[Lanes]) {
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					raw[lane] = 0;
+				}
+				for(size_t i = 0; i < N; i++) {
+					if(_inputs[i]->read()) {
+						raw[i / 32] |= (1UL << (i % 32));
+					}
+				}
+			}
+
+			void _callback(void) {
+				uint32_t raw[Lanes];
+				sample(raw);
+
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					uint32_t changed = _debouncers[lane].update(raw[lane]);
+					uint32_t state = _debouncers[lane].state();
+
+					/** Only visit pins that had a confirmed edge */
+					while(changed) {
+						uint8_t bit = __builtin_ctz(changed);
+						changed &= (changed - 1);
+
+						size_t index = (lane * 32) + bit;
+						mbed::Callback<void()>& cb = ((state >> bit) & 1) ? _rise[index] : _fall[index];
+						if(cb) {
+							cb();
+						}
+					}
+				}
+			}
+
+			mbed::LowPowerTicker _ticker;
+			unsigned int _sample_period_us;
+			mbed::DigitalIn* _inputs[N];
+			VerticalCounterDebouncer _debouncers[Lanes];
+			mbed::Callback<void()> _rise[N];
+			mbed::Callback<void()> _fall[N];
+
+	};
+}
+
+#endif /* DRIVERS_DEBOUNCEBANK_H_ */
+
+#endif /** defined(DEVICE_LPTICKER) || defined(DEVICE_LOWPOWERTIMER) */
@@ -32,6 +32,9 @@
 #ifndef DEBOUNCEIN_H
 #define DEBOUNCEIN_H
 
+#include "DebounceIntegrator.h"
+#include "EdgeEvent.h"
+
 #include "platform/Callback.h"
 #include "drivers/LowPowerTicker.h"
 #include "drivers/DigitalIn.h"
@@ -77,9 +80,7 @@ namespace ep
 			 * @param debounce_ms
 			 */
 			void set_debounce(unsigned int debounce_ms) {
-				_samples = (debounce_ms / 10);
-				if (_samples == 0)
-					_samples = 1;
+				_integrator.set_samples(debounce_ms / 10);
 			}
 
 			/** Attach a function to call when a rising edge occurs on the debounced input
@@ -102,12 +103,34 @@ namespace ep
 				_fall = func;
 			}
 
+			/** Attach a ring that receives a timestamped event for each debounced edge
+			 *
+			 *  @param ring Ring to push events to, or NULL to set as none
+			 *
+			 *  @note events are pushed in the interrupt context, drain the ring from a thread
+			 */
+			void attach_event_ring(EdgeEventRing* ring) {
+				_event_ring = ring;
+			}
+
+			/** Returns the time of the first sample that disagreed with the
+			 *  debounced state before the last debounced edge
+			 */
+			us_timestamp_t last_raw_edge_us(void) const {
+				return _raw_edge_us;
+			}
+
+			/** Returns the time the last debounced edge was confirmed */
+			us_timestamp_t last_edge_us(void) const {
+				return _edge_us;
+			}
+
 			/** read
 			 *
 			 * Read the value of the debounced pin.
 			 */
 			int read(void) {
-				return _shadow;
+				return _integrator.read();
 			}
 
 			/** operator int()
@@ -123,48 +146,43 @@ namespace ep
 			 * @param PinName pin The pin to assign as an input.
 			 * @param debounce_ms The number of milliseconds to debounce
 			 */
-			DebounceIn(PinName pin, unsigned int debounce_ms = 100) : mbed::DigitalIn(pin) {
-				_counter = 0;
+			DebounceIn(PinName pin, unsigned int debounce_ms = 100) : mbed::DigitalIn(pin),
+				_raw_edge_us(0), _edge_us(0), _event_ring(NULL) {
 				set_debounce(debounce_ms);
 				set_debounce_us(10000);
-
-				_prevShadow = mbed::DigitalIn::read();
+				_integrator.reset(mbed::DigitalIn::read());
 			};
 
 		protected:
 			void _callback(void)
 			{
-				if (mbed::DigitalIn::read())
-				{
-					if (_counter < _samples) {
-						_counter++;
+				int raw = mbed::DigitalIn::read();
+
+				/** Only read the clock while the input disagrees with the debounced state */
+				us_timestamp_t now = 0;
+				if (raw != _integrator.read()) {
+					now = edge_timestamp_us();
+					if (_integrator.is_settled(_integrator.read())) {
+						_raw_edge_us = now;
 					}
+				}
 
-					if (_counter == _samples)
-					{
-						_shadow = 1;
-						if (_shadow != _prevShadow && _rise)
-						{
-							_prevShadow = _shadow;
-							_rise();
-						}
+				DebounceIntegrator::edge_t edge = _integrator.update(raw);
+				if (edge != DebounceIntegrator::EDGE_NONE) {
+					_edge_us = now;
+					if (_event_ring) {
+						edge_event_t event = {
+							(edge == DebounceIntegrator::EDGE_RISE) ? edge_event_t::RISE : edge_event_t::FALL,
+							_raw_edge_us, now, 0, this
+						};
+						_event_ring->push(event);
 					}
 				}
-				else
-				{
-					if (_counter > 0) {
-						_counter--;
-					}
 
-					if (_counter == 0)
-					{
-						_shadow = 0;
-						if (_shadow != _prevShadow && _fall)
-						{
-							_prevShadow = _shadow;
-							_fall();
-						}
-					}
+				if (edge == DebounceIntegrator::EDGE_RISE && _rise) {
+					_rise();
+				} else if (edge == DebounceIntegrator::EDGE_FALL && _fall) {
+					_fall();
 				}
 			}
 
@@ -186,14 +204,14 @@ namespace ep
 			 * @param num_samples The number of samples.
 			 */
 			void set_samples(unsigned int num_samples) {
-				_samples = num_samples;
+				_integrator.set_samples(num_samples);
 			}
 
 			mbed::LowPowerTicker _ticker;
-			int _shadow;
-			int _prevShadow;
-			int _counter;
-			int _samples;
+			DebounceIntegrator _integrator;
+			us_timestamp_t _raw_edge_us;
+			us_timestamp_t _edge_us;
+			EdgeEventRing* _event_ring;
 			mbed::Callback<void()> _rise;
 			mbed::Callback<void()> _fall;
 	};
@@ -0,0 +1,191 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_DEBOUNCEINTEGRATOR_H_
+#define DRIVERS_DEBOUNCEINTEGRATOR_H_
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Integrating debounce filter used by DebounceIn and TicklessDebounceIn
+	 *
+	 * Each sample counts up (input high) or down (input low) between 0 and the
+	 * configured number of samples. The debounced state only changes when the
+	 * counter reaches either end.
+	 *
+	 * This class has no hardware dependencies so it can be tested on the host.
+	 */
+	class DebounceIntegrator
+	{
+
+		public:
+
+			/** Edge reported by update() */
+			enum edge_t {
+				EDGE_FALL = -1,
+				EDGE_NONE = 0,
+				EDGE_RISE = 1
+			};
+
+			/**
+			 * Constructor
+			 * @param[in] initial_state Initial debounced state
+			 * @param[in] samples Number of samples required to accept a change
+			 */
+			DebounceIntegrator(int initial_state = 0, unsigned int samples = 10) : _shadow(0), _counter(0), _samples(1) {
+				set_samples(samples);
+				reset(initial_state);
+			}
+
+			/**
+			 * Sets the number of samples required to accept a change
+			 *
+			 * A settled counter stays at the end matching the debounced state,
+			 * so the next change takes the new number of samples to accept.
+			 * @param[in] samples Number of samples (0 is treated as 1)
+			 */
+			void set_samples(unsigned int samples) {
+				bool settled = is_settled(_shadow);
+				_samples = (samples == 0) ? 1 : samples;
+				if(settled) {
+					_counter = _shadow ? _samples : 0;
+				} else if(_counter > _samples) {
+					_counter = _samples;
+				}
+			}
+
+			/**
+			 * Forces the debounced state and puts the counter at the matching end
+			 * @param[in] state New debounced state
+			 */
+			void reset(int state) {
+				_shadow = state ? 1 : 0;
+				_counter = _shadow ? _samples : 0;
+			}
+
+			/**
+			 * Feeds one raw sample into the filter
+			 * @param[in] raw Raw input level
+			 * @retval Edge of the debounced state caused by this sample, if any
+			 */
+			edge_t update(int raw) {
+				if(raw) {
+					if(_counter < _samples) {
+						_counter++;
+					}
+
+					if(_counter == _samples && !_shadow) {
+						_shadow = 1;
+						return EDGE_RISE;
+					}
+				} else {
+					if(_counter > 0) {
+						_counter--;
+					}
+
+					if(_counter == 0 && _shadow) {
+						_shadow = 0;
+						return EDGE_FALL;
+					}
+				}
+				return EDGE_NONE;
+			}
+
+			/**
+			 * Returns true when further samples at the given level cannot change anything,
+			 * ie: the counter is saturated at the end matching both raw and debounced state
+			 */
+			bool is_settled(int raw) const {
+				return raw ? (_shadow && _counter == _samples) : (!_shadow && _counter == 0);
+			}
+
+			/** Returns the debounced state */
+			int read(void) const {
+				return _shadow;
+			}
+
+		protected:
+
+			int _shadow;
+			unsigned int _counter;
+			unsigned int _samples;
+
+	};
+
+	/**
+	 * Sampling window state machine for interrupt-driven debouncing
+	 *
+	 * An edge opens a window in which the input is sampled periodically, and the
+	 * window closes once the integrator has settled. The caller owns the interrupt
+	 * and timer and only has to follow the return values.
+	 */
+	class DebounceWindow : public DebounceIntegrator
+	{
+
+		public:
+
+			DebounceWindow(int initial_state = 0, unsigned int samples = 10) :
+				DebounceIntegrator(initial_state, samples), _active(false) { }
+
+			/**
+			 * Called on a raw edge interrupt
+			 * @retval true if a new sampling window must be started, false if one is already active
+			 */
+			bool edge(void) {
+				if(_active) {
+					return false;
+				}
+				_active = true;
+				return true;
+			}
+
+			/**
+			 * Called on each sample of an active window
+			 * @param[in] raw Raw input level
+			 * @retval Edge of the debounced state caused by this sample, if any
+			 * @note check active() afterwards to find out if another sample is needed
+			 */
+			edge_t sample(int raw) {
+				edge_t result = update(raw);
+				if(is_settled(raw)) {
+					_active = false;
+				}
+				return result;
+			}
+
+			/** Returns true while a sampling window is open */
+			bool active(void) const {
+				return _active;
+			}
+
+		protected:
+
+			bool _active;
+
+	};
+}
+
+#endif /* DRIVERS_DEBOUNCEINTEGRATOR_H_ */
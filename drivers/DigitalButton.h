@@ -71,6 +71,9 @@ namespace ep
 
 			virtual ~DigitalButton() { }
 
+			/** Events are reported as button presses/releases rather than debounced edges */
+			using ButtonIn::attach_event_ring;
+
 			/**
 			 * Read the status of the input
 			 * @retval An integer representing the state of the underlying button input
@@ -82,6 +85,17 @@ namespace ep
 				return this->read();
 			}
 
+		protected:
+
+			/**
+			 * Report the debouncer's raw and confirmed edge times
+			 */
+			virtual void _edge_times(us_timestamp_t& raw_us, us_timestamp_t& confirmed_us)
+			{
+				raw_us = this->last_raw_edge_us();
+				confirmed_us = this->last_edge_us();
+			}
+
 
 	};
 }
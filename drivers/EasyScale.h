@@ -30,7 +30,11 @@
 
 #include "platform/platform.h"
 
+#include "EasyScaleWaveform.h"
+
 #include "drivers/DigitalInOut.h"
+#include "drivers/Timeout.h"
+#include "platform/Callback.h"
 
 class EasyScale
 {
@@ -47,19 +51,25 @@ class EasyScale
 		 */
 		EasyScale(PinName ctrl_pin);
 
-		~EasyScale() { }
+		~EasyScale() {
+			_timeout.detach();
+		}
 
 		/**
 		 * Powers on devices connected to the EasyScale control pin
 		 * Takes care of configuring connected devices to
 		 * use EasyScale as the control input
+		 *
+		 * @retval true if done, false if an asynchronous transfer is in progress
 		 */
-		void power_on(void);
+		bool power_on(void);
 
 		/**
 		 * Shuts down devices connected to the EasyScale control pin
+		 *
+		 * @retval true if done, false if an asynchronous transfer is in progress
 		 */
-		void shutdown(void);
+		bool shutdown(void);
 
 		/**
 		 * Sets the brightness
@@ -68,34 +78,105 @@ class EasyScale
 		 * @note This class contains static device addresses for various TI chips
 		 *
 		 * @retval 0 if brightness setting was acknowledged, 1 otherwise
+		 * @note nothing is sent (and false is returned) while an asynchronous transfer is in progress
 		 */
 		bool set_brightness(uint8_t brightness, uint8_t addr = DEVICE_ADDRESS_TPS61158);
 
+		/**
+		 * Powers on devices connected to the EasyScale control pin without blocking
+		 * @param[in] done (optional) Callback executed when the sequence is complete (ack is always true)
+		 *
+		 * @note callback is called in the interrupt context
+		 * @retval true if started, false if a transfer is already in progress
+		 */
+		bool power_on_async(mbed::Callback<void(bool)> done = NULL);
+
+		/**
+		 * Sets the brightness without blocking
+		 *
+		 * The frame is clocked out from a Timeout at a lower bit rate than the
+		 * blocking API (see EasyScaleWaveform::slow_timing) and the ACK is
+		 * reported through the callback
+		 *
+		 * @param[in] brightness Brightness setting ranging from 0 (off) to 31 (full brightness)
+		 * @param[in] addr Device address to send to
+		 * @param[in] done (optional) Callback executed with true if the setting was acknowledged
+		 *
+		 * @note callback is called in the interrupt context
+		 * @retval true if started, false if a transfer is already in progress
+		 */
+		bool set_brightness_async(uint8_t brightness, uint8_t addr = DEVICE_ADDRESS_TPS61158,
+				mbed::Callback<void(bool)> done = NULL);
+
+		/**
+		 * Aborts the asynchronous transfer in progress, if any
+		 *
+		 * The done callback is not called. The control pin is left driven high
+		 * so the devices stay enabled and discard the incomplete frame.
+		 * Blocking transfers are not affected.
+		 *
+		 * @retval true if a transfer was aborted
+		 */
+		bool abort(void);
+
+		/**
+		 * Returns true while a transfer is in progress
+		 */
+		bool is_busy(void) const {
+			return _busy;
+		}
+
 	protected:
 
 		/**
-		 * Writes a byte to the EasyScale bus
-		 * @param[in] data_byte Byte to write to bus
+		 * Marks the bus busy, atomically with respect to interrupts and other threads
+		 * @retval true if claimed, false if a transfer is already in progress
+		 */
+		bool claim(void);
+
+		/**
+		 * Replays waveform steps with busy waits
+		 * @retval ACK state sampled by the waveform (false if it has no ACK)
 		 */
-		void write_byte(uint8_t data_byte);
+		bool play_blocking(const easyscale_step_t* steps, size_t count);
 
 		/**
-		 * Writes a low bit to the bus
-		 * (Logic 0: t_low >= 2 * t_high)
+		 * Applies the action of a step to the control pin
 		 */
-		void send_low(void);
+		void apply_step(const easyscale_step_t& step);
 
 		/**
-		 * Writes a high bit to the bus
-		 * (Logic 1: t_high >= 2 * t_low)
+		 * Starts replaying _steps from a Timeout
 		 */
-		void send_high(void);
+		bool start_async(size_t count, mbed::Callback<void(bool)> done);
+
+		/**
+		 * Timeout handler, runs the next step of an asynchronous transfer
+		 */
+		void async_step(void);
 
 	protected:
 
 		/** Digital Input/Output for EasyScale control pin */
 		mbed::DigitalInOut es_ctrl_pin;
 
+		/** Timeout clocking asynchronous transfers */
+		mbed::Timeout _timeout;
+
+		/** Steps of the current asynchronous transfer */
+		easyscale_step_t _steps[EasyScaleWaveform::MaxSteps];
+		size_t _step_count;			/** 0 when no asynchronous transfer is in progress */
+		size_t _step_index;
+
+		/** Last sampled ACK state */
+		bool _ack;
+
+		/** Indicates a transfer is in progress, see claim() */
+		volatile bool _busy;
+
+		/** Completion callback of the current asynchronous transfer */
+		mbed::Callback<void(bool)> _done_cb;
+
 
 };
 
@@ -0,0 +1,179 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_EASYSCALEFADER_H_
+#define DRIVERS_EASYSCALEFADER_H_
+
+#include "EasyScale.h"
+
+#include "events/EventQueue.h"
+#include "platform/NonCopyable.h"
+
+#include <chrono>
+#include <stdint.h>
+
+/** Time to wait before trying again when the bus is taken by another transfer */
+#define EASYSCALE_FADER_RETRY_MS 2
+
+/**
+ * Smooth brightness fades for EasyScale backlight drivers
+ *
+ * A fade is described by a target brightness, a duration and an easing curve.
+ * The fader only sends a frame when the eased brightness crosses to a new
+ * integer level, and sleeps on the EventQueue until the next crossing.
+ *
+ * Requests may be made from any context. They are coalesced: only the latest
+ * request is pursued and superseded targets are dropped. If the bus is slower
+ * than the fade, intermediate levels are skipped instead of queuing frames.
+ *
+ * Example:
+ * @code
+ * EasyScale backlight(BACKLIGHT_CTRL);
+ * EasyScaleFader fader(backlight, queue);
+ * backlight.power_on();
+ * fader.fade_to(31, 500ms, EasyScaleFader::EASE_IN_OUT);
+ * @endcode
+ */
+class EasyScaleFader : private mbed::NonCopyable<EasyScaleFader>
+{
+	public:
+
+		/** Maximum EasyScale brightness level */
+		static constexpr uint8_t MaxLevel = 31;
+
+		/** Easing curves */
+		enum easing_t {
+			EASE_LINEAR,		/** Constant rate */
+			EASE_IN,			/** Starts slow (quadratic) */
+			EASE_OUT,			/** Ends slow (quadratic) */
+			EASE_IN_OUT			/** Starts and ends slow */
+		};
+
+	public:
+
+		/**
+		 * Instantiate a fader
+		 * @param[in] easyscale EasyScale bus of the backlight driver
+		 * @param[in] queue EventQueue to run the fader on
+		 * @param[in] addr (optional) Device address to send to
+		 * @param[in] initial_level (optional) Brightness the device is currently set to
+		 */
+		EasyScaleFader(EasyScale& easyscale, events::EventQueue& queue,
+				uint8_t addr = EasyScale::DEVICE_ADDRESS_TPS61158, uint8_t initial_level = 0);
+
+		~EasyScaleFader();
+
+		/**
+		 * Fade to a new brightness, superseding any fade in progress
+		 * @param[in] target Target brightness from 0 (off) to 31 (full brightness)
+		 * @param[in] duration Fade duration (0 to set the brightness as soon as possible)
+		 * @param[in] easing (optional) Easing curve
+		 */
+		void fade_to(uint8_t target, std::chrono::milliseconds duration, easing_t easing = EASE_LINEAR);
+
+		/**
+		 * Returns the last brightness level sent to the device
+		 */
+		uint8_t get_level(void) const {
+			return _level;
+		}
+
+		/**
+		 * Returns true while a fade is in progress
+		 */
+		bool is_fading(void) const {
+			return _fading;
+		}
+
+		/**
+		 * Returns the number of frames that were not acknowledged
+		 */
+		uint32_t get_nack_count(void) const {
+			return _nack_count;
+		}
+
+		/**
+		 * Returns the eased level of a fade at the given time (exposed for testing)
+		 * @param[in] start Level at the start of the fade
+		 * @param[in] target Level at the end of the fade
+		 * @param[in] elapsed_ms Time since the start of the fade
+		 * @param[in] duration_ms Duration of the fade
+		 * @param[in] easing Easing curve
+		 */
+		static uint8_t level_at(uint8_t start, uint8_t target, uint32_t elapsed_ms,
+				uint32_t duration_ms, easing_t easing);
+
+	protected:
+
+		/** Applies the latest request (queue context) */
+		void process_request(void);
+
+		/** Sends the current level if needed, otherwise sleeps until the next level change (queue context) */
+		void service(void);
+
+		/** Calls service() again after EASYSCALE_FADER_RETRY_MS (queue context) */
+		void retry(void);
+
+		/** Timer event handler (queue context) */
+		void on_timer(void);
+
+		/** EasyScale completion handler (interrupt context) */
+		void on_frame_done(bool ack);
+
+		/** Continues the fade after a frame (queue context) */
+		void after_frame(void);
+
+		/** Returns the first time after elapsed_ms at which the level changes */
+		uint32_t next_change_ms(uint32_t elapsed_ms, uint8_t level) const;
+
+		static uint32_t now_ms(void);
+
+	protected:
+
+		EasyScale& _easyscale;
+		events::EventQueue& _queue;
+		uint8_t _addr;
+
+		/** Latest request, written from any context */
+		volatile uint8_t _req_target;
+		volatile uint32_t _req_duration_ms;
+		volatile easing_t _req_easing;
+		volatile bool _req_posted;
+		volatile int _request_id;		/** Posted process_request() event */
+
+		/** Current fade, only used in queue context */
+		uint8_t _start_level;
+		uint8_t _target;
+		uint32_t _start_ms;
+		uint32_t _duration_ms;
+		easing_t _easing;
+		int _timer_id;
+
+		volatile uint8_t _level;
+		volatile bool _fading;
+		volatile bool _sending;		/** One of our frames is in flight */
+		volatile int _frame_done_id;	/** Posted after_frame() event */
+		volatile uint32_t _nack_count;
+};
+
+#endif /* DRIVERS_EASYSCALEFADER_H_ */
@@ -0,0 +1,186 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_EASYSCALEWAVEFORM_H_
+#define DRIVERS_EASYSCALEWAVEFORM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * One step of an EasyScale waveform: an action on the control
+ * pin followed by a hold time before the next step
+ */
+struct easyscale_step_t {
+
+	enum action_t {
+		DRIVE_LOW,		/** Drive the control pin low */
+		DRIVE_HIGH,		/** Drive the control pin high (as an output) */
+		RELEASE,		/** Release the control pin (input with pull-up) for the slave's ACK */
+		SAMPLE_ACK		/** Sample the ACK (active low) */
+	};
+
+	action_t action;
+	uint16_t duration_us;
+};
+
+/**
+ * EasyScale bit timing
+ *
+ * Logic 0: t_low >= 2 * t_high
+ * Logic 1: t_high >= 2 * t_low
+ */
+struct easyscale_timing_t {
+	uint16_t short_us;			/** Short half of a bit */
+	uint16_t long_us;			/** Long half of a bit */
+	uint16_t eos_us;			/** End of stream (low) */
+	uint16_t start_us;			/** Start condition (high) */
+	uint16_t ack_sample_us;		/** Delay from releasing the pin to sampling the ACK */
+	uint16_t ack_clear_us;		/** Delay for the slave to release the ACK before driving the pin again */
+};
+
+/**
+ * Generates EasyScale waveforms as a list of steps
+ *
+ * The same steps are replayed with busy waits by the blocking EasyScale API
+ * and from a Timeout by the asynchronous API, and can be checked on the host.
+ */
+class EasyScaleWaveform
+{
+	public:
+
+		/** Steps in a brightness frame */
+		static constexpr size_t FrameSteps = 16 + 2 + 16 + 1 + 3;
+
+		/** Steps in the power on sequence */
+		static constexpr size_t PowerOnSteps = 3;
+
+		/** Maximum number of steps of any waveform */
+		static constexpr size_t MaxSteps = FrameSteps;
+
+		/**
+		 * Timing used by the blocking API (~83kHz)
+		 */
+		static easyscale_timing_t fast_timing(void) {
+			easyscale_timing_t timing = { 10, 40, 5, 5, 10, 900 };
+			return timing;
+		}
+
+		/**
+		 * Timing used by the asynchronous API (~5kHz)
+		 *
+		 * Bit halves are long enough to be timed by a Timeout and the 3:1 ratio
+		 * tolerates tens of microseconds of interrupt latency on any step while
+		 * staying inside the EasyScale data rate range (1.7kHz - 160kHz)
+		 */
+		static easyscale_timing_t slow_timing(void) {
+			easyscale_timing_t timing = { 50, 150, 50, 50, 10, 900 };
+			return timing;
+		}
+
+		/**
+		 * Builds a brightness frame: address byte, EOS, start, data byte with
+		 * request for acknowledge, EOS, then the ACK sequence
+		 *
+		 * @param[in] addr Device address
+		 * @param[in] brightness Brightness from 0 (off) to 31 (full brightness)
+		 * @param[in] timing Bit timing
+		 * @param[out] steps Destination, must hold FrameSteps steps
+		 * @retval Number of steps written
+		 */
+		static size_t build_frame(uint8_t addr, uint8_t brightness,
+				const easyscale_timing_t& timing, easyscale_step_t* steps) {
+
+			// Mask input data (only 5 LSB are valid)
+			// Also sets both register address bits (5, 6) to 0
+			brightness &= 0x1F;
+			// Add request for acknowledge bit (RFA, bit 7)
+			brightness |= 0x80;
+
+			size_t n = 0;
+			n = build_byte(addr, timing, steps, n);
+
+			// End of Stream (EOS) then Start
+			steps[n++] = step(easyscale_step_t::DRIVE_LOW, timing.eos_us);
+			steps[n++] = step(easyscale_step_t::DRIVE_HIGH, timing.start_us);
+
+			n = build_byte(brightness, timing, steps, n);
+
+			// End of Stream (EOS)
+			steps[n++] = step(easyscale_step_t::DRIVE_LOW, timing.eos_us);
+
+			// Check the acknowledge bit, then wait for it to go away to avoid driving the slave's output
+			steps[n++] = step(easyscale_step_t::RELEASE, timing.ack_sample_us);
+			steps[n++] = step(easyscale_step_t::SAMPLE_ACK, timing.ack_clear_us);
+
+			// Idle the bus
+			steps[n++] = step(easyscale_step_t::DRIVE_HIGH, 0);
+
+			return n;
+		}
+
+		/**
+		 * Builds the power on sequence that selects EasyScale mode
+		 *
+		 * 1. Pull CTRL pin high to enable the TPS61158 and to start
+		 * 	the 1-wire detection window.
+		 *
+		 * 2. After the EasyScale detect delay (tes_delay, 100us) expires, drive CTRL
+		 * 	low for more than the EasyScale detection time (tes_detect, 450 us)
+		 *
+		 * 3. The CTRL pin has to be low for more than EasyScale detection time
+		 * 	before the EasyScale detection window (tes_win, 3.5ms) expires.
+		 * 	EasyScale detection window starts from the first
+		 * 	CTRL pin low-to-high transition
+		 *
+		 * @param[out] steps Destination, must hold PowerOnSteps steps
+		 * @retval Number of steps written
+		 */
+		static size_t build_power_on(easyscale_step_t* steps) {
+			steps[0] = step(easyscale_step_t::DRIVE_HIGH, 150);
+			steps[1] = step(easyscale_step_t::DRIVE_LOW, 500);
+			steps[2] = step(easyscale_step_t::DRIVE_HIGH, 10);
+			return PowerOnSteps;
+		}
+
+	protected:
+
+		static easyscale_step_t step(easyscale_step_t::action_t action, uint16_t duration_us) {
+			easyscale_step_t s = { action, duration_us };
+			return s;
+		}
+
+		/** Shifts out a byte MSB first, each bit is a low then a high step */
+		static size_t build_byte(uint8_t data_byte, const easyscale_timing_t& timing,
+				easyscale_step_t* steps, size_t n) {
+			for(int i = 7; i >= 0; i--)
+			{
+				bool bit = (data_byte & (0x01 << i));
+				steps[n++] = step(easyscale_step_t::DRIVE_LOW, bit ? timing.short_us : timing.long_us);
+				steps[n++] = step(easyscale_step_t::DRIVE_HIGH, bit ? timing.long_us : timing.short_us);
+			}
+			return n;
+		}
+};
+
+#endif /* DRIVERS_EASYSCALEWAVEFORM_H_ */
@@ -0,0 +1,87 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_EDGEEVENT_H_
+#define DRIVERS_EDGEEVENT_H_
+
+#include "extensions/LockFreeRing.h"
+
+#include "hal/ticker_api.h"
+#if defined(DEVICE_LPTICKER)
+#include "hal/lp_ticker_api.h"
+#else
+#include "hal/us_ticker_api.h"
+#endif
+
+#include <stdint.h>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Timestamped edge event reported by debounced inputs and buttons
+	 */
+	struct edge_event_t {
+
+		enum type_t {
+			FALL,		/** Debounced input went low */
+			RISE,		/** Debounced input went high */
+			PRESS,		/** Button was pressed */
+			RELEASE		/** Button was released */
+		};
+
+		type_t type;
+
+		/** Time the raw input first changed (microseconds, see edge_timestamp_us()) */
+		us_timestamp_t raw_us;
+
+		/** Time the change was confirmed by the debouncer (microseconds) */
+		us_timestamp_t confirmed_us;
+
+		/** RELEASE only: time since the matching PRESS was confirmed, 0 otherwise */
+		uint32_t duration_us;
+
+		/** Input that produced the event, so several inputs can share a ring */
+		const void* source;
+	};
+
+	/** Ring of edge events, drained from thread context */
+	typedef LockFreeRing<edge_event_t> EdgeEventRing;
+
+	/**
+	 * Monotonic timestamp used for edge events
+	 *
+	 * Uses the low power ticker when available so it keeps counting in deep sleep
+	 */
+	inline us_timestamp_t edge_timestamp_us(void) {
+#if defined(DEVICE_LPTICKER)
+		return ticker_read_us(get_lp_ticker_data());
+#else
+		return ticker_read_us(get_us_ticker_data());
+#endif
+	}
+}
+
+#endif /* DRIVERS_EDGEEVENT_H_ */
@@ -0,0 +1,221 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_GESTUREENGINE_H_
+#define DRIVERS_GESTUREENGINE_H_
+
+#include "ButtonIn.h"
+#include "GestureRecognizer.h"
+#include "EdgeEvent.h"
+
+#include "extensions/LockFreeRing.h"
+
+#include "events/EventQueue.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_critical.h"
+
+#include <chrono>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Delivers multi-click, hold-repeat and chord gestures of several buttons on an EventQueue
+	 *
+	 * Press/release edges are buffered in interrupt context and drained on the queue,
+	 * where a GestureRecognizer processes them. One queue event serves as the timer for
+	 * all buttons, so the buttons' own long press timeouts are not used (do not attach
+	 * short/long press callbacks to buttons managed by an engine).
+	 *
+	 * If the queue is full when an edge arrives, the edge stays buffered until the
+	 * next edge or timer event. If the edge buffer itself overflows, the recognizer is
+	 * resynchronized with the buttons' status() so no button is left held.
+	 *
+	 * Example:
+	 * @code
+	 * ep::DigitalButton up(BUTTON1, true), down(BUTTON2, true);
+	 * ep::ButtonIn* const buttons[] = { &up, &down };
+	 * ep::GestureEngine<2> gestures(buttons, queue, callback(on_gesture));
+	 * @endcode
+	 *
+	 * @note gestures are delivered in the context of the EventQueue
+	 *
+	 * @tparam N Number of buttons (1 to 32)
+	 * @tparam Q Number of edges buffered between queue dispatches (power of two)
+	 */
+	template<size_t N, size_t Q = 16>
+	class GestureEngine : private mbed::NonCopyable<GestureEngine<N, Q> >
+	{
+
+		public:
+
+			/**
+			 * Constructor
+			 * @param[in] buttons Buttons to recognize gestures of, gesture_t::button is the index in this array
+			 * @param[in] queue EventQueue to process edges and deliver gestures on
+			 * @param[in] sink Callback receiving recognized gestures
+			 * @param[in] config (optional) Timing configuration
+			 */
+			GestureEngine(ButtonIn* const (&buttons)[N], events::EventQueue& queue,
+					mbed::Callback<void(const gesture_t&)> sink,
+					const gesture_config_t& config = GestureRecognizer<N>::default_config()) :
+					_queue(queue), _recognizer(sink, config), _timer_id(0),
+					_edges(_edge_storage), _dropped(0), _drain_id(0) {
+				for(size_t i = 0; i < N; i++) {
+					_buttons[i] = buttons[i];
+					_buttons[i]->attach_edge_observer(mbed::callback(this, &GestureEngine::_on_edge));
+				}
+			}
+
+			~GestureEngine() {
+				for(size_t i = 0; i < N; i++) {
+					_buttons[i]->attach_edge_observer(NULL);
+				}
+				if(_timer_id) {
+					_queue.cancel(_timer_id);
+				}
+				if(_drain_id) {
+					_queue.cancel(_drain_id);
+				}
+			}
+
+			/**
+			 * Changes the timing configuration
+			 * @note must be called from the EventQueue's context
+			 */
+			void set_config(const gesture_config_t& config) {
+				_recognizer.set_config(config);
+			}
+
+		protected:
+
+			/** Edge buffered between interrupt and queue context */
+			struct edge_t {
+				uint8_t button;
+				bool pressed;
+				uint32_t time_ms;
+			};
+
+			/** Called in interrupt context by the buttons */
+			void _on_edge(ButtonIn* button, const edge_event_t& event) {
+				for(size_t i = 0; i < N; i++) {
+					if(_buttons[i] == button) {
+						edge_t edge = { (uint8_t) i, event.type == edge_event_t::PRESS, _to_ms(event.confirmed_us) };
+
+						/** Buttons may interrupt each other, so pushes and posts are serialized */
+						core_util_critical_section_enter();
+						_edges.push(edge);
+						if(!_drain_id) {
+							/** Stays 0 if the queue is full, the next edge or timer event retries */
+							_drain_id = _queue.call(this, &GestureEngine::_drain);
+						}
+						core_util_critical_section_exit();
+						return;
+					}
+				}
+			}
+
+			void _drain(void) {
+				core_util_critical_section_enter();
+				_drain_id = 0;
+				core_util_critical_section_exit();
+
+				_process_edges();
+				_reschedule();
+			}
+
+			void _on_timer(void) {
+				_timer_id = 0;
+				_process_edges();
+				_recognizer.poll(_to_ms(edge_timestamp_us()));
+				_reschedule();
+			}
+
+			/** Feeds the buffered edges to the recognizer, in order */
+			void _process_edges(void) {
+				edge_t edge;
+				while(_edges.pop(edge)) {
+					if(edge.pressed) {
+						_recognizer.press(edge.button, edge.time_ms);
+					} else {
+						_recognizer.release(edge.button, edge.time_ms);
+					}
+				}
+
+				/** Edges were lost, catch up with the buttons' current state */
+				uint32_t dropped = _edges.dropped();
+				if(dropped != _dropped) {
+					_dropped = dropped;
+					uint32_t now_ms = _to_ms(edge_timestamp_us());
+					for(size_t i = 0; i < N; i++) {
+						bool pressed = _buttons[i]->status();
+						if(pressed != (bool)(_recognizer.pressed() & (1UL << i))) {
+							if(pressed) {
+								_recognizer.press((uint8_t) i, now_ms);
+							} else {
+								_recognizer.release((uint8_t) i, now_ms);
+							}
+						}
+					}
+				}
+			}
+
+			/** Keeps the single timer event aimed at the recognizer's earliest deadline */
+			void _reschedule(void) {
+				if(_timer_id) {
+					_queue.cancel(_timer_id);
+					_timer_id = 0;
+				}
+
+				uint32_t deadline_ms;
+				if(_recognizer.next_deadline(deadline_ms)) {
+					int32_t delay_ms = (int32_t)(deadline_ms - _to_ms(edge_timestamp_us()));
+					if(delay_ms < 0) {
+						delay_ms = 0;
+					}
+					_timer_id = _queue.call_in(std::chrono::milliseconds(delay_ms),
+							this, &GestureEngine::_on_timer);
+				}
+			}
+
+			static uint32_t _to_ms(us_timestamp_t time_us) {
+				return (uint32_t)(time_us / 1000);
+			}
+
+			events::EventQueue& _queue;
+			GestureRecognizer<N> _recognizer;
+			ButtonIn* _buttons[N];
+			int _timer_id;
+
+			edge_t _edge_storage[Q];
+			LockFreeRing<edge_t> _edges;
+			uint32_t _dropped;			/** _edges.dropped() when the recognizer was last resynchronized */
+			volatile int _drain_id;		/** Posted _drain() event, 0 if none */
+
+	};
+}
+
+#endif /* DRIVERS_GESTUREENGINE_H_ */
@@ -0,0 +1,302 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_GESTURERECOGNIZER_H_
+#define DRIVERS_GESTURERECOGNIZER_H_
+
+#include "platform/Callback.h"
+#include "platform/mbed_assert.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/** Gesture reported by a GestureRecognizer */
+	struct gesture_t {
+
+		enum type_t {
+			CLICK,			/** One or more clicks, see count */
+			HOLD_START,		/** Button held for longer than the hold time */
+			HOLD_REPEAT,	/** Auto-repeat while held, see count */
+			HOLD_END,		/** Held button was released */
+			CHORD			/** Several buttons pressed together, see mask */
+		};
+
+		type_t type;
+
+		/** Index of the button (the first button of the mask for CHORD) */
+		uint8_t button;
+
+		/** CLICK: number of clicks, HOLD_REPEAT: repeat number (starting at 1) */
+		uint8_t count;
+
+		/** Buttons involved (bit n = button n) */
+		uint32_t mask;
+	};
+
+	/** Timing configuration of a GestureRecognizer */
+	struct gesture_config_t {
+		uint32_t multi_click_ms;		/** Max time from a release to the next press of a multi-click */
+		uint8_t max_clicks;				/** Clicks reported immediately without waiting for the window */
+		uint32_t hold_ms;				/** Time a press must last to become a hold */
+		uint32_t repeat_start_ms;		/** First auto-repeat interval */
+		uint32_t repeat_min_ms;			/** Fastest auto-repeat interval */
+		uint8_t repeat_accel_pct;		/** Each repeat interval is this percentage of the previous one */
+		uint32_t chord_ms;				/** Max time between presses that form a chord */
+	};
+
+	/**
+	 * Recognizes multi-clicks, accelerating hold-repeat and chords across up to 32 buttons
+	 *
+	 * The recognizer is fed press/release edges with timestamps and owns no timers.
+	 * Whenever next_deadline() reports a pending deadline the owner must call
+	 * poll() at (or after) that time, so a single timer serves all buttons.
+	 *
+	 * Times are in milliseconds from any monotonic clock and may wrap.
+	 *
+	 * This class has no hardware dependencies so it can be tested on the host.
+	 * @see GestureEngine
+	 *
+	 * @tparam N Number of buttons (1 to 32)
+	 */
+	template<size_t N>
+	class GestureRecognizer
+	{
+
+		public:
+
+			/** Default timing, tuned for mechanical tact switches */
+			static gesture_config_t default_config(void) {
+				gesture_config_t config = { 300, 3, 600, 400, 50, 75, 80 };
+				return config;
+			}
+
+			/**
+			 * Constructor
+			 * @param[in] sink Callback receiving recognized gestures
+			 * @param[in] config Timing configuration
+			 */
+			GestureRecognizer(mbed::Callback<void(const gesture_t&)> sink,
+					const gesture_config_t& config = default_config()) :
+					_sink(sink), _config(config), _pressed(0) {
+				MBED_ASSERT(N > 0 && N <= 32);
+				for(size_t i = 0; i < N; i++) {
+					_reset(_buttons[i]);
+					_buttons[i].pressed = false;
+				}
+			}
+
+			/** Changes the timing configuration */
+			void set_config(const gesture_config_t& config) {
+				_config = config;
+			}
+
+			/**
+			 * Reports a press of the given button
+			 * @param[in] button Button index
+			 * @param[in] now_ms Time of the press
+			 */
+			void press(uint8_t button, uint32_t now_ms) {
+				MBED_ASSERT(button < N);
+				button_t& b = _buttons[button];
+				if(b.pressed) {
+					return;
+				}
+				b.pressed = true;
+				b.press_ms = now_ms;
+				_pressed |= (1UL << button);
+
+				/** Any other fresh press within the chord window forms a chord with this one */
+				uint32_t chord = (1UL << button);
+				for(size_t i = 0; i < N; i++) {
+					button_t& other = _buttons[i];
+					if(i != button && other.pressed && !other.consumed && !other.holding &&
+							(uint32_t)(now_ms - other.press_ms) <= _config.chord_ms) {
+						chord |= (1UL << i);
+					}
+				}
+
+				if(chord != (1UL << button)) {
+					for(size_t i = 0; i < N; i++) {
+						if(chord & (1UL << i)) {
+							_reset(_buttons[i]);
+							_buttons[i].consumed = true;
+						}
+					}
+					_emit(gesture_t::CHORD, _first(chord), 0, chord);
+					return;
+				}
+
+				/** Wait for the release (or hold time) rather than the multi-click window */
+				b.deadline_ms = now_ms + _config.hold_ms;
+				b.deadline_pending = true;
+			}
+
+			/**
+			 * Reports a release of the given button
+			 * @param[in] button Button index
+			 * @param[in] now_ms Time of the release
+			 */
+			void release(uint8_t button, uint32_t now_ms) {
+				MBED_ASSERT(button < N);
+				button_t& b = _buttons[button];
+				if(!b.pressed) {
+					return;
+				}
+				b.pressed = false;
+				_pressed &= ~(1UL << button);
+
+				if(b.consumed) {
+					_reset(b);
+				} else if(b.holding) {
+					_reset(b);
+					_emit(gesture_t::HOLD_END, button, 0, (1UL << button));
+				} else if(++b.clicks >= _config.max_clicks) {
+					uint8_t clicks = b.clicks;
+					_reset(b);
+					_emit(gesture_t::CLICK, button, clicks, (1UL << button));
+				} else {
+					b.deadline_ms = now_ms + _config.multi_click_ms;
+					b.deadline_pending = true;
+				}
+			}
+
+			/**
+			 * Handles all deadlines that have expired at the given time
+			 * @param[in] now_ms Current time
+			 */
+			void poll(uint32_t now_ms) {
+				for(size_t i = 0; i < N; i++) {
+					button_t& b = _buttons[i];
+					while(b.deadline_pending && _expired(b.deadline_ms, now_ms)) {
+						_handle_deadline((uint8_t) i, b);
+					}
+				}
+			}
+
+			/**
+			 * Returns the earliest pending deadline
+			 * @param[out] deadline_ms Earliest deadline, only written if one is pending
+			 * @retval true if a deadline is pending
+			 */
+			bool next_deadline(uint32_t& deadline_ms) const {
+				bool pending = false;
+				for(size_t i = 0; i < N; i++) {
+					const button_t& b = _buttons[i];
+					if(b.deadline_pending && (!pending || _expired(b.deadline_ms, deadline_ms))) {
+						deadline_ms = b.deadline_ms;
+						pending = true;
+					}
+				}
+				return pending;
+			}
+
+			/** Returns the buttons currently pressed (bit n = button n) */
+			uint32_t pressed(void) const {
+				return _pressed;
+			}
+
+		protected:
+
+			struct button_t {
+				uint32_t press_ms;
+				uint32_t deadline_ms;
+				uint32_t repeat_interval_ms;
+				uint8_t clicks;
+				uint8_t repeats;
+				bool pressed;
+				bool holding;
+				bool consumed;
+				bool deadline_pending;
+			};
+
+			/** Returns true if deadline is at or before now (wrap safe) */
+			static bool _expired(uint32_t deadline_ms, uint32_t now_ms) {
+				return (int32_t)(now_ms - deadline_ms) >= 0;
+			}
+
+			static uint8_t _first(uint32_t mask) {
+				uint8_t i = 0;
+				while(!(mask & 1)) {
+					mask >>= 1;
+					i++;
+				}
+				return i;
+			}
+
+			void _reset(button_t& b) {
+				b.clicks = 0;
+				b.repeats = 0;
+				b.holding = false;
+				b.consumed = false;
+				b.deadline_pending = false;
+			}
+
+			void _handle_deadline(uint8_t button, button_t& b) {
+				if(!b.pressed) {
+					/** Multi-click window closed */
+					uint8_t clicks = b.clicks;
+					_reset(b);
+					_emit(gesture_t::CLICK, button, clicks, (1UL << button));
+				} else if(!b.holding) {
+					/** Hold time reached, any clicks before the hold are absorbed into it */
+					b.clicks = 0;
+					b.holding = true;
+					b.repeat_interval_ms = _config.repeat_start_ms;
+					b.deadline_ms += b.repeat_interval_ms;
+					_emit(gesture_t::HOLD_START, button, 0, (1UL << button));
+				} else {
+					/** Auto-repeat, each interval shorter than the last down to the minimum */
+					if(b.repeats < 0xFF) {
+						b.repeats++;
+					}
+					uint32_t next = (b.repeat_interval_ms * _config.repeat_accel_pct) / 100;
+					b.repeat_interval_ms = (next < _config.repeat_min_ms) ? _config.repeat_min_ms : next;
+					if(b.repeat_interval_ms == 0) {
+						b.repeat_interval_ms = 1;
+					}
+					b.deadline_ms += b.repeat_interval_ms;
+					_emit(gesture_t::HOLD_REPEAT, button, b.repeats, (1UL << button));
+				}
+			}
+
+			void _emit(gesture_t::type_t type, uint8_t button, uint8_t count, uint32_t mask) {
+				if(_sink) {
+					gesture_t gesture = { type, button, count, mask };
+					_sink(gesture);
+				}
+			}
+
+			mbed::Callback<void(const gesture_t&)> _sink;
+			gesture_config_t _config;
+			button_t _buttons[N];
+			uint32_t _pressed;
+
+	};
+}
+
+#endif /* DRIVERS_GESTURERECOGNIZER_H_ */
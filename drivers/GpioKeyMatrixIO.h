@@ -0,0 +1,112 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_GPIOKEYMATRIXIO_H_
+#define DRIVERS_GPIOKEYMATRIXIO_H_
+
+#include "KeyMatrix.h"
+
+#include "drivers/DigitalIn.h"
+#include "drivers/DigitalInOut.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_wait_api.h"
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * KeyMatrix backend using MCU GPIOs
+	 *
+	 * The selected row is driven low and all other rows are left high impedance,
+	 * columns are read with pull-ups (a closed key reads low).
+	 *
+	 * @tparam R Number of rows
+	 * @tparam C Number of columns (1 to 32)
+	 */
+	template<uint8_t R, uint8_t C>
+	class GpioKeyMatrixIO : public KeyMatrixIO, private mbed::NonCopyable<GpioKeyMatrixIO<R, C> >
+	{
+
+		public:
+
+			/**
+			 * Constructor
+			 * @param[in] rows Row pins
+			 * @param[in] cols Column pins
+			 * @param[in] settle_us (optional) Time to wait after selecting a row before reading the columns
+			 */
+			GpioKeyMatrixIO(const PinName (&rows)[R], const PinName (&cols)[C],
+					unsigned int settle_us = 5) : _settle_us(settle_us) {
+				for(uint8_t r = 0; r < R; r++) {
+					_rows[r] = new mbed::DigitalInOut(rows[r], PIN_INPUT, PullNone, 0);
+				}
+				for(uint8_t c = 0; c < C; c++) {
+					_cols[c] = new mbed::DigitalIn(cols[c], PullUp);
+				}
+			}
+
+			virtual ~GpioKeyMatrixIO() {
+				for(uint8_t r = 0; r < R; r++) {
+					delete _rows[r];
+				}
+				for(uint8_t c = 0; c < C; c++) {
+					delete _cols[c];
+				}
+			}
+
+			virtual void select_row(uint8_t row) {
+				release_rows();
+				_rows[row]->write(0);
+				_rows[row]->output();
+				if(_settle_us) {
+					wait_us(_settle_us);
+				}
+			}
+
+			virtual void release_rows(void) {
+				for(uint8_t r = 0; r < R; r++) {
+					_rows[r]->input();
+				}
+			}
+
+			virtual uint32_t read_columns(void) {
+				uint32_t closed = 0;
+				for(uint8_t c = 0; c < C; c++) {
+					if(!_cols[c]->read()) {
+						closed |= (1UL << c);
+					}
+				}
+				return closed;
+			}
+
+		private:
+
+			mbed::DigitalInOut* _rows[R];
+			mbed::DigitalIn* _cols[C];
+			unsigned int _settle_us;
+	};
+}
+
+#endif /* DRIVERS_GPIOKEYMATRIXIO_H_ */
@@ -0,0 +1,365 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_KEYMATRIX_H_
+#define DRIVERS_KEYMATRIX_H_
+
+#include "ButtonIn.h"
+#include "VerticalCounterDebouncer.h"
+
+#include "events/EventQueue.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_assert.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Row drive/column sense interface used by KeyMatrix
+	 *
+	 * Implementations exist for GPIOs (GpioKeyMatrixIO) and for the MCP23008
+	 * and STMPE1600 IO expanders.
+	 */
+	class KeyMatrixIO
+	{
+
+		public:
+
+			virtual ~KeyMatrixIO() { }
+
+			/**
+			 * Drive the given row active, all other rows inactive (preferably high impedance)
+			 * @param[in] row Row index
+			 */
+			virtual void select_row(uint8_t row) = 0;
+
+			/** Return all rows to the idle state between scans */
+			virtual void release_rows(void) = 0;
+
+			/**
+			 * Read the columns of the selected row
+			 * @retval Bit c set if the key in column c of the selected row is closed
+			 */
+			virtual uint32_t read_columns(void) = 0;
+	};
+
+	class MatrixButton;
+
+	/**
+	 * Non-template base of KeyMatrix, used by MatrixButton
+	 */
+	class KeyMatrixBase
+	{
+
+		public:
+
+			virtual ~KeyMatrixBase() { }
+
+			/**
+			 * Read the debounced state of a key
+			 * @param[in] key Key index (row * columns + column)
+			 * @retval 1 if pressed, 0 if released
+			 */
+			virtual int read(size_t key) const = 0;
+
+			/** Returns the index of the key at the given row and column */
+			virtual size_t key_index(uint8_t row, uint8_t col) const = 0;
+
+			/**
+			 * Register the button that receives press/release events of a key
+			 * @param[in] key Key index
+			 * @param[in] button Button, or NULL to unregister
+			 */
+			virtual void attach_button(size_t key, MatrixButton* button) = 0;
+	};
+
+	/**
+	 * ButtonIn backend for one key of a KeyMatrix
+	 *
+	 * Provides ButtonIn short/long press semantics for each key of a scanned matrix.
+	 *
+	 * @note press/release handling runs in the context of the matrix scan (the EventQueue),
+	 * long press callbacks are still called in the interrupt context
+	 */
+	class MatrixButton : public ButtonIn
+	{
+		public:
+
+			/**
+			 * Instantiate a MatrixButton
+			 * @param[in] matrix Matrix the key belongs to
+			 * @param[in] row Row of the key
+			 * @param[in] col Column of the key
+			 * @param[in] sp_cb (optional) Short press callback
+			 * @param[in] lp_cb (optional) Long press callback
+			 */
+			MatrixButton(KeyMatrixBase& matrix, uint8_t row, uint8_t col,
+					mbed::Callback<void(ButtonIn*)> sp_cb = NULL,
+					mbed::Callback<void(ButtonIn*)> lp_cb = NULL) :
+			ButtonIn(false, sp_cb, lp_cb), _matrix(matrix), _key(matrix.key_index(row, col))
+			{
+				_matrix.attach_button(_key, this);
+			}
+
+			virtual ~MatrixButton()
+			{
+				_matrix.attach_button(_key, NULL);
+			}
+
+			/**
+			 * Read the status of the input
+			 * @retval An integer representing the state of the underlying button input
+			 * 0 - released, 1 - pressed
+			 */
+			virtual int status()
+			{
+				return _matrix.read(_key);
+			}
+
+		private:
+
+			KeyMatrixBase& _matrix;
+			size_t _key;
+	};
+
+	/**
+	 * Timer-driven scanner for an R x C key matrix
+	 *
+	 * Each scan drives one row at a time and reads all columns. Every key is
+	 * debounced with vertical counters (32 keys per word operation) and confirmed
+	 * edges are delivered to the attached MatrixButton of the key and to an
+	 * optional application callback.
+	 *
+	 * Matrices without diodes suffer from ghosting: when three corners of a
+	 * rectangle of keys are pressed the fourth appears pressed too. With
+	 * anti-ghosting enabled (the default) keys in any such rectangle keep their
+	 * previous state until the rectangle is resolved.
+	 *
+	 * Example:
+	 * @code
+	 * static const PinName rows[] = { P0_2, P0_3, P0_4, P0_5 };
+	 * static const PinName cols[] = { P0_6, P0_7, P0_8, P0_9 };
+	 * ep::GpioKeyMatrixIO<4, 4> io(rows, cols);
+	 * ep::KeyMatrix<4, 4> keypad(io);
+	 * ep::MatrixButton enter(keypad, 3, 2, callback(on_enter));
+	 * keypad.start(queue, 5ms);
+	 * @endcode
+	 *
+	 * @tparam R Number of rows
+	 * @tparam C Number of columns (1 to 32)
+	 */
+	template<uint8_t R, uint8_t C>
+	class KeyMatrix : public KeyMatrixBase, private mbed::NonCopyable<KeyMatrix<R, C> >
+	{
+
+		public:
+
+			static constexpr size_t Keys = (size_t) R * C;
+			static constexpr size_t Lanes = (Keys + 31) / 32;
+
+			/**
+			 * Constructor
+			 * @param[in] io Row/column backend
+			 * @param[in] samples (optional) Consecutive scans required to accept a key change
+			 */
+			KeyMatrix(KeyMatrixIO& io, uint8_t samples = 4) : _io(io), _anti_ghosting(true),
+					_queue(NULL), _event_id(0) {
+				MBED_ASSERT(R > 0 && C > 0 && C <= 32);
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					_debouncers[lane].reset(0);
+					_debouncers[lane].set_samples(samples);
+				}
+				for(size_t key = 0; key < Keys; key++) {
+					_buttons[key] = NULL;
+				}
+			}
+
+			virtual ~KeyMatrix() {
+				stop();
+			}
+
+			/**
+			 * Start scanning periodically on the given EventQueue
+			 * @param[in] queue EventQueue to scan on
+			 * @param[in] period Scan period, the debounce time is period * samples
+			 */
+			void start(events::EventQueue& queue, std::chrono::milliseconds period) {
+				stop();
+				_queue = &queue;
+				_event_id = queue.call_every(period, mbed::callback(this, &KeyMatrix::scan));
+			}
+
+			/** Stop periodic scanning */
+			void stop(void) {
+				if(_queue) {
+					_queue->cancel(_event_id);
+					_queue = NULL;
+					_event_id = 0;
+				}
+			}
+
+			/**
+			 * Sets the number of consecutive scans required to accept a key change
+			 * @param[in] samples Number of scans, see VerticalCounterDebouncer::MaxSamples
+			 */
+			void set_samples(uint8_t samples) {
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					_debouncers[lane].set_samples(samples);
+				}
+			}
+
+			/**
+			 * Enables or disables anti-ghosting
+			 * @param[in] enable Disable for matrices with a diode on every key
+			 */
+			void set_anti_ghosting(bool enable) {
+				_anti_ghosting = enable;
+			}
+
+			/**
+			 * Attach a function to call on every confirmed key change
+			 * @param[in] func Callback receiving the key index and true if pressed
+			 */
+			void attach(mbed::Callback<void(size_t, bool)> func) {
+				_key_cb = func;
+			}
+
+			/** Scan the matrix once (called periodically after start()) */
+			void scan(void) {
+				uint32_t rows[R];
+				for(uint8_t r = 0; r < R; r++) {
+					_io.select_row(r);
+					rows[r] = _io.read_columns() & ((C == 32) ? 0xFFFFFFFFUL : ((1UL << C) - 1));
+				}
+				_io.release_rows();
+
+				if(_anti_ghosting) {
+					_mask_ghosts(rows);
+				}
+
+				uint32_t raw[Lanes];
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					raw[lane] = 0;
+				}
+				for(uint8_t r = 0; r < R; r++) {
+					for(uint8_t c = 0; c < C; c++) {
+						if(rows[r] & (1UL << c)) {
+							size_t key = key_index(r, c);
+							raw[key / 32] |= (1UL << (key % 32));
+						}
+					}
+				}
+
+				for(size_t lane = 0; lane < Lanes; lane++) {
+					uint32_t changed = _debouncers[lane].update(raw[lane]);
+					uint32_t state = _debouncers[lane].state();
+					while(changed) {
+						uint8_t bit = __builtin_ctz(changed);
+						changed &= (changed - 1);
+						_notify((lane * 32) + bit, (state >> bit) & 1);
+					}
+				}
+			}
+
+			virtual int read(size_t key) const {
+				MBED_ASSERT(key < Keys);
+				return (_debouncers[key / 32].state() >> (key % 32)) & 1;
+			}
+
+			virtual size_t key_index(uint8_t row, uint8_t col) const {
+				MBED_ASSERT(row < R && col < C);
+				return ((size_t) row * C) + col;
+			}
+
+			virtual void attach_button(size_t key, MatrixButton* button) {
+				MBED_ASSERT(key < Keys);
+				_buttons[key] = button;
+			}
+
+		protected:
+
+			/**
+			 * Replaces keys that are part of a rectangle of closed keys with their
+			 * debounced state, since any one of them may be a ghost
+			 */
+			void _mask_ghosts(uint32_t (&rows)[R]) {
+				uint32_t ambiguous[R] = { 0 };
+				for(uint8_t r1 = 0; r1 < R; r1++) {
+					for(uint8_t r2 = r1 + 1; r2 < R; r2++) {
+						uint32_t common = rows[r1] & rows[r2];
+						if(common & (common - 1)) {
+							ambiguous[r1] |= common;
+							ambiguous[r2] |= common;
+						}
+					}
+				}
+
+				for(uint8_t r = 0; r < R; r++) {
+					if(!ambiguous[r]) {
+						continue;
+					}
+					for(uint8_t c = 0; c < C; c++) {
+						if(ambiguous[r] & (1UL << c)) {
+							if(read(key_index(r, c))) {
+								rows[r] |= (1UL << c);
+							} else {
+								rows[r] &= ~(1UL << c);
+							}
+						}
+					}
+				}
+			}
+
+			void _notify(size_t key, bool pressed) {
+				MatrixButton* button = _buttons[key];
+				if(button) {
+					if(pressed) {
+						button->_internal_press_handler();
+					} else {
+						button->_internal_release_handler();
+					}
+				}
+				if(_key_cb) {
+					_key_cb(key, pressed);
+				}
+			}
+
+			KeyMatrixIO& _io;
+			VerticalCounterDebouncer _debouncers[Lanes];
+			MatrixButton* _buttons[Keys];
+			mbed::Callback<void(size_t, bool)> _key_cb;
+			bool _anti_ghosting;
+			events::EventQueue* _queue;
+			int _event_id;
+
+	};
+}
+
+#endif /* DRIVERS_KEYMATRIX_H_ */
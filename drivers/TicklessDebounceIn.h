@@ -0,0 +1,219 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if defined(DEVICE_INTERRUPTIN) && (defined(DEVICE_LPTICKER) || defined(DEVICE_LOWPOWERTIMER))
+
+#ifndef DRIVERS_TICKLESSDEBOUNCEIN_H_
+#define DRIVERS_TICKLESSDEBOUNCEIN_H_
+
+#include "DebounceIntegrator.h"
+#include "EdgeEvent.h"
+
+#include "drivers/InterruptIn.h"
+#include "drivers/LowPowerTimeout.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+
+#include <chrono>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Interrupt-driven version of DebounceIn
+	 *
+	 * The input sleeps on an InterruptIn edge. An edge opens a short sampling window
+	 * driven by a LowPowerTimeout that runs the same integrating filter as DebounceIn.
+	 * Once the input has settled the window closes and only the interrupt remains
+	 * armed, so a stable input causes no periodic wakeups.
+	 *
+	 * Example:
+	 * @code
+	 * ep::TicklessDebounceIn button(BUTTON1);
+	 * button.fall(callback(on_pressed));
+	 * @endcode
+	 */
+	class TicklessDebounceIn : private mbed::NonCopyable<TicklessDebounceIn>
+	{
+
+		public:
+
+			/** Constructor
+			 *
+			 * @param PinName pin The pin to assign as an input.
+			 * @param debounce_ms The number of milliseconds to debounce
+			 * @param sample_period_us The sample period used while a window is open
+			 */
+			TicklessDebounceIn(PinName pin, unsigned int debounce_ms = 100,
+					unsigned int sample_period_us = 10000) : _irq(pin),
+					_sample_period(sample_period_us), _window_start_us(0), _raw_edge_us(0), _edge_us(0), _event_ring(NULL) {
+				set_debounce(debounce_ms);
+				_window.reset(_irq.read());
+				_irq.rise(mbed::callback(this, &TicklessDebounceIn::_edge));
+				_irq.fall(mbed::callback(this, &TicklessDebounceIn::_edge));
+			}
+
+			~TicklessDebounceIn() {
+				_irq.disable_irq();
+				_timeout.detach();
+			}
+
+			/** Sets the debounce time in milliseconds
+			 * @note rounds down to a multiple of the sample period
+			 * @param debounce_ms
+			 */
+			void set_debounce(unsigned int debounce_ms) {
+				_window.set_samples(((unsigned long) debounce_ms * 1000) / _sample_period.count());
+			}
+
+			/** Attach a function to call when a rising edge occurs on the debounced input
+			 *
+			 *  @param func A pointer to a void function, or 0 to set as none
+			 *
+			 *  @note called in the interrupt context
+			 */
+			void rise(mbed::Callback<void()> func) {
+				_rise = func;
+			}
+
+			/** Attach a function to call when a falling edge occurs on the debounced input
+			 *
+			 *  @param func A pointer to a void function, or 0 to set as none
+			 *
+			 *  @note called in the interrupt context
+			 */
+			void fall(mbed::Callback<void()> func) {
+				_fall = func;
+			}
+
+			/** Attach a ring that receives a timestamped event for each debounced edge
+			 *
+			 *  @param ring Ring to push events to, or NULL to set as none
+			 *
+			 *  @note events are pushed in the interrupt context, drain the ring from a thread
+			 */
+			void attach_event_ring(EdgeEventRing* ring) {
+				_event_ring = ring;
+			}
+
+			/** Returns the time of the raw edge that opened the window of the last debounced edge */
+			us_timestamp_t last_raw_edge_us(void) const {
+				return _raw_edge_us;
+			}
+
+			/** Returns the time the last debounced edge was confirmed */
+			us_timestamp_t last_edge_us(void) const {
+				return _edge_us;
+			}
+
+			/** Set the input pin mode
+			 *
+			 *  @param pull PullUp, PullDown, PullNone, OpenDrain
+			 */
+			void mode(PinMode pull) {
+				_irq.mode(pull);
+			}
+
+			/** read
+			 *
+			 * Read the value of the debounced pin.
+			 */
+			int read(void) {
+				return _window.read();
+			}
+
+			/** operator int()
+			 *
+			 * Read the value of the debounced pin.
+			 */
+			operator int() {
+				return read();
+			}
+
+			/** Returns true while a sampling window is open (the input is not stable yet) */
+			bool is_sampling(void) const {
+				return _window.active();
+			}
+
+		protected:
+
+			/** Raw edge interrupt, opens a sampling window */
+			void _edge(void) {
+				if(_window.edge()) {
+					_irq.disable_irq();
+					_window_start_us = edge_timestamp_us();
+					_timeout.attach(mbed::callback(this, &TicklessDebounceIn::_sample), _sample_period);
+				}
+			}
+
+			/** Periodic sample while a window is open */
+			void _sample(void) {
+				DebounceIntegrator::edge_t edge = _window.sample(_irq.read());
+				if(edge != DebounceIntegrator::EDGE_NONE) {
+					_raw_edge_us = _window_start_us;
+					_edge_us = edge_timestamp_us();
+					if(_event_ring) {
+						edge_event_t event = {
+							(edge == DebounceIntegrator::EDGE_RISE) ? edge_event_t::RISE : edge_event_t::FALL,
+							_raw_edge_us, _edge_us, 0, this
+						};
+						_event_ring->push(event);
+					}
+				}
+
+				if(_window.active()) {
+					_timeout.attach(mbed::callback(this, &TicklessDebounceIn::_sample), _sample_period);
+				} else {
+					_irq.enable_irq();
+
+					/** An edge may have been missed while the interrupt was disabled */
+					if(_irq.read() != _window.read()) {
+						_edge();
+					}
+				}
+
+				if(edge == DebounceIntegrator::EDGE_RISE && _rise) {
+					_rise();
+				} else if(edge == DebounceIntegrator::EDGE_FALL && _fall) {
+					_fall();
+				}
+			}
+
+			mbed::InterruptIn _irq;
+			mbed::LowPowerTimeout _timeout;
+			std::chrono::microseconds _sample_period;
+			DebounceWindow _window;
+			us_timestamp_t _window_start_us;
+			us_timestamp_t _raw_edge_us;
+			us_timestamp_t _edge_us;
+			EdgeEventRing* _event_ring;
+			mbed::Callback<void()> _rise;
+			mbed::Callback<void()> _fall;
+	};
+}
+
+#endif /* DRIVERS_TICKLESSDEBOUNCEIN_H_ */
+
+#endif /** defined(DEVICE_INTERRUPTIN) && (defined(DEVICE_LPTICKER) || defined(DEVICE_LOWPOWERTIMER)) */
@@ -0,0 +1,161 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef DRIVERS_VERTICALCOUNTERDEBOUNCER_H_
+#define DRIVERS_VERTICALCOUNTERDEBOUNCER_H_
+
+#include <stdint.h>
+
+namespace ep
+{
+
+	/** \addtogroup drivers */
+
+	/**
+	 * Debounces 32 inputs in parallel using bitwise vertical counters
+	 *
+	 * Each input has its own counter of consecutive samples that disagree with
+	 * its debounced state. The counters are stored "vertically": bit n of each
+	 * plane belongs to input n, so a handful of word operations updates all 32
+	 * counters at once. When an input's counter reaches the configured number of
+	 * samples its debounced state toggles.
+	 *
+	 * This class has no hardware dependencies so it can be tested on the host.
+	 * @see DebounceBank for a version that samples DigitalIn pins from a ticker
+	 */
+	class VerticalCounterDebouncer
+	{
+
+		public:
+
+			/** Number of bit planes in each counter */
+			static constexpr uint8_t CounterBits = 4;
+
+			/** Maximum number of consecutive samples supported */
+			static constexpr uint8_t MaxSamples = (1 << CounterBits) - 1;
+
+			/**
+			 * Constructor
+			 * @param[in] initial_state Initial debounced state of each input (bit n = input n)
+			 * @param[in] samples Consecutive samples required to accept a change (1 to MaxSamples)
+			 */
+			VerticalCounterDebouncer(uint32_t initial_state = 0, uint8_t samples = 10) : _state(initial_state) {
+				reset(initial_state);
+				set_samples(samples);
+			}
+
+			/**
+			 * Sets the number of consecutive samples required to accept a change
+			 * @param[in] samples Number of samples, clamped to 1 to MaxSamples
+			 *
+			 * @note a change in progress that already has enough samples for the new
+			 * threshold is accepted on its next disagreeing sample
+			 */
+			void set_samples(uint8_t samples) {
+				if(samples == 0) {
+					samples = 1;
+				} else if(samples > MaxSamples) {
+					samples = MaxSamples;
+				}
+				_samples = samples;
+
+				/** Find the counters above samples - 1, comparing from the MSB plane down */
+				uint8_t limit = samples - 1;
+				uint32_t above = 0;
+				uint32_t equal = 0xFFFFFFFF;
+				for(int i = CounterBits - 1; i >= 0; i--) {
+					if(limit & (1 << i)) {
+						equal &= _count[i];
+					} else {
+						above |= equal & _count[i];
+						equal &= ~_count[i];
+					}
+				}
+
+				/** Clamp them to samples - 1, so they can't count past the threshold and wrap */
+				for(uint8_t i = 0; i < CounterBits; i++) {
+					_count[i] = (_count[i] & ~above) | ((limit & (1 << i)) ? above : 0);
+				}
+			}
+
+			/** Returns the number of consecutive samples required to accept a change */
+			uint8_t get_samples(void) const {
+				return _samples;
+			}
+
+			/**
+			 * Forces the debounced state and clears all counters
+			 * @param[in] state New debounced state (bit n = input n)
+			 */
+			void reset(uint32_t state) {
+				_state = state;
+				for(uint8_t i = 0; i < CounterBits; i++) {
+					_count[i] = 0;
+				}
+			}
+
+			/**
+			 * Feeds one raw sample of all inputs into the debouncer
+			 * @param[in] raw Raw input levels (bit n = input n)
+			 * @retval Mask of inputs whose debounced state changed on this sample
+			 */
+			uint32_t update(uint32_t raw) {
+				uint32_t delta = raw ^ _state;
+
+				/** Increment counters of disagreeing inputs, clear the rest */
+				uint32_t carry = delta;
+				for(uint8_t i = 0; i < CounterBits; i++) {
+					uint32_t next_carry = _count[i] & carry;
+					_count[i] = (_count[i] ^ carry) & delta;
+					carry = next_carry;
+				}
+
+				/** Inputs whose counter equals the sample threshold toggle */
+				uint32_t toggled = delta;
+				for(uint8_t i = 0; i < CounterBits; i++) {
+					toggled &= (_samples & (1 << i)) ? _count[i] : ~_count[i];
+				}
+
+				_state ^= toggled;
+				for(uint8_t i = 0; i < CounterBits; i++) {
+					_count[i] &= ~toggled;
+				}
+
+				return toggled;
+			}
+
+			/** Returns the debounced state of all inputs (bit n = input n) */
+			uint32_t state(void) const {
+				return _state;
+			}
+
+		protected:
+
+			uint32_t _state;					/** Debounced state of each input */
+			uint32_t _count[CounterBits];		/** Counter bit planes, _count[0] is the LSB */
+			uint8_t _samples;					/** Consecutive samples required to accept a change */
+
+	};
+}
+
+#endif /* DRIVERS_VERTICALCOUNTERDEBOUNCER_H_ */
@@ -21,123 +21,166 @@
  */
 
 #include "EasyScale.h"
+#include "platform/mbed_critical.h"
 #include "platform/mbed_wait_api.h"
 
-/**
- * EasyScale max frequency: 100kHz
- * (Logic 0: t_low >= 2 * t_high)
- * (Logic 1: t_high >= 2 * t_low)
- *
- * These delays set it to ~83kHz
- */
-#define EASYSCALE_LONG_DELAY_US 40
-#define EASYSCALE_SHORT_DELAY_US 10
-
 uint8_t EasyScale::DEVICE_ADDRESS_TPS61158 = 0x58;
 uint8_t EasyScale::DEVICE_ADDRESS_TPS61165 = 0x72;
 
 EasyScale::EasyScale(PinName ctrl_pin) :
-							es_ctrl_pin(ctrl_pin, PIN_OUTPUT, PullNone, 0)
+							es_ctrl_pin(ctrl_pin, PIN_OUTPUT, PullNone, 0),
+							_step_count(0), _step_index(0), _ack(false), _busy(false)
 {
 }
 
-void EasyScale::power_on(void)
+bool EasyScale::power_on(void)
 {
-
-	/**
-	 * 1. Pull CTRL pin high to enable the TPS61158 and to start
-	 * 	the 1-wire detection window.
-	 *
-	 * 2. After the EasyScale detect delay (tes_delay, 100us) expires, drive CTRL
-	 * 	low for more than the EasyScale detection time (tes_detect, 450 us)
-	 *
-	 * 3. The CTRL pin has to be low for more than EasyScale detection time
-	 * 	before the EasyScale detection window (tes_win, 3.5ms) expires.
-	 * 	EasyScale detection window starts from the first
-	 * 	CTRL pin low-to-high transition
-	 */
-	es_ctrl_pin.write(1);
-	wait_us(150);
-	es_ctrl_pin.write(0);
-	wait_us(500);
-	es_ctrl_pin.write(1);
-	wait_us(10);
+	if(!claim())
+		return false;
+
+	easyscale_step_t steps[EasyScaleWaveform::PowerOnSteps];
+	size_t count = EasyScaleWaveform::build_power_on(steps);
+	play_blocking(steps, count);
+	_busy = false;
+	return true;
 }
 
-void EasyScale::shutdown(void)
+bool EasyScale::shutdown(void)
 {
+	if(!claim())
+		return false;
+
 	es_ctrl_pin.write(0);
+	_busy = false;
+	return true;
 }
 
 bool EasyScale::set_brightness(uint8_t brightness, uint8_t addr)
 {
+	if(!claim())
+		return false;
+
+	easyscale_step_t steps[EasyScaleWaveform::FrameSteps];
+	size_t count = EasyScaleWaveform::build_frame(addr, brightness,
+			EasyScaleWaveform::fast_timing(), steps);
+	bool ack = play_blocking(steps, count);
+	_busy = false;
+	return ack;
+}
 
-	// Mask input data (only 5 LSB are valid)
-	// Also sets both register address bits (5, 6) to 0
-	brightness &= 0x1F;
-	// Add request for acknowledge bit (RFA, bit 7)
-	brightness |= 0x80;
-
-	// Write device address to bus
-	write_byte(addr);
-
-	// Send End of Stream (EOS)
-	es_ctrl_pin.write(0);
-	wait_us(5);
-
-	// Send Start
-	es_ctrl_pin.write(1);
-	wait_us(5);
+bool EasyScale::power_on_async(mbed::Callback<void(bool)> done)
+{
+	if(!claim())
+		return false;
 
-	// Write data to bus
-	write_byte(brightness);
+	size_t count = EasyScaleWaveform::build_power_on(_steps);
+	_ack = true;
+	return start_async(count, done);
+}
 
-	// Send End of Stream (EOS)
-	es_ctrl_pin.write(0);
-	wait_us(5);
+bool EasyScale::set_brightness_async(uint8_t brightness, uint8_t addr,
+		mbed::Callback<void(bool)> done)
+{
+	if(!claim())
+		return false;
 
-	// Check the acknowledge bit (active low output)
-	es_ctrl_pin.input();
-	es_ctrl_pin.mode(PullUp);
-	wait_us(10);
-	bool ack = !es_ctrl_pin.read();
+	size_t count = EasyScaleWaveform::build_frame(addr, brightness,
+			EasyScaleWaveform::slow_timing(), _steps);
+	_ack = false;
+	return start_async(count, done);
+}
 
-	// Wait for ACK condition to go away to avoid driving the slave's output
-	wait_us(900);
-	// Set the pin back to an output and idle the bus
-	es_ctrl_pin.output();
-	//es_ctrl_pin.mode(PullNone);
-	es_ctrl_pin.write(1);
+bool EasyScale::abort(void)
+{
+	bool aborted = false;
+	core_util_critical_section_enter();
+	// Only asynchronous transfers set _step_count, it is cleared when they end
+	if(_busy && _step_count)
+	{
+		_timeout.detach();
+		_step_count = 0;
+		_done_cb = NULL;
+		es_ctrl_pin.output();
+		es_ctrl_pin.write(1);
+		_busy = false;
+		aborted = true;
+	}
+	core_util_critical_section_exit();
+	return aborted;
+}
 
-	return ack;
+bool EasyScale::claim(void)
+{
+	core_util_critical_section_enter();
+	bool was_busy = _busy;
+	_busy = true;
+	core_util_critical_section_exit();
+	return !was_busy;
+}
 
+bool EasyScale::play_blocking(const easyscale_step_t* steps, size_t count)
+{
+	_ack = false;
+	for(size_t i = 0; i < count; i++)
+	{
+		apply_step(steps[i]);
+		if(steps[i].duration_us)
+			wait_us(steps[i].duration_us);
+	}
+	return _ack;
 }
 
-void EasyScale::write_byte(uint8_t data_byte)
+void EasyScale::apply_step(const easyscale_step_t& step)
 {
-	// Shift out MSB first
-	for(int i = 7; i >= 0; i--)
+	switch(step.action)
 	{
-		// If the bit is set, send a high
-		if((data_byte & (0x01 << i)))
-			send_high();
-		else
-			send_low();
+		case easyscale_step_t::DRIVE_LOW:
+			es_ctrl_pin.write(0);
+			break;
+
+		case easyscale_step_t::DRIVE_HIGH:
+			// Set the pin back to an output if it was released for the ACK
+			es_ctrl_pin.output();
+			es_ctrl_pin.write(1);
+			break;
+
+		case easyscale_step_t::RELEASE:
+			es_ctrl_pin.input();
+			es_ctrl_pin.mode(PullUp);
+			break;
+
+		case easyscale_step_t::SAMPLE_ACK:
+			// The acknowledge bit is an active low output
+			_ack = !es_ctrl_pin.read();
+			break;
 	}
 }
 
-void EasyScale::send_low(void)
+bool EasyScale::start_async(size_t count, mbed::Callback<void(bool)> done)
 {
-	es_ctrl_pin.write(0);
-	wait_us(EASYSCALE_LONG_DELAY_US);
-	es_ctrl_pin.write(1);
-	wait_us(EASYSCALE_SHORT_DELAY_US);
+	_done_cb = done;
+	_step_count = count;
+	_step_index = 0;
+	async_step();
+	return true;
 }
 
-void EasyScale::send_high(void)
+void EasyScale::async_step(void)
 {
-	es_ctrl_pin.write(0);
-	wait_us(EASYSCALE_SHORT_DELAY_US);
-	es_ctrl_pin.write(1);
-	wait_us(EASYSCALE_LONG_DELAY_US);
+	// Run steps until one needs a hold time
+	while(_step_index < _step_count)
+	{
+		const easyscale_step_t& step = _steps[_step_index++];
+		apply_step(step);
+		if(step.duration_us)
+		{
+			_timeout.attach_us(mbed::callback(this, &EasyScale::async_step), step.duration_us);
+			return;
+		}
+	}
+
+	_step_count = 0;
+	_busy = false;
+	if(_done_cb)
+		_done_cb(_ack);
 }
@@ -0,0 +1,237 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "EasyScaleFader.h"
+
+#include "platform/mbed_critical.h"
+#include "rtos/Kernel.h"
+
+EasyScaleFader::EasyScaleFader(EasyScale& easyscale, events::EventQueue& queue,
+		uint8_t addr, uint8_t initial_level) :
+							_easyscale(easyscale), _queue(queue), _addr(addr),
+							_req_target(initial_level), _req_duration_ms(0), _req_easing(EASE_LINEAR),
+							_req_posted(false), _request_id(0), _start_level(initial_level), _target(initial_level),
+							_start_ms(0), _duration_ms(0), _easing(EASE_LINEAR), _timer_id(0),
+							_level(initial_level), _fading(false), _sending(false), _frame_done_id(0), _nack_count(0)
+{
+}
+
+EasyScaleFader::~EasyScaleFader()
+{
+	// Stop our frame first so on_frame_done() can't post anything afterwards
+	if(_sending)
+		_easyscale.abort();
+
+	if(_timer_id)
+		_queue.cancel(_timer_id);
+	if(_request_id)
+		_queue.cancel(_request_id);
+	if(_frame_done_id)
+		_queue.cancel(_frame_done_id);
+}
+
+void EasyScaleFader::fade_to(uint8_t target, std::chrono::milliseconds duration, easing_t easing)
+{
+	if(target > MaxLevel)
+		target = MaxLevel;
+
+	bool post;
+	core_util_critical_section_enter();
+	_req_target = target;
+	_req_duration_ms = duration.count();
+	_req_easing = easing;
+	post = !_req_posted;
+	_req_posted = true;
+	core_util_critical_section_exit();
+
+	// Only one event is ever queued, later requests just overwrite the pending one
+	if(post)
+	{
+		int id = _queue.call(this, &EasyScaleFader::process_request);
+		core_util_critical_section_enter();
+		_request_id = id;
+		// The queue is full, let the next request try again
+		if(!id)
+			_req_posted = false;
+		core_util_critical_section_exit();
+	}
+}
+
+uint8_t EasyScaleFader::level_at(uint8_t start, uint8_t target, uint32_t elapsed_ms,
+		uint32_t duration_ms, easing_t easing)
+{
+	if(elapsed_ms >= duration_ms)
+		return target;
+
+	// Progress and eased progress in Q16
+	uint32_t p = (uint32_t)(((uint64_t) elapsed_ms << 16) / duration_ms);
+	uint32_t e;
+	switch(easing)
+	{
+		case EASE_IN:
+			e = (p * (uint64_t) p) >> 16;
+			break;
+
+		case EASE_OUT:
+			e = 65536 - ((((65536 - p) * (uint64_t)(65536 - p))) >> 16);
+			break;
+
+		case EASE_IN_OUT:
+			if(p < 32768)
+				e = (p * (uint64_t) p) >> 15;
+			else
+				e = 65536 - ((((65536 - p) * (uint64_t)(65536 - p))) >> 15);
+			break;
+
+		case EASE_LINEAR:
+		default:
+			e = p;
+			break;
+	}
+
+	// Round the magnitude so fading down never overshoots the target
+	if(target >= start)
+		return (uint8_t)(start + (((uint64_t)(target - start) * e + 32768) >> 16));
+	else
+		return (uint8_t)(start - (((uint64_t)(start - target) * e + 32768) >> 16));
+}
+
+uint32_t EasyScaleFader::next_change_ms(uint32_t elapsed_ms, uint8_t level) const
+{
+	// The eased level is monotonic, so binary search for the first time it differs
+	uint32_t lo = elapsed_ms;
+	uint32_t hi = _duration_ms;
+	while(lo + 1 < hi)
+	{
+		uint32_t mid = lo + ((hi - lo) / 2);
+		if(level_at(_start_level, _target, mid, _duration_ms, _easing) != level)
+			hi = mid;
+		else
+			lo = mid;
+	}
+	return hi;
+}
+
+void EasyScaleFader::process_request(void)
+{
+	core_util_critical_section_enter();
+	_target = _req_target;
+	_duration_ms = _req_duration_ms;
+	_easing = _req_easing;
+	_req_posted = false;
+	_request_id = 0;
+	core_util_critical_section_exit();
+
+	// Continue from wherever the previous fade got to
+	_start_level = _level;
+	_start_ms = now_ms();
+	_fading = true;
+	service();
+}
+
+void EasyScaleFader::service(void)
+{
+	if(_timer_id)
+	{
+		_queue.cancel(_timer_id);
+		_timer_id = 0;
+	}
+
+	if(!_fading)
+		return;
+
+	// Our frame is in flight, on_frame_done() will come back here
+	if(_sending)
+		return;
+
+	// The bus is taken by a transfer that isn't ours (eg: power_on_async()),
+	// nothing will call back when it's done so check again later
+	if(_easyscale.is_busy())
+	{
+		retry();
+		return;
+	}
+
+	uint32_t elapsed = now_ms() - _start_ms;
+	uint8_t level = level_at(_start_level, _target, elapsed, _duration_ms, _easing);
+
+	if(level != _level)
+	{
+		// Only consider the level sent once the frame has actually started
+		_sending = true;
+		if(_easyscale.set_brightness_async(level, _addr,
+				mbed::callback(this, &EasyScaleFader::on_frame_done)))
+		{
+			_level = level;
+		}
+		else
+		{
+			_sending = false;
+			retry();
+		}
+		return;
+	}
+
+	if(elapsed >= _duration_ms)
+	{
+		_fading = false;
+		return;
+	}
+
+	uint32_t next = next_change_ms(elapsed, level);
+	_timer_id = _queue.call_in(std::chrono::milliseconds(next - elapsed),
+			this, &EasyScaleFader::on_timer);
+}
+
+void EasyScaleFader::retry(void)
+{
+	_timer_id = _queue.call_in(std::chrono::milliseconds(EASYSCALE_FADER_RETRY_MS),
+			this, &EasyScaleFader::on_timer);
+}
+
+void EasyScaleFader::on_timer(void)
+{
+	_timer_id = 0;
+	service();
+}
+
+void EasyScaleFader::on_frame_done(bool ack)
+{
+	if(!ack)
+		_nack_count++;
+
+	_sending = false;
+	_frame_done_id = _queue.call(this, &EasyScaleFader::after_frame);
+}
+
+void EasyScaleFader::after_frame(void)
+{
+	_frame_done_id = 0;
+	service();
+}
+
+uint32_t EasyScaleFader::now_ms(void)
+{
+	return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+			rtos::Kernel::Clock::now().time_since_epoch()).count();
+}
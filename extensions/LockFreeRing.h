@@ -0,0 +1,131 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef EP_OC_MCU_EXTENSIONS_LOCKFREERING_H_
+#define EP_OC_MCU_EXTENSIONS_LOCKFREERING_H_
+
+#include "platform/Span.h"
+#include "platform/NonCopyable.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_atomic.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ep {
+
+/**
+ * Single-producer, single-consumer lock-free ring buffer
+ *
+ * The ring does not allocate; it is constructed over application-provided
+ * storage whose size must be a power of two. One context (typically an ISR)
+ * may push while another (typically a thread) pops without a critical section.
+ *
+ * Example:
+ * @code
+ * static ep::edge_event_t event_storage[16];
+ * ep::LockFreeRing<ep::edge_event_t> events(event_storage);
+ * @endcode
+ *
+ * @note Only one context may push and only one context may pop. Producers that
+ * share a ring must not preempt each other (eg: all ticker callbacks)
+ */
+template<typename T>
+class LockFreeRing : private mbed::NonCopyable<LockFreeRing<T> > {
+public:
+
+    /**
+     * Construct a ring over the given storage
+     * @param[in] storage Element storage, size must be a non-zero power of two
+     */
+    LockFreeRing(mbed::Span<T> storage) : _buffer(storage.data()),
+            _mask(storage.size() - 1), _head(0), _tail(0), _dropped(0) {
+        MBED_ASSERT((storage.size() > 0) && ((storage.size() & (storage.size() - 1)) == 0));
+    }
+
+    /**
+     * Push an element (producer context only)
+     * @param[in] item Element to copy into the ring
+     * @retval true if the element was queued, false if the ring was full (the element is dropped)
+     */
+    bool push(const T& item) {
+        uint32_t head = _head;
+        if((head - core_util_atomic_load_u32(&_tail)) > _mask) {
+            _dropped++;
+            return false;
+        }
+        _buffer[head & _mask] = item;
+        core_util_atomic_store_u32(&_head, head + 1);
+        return true;
+    }
+
+    /**
+     * Pop the oldest element (consumer context only)
+     * @param[out] item Destination of the popped element
+     * @retval true if an element was popped, false if the ring was empty
+     */
+    bool pop(T& item) {
+        uint32_t tail = _tail;
+        if(tail == core_util_atomic_load_u32(&_head)) {
+            return false;
+        }
+        item = _buffer[tail & _mask];
+        core_util_atomic_store_u32(&_tail, tail + 1);
+        return true;
+    }
+
+    /** Returns true if there is nothing to pop */
+    bool empty(void) const {
+        return core_util_atomic_load_u32(&_head) == core_util_atomic_load_u32(&_tail);
+    }
+
+    /** Returns the number of queued elements */
+    size_t size(void) const {
+        return core_util_atomic_load_u32(&_head) - core_util_atomic_load_u32(&_tail);
+    }
+
+    /** Returns the maximum number of queued elements */
+    size_t capacity(void) const {
+        return _mask + 1;
+    }
+
+    /** Returns the number of elements dropped because the ring was full */
+    uint32_t dropped(void) const {
+        return core_util_atomic_load_u32(&_dropped);
+    }
+
+protected:
+
+    T* _buffer;
+    const uint32_t _mask;
+
+    /** Free-running indices, only the producer writes _head and only the consumer writes _tail */
+    volatile uint32_t _head;
+    volatile uint32_t _tail;
+
+    volatile uint32_t _dropped;
+
+};
+
+}
+
+#endif /* EP_OC_MCU_EXTENSIONS_LOCKFREERING_H_ */
@@ -0,0 +1,227 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef EP_OC_MCU_EXTENSIONS_DSP_FIXEDPOINT_H_
+#define EP_OC_MCU_EXTENSIONS_DSP_FIXEDPOINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ep {
+
+/**
+ * Signed Q-format fixed point number: a 32-bit integer with FRAC fractional bits
+ *
+ * Range is +/-2^(31 - FRAC) with a resolution of 2^-FRAC. Products are
+ * computed in 64 bits and truncated; nothing saturates, so FRAC must leave
+ * headroom for the largest intermediate value of the computation.
+ *
+ * Conversions from float are meant for constants computed once, the
+ * arithmetic itself only uses integer instructions.
+ *
+ * Example:
+ * @code
+ * typedef ep::Fixed<24> q24_t;
+ * q24_t dt = q24_t::from_float(0.005f);
+ * q24_t angle = rate * dt;
+ * @endcode
+ */
+template<int FRAC>
+struct Fixed {
+
+    static_assert((FRAC > 0) && (FRAC < 31), "FRAC must leave an integer and a sign bit");
+
+    static const int FRACTIONAL_BITS = FRAC;
+
+    int32_t raw;
+
+    Fixed() : raw(0) { }
+
+    static Fixed from_raw(int32_t value) {
+        Fixed f;
+        f.raw = value;
+        return f;
+    }
+
+    static Fixed from_int(int32_t value) {
+        return from_raw(value * (1 << FRAC));
+    }
+
+    static Fixed from_float(float value) {
+        float scaled = value * (float)(1 << FRAC);
+        return from_raw((int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f));
+    }
+
+    /** Value of a Q15 integer (eg: a raw 16-bit sensor reading over its full scale) */
+    static Fixed from_q15(int16_t value) {
+        return (FRAC >= 15) ? from_raw((int32_t) value * (1 << (FRAC - 15)))
+                            : from_raw(value >> (15 - FRAC));
+    }
+
+    float to_float() const {
+        return (float) raw / (float)(1 << FRAC);
+    }
+
+    Fixed operator-() const { return from_raw(-raw); }
+
+    Fixed operator+(Fixed other) const { return from_raw(raw + other.raw); }
+    Fixed operator-(Fixed other) const { return from_raw(raw - other.raw); }
+    Fixed operator*(Fixed other) const {
+        return from_raw((int32_t)(((int64_t) raw * other.raw) >> FRAC));
+    }
+
+    /** Multiplication by an integer is exact, eg: x * 2 */
+    Fixed operator*(int32_t other) const { return from_raw(raw * other); }
+
+    Fixed& operator+=(Fixed other) { raw += other.raw; return *this; }
+    Fixed& operator-=(Fixed other) { raw -= other.raw; return *this; }
+    Fixed& operator*=(Fixed other) { *this = *this * other; return *this; }
+
+    bool operator==(Fixed other) const { return raw == other.raw; }
+    bool operator!=(Fixed other) const { return raw != other.raw; }
+    bool operator<(Fixed other) const { return raw < other.raw; }
+    bool operator>(Fixed other) const { return raw > other.raw; }
+};
+
+namespace detail {
+
+/**
+ * 1/sqrt(x) as y * 2^exponent, with y in [1, 2] as Q30, for x > 0 with
+ * frac fractional bits
+ *
+ * Integer only: x is normalized to [0.25, 1) and refined with four Newton
+ * iterations from a linear estimate.
+ */
+inline uint32_t inv_sqrt_q30(uint64_t x, int frac, int* exponent)
+{
+    // Even shift so that m = x * 4^(shift / 2) has its MSb in bit 62 or 63
+    int shift = 0;
+    while ((x << shift) < ((uint64_t) 1 << 62)) {
+        shift += 2;
+    }
+    uint64_t m = (x << shift) >> 32;    // Q32, in [0.25, 1)
+
+    // From y0 = 2.2 - 1.2 m (error < 15%)
+    uint64_t y = 2362232013u - ((m * 1288490189u) >> 32);
+    for (int i = 0; i < 4; i++) {
+        uint64_t y2 = (y * y) >> 30;                // Q30
+        uint64_t t = (m * y2) >> 32;                // Q30, m * y^2
+        y = (y * (((uint64_t) 3 << 30) - t)) >> 31; // y * (3 - m y^2) / 2
+    }
+
+    // x is m * 2^(64 - shift - frac)
+    *exponent = (frac + shift - 64) / 2;
+    return (uint32_t) y;
+}
+
+/** value * y * 2^shift, y being Q30, rounded */
+inline int32_t scale_q30(int32_t value, uint32_t y, int shift)
+{
+    int64_t product = (int64_t) value * y;
+    shift -= 30;
+    if (shift >= 0) {
+        return (int32_t)(product << shift);
+    }
+    if (shift < -62) {
+        return 0;
+    }
+    return (int32_t)((product + ((int64_t) 1 << (-shift - 1))) >> -shift);
+}
+
+}
+
+/**
+ * 1/sqrt(x) for an unsigned value with 2 * FRAC fractional bits (eg: a sum
+ * of squares of Fixed<FRAC> raw values), as Fixed<FRAC>
+ *
+ * Integer only. Saturates for results out of range, returns 0 for 0.
+ */
+template<int FRAC>
+Fixed<FRAC> fixed_inv_sqrt(uint64_t x)
+{
+    if (x == 0) {
+        return Fixed<FRAC>();
+    }
+
+    int exponent;
+    uint32_t y = detail::inv_sqrt_q30(x, 2 * FRAC, &exponent);
+
+    // Result in Q(FRAC): y * 2^(exponent + FRAC - 30), y being at least 2^30
+    int shift = exponent + FRAC;
+    if (shift >= 30) {
+        return Fixed<FRAC>::from_raw((shift > 30 || y > INT32_MAX) ? INT32_MAX : (int32_t) y);
+    }
+    return Fixed<FRAC>::from_raw(detail::scale_q30(1, y, shift));
+}
+
+/**
+ * sqrt(x) for an unsigned value with 2 * FRAC fractional bits, as Fixed<FRAC>
+ *
+ * Exact (truncated) integer square root. Saturates for results out of range.
+ */
+template<int FRAC>
+Fixed<FRAC> fixed_sqrt(uint64_t x)
+{
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= result + bit) {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return Fixed<FRAC>::from_raw(result > INT32_MAX ? INT32_MAX : (int32_t) result);
+}
+
+/**
+ * Scales v[0..n) to unit length, leaves it unchanged if it is zero
+ *
+ * Works for vectors of any length, the scale factor is never formed.
+ */
+template<int FRAC>
+void normalize(Fixed<FRAC>* v, size_t n)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += (uint64_t)((int64_t) v[i].raw * v[i].raw);
+    }
+    if (sum == 0) {
+        return;
+    }
+
+    // The sum has 2 * FRAC fractional bits, v[i] / |v| keeps FRAC
+    int exponent;
+    uint32_t y = detail::inv_sqrt_q30(sum, 2 * FRAC, &exponent);
+    for (size_t i = 0; i < n; i++) {
+        v[i].raw = detail::scale_q30(v[i].raw, y, exponent);
+    }
+}
+
+}
+
+#endif /* EP_OC_MCU_EXTENSIONS_DSP_FIXEDPOINT_H_ */
@@ -0,0 +1,366 @@
+/**
+ * ep-oc-mcu
+ * Embedded Planet Open Core for Microcontrollers
+ *
+ * Built with ARM Mbed-OS
+ *
+ * Copyright (c) 2020 Embedded Planet, Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef EP_OC_MCU_EXTENSIONS_DSP_MADGWICKFILTER_H_
+#define EP_OC_MCU_EXTENSIONS_DSP_MADGWICKFILTER_H_
+
+// Note: Does NOT require CMSIS DSP library
+
+#include "FixedPoint.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ep {
+
+namespace detail {
+
+/**
+ * Arithmetic the filter needs beyond + - *, for each number type
+ */
+template<typename T>
+struct MadgwickMath;
+
+template<>
+struct MadgwickMath<float> {
+
+    static float from_float(float value) { return value; }
+
+    static float to_float(float value) { return value; }
+
+    /** Raw reading, only its direction matters */
+    static float from_raw(int16_t value) { return (float) value; }
+
+    static float scale(float factor, int16_t value) { return factor * (float) value; }
+
+    static float hypot(float a, float b) { return sqrtf(a * a + b * b); }
+
+    static void normalize(float* v, size_t n) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < n; i++) {
+            sum += v[i] * v[i];
+        }
+        if (sum == 0.0f) {
+            return;
+        }
+        float inv = 1.0f / sqrtf(sum);
+        for (size_t i = 0; i < n; i++) {
+            v[i] *= inv;
+        }
+    }
+};
+
+template<int FRAC>
+struct MadgwickMath<Fixed<FRAC> > {
+
+    typedef Fixed<FRAC> T;
+
+    static T from_float(float value) { return T::from_float(value); }
+
+    static float to_float(T value) { return value.to_float(); }
+
+    static T from_raw(int16_t value) { return T::from_q15(value); }
+
+    static T scale(T factor, int16_t value) { return factor * (int32_t) value; }
+
+    static T hypot(T a, T b) {
+        return fixed_sqrt<FRAC>((uint64_t)((int64_t) a.raw * a.raw) + (uint64_t)((int64_t) b.raw * b.raw));
+    }
+
+    static void normalize(T* v, size_t n) { ep::normalize(v, n); }
+};
+
+}
+
+/**
+ * Madgwick gradient descent orientation filter
+ *
+ * Fuses raw gyroscope, accelerometer and (optionally) magnetometer readings
+ * into an orientation quaternion, following Madgwick's reference IMU and
+ * MARG algorithms. The quaternion gives the orientation of the earth frame
+ * relative to the sensor frame, with gravity along +Z.
+ *
+ * T is either float or an ep::Fixed type. The fixed point version only
+ * uses integer instructions in update(): ep::Fixed<24> (Q24, range +/-128)
+ * leaves room for 2000 dps gyro rates and the gradient terms, and is the
+ * better choice on cores without an FPU. On an FPU the float version
+ * uses single precision throughout.
+ *
+ * Accelerometer and magnetometer readings are only used for their direction,
+ * so any per-axis consistent raw units work, but the three sensors must use
+ * the same axes. On the LSM9DS1 for instance, the magnetometer X and Y axes
+ * are those of the accel/gyro negated and swapped: pass (-my, -mx, mz).
+ *
+ * Example:
+ * @code
+ * // LSM9DS1 at 2000 dps, 238 Hz
+ * ep::MadgwickFilter<ep::Fixed<24> > fusion(0.07f * 3.14159265f / 180.0f, 1.0f / 238.0f);
+ *
+ * int n = imu.readFIFOStream(samples, LSM9DS1_FIFO_DEPTH, now_us);
+ * if (n > 0) {
+ *     fusion.update_batch(&samples[0].gx, &samples[0].ax, n, sizeof(samples[0]));
+ * }
+ * @endcode
+ */
+template<typename T>
+class MadgwickFilter {
+
+    typedef detail::MadgwickMath<T> Math;
+
+public:
+
+    /**
+     * @param[in] gyro_scale Gyroscope resolution, in rad/s per LSB
+     * @param[in] sample_period Time between updates, in seconds
+     * @param[in] beta Filter gain, higher trusts the accelerometer and
+     * magnetometer more and converges faster, but lets more of their noise through
+     */
+    MadgwickFilter(float gyro_scale, float sample_period, float beta = 0.1f) :
+        _gyro_scale(Math::from_float(gyro_scale)),
+        _period(Math::from_float(sample_period)),
+        _beta(Math::from_float(beta))
+    {
+        reset();
+    }
+
+    /** Returns to the identity orientation */
+    void reset()
+    {
+        _q[0] = Math::from_float(1.0f);
+        _q[1] = _q[2] = _q[3] = T();
+    }
+
+    void set_gyro_scale(float gyro_scale) { _gyro_scale = Math::from_float(gyro_scale); }
+
+    void set_sample_period(float sample_period) { _period = Math::from_float(sample_period); }
+
+    void set_beta(float beta) { _beta = Math::from_float(beta); }
+
+    /**
+     * Integrates one gyroscope and accelerometer reading
+     *
+     * An all zero accelerometer reading is ignored (gyro only update).
+     *
+     * @param[in] gyro Raw X, Y, Z angular rate
+     * @param[in] accel Raw X, Y, Z acceleration
+     */
+    void update(const int16_t gyro[3], const int16_t accel[3])
+    {
+        T g[3];
+        for (int i = 0; i < 3; i++) {
+            g[i] = Math::scale(_gyro_scale, gyro[i]);
+        }
+
+        T q0 = _q[0], q1 = _q[1], q2 = _q[2], q3 = _q[3];
+
+        // Rate of change of quaternion from gyroscope, times 2
+        T q_dot[4];
+        q_dot[0] = -q1 * g[0] - q2 * g[1] - q3 * g[2];
+        q_dot[1] = q0 * g[0] + q2 * g[2] - q3 * g[1];
+        q_dot[2] = q0 * g[1] - q1 * g[2] + q3 * g[0];
+        q_dot[3] = q0 * g[2] + q1 * g[1] - q2 * g[0];
+
+        if (accel[0] != 0 || accel[1] != 0 || accel[2] != 0) {
+            T a[3] = { Math::from_raw(accel[0]), Math::from_raw(accel[1]), Math::from_raw(accel[2]) };
+            Math::normalize(a, 3);
+
+            T q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+            T one = Math::from_float(1.0f);
+
+            // Gradient of the gravity objective function, halved since only
+            // its direction is used
+            T s[4];
+            s[0] = q0 * (q2q2 + q1q1) * 2 + q2 * a[0] - q1 * a[1];
+            s[1] = q1 * (q3q3 + q0q0 - one + a[2]) * 2 - q3 * a[0] - q0 * a[1] + q1 * (q1q1 + q2q2) * 4;
+            s[2] = q2 * (q0q0 + q3q3 - one + a[2]) * 2 + q0 * a[0] - q3 * a[1] + q2 * (q1q1 + q2q2) * 4;
+            s[3] = q3 * (q1q1 + q2q2) * 2 - q1 * a[0] - q2 * a[1];
+            Math::normalize(s, 4);
+
+            for (int i = 0; i < 4; i++) {
+                q_dot[i] -= _beta * s[i] * 2;
+            }
+        }
+
+        integrate(q_dot);
+    }
+
+    /**
+     * Integrates one gyroscope, accelerometer and magnetometer reading
+     *
+     * Falls back to the IMU update if the magnetometer reading is all zero.
+     * An all zero accelerometer reading is ignored (gyro only update).
+     *
+     * @param[in] gyro Raw X, Y, Z angular rate
+     * @param[in] accel Raw X, Y, Z acceleration
+     * @param[in] mag Raw X, Y, Z magnetic field, on the gyro/accel axes
+     */
+    void update(const int16_t gyro[3], const int16_t accel[3], const int16_t mag[3])
+    {
+        if (mag[0] == 0 && mag[1] == 0 && mag[2] == 0) {
+            update(gyro, accel);
+            return;
+        }
+
+        T g[3];
+        for (int i = 0; i < 3; i++) {
+            g[i] = Math::scale(_gyro_scale, gyro[i]);
+        }
+
+        T q0 = _q[0], q1 = _q[1], q2 = _q[2], q3 = _q[3];
+
+        T q_dot[4];
+        q_dot[0] = -q1 * g[0] - q2 * g[1] - q3 * g[2];
+        q_dot[1] = q0 * g[0] + q2 * g[2] - q3 * g[1];
+        q_dot[2] = q0 * g[1] - q1 * g[2] + q3 * g[0];
+        q_dot[3] = q0 * g[2] + q1 * g[1] - q2 * g[0];
+
+        if (accel[0] != 0 || accel[1] != 0 || accel[2] != 0) {
+            T a[3] = { Math::from_raw(accel[0]), Math::from_raw(accel[1]), Math::from_raw(accel[2]) };
+            T m[3] = { Math::from_raw(mag[0]), Math::from_raw(mag[1]), Math::from_raw(mag[2]) };
+            Math::normalize(a, 3);
+            Math::normalize(m, 3);
+
+            T q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+            T q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+            T q2q2 = q2 * q2, q2q3 = q2 * q3;
+            T q3q3 = q3 * q3;
+            T half = Math::from_float(0.5f);
+            T one = Math::from_float(1.0f);
+
+            // Earth frame magnetic field h, and its reference direction b =
+            // (|hx, hy|, 0, hz). bx2 and bz2 are 2 * bx and 2 * bz, like in the
+            // paper (the reference C code leaves bx and bz unscaled)
+            T hx = (m[0] * (half - q2q2 - q3q3) + m[1] * (q1q2 - q0q3) + m[2] * (q1q3 + q0q2)) * 2;
+            T hy = (m[0] * (q1q2 + q0q3) + m[1] * (half - q1q1 - q3q3) + m[2] * (q2q3 - q0q1)) * 2;
+            T bx2 = Math::hypot(hx, hy) * 2;
+            T bz2 = (m[0] * (q1q3 - q0q2) + m[1] * (q2q3 + q0q1) + m[2] * (half - q1q1 - q2q2)) * 4;
+
+            // Objective function: gravity and magnetic field errors
+            T fa0 = (q1q3 - q0q2) * 2 - a[0];
+            T fa1 = (q0q1 + q2q3) * 2 - a[1];
+            T fa2 = one - (q1q1 + q2q2) * 2 - a[2];
+            T fm0 = bx2 * (half - q2q2 - q3q3) + bz2 * (q1q3 - q0q2) - m[0];
+            T fm1 = bx2 * (q1q2 - q0q3) + bz2 * (q0q1 + q2q3) - m[1];
+            T fm2 = bx2 * (q0q2 + q1q3) + bz2 * (half - q1q1 - q2q2) - m[2];
+
+            // Gradient: Jacobian transposed times objective function
+            T s[4];
+            s[0] = (-q2 * fa0 + q1 * fa1) * 2
+                   - bz2 * q2 * fm0
+                   + (bz2 * q1 - bx2 * q3) * fm1
+                   + bx2 * q2 * fm2;
+            s[1] = (q3 * fa0 + q0 * fa1) * 2 - q1 * fa2 * 4
+                   + bz2 * q3 * fm0
+                   + (bx2 * q2 + bz2 * q0) * fm1
+                   + (bx2 * q3 - bz2 * q1 * 2) * fm2;
+            s[2] = (-q0 * fa0 + q3 * fa1) * 2 - q2 * fa2 * 4
+                   + (-bx2 * q2 * 2 - bz2 * q0) * fm0
+                   + (bx2 * q1 + bz2 * q3) * fm1
+                   + (bx2 * q0 - bz2 * q2 * 2) * fm2;
+            s[3] = (q1 * fa0 + q2 * fa1) * 2
+                   + (-bx2 * q3 * 2 + bz2 * q1) * fm0
+                   + (-bx2 * q0 + bz2 * q2) * fm1
+                   + bx2 * q1 * fm2;
+            Math::normalize(s, 4);
+
+            for (int i = 0; i < 4; i++) {
+                q_dot[i] -= _beta * s[i] * 2;
+            }
+        }
+
+        integrate(q_dot);
+    }
+
+    /**
+     * Integrates count consecutive samples, eg: a FIFO burst
+     *
+     * Samples are read from strided arrays so that driver sample structures
+     * can be passed as they are:
+     * @code
+     * // lsm9ds1_fifo_sample_t
+     * fusion.update_batch(&samples[0].gx, &samples[0].ax, n, sizeof(samples[0]));
+     * // icm20602_sample_t
+     * fusion.update_batch(samples[0].gyro, samples[0].accel, n, sizeof(samples[0]));
+     * @endcode
+     *
+     * @param[in] gyro Raw X, Y, Z angular rate of the first sample
+     * @param[in] accel Raw X, Y, Z acceleration of the first sample
+     * @param[in] count Number of samples
+     * @param[in] stride Distance in bytes between two samples
+     */
+    void update_batch(const int16_t* gyro, const int16_t* accel, size_t count, size_t stride)
+    {
+        const uint8_t* g = reinterpret_cast<const uint8_t*>(gyro);
+        const uint8_t* a = reinterpret_cast<const uint8_t*>(accel);
+        for (size_t i = 0; i < count; i++) {
+            update(reinterpret_cast<const int16_t*>(g), reinterpret_cast<const int16_t*>(a));
+            g += stride;
+            a += stride;
+        }
+    }
+
+    /**
+     * Gets the orientation quaternion
+     * @param[out] q W, X, Y, Z
+     */
+    void get_quaternion(float q[4]) const
+    {
+        for (int i = 0; i < 4; i++) {
+            q[i] = Math::to_float(_q[i]);
+        }
+    }
+
+    /**
+     * Gets the orientation as aerospace (Z-Y-X) Euler angles, in radians
+     */
+    void get_euler(float* roll, float* pitch, float* yaw) const
+    {
+        float q[4];
+        get_quaternion(q);
+        *roll = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]));
+        float sin_pitch = 2.0f * (q[0] * q[2] - q[3] * q[1]);
+        *pitch = asinf(sin_pitch > 1.0f ? 1.0f : (sin_pitch < -1.0f ? -1.0f : sin_pitch));
+        *yaw = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]));
+    }
+
+private:
+
+    /** q += q_dot * period / 2, then renormalizes */
+    void integrate(const T q_dot[4])
+    {
+        T half_period = _period * Math::from_float(0.5f);
+        for (int i = 0; i < 4; i++) {
+            _q[i] += q_dot[i] * half_period;
+        }
+        Math::normalize(_q, 4);
+    }
+
+    T _q[4];
+    T _gyro_scale;
+    T _period;
+    T _beta;
+};
+
+}
+
+#endif /* EP_OC_MCU_EXTENSIONS_DSP_MADGWICKFILTER_H_ */